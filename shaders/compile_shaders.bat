@@ -1,2 +1,4 @@
 @echo off 
-for /r %%i in (*.frag, *.vert) do %VULKAN_SDK%/Bin/glslangValidator.exe -V %%i
\ No newline at end of file
+for /r %%i in (*.frag, *.vert) do %VULKAN_SDK%/Bin/glslangValidator.exe -V %%i
+rem Compute shaders are named after their file, otherwise they would all be written to comp.spv
+for /r %%i in (*.comp) do %VULKAN_SDK%/Bin/glslangValidator.exe -V %%i -o %%~ni.spv
\ No newline at end of file
@@ -1,11 +1,46 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(location = 0) in vec3 position;
+// Packed chunk vertex, see ChunkVertex in vertex.hpp for the bit layout
+layout(location = 0) in uint positionData;
+layout(location = 1) in uint materialData;
+
+layout(push_constant) uniform ChunkPushConstants {
+    mat4 viewProjection;
+} pushConstants;
+
+// Only the origin is read here, the rest of ChunkRecord is for culling
+struct ChunkRecord {
+    vec4 origin;
+    vec4 boundsMinimum;
+    vec4 boundsMaximum;
+    uvec4 drawArguments;
+};
+
+// Indirect draws carry the chunk ID as their first instance
+layout(std430, set = 0, binding = 0) readonly buffer ChunkRecords {
+    ChunkRecord chunks[];
+};
 
 layout(location = 0) out vec3 fragColor;
+// The depth prepass and the main pass must produce the exact same depth
+invariant gl_Position;
+
+const vec3 faceNormals[6] = vec3[](
+    vec3(1.0, 0.0, 0.0), vec3(-1.0, 0.0, 0.0),
+    vec3(0.0, 1.0, 0.0), vec3(0.0, -1.0, 0.0),
+    vec3(0.0, 0.0, 1.0), vec3(0.0, 0.0, -1.0)
+);
+const vec3 lightDirection = vec3(0.4, 0.8, 0.45);
 
 void main() {
-    gl_Position = vec4(position, 1.0);
-    fragColor = vec3(1.0, 1.0, 1.0);
-}
\ No newline at end of file
+    vec3 position = vec3(positionData & 63u, (positionData >> 6u) & 63u, (positionData >> 12u) & 63u);
+    vec3 normal = faceNormals[(positionData >> 18u) & 7u];
+    float ambientOcclusion = float((positionData >> 21u) & 3u) / 3.0;
+    uint material = materialData & 0xFFFFu;
+    gl_Position = pushConstants.viewProjection * vec4(chunks[gl_InstanceIndex].origin.xyz + position, 1.0);
+    // Placeholder coloring until materials have textures, spreads material IDs across hues
+    vec3 albedo = 0.5 + 0.5 * cos(6.28318 * (float(material) * 0.61803 + vec3(0.0, 0.33, 0.67)));
+    float diffuse = 0.35 + 0.65 * max(dot(normal, normalize(lightDirection)), 0.0);
+    fragColor = albedo * diffuse * mix(0.5, 1.0, ambientOcclusion);
+}
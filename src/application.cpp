@@ -3,7 +3,11 @@
 namespace voxelfield {
     Application::Application(const std::string& name) {
         m_Name = name;
+#ifdef _WIN32
         m_Handle = GetModuleHandle(nullptr);
+#else
+        m_Handle = nullptr;
+#endif
     }
 }
 
@@ -0,0 +1,1103 @@
+#include "benchmarks.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "chunk_mesher.hpp"
+#include "chunk_meshing_pipeline.hpp"
+#include "io_service.hpp"
+#include "job_system.hpp"
+#include "logger.hpp"
+#include "mapped_file.hpp"
+#include "memory_arena.hpp"
+#include "region_file.hpp"
+#include "string_util.hpp"
+#include "terrain_generator.hpp"
+#include "tracer.hpp"
+#include "virtual_file_system.hpp"
+#include "world.hpp"
+
+#define BENCHMARK_SEED 1337u
+#define RANDOM_ACCESS_COUNT (1u << 22)
+#define ITERATION_PASSES 64u
+#define MESHING_PASSES 32u
+// Terrain world used for the memory report, in chunks
+#define TERRAIN_WIDTH 32
+#define TERRAIN_HEIGHT 8
+#define MESHING_TERRAIN_WIDTH 4
+#define MESHING_TERRAIN_HEIGHT 2
+#define EMPTY_JOB_COUNT (1u << 18)
+#define EDIT_PASSES 256u
+#define EDITS_PER_SECOND 10000.0
+#define EDITING_SECONDS 2.0
+#define EDITING_FRAME_SECONDS (1.0 / 60.0)
+// Terrain saved and loaded through region files, in chunks
+#define REGION_TERRAIN_WIDTH 16
+#define REGION_TERRAIN_HEIGHT 4
+// Times every chunk is saved again, enough to push the region files through compaction
+#define REGION_RESAVE_PASSES 4u
+// Terrain generated chunk by chunk, in chunks
+#define GENERATION_TERRAIN_WIDTH 8
+#define GENERATION_TERRAIN_HEIGHT 4
+// Records logged between flushes, below the ring capacity so the calls never wait
+#define LOG_BURST_SIZE (LOG_RING_CAPACITY / 2)
+#define LOG_BURST_COUNT 1024u
+// Records each worker logs as fast as it can to overflow its ring
+#define LOG_FLOOD_COUNT (1u << 16)
+#define FORMATTING_CALL_COUNT (1u << 18)
+// Generated assets loaded loose and packed, sizes are spread up to the maximum
+#define ASSET_FILE_COUNT 512u
+#define ASSET_MAX_FILE_SIZE (64u << 10)
+// Small reads at random offsets of one file, about the size of a compressed chunk
+#define IO_BENCHMARK_FILE_SIZE (64u << 20)
+#define IO_BENCHMARK_READ_SIZE 4096u
+#define IO_BENCHMARK_READ_COUNT 16384u
+// Reads submitted with one call, and kept in flight at once, no more than there are registered buffers
+#define IO_BENCHMARK_BATCH_SIZE 16u
+#define IO_BENCHMARK_IN_FLIGHT_COUNT 64u
+// Frames of temporary lists, each list about the size of a frame's draw list
+#define ALLOCATOR_FRAME_COUNT 4096u
+#define ALLOCATOR_LISTS_PER_FRAME 16u
+#define ALLOCATOR_LIST_SIZE 512u
+// Entries added to and removed from a map every frame, out of the ones it holds
+#define ALLOCATOR_MAP_SIZE 1024u
+#define ALLOCATOR_MAP_CHURN 64u
+// Zones opened and closed per pass, few enough that a capture keeps every one of them
+#define TRACE_ZONE_COUNT (TRACE_BUFFER_CAPACITY / 2)
+
+namespace voxelfield::benchmarks {
+    namespace {
+        typedef std::chrono::steady_clock Clock;
+
+        // Block type counts spanning every storage width, from uniform through to direct
+        constexpr uint32 BLOCK_TYPE_COUNTS[] = {1, 2, 16, 256, 4096};
+
+        double GetNanoseconds(const Clock::time_point start, const uint64 operationCount) {
+            return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(operationCount);
+        }
+
+        world::Chunk CreateRandomChunk(const uint32 blockTypeCount, std::mt19937& random) {
+            world::Chunk chunk;
+            std::uniform_int_distribution<uint32> blockDistribution(0, blockTypeCount - 1);
+            for (uint32 blockIndex = 0; blockIndex < CHUNK_VOLUME; blockIndex++)
+                chunk.SetBlock(blockIndex, static_cast<world::BlockId>(blockDistribution(random)));
+            chunk.Compact();
+            return chunk;
+        }
+
+        void RunRandomAccess() {
+            std::mt19937 random(BENCHMARK_SEED);
+            std::uniform_int_distribution<uint32> indexDistribution(0, CHUNK_VOLUME - 1);
+            std::vector<uint32> blockIndices(RANDOM_ACCESS_COUNT);
+            for (uint32& blockIndex : blockIndices) blockIndex = indexDistribution(random);
+            for (const uint32 blockTypeCount : BLOCK_TYPE_COUNTS) {
+                world::Chunk chunk = CreateRandomChunk(blockTypeCount, random);
+                std::uniform_int_distribution<uint32> blockDistribution(0, blockTypeCount - 1);
+                std::vector<world::BlockId> blocks(RANDOM_ACCESS_COUNT);
+                for (world::BlockId& block : blocks) block = static_cast<world::BlockId>(blockDistribution(random));
+
+                uint64 checksum = 0;
+                Clock::time_point start = Clock::now();
+                for (const uint32 blockIndex : blockIndices) checksum += chunk.GetBlock(blockIndex);
+                const double getNanoseconds = GetNanoseconds(start, RANDOM_ACCESS_COUNT);
+                start = Clock::now();
+                for (uint32 accessIndex = 0; accessIndex < RANDOM_ACCESS_COUNT; accessIndex++)
+                    chunk.SetBlock(blockIndices[accessIndex], blocks[accessIndex]);
+                const double setNanoseconds = GetNanoseconds(start, RANDOM_ACCESS_COUNT);
+                logging::Log(logging::LogType::INFORMATION_LOG,
+                             FORMAT("chunk-random-access: {:4} block types, {:2} bits, get {:.2f} ns, set {:.2f} ns (checksum {})"),
+                             blockTypeCount, chunk.GetBitsPerIndex(), getNanoseconds, setNanoseconds, checksum);
+            }
+        }
+
+        void RunIteration() {
+            std::mt19937 random(BENCHMARK_SEED);
+            for (const uint32 blockTypeCount : BLOCK_TYPE_COUNTS) {
+                const world::Chunk chunk = CreateRandomChunk(blockTypeCount, random);
+                uint64 checksum = 0;
+                Clock::time_point start = Clock::now();
+                for (uint32 pass = 0; pass < ITERATION_PASSES; pass++)
+                    chunk.ForEachBlock([&](const uint32 blockIndex, const world::BlockId block) { checksum += block ^ blockIndex; });
+                const double forEachNanoseconds = GetNanoseconds(start, static_cast<uint64>(ITERATION_PASSES) * CHUNK_VOLUME);
+                start = Clock::now();
+                for (uint32 pass = 0; pass < ITERATION_PASSES; pass++)
+                    for (uint32 blockIndex = 0; blockIndex < CHUNK_VOLUME; blockIndex++)
+                        checksum += chunk.GetBlock(blockIndex) ^ blockIndex;
+                const double getNanoseconds = GetNanoseconds(start, static_cast<uint64>(ITERATION_PASSES) * CHUNK_VOLUME);
+                logging::Log(logging::LogType::INFORMATION_LOG,
+                             FORMAT("chunk-iteration: {:4} block types, {:2} bits, for each {:.3f} ns, get {:.3f} ns per block "
+                                    "(checksum {})"), blockTypeCount, chunk.GetBitsPerIndex(), forEachNanoseconds, getNanoseconds, checksum);
+            }
+        }
+
+        /// Returns false when evicting did not bring the world within its budget or kept a chunk further than one it evicted
+        bool RunMemory() {
+            constexpr size_t rawChunkSize = CHUNK_VOLUME * sizeof(world::BlockId);
+            std::mt19937 random(BENCHMARK_SEED);
+            for (const uint32 blockTypeCount : BLOCK_TYPE_COUNTS) {
+                const world::Chunk chunk = CreateRandomChunk(blockTypeCount, random);
+                const size_t chunkSize = sizeof(world::Chunk) + chunk.GetMemoryUsage();
+                logging::Log(logging::LogType::INFORMATION_LOG,
+                             FORMAT("chunk-memory: {:4} block types, {:2} bits, {} bytes per chunk, {:.1f}% of raw"), blockTypeCount,
+                             chunk.GetBitsPerIndex(), chunkSize, 100.0 * chunkSize / rawChunkSize);
+            }
+            // Air chunks above the surface are resident too, as they would be inside a view distance
+            world::World world;
+            world::GenerateTerrain(world, TERRAIN_WIDTH, TERRAIN_HEIGHT, BENCHMARK_SEED);
+            const size_t chunkCount = world.GetChunkCount(), memoryUsage = world.GetMemoryUsage();
+            const size_t chunkSize = memoryUsage / chunkCount, budgetChunkCount = world.GetMemoryBudget() / chunkSize;
+            logging::Log(logging::LogType::INFORMATION_LOG,
+                         FORMAT("chunk-memory: terrain of {} chunks uses {:.1f} MB, {} bytes per chunk against {} raw"), chunkCount,
+                         memoryUsage / (1024.0 * 1024.0), chunkSize, rawChunkSize);
+            // Columns of the terrain height around the player that fit, the view distance is the radius of that square
+            const auto viewDistance = static_cast<uint32>((std::sqrt(static_cast<double>(budgetChunkCount / TERRAIN_HEIGHT)) - 1.0) / 2.0);
+            const auto rawViewDistance = static_cast<uint32>(
+                    (std::sqrt(static_cast<double>(world.GetMemoryBudget() / rawChunkSize / TERRAIN_HEIGHT)) - 1.0) / 2.0);
+            logging::Log(logging::LogType::INFORMATION_LOG,
+                         FORMAT("chunk-memory: {} MB budget holds {} chunks, a view distance of {} chunks against {} raw"),
+                         world.GetMemoryBudget() / (1024 * 1024), budgetChunkCount, viewDistance, rawViewDistance);
+            // A budget of half the terrain around one of its corners evicts the far half
+            world::World boundedWorld(memoryUsage / 2);
+            world::GenerateTerrain(boundedWorld, TERRAIN_WIDTH, TERRAIN_HEIGHT, BENCHMARK_SEED);
+            constexpr world::ChunkPosition center{0, 0, 0};
+            std::vector<world::ChunkPosition> evictedPositions;
+            const Clock::time_point start = Clock::now();
+            const size_t evictedCount = boundedWorld.EvictFurthestChunks(center, evictedPositions);
+            const double evictMilliseconds = GetNanoseconds(start, 1) / 1e6;
+            const auto getDistanceSquared = [&](const world::ChunkPosition& position) {
+                const int64_t x = position.x - center.x, y = position.y - center.y, z = position.z - center.z;
+                return x * x + y * y + z * z;
+            };
+            int64_t nearestEvictedDistanceSquared = INT64_MAX, furthestResidentDistanceSquared = 0;
+            for (const world::ChunkPosition& position : evictedPositions)
+                nearestEvictedDistanceSquared = std::min(nearestEvictedDistanceSquared, getDistanceSquared(position));
+            for (int32 chunkZ = 0; chunkZ < TERRAIN_WIDTH; chunkZ++)
+                for (int32 chunkY = 0; chunkY < TERRAIN_HEIGHT; chunkY++)
+                    for (int32 chunkX = 0; chunkX < TERRAIN_WIDTH; chunkX++) {
+                        const world::ChunkPosition position{chunkX, chunkY, chunkZ};
+                        if (boundedWorld.GetChunk(position))
+                            furthestResidentDistanceSquared = std::max(furthestResidentDistanceSquared, getDistanceSquared(position));
+                    }
+            const size_t residentSize = boundedWorld.GetMemoryUsage();
+            const bool isEvictionCorrect = residentSize <= boundedWorld.GetMemoryBudget() && evictedCount == evictedPositions.size() &&
+                                           furthestResidentDistanceSquared <= nearestEvictedDistanceSquared;
+            logging::Log(isEvictionCorrect ? logging::LogType::INFORMATION_LOG : logging::LogType::ERROR_LOG,
+                         FORMAT("chunk-memory: evicted {} of {} chunks in {:.2f} ms, {:.1f} MB resident against a {:.1f} MB budget, {}"),
+                         evictedCount, chunkCount, evictMilliseconds, residentSize / (1024.0 * 1024.0),
+                         boundedWorld.GetMemoryBudget() / (1024.0 * 1024.0),
+                         isEvictionCorrect ? "furthest first" : "out of order or over budget");
+            return isEvictionCorrect;
+        }
+
+        void LogMeshing(const char* scenario, const Clock::time_point start, const uint64 chunkCount, const rendering::ChunkMesh& mesh) {
+            uint64 quadCount = 0;
+            for (const uint32 sliceQuadCount : mesh.sliceQuadCounts) quadCount += sliceQuadCount;
+            logging::Log(logging::LogType::INFORMATION_LOG,
+                         FORMAT("chunk-meshing: {}, {:.1f} us per chunk with {}, {} quads in the last mesh with room for {}"), scenario,
+                         GetNanoseconds(start, chunkCount) / 1000.0, rendering::ChunkMesher::GetInstructionSet(), quadCount,
+                         mesh.vertices.size() / 4);
+        }
+
+        void RunMeshing() {
+            rendering::ChunkMesher mesher;
+            rendering::ChunkMesh mesh;
+            const rendering::ChunkNeighbours noNeighbours{};
+            // Every chunk of a small terrain, air chunks included as they would be when streaming in a view distance
+            world::World world;
+            world::GenerateTerrain(world, MESHING_TERRAIN_WIDTH, MESHING_TERRAIN_HEIGHT, BENCHMARK_SEED);
+            Clock::time_point start = Clock::now();
+            for (uint32 pass = 0; pass < MESHING_PASSES; pass++)
+                for (int32 chunkZ = 0; chunkZ < MESHING_TERRAIN_WIDTH; chunkZ++)
+                    for (int32 chunkY = 0; chunkY < MESHING_TERRAIN_HEIGHT; chunkY++)
+                        for (int32 chunkX = 0; chunkX < MESHING_TERRAIN_WIDTH; chunkX++)
+                            mesher.Mesh(world, {chunkX, chunkY, chunkZ}, mesh);
+            LogMeshing("terrain", start, static_cast<uint64>(MESHING_PASSES) * world.GetChunkCount(), mesh);
+            // Ball of four materials in layers, merging stops at every material change
+            world::Chunk sphere;
+            constexpr int32 center = CHUNK_SIZE / 2, radius = CHUNK_SIZE / 2 - 2;
+            for (int32 y = 0; y < static_cast<int32>(CHUNK_SIZE); y++)
+                for (int32 z = 0; z < static_cast<int32>(CHUNK_SIZE); z++)
+                    for (int32 x = 0; x < static_cast<int32>(CHUNK_SIZE); x++)
+                        if ((x - center) * (x - center) + (y - center) * (y - center) + (z - center) * (z - center) <= radius * radius)
+                            sphere.SetBlock(x, y, z, static_cast<world::BlockId>(1 + y / 8));
+            start = Clock::now();
+            for (uint32 pass = 0; pass < MESHING_PASSES; pass++) mesher.Mesh(sphere, noNeighbours, mesh);
+            LogMeshing("sphere", start, MESHING_PASSES, mesh);
+            // Half of the blocks solid at random in four materials is close to the worst case, next to nothing merges
+            std::mt19937 random(BENCHMARK_SEED);
+            std::uniform_int_distribution<uint32> blockDistribution(0, 7);
+            world::Chunk noise;
+            for (uint32 blockIndex = 0; blockIndex < CHUNK_VOLUME; blockIndex++) {
+                const uint32 block = blockDistribution(random);
+                noise.SetBlock(blockIndex, static_cast<world::BlockId>(block < 4 ? AIR_BLOCK : block));
+            }
+            start = Clock::now();
+            for (uint32 pass = 0; pass < MESHING_PASSES; pass++) mesher.Mesh(noise, noNeighbours, mesh);
+            LogMeshing("noise", start, MESHING_PASSES, mesh);
+        }
+
+        void RunJobs() {
+            jobs::JobSystem jobSystem;
+            // Scheduling overhead alone, every job is empty
+            jobs::Counter counter;
+            Clock::time_point start = Clock::now();
+            for (uint32 jobIndex = 0; jobIndex < EMPTY_JOB_COUNT; jobIndex++) jobSystem.Run([] {}, &counter);
+            jobSystem.Wait(counter);
+            logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("jobs: {} workers, {:.1f} ns per empty job"),
+                         jobSystem.GetWorkerCount(), GetNanoseconds(start, EMPTY_JOB_COUNT));
+            // Meshing the terrain on one thread against every worker, with a mesher per worker
+            world::World world;
+            world::GenerateTerrain(world, MESHING_TERRAIN_WIDTH, MESHING_TERRAIN_HEIGHT, BENCHMARK_SEED);
+            std::vector<world::ChunkPosition> chunkPositions;
+            for (int32 chunkZ = 0; chunkZ < MESHING_TERRAIN_WIDTH; chunkZ++)
+                for (int32 chunkY = 0; chunkY < MESHING_TERRAIN_HEIGHT; chunkY++)
+                    for (int32 chunkX = 0; chunkX < MESHING_TERRAIN_WIDTH; chunkX++)
+                        chunkPositions.push_back({chunkX, chunkY, chunkZ});
+            std::vector<rendering::ChunkMesher> meshers(jobSystem.GetWorkerCount());
+            std::vector<rendering::ChunkMesh> meshes(chunkPositions.size());
+            const uint64 chunkCount = static_cast<uint64>(MESHING_PASSES) * chunkPositions.size();
+            start = Clock::now();
+            for (uint32 pass = 0; pass < MESHING_PASSES; pass++)
+                for (size_t chunkIndex = 0; chunkIndex < chunkPositions.size(); chunkIndex++)
+                    meshers[0].Mesh(world, chunkPositions[chunkIndex], meshes[chunkIndex]);
+            const double serialNanoseconds = GetNanoseconds(start, chunkCount);
+            start = Clock::now();
+            for (uint32 pass = 0; pass < MESHING_PASSES; pass++)
+                jobSystem.ParallelFor(chunkPositions.size(), [&](const size_t first, const size_t last) {
+                    rendering::ChunkMesher& mesher = meshers[jobSystem.GetWorkerIndex()];
+                    for (size_t chunkIndex = first; chunkIndex < last; chunkIndex++)
+                        mesher.Mesh(world, chunkPositions[chunkIndex], meshes[chunkIndex]);
+                }, 1);
+            const double parallelNanoseconds = GetNanoseconds(start, chunkCount);
+            logging::Log(logging::LogType::INFORMATION_LOG,
+                         FORMAT("jobs: meshing {:.1f} us per chunk on one thread, {:.1f} us in parallel, {:.2f}x"),
+                         serialNanoseconds / 1000.0, parallelNanoseconds / 1000.0, serialNanoseconds / parallelNanoseconds);
+            jobSystem.LogUtilization();
+        }
+
+        // Places a block on top of the column or breaks its top block, the kind of edit a player makes
+        void EditSurface(world::World& world, std::mt19937& random, const int32 worldWidth, const int32 worldHeight) {
+            std::uniform_int_distribution<int32> columnDistribution(0, worldWidth - 1);
+            const int32 x = columnDistribution(random), z = columnDistribution(random);
+            int32 top = worldHeight - 1;
+            while (top >= 0 && world.GetBlock(x, top, z) == AIR_BLOCK) top--;
+            if (random() % 2 == 0 && top + 1 < worldHeight)
+                world.EditBlock(x, top + 1, z, static_cast<world::BlockId>(1 + random() % 4));
+            else if (top >= 0)
+                world.EditBlock(x, top, z, AIR_BLOCK);
+        }
+
+        void RunEditing() {
+            constexpr int32 worldWidth = MESHING_TERRAIN_WIDTH * CHUNK_SIZE, worldHeight = MESHING_TERRAIN_HEIGHT * CHUNK_SIZE;
+            std::mt19937 random(BENCHMARK_SEED);
+            world::World world;
+            world::GenerateTerrain(world, MESHING_TERRAIN_WIDTH, MESHING_TERRAIN_HEIGHT, BENCHMARK_SEED);
+            // Cost of one chunk after a single edit, slices against the whole chunk
+            {
+                rendering::ChunkMesher mesher;
+                rendering::ChunkMesh mesh, fullMesh;
+                rendering::ChunkBorders borders;
+                world::DirtySliceMap dirtySlices;
+                std::unordered_map<world::ChunkPosition, rendering::ChunkMesh, world::ChunkPositionHash> meshes;
+                for (int32 chunkZ = 0; chunkZ < MESHING_TERRAIN_WIDTH; chunkZ++)
+                    for (int32 chunkY = 0; chunkY < MESHING_TERRAIN_HEIGHT; chunkY++)
+                        for (int32 chunkX = 0; chunkX < MESHING_TERRAIN_WIDTH; chunkX++)
+                            mesher.Mesh(world, {chunkX, chunkY, chunkZ}, meshes[{chunkX, chunkY, chunkZ}]);
+                double remeshNanoseconds = 0.0, meshNanoseconds = 0.0;
+                uint64 remeshCount = 0, changedVertexCount = 0, vertexCount = 0;
+                for (uint32 pass = 0; pass < EDIT_PASSES; pass++) {
+                    EditSurface(world, random, worldWidth, worldHeight);
+                    world.TakeDirtySlices(dirtySlices);
+                    for (const auto& [position, slices] : dirtySlices) {
+                        const world::Chunk& chunk = *world.GetChunk(position);
+                        rendering::ExtractBorders(rendering::GetChunkNeighbours(world, position), borders);
+                        rendering::ChunkMesh& chunkMesh = meshes[position];
+                        Clock::time_point start = Clock::now();
+                        mesher.Remesh(chunk, borders, slices, chunkMesh);
+                        remeshNanoseconds += GetNanoseconds(start, 1);
+                        start = Clock::now();
+                        mesher.Mesh(chunk, borders, fullMesh);
+                        meshNanoseconds += GetNanoseconds(start, 1);
+                        remeshCount++;
+                        changedVertexCount += rendering::CountChangedVertices(chunkMesh);
+                        vertexCount += chunkMesh.vertices.size();
+                    }
+                }
+                logging::Log(logging::LogType::INFORMATION_LOG,
+                             FORMAT("chunk-editing: {} remeshes, {:.1f} us for the dirty slices against {:.1f} us for the whole chunk, "
+                                    "{:.1f}% of the vertices changed"), remeshCount, remeshNanoseconds / remeshCount / 1000.0,
+                             meshNanoseconds / remeshCount / 1000.0, 100.0 * changedVertexCount / std::max<uint64>(vertexCount, 1));
+            }
+            // Edits streaming through the pipeline at a steady rate, frames paced like a game would
+            jobs::JobSystem jobSystem;
+            rendering::ChunkMeshingPipeline pipeline(jobSystem);
+            const math::Vector3 cameraPosition{worldWidth / 2.0f, static_cast<float>(worldHeight), worldWidth / 2.0f};
+            const std::array<math::Vector4, 6> everywhere{
+                    math::Vector4{0.0f, 0.0f, 0.0f, 1.0f}, math::Vector4{0.0f, 0.0f, 0.0f, 1.0f}, math::Vector4{0.0f, 0.0f, 0.0f, 1.0f},
+                    math::Vector4{0.0f, 0.0f, 0.0f, 1.0f}, math::Vector4{0.0f, 0.0f, 0.0f, 1.0f}, math::Vector4{0.0f, 0.0f, 0.0f, 1.0f}
+            };
+            for (int32 chunkZ = 0; chunkZ < MESHING_TERRAIN_WIDTH; chunkZ++)
+                for (int32 chunkY = 0; chunkY < MESHING_TERRAIN_HEIGHT; chunkY++)
+                    for (int32 chunkX = 0; chunkX < MESHING_TERRAIN_WIDTH; chunkX++)
+                        pipeline.MarkDirty({chunkX, chunkY, chunkZ});
+            const auto ignore = [](const world::ChunkPosition&, const rendering::ChunkMesh&) {};
+            memory::LinearArena frameArena(FRAME_ARENA_SIZE);
+            while (pipeline.GetDirtyCount() + pipeline.GetInFlightCount() + pipeline.GetReadyCount() > 0) {
+                frameArena.Reset();
+                pipeline.Update(world, cameraPosition, everywhere, frameArena);
+                pipeline.Upload(ignore);
+                std::this_thread::yield();
+            }
+            world::DirtySliceMap dirtySlices;
+            world.TakeDirtySlices(dirtySlices);
+            // Time of the oldest edit of each chunk that is not visible yet
+            std::unordered_map<world::ChunkPosition, Clock::time_point, world::ChunkPositionHash> editTimes;
+            std::vector<double> latencies;
+            uint64 editCount = 0, remeshCount = 0, uploadedSize = 0;
+            const Clock::time_point start = Clock::now();
+            for (Clock::time_point frameStart = start; std::chrono::duration<double>(frameStart - start).count() < EDITING_SECONDS;) {
+                const auto dueEditCount = static_cast<uint64>(std::chrono::duration<double>(frameStart - start).count() * EDITS_PER_SECOND);
+                for (; editCount < dueEditCount; editCount++) EditSurface(world, random, worldWidth, worldHeight);
+                world.TakeDirtySlices(dirtySlices);
+                for (const auto& [position, slices] : dirtySlices) editTimes.try_emplace(position, frameStart);
+                pipeline.MarkDirtySlices(dirtySlices);
+                frameArena.Reset();
+                pipeline.Update(world, cameraPosition, everywhere, frameArena);
+                pipeline.Upload([&](const world::ChunkPosition& position, const rendering::ChunkMesh& mesh) {
+                    remeshCount++;
+                    uploadedSize += rendering::CountChangedVertices(mesh) * sizeof(rendering::ChunkVertex);
+                    // A mesh only covers every edit of its chunk once no newer edit is waiting
+                    if (pipeline.IsDirty(position)) return;
+                    if (const auto it = editTimes.find(position); it != editTimes.end()) {
+                        latencies.push_back(std::chrono::duration<double, std::milli>(Clock::now() - it->second).count());
+                        editTimes.erase(it);
+                    }
+                });
+                jobSystem.EndFrame();
+                frameStart += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(EDITING_FRAME_SECONDS));
+                std::this_thread::sleep_until(frameStart);
+            }
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            std::sort(latencies.begin(), latencies.end());
+            const auto percentile = [&](const double fraction) {
+                return latencies.empty() ? 0.0 : latencies[static_cast<size_t>(fraction * (latencies.size() - 1))];
+            };
+            logging::Log(logging::LogType::INFORMATION_LOG,
+                         FORMAT("chunk-editing: {:.0f} edits/s, {:.0f} remeshes/s, {:.1f} KB of vertices per remesh, edit to mesh "
+                                "latency median {:.1f} ms, p99 {:.1f} ms, max {:.1f} ms"), editCount / seconds, remeshCount / seconds,
+                         uploadedSize / 1024.0 / std::max<uint64>(remeshCount, 1), percentile(0.5), percentile(0.99), percentile(1.0));
+        }
+
+        uint64 GetChunkChecksum(const world::Chunk& chunk) {
+            uint64 checksum = 0;
+            chunk.ForEachBlock([&](const uint32 blockIndex, const world::BlockId block) { checksum = checksum * 31 + (block ^ blockIndex); });
+            return checksum;
+        }
+
+        uint64 GetDirectorySize(const std::filesystem::path& directory) {
+            uint64 size = 0;
+            for (const auto& entry : std::filesystem::directory_iterator(directory)) size += entry.file_size();
+            return size;
+        }
+
+        void LogRegionLoad(const char* scenario, const double seconds, const size_t chunkCount, const uint64 compressedSize,
+                           const size_t mismatchCount) {
+            logging::Log(mismatchCount == 0 ? logging::LogType::INFORMATION_LOG : logging::LogType::ERROR_LOG,
+                         FORMAT("region-io: {} load, {:.0f} chunks/s, {:.1f} MB/s of compressed chunks, {} chunks differ"), scenario,
+                         chunkCount / seconds, compressedSize / (1024.0 * 1024.0) / seconds, mismatchCount);
+        }
+
+        bool RunRegionIo() {
+            world::World world;
+            world::GenerateTerrain(world, REGION_TERRAIN_WIDTH, REGION_TERRAIN_HEIGHT, BENCHMARK_SEED);
+            std::vector<world::ChunkPosition> chunkPositions;
+            for (int32 chunkZ = 0; chunkZ < REGION_TERRAIN_WIDTH; chunkZ++)
+                for (int32 chunkY = 0; chunkY < REGION_TERRAIN_HEIGHT; chunkY++)
+                    for (int32 chunkX = 0; chunkX < REGION_TERRAIN_WIDTH; chunkX++)
+                        chunkPositions.push_back({chunkX, chunkY, chunkZ});
+            const std::filesystem::path directory = std::filesystem::temp_directory_path() / "voxelfield-region-benchmark";
+            std::filesystem::remove_all(directory);
+            uint64 size = 0, compressedSize = 0;
+            bool isPassing = true;
+            {
+                world::RegionStorage storage(directory.string());
+                std::vector<uint8> serialized;
+                for (const world::ChunkPosition& position : chunkPositions) world.GetChunk(position)->Serialize(serialized);
+                size = serialized.size();
+                const Clock::time_point start = Clock::now();
+                for (const world::ChunkPosition& position : chunkPositions) {
+                    storage.SaveChunk(*world.GetChunk(position), position);
+                    compressedSize += storage.GetLastCompressedSize();
+                }
+                const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+                logging::Log(logging::LogType::INFORMATION_LOG,
+                             FORMAT("region-io: saved {} chunks at {:.0f} chunks/s, {:.1f} MB/s, compressed to {:.1f}% of {:.1f} MB"),
+                             chunkPositions.size(), chunkPositions.size() / seconds, size / (1024.0 * 1024.0) / seconds,
+                             100.0 * compressedSize / size, size / (1024.0 * 1024.0));
+            }
+            // Cold is a fresh storage after asking the operating system to drop the files from its cache, warm loads everything again
+            for (const auto& entry : std::filesystem::directory_iterator(directory)) file::MappedFile::EvictFromCache(entry.path().string());
+            {
+                world::RegionStorage storage(directory.string());
+                for (const char* scenario : {"cold", "warm"}) {
+                    world::World loadedWorld;
+                    const Clock::time_point start = Clock::now();
+                    for (const world::ChunkPosition& position : chunkPositions) storage.LoadChunk(loadedWorld, position);
+                    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+                    size_t mismatchCount = 0;
+                    for (const world::ChunkPosition& position : chunkPositions) {
+                        const world::Chunk* chunk = loadedWorld.GetChunk(position);
+                        if (!chunk || GetChunkChecksum(*chunk) != GetChunkChecksum(*world.GetChunk(position))) mismatchCount++;
+                    }
+                    LogRegionLoad(scenario, seconds, chunkPositions.size(), compressedSize, mismatchCount);
+                    isPassing = isPassing && mismatchCount == 0;
+                }
+            }
+            // Every save appends, compaction is what keeps the files from growing with each pass
+            {
+                world::RegionStorage storage(directory.string());
+                const Clock::time_point start = Clock::now();
+                for (uint32 pass = 0; pass < REGION_RESAVE_PASSES; pass++)
+                    for (const world::ChunkPosition& position : chunkPositions) storage.SaveChunk(*world.GetChunk(position), position);
+                const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+                logging::Log(logging::LogType::INFORMATION_LOG,
+                             FORMAT("region-io: saved every chunk {} more times at {:.0f} chunks/s, files hold {:.1f} MB for {:.1f} MB "
+                                    "of chunks"), REGION_RESAVE_PASSES, REGION_RESAVE_PASSES * chunkPositions.size() / seconds,
+                             GetDirectorySize(directory) / (1024.0 * 1024.0), compressedSize / (1024.0 * 1024.0));
+            }
+            std::filesystem::remove_all(directory);
+            return isPassing;
+        }
+
+        bool RunTerrainGeneration() {
+            std::vector<world::ChunkPosition> chunkPositions;
+            for (int32 chunkZ = 0; chunkZ < GENERATION_TERRAIN_WIDTH; chunkZ++)
+                for (int32 chunkY = 0; chunkY < GENERATION_TERRAIN_HEIGHT; chunkY++)
+                    for (int32 chunkX = 0; chunkX < GENERATION_TERRAIN_WIDTH; chunkX++)
+                        chunkPositions.push_back({chunkX, chunkY, chunkZ});
+            // One thread, the scalar reference against the vectorized generator, which have to agree block for block
+            world::TerrainGenerator generator(BENCHMARK_SEED);
+            world::Chunk chunk, referenceChunk;
+            double nanoseconds = 0.0, referenceNanoseconds = 0.0;
+            size_t mismatchCount = 0;
+            for (const world::ChunkPosition& position : chunkPositions) {
+                Clock::time_point start = Clock::now();
+                generator.Generate(position, chunk);
+                nanoseconds += GetNanoseconds(start, 1);
+                start = Clock::now();
+                generator.GenerateReference(position, referenceChunk);
+                referenceNanoseconds += GetNanoseconds(start, 1);
+                for (uint32 blockIndex = 0; blockIndex < CHUNK_VOLUME; blockIndex++)
+                    if (chunk.GetBlock(blockIndex) != referenceChunk.GetBlock(blockIndex)) mismatchCount++;
+            }
+            const double chunksPerSecond = chunkPositions.size() / (nanoseconds / 1e9);
+            logging::Log(mismatchCount == 0 ? logging::LogType::INFORMATION_LOG : logging::LogType::ERROR_LOG,
+                         FORMAT("terrain-generation: {:.0f} chunks/s with {} against {:.0f} chunks/s scalar, {:.2f}x, {} blocks differ"),
+                         chunksPerSecond, world::TerrainGenerator::GetInstructionSet(),
+                         chunkPositions.size() / (referenceNanoseconds / 1e9), referenceNanoseconds / nanoseconds, mismatchCount);
+            // Whole worlds at a time on more and more workers, a job system has two at least
+            const uint32 maximumWorkerCount = std::max(std::thread::hardware_concurrency(), 2u);
+            for (uint32 workerCount = 2;; workerCount = std::min(workerCount * 2, maximumWorkerCount)) {
+                jobs::JobSystem jobSystem(workerCount);
+                world::World world;
+                const Clock::time_point start = Clock::now();
+                world::GenerateTerrain(world, jobSystem, GENERATION_TERRAIN_WIDTH, GENERATION_TERRAIN_HEIGHT, BENCHMARK_SEED);
+                const double parallelChunksPerSecond = world.GetChunkCount() / std::chrono::duration<double>(Clock::now() - start).count();
+                logging::Log(logging::LogType::INFORMATION_LOG,
+                             FORMAT("terrain-generation: {:2} workers, {:.0f} chunks/s, {:.0f} chunks/s per worker, {:.0f}% of one "
+                                    "thread each"), workerCount, parallelChunksPerSecond, parallelChunksPerSecond / workerCount,
+                             100.0 * parallelChunksPerSecond / workerCount / chunksPerSecond);
+                if (workerCount == maximumWorkerCount) break;
+            }
+            return mismatchCount == 0;
+        }
+
+        void RunLogging() {
+            const std::filesystem::path fileName = std::filesystem::temp_directory_path() / "voxelfield-logging-benchmark.log";
+            std::filesystem::remove(fileName);
+            logging::LoggerOptions options{fileName.string(), logging::OverflowPolicy::BLOCK_PRODUCER};
+            logging::Configure(options);
+            // Cost on the calling thread, with the background thread writing the previous burst meanwhile
+            double deferredNanoseconds = 0.0, formattedNanoseconds = 0.0;
+            for (uint32 burst = 0; burst < LOG_BURST_COUNT; burst++) {
+                Clock::time_point start = Clock::now();
+                for (uint32 recordIndex = 0; recordIndex < LOG_BURST_SIZE; recordIndex++)
+                    logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Chunk {} of burst {} meshed in {:.2f} us on {}"), recordIndex,
+                                 burst, 1.5, "worker");
+                deferredNanoseconds += GetNanoseconds(start, LOG_BURST_SIZE);
+                logging::Flush();
+                start = Clock::now();
+                for (uint32 recordIndex = 0; recordIndex < LOG_BURST_SIZE; recordIndex++)
+                    logging::Log(logging::LogType::INFORMATION_LOG,
+                                 util::Format(FORMAT("Chunk {} of burst {} meshed in {:.2f} us on {}"), recordIndex, burst, 1.5, "worker"));
+                formattedNanoseconds += GetNanoseconds(start, LOG_BURST_SIZE);
+                logging::Flush();
+            }
+            // What every call used to cost, formatting and writing the line through to the file before returning
+            double synchronousNanoseconds;
+            {
+                File* file = std::fopen(fileName.string().c_str(), "ab");
+                const Clock::time_point start = Clock::now();
+                for (uint32 recordIndex = 0; recordIndex < LOG_BURST_SIZE; recordIndex++) {
+                    const auto line = util::Format(FORMAT("Chunk {} of burst {} meshed in {:.2f} us on {}"), recordIndex, 0u, 1.5, "worker");
+                    std::fputs(line.GetString(), file);
+                    std::fputc('\n', file);
+                    std::fflush(file);
+                }
+                synchronousNanoseconds = GetNanoseconds(start, LOG_BURST_SIZE);
+                std::fclose(file);
+            }
+            // Every worker logging flat out, the rings fill faster than the background thread empties them
+            options.overflowPolicy = logging::OverflowPolicy::DROP_RECORDS;
+            logging::Configure(options);
+            jobs::JobSystem jobSystem;
+            const uint64 previousDroppedCount = logging::GetDroppedCount();
+            const Clock::time_point start = Clock::now();
+            jobSystem.ParallelFor(jobSystem.GetWorkerCount(), [&](const size_t first, const size_t last) {
+                for (size_t producer = first; producer < last; producer++)
+                    for (uint32 recordIndex = 0; recordIndex < LOG_FLOOD_COUNT; recordIndex++)
+                        logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Flood record {} from producer {}"), recordIndex, producer);
+            }, 1);
+            const double floodSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+            logging::Flush();
+            const uint64 droppedCount = logging::GetDroppedCount() - previousDroppedCount;
+            const uint64 floodCount = static_cast<uint64>(LOG_FLOOD_COUNT) * jobSystem.GetWorkerCount();
+            logging::Configure({});
+            const uint64 fileSize = std::filesystem::file_size(fileName);
+            std::filesystem::remove(fileName);
+            logging::Log(logging::LogType::INFORMATION_LOG,
+                         FORMAT("logging: {:.1f} ns per deferred record, {:.1f} ns formatting on the caller, {:.1f} ns writing "
+                                "synchronously"), deferredNanoseconds / LOG_BURST_COUNT, formattedNanoseconds / LOG_BURST_COUNT,
+                         synchronousNanoseconds);
+            logging::Log(logging::LogType::INFORMATION_LOG,
+                         FORMAT("logging: {} workers flooding at {:.0f} records/s dropped {} of {}, {:.1f} MB written"),
+                         jobSystem.GetWorkerCount(), floodCount / floodSeconds, droppedCount, floodCount, fileSize / (1024.0 * 1024.0));
+        }
+
+        // util::Format as it was before formats were checked at compile time, kept to measure against
+        std::string FormatWithVsnprintf(const std::string& format, const unsigned int length, ...) {
+            va_list arguments;
+            std::vector<char> output(length);
+            va_start(arguments, length);
+            std::vsnprintf(output.data(), length, format.c_str(), arguments);
+            va_end(arguments);
+            return output.data();
+        }
+
+        /// Times both ways of formatting one of the engine's messages, which have to write the same text
+        template<typename LegacyFormatter, typename CheckedFormatter>
+        void CompareFormatting(const char* pattern, const LegacyFormatter& legacyFormatter, const CheckedFormatter& checkedFormatter) {
+            uint64 legacyLength = 0, checkedLength = 0;
+            Clock::time_point start = Clock::now();
+            for (uint32 callIndex = 0; callIndex < FORMATTING_CALL_COUNT; callIndex++) legacyLength += legacyFormatter(callIndex).size();
+            const double legacyNanoseconds = GetNanoseconds(start, FORMATTING_CALL_COUNT);
+            start = Clock::now();
+            for (uint32 callIndex = 0; callIndex < FORMATTING_CALL_COUNT; callIndex++)
+                checkedLength += checkedFormatter(callIndex).GetLength();
+            const double checkedNanoseconds = GetNanoseconds(start, FORMATTING_CALL_COUNT);
+            uint32 mismatchCount = 0;
+            for (uint32 callIndex = 0; callIndex < FORMATTING_CALL_COUNT; callIndex += FORMATTING_CALL_COUNT / 64)
+                if (legacyFormatter(callIndex) != checkedFormatter(callIndex).GetView()) mismatchCount++;
+            if (legacyLength != checkedLength) mismatchCount++;
+            logging::Log(logging::LogType::INFORMATION_LOG,
+                         FORMAT("formatting: {:<16} {:.1f} ns with vsnprintf, {:.1f} ns checked, {:.2f}x, {} mismatches"), pattern,
+                         legacyNanoseconds, checkedNanoseconds, legacyNanoseconds / checkedNanoseconds, mismatchCount);
+        }
+
+        void RunFormatting() {
+            // Vulkan errors are written as numbers here to compare, they are written by name everywhere else
+            CompareFormatting("vulkan-error", [](const uint32 callIndex) {
+                return FormatWithVsnprintf("Error code %i, could not create Vulkan swapchain", MAX_MESSAGE_LENGTH,
+                                           static_cast<VkResult>(-static_cast<int32>(callIndex % 4) - 1));
+            }, [](const uint32 callIndex) {
+                return util::Format(FORMAT("Error code {:d}, could not create Vulkan swapchain"),
+                                    static_cast<VkResult>(-static_cast<int32>(callIndex % 4) - 1));
+            });
+            const char deviceName[256] = "Voxelfield Benchmark Device";
+            const char extensionName[256] = "VK_KHR_timeline_semaphore";
+            CompareFormatting("device", [&](const uint32) {
+                return FormatWithVsnprintf("Vulkan extension %s supported for device %s", MAX_MESSAGE_LENGTH, extensionName, deviceName);
+            }, [&](const uint32) {
+                return util::Format(FORMAT("Vulkan extension {} supported for device {}"), extensionName, deviceName);
+            });
+            CompareFormatting("frame-statistics", [](const uint32 callIndex) {
+                const double milliseconds = 16.0 + callIndex * 0.001;
+                return FormatWithVsnprintf("[Frame statistics] %-8s min %.3f avg %.3f p50 %.3f p95 %.3f p99 %.3f max %.3f ms over %u frames",
+                                           MAX_MESSAGE_LENGTH, "cpu", milliseconds * 0.5, milliseconds, milliseconds, milliseconds * 1.5,
+                                           milliseconds * 2.0, milliseconds * 4.0, callIndex);
+            }, [](const uint32 callIndex) {
+                const double milliseconds = 16.0 + callIndex * 0.001;
+                return util::Format(FORMAT("[Frame statistics] {:<8} min {:.3f} avg {:.3f} p50 {:.3f} p95 {:.3f} p99 {:.3f} max {:.3f} "
+                                           "ms over {} frames"), "cpu", milliseconds * 0.5, milliseconds, milliseconds, milliseconds * 1.5,
+                                    milliseconds * 2.0, milliseconds * 4.0, callIndex);
+            });
+            CompareFormatting("region-file", [](const uint32 callIndex) {
+                const int32 position = static_cast<int32>(callIndex) - static_cast<int32>(FORMATTING_CALL_COUNT / 2);
+                return FormatWithVsnprintf("region.%i.%i.%i.vfr", MAX_MESSAGE_LENGTH, position, -position / 3, position / 7);
+            }, [](const uint32 callIndex) {
+                const int32 position = static_cast<int32>(callIndex) - static_cast<int32>(FORMATTING_CALL_COUNT / 2);
+                return util::Format(FORMAT("region.{}.{}.{}.vfr"), position, -position / 3, position / 7);
+            });
+            CompareFormatting("counts", [](const uint32 callIndex) {
+                return FormatWithVsnprintf("Dropped %llu log records because a ring was full, %llu in total", MAX_MESSAGE_LENGTH,
+                                           static_cast<unsigned long long>(callIndex), static_cast<unsigned long long>(callIndex) << 20);
+            }, [](const uint32 callIndex) {
+                return util::Format(FORMAT("Dropped {} log records because a ring was full, {} in total"), static_cast<uint64>(callIndex),
+                                    static_cast<uint64>(callIndex) << 20);
+            });
+        }
+
+        struct AssetLoadResult {
+            uint64 checksum = 0;
+            uint32 zeroCopyCount = 0;
+        };
+
+        // file::ReadFile as it was before assets went through the file system, kept to measure against
+        std::vector<char> ReadFileWithStream(const std::string& fileName) {
+            std::ifstream file(fileName, std::ios::binary);
+            if (!file.is_open()) throw std::runtime_error(util::Format(FORMAT("Could not open file with name {}"), fileName));
+            uintmax_t fileSize = std::filesystem::file_size(fileName);
+            std::vector<char> buffer(fileSize);
+            file.read(buffer.data(), fileSize);
+            return buffer;
+        }
+
+        /// Reads every byte, so mapped assets are paged in as they would be when used
+        uint64 GetAssetChecksum(const void* data, const size_t size) {
+            const auto* bytes = static_cast<const uint8*>(data);
+            uint64 checksum = size;
+            size_t byteIndex = 0;
+            for (; byteIndex + sizeof(uint64) <= size; byteIndex += sizeof(uint64)) {
+                uint64 word;
+                std::memcpy(&word, bytes + byteIndex, sizeof(uint64));
+                checksum = checksum * 31 + word;
+            }
+            for (; byteIndex < size; byteIndex++) checksum = checksum * 31 + bytes[byteIndex];
+            return checksum;
+        }
+
+        AssetLoadResult LoadAssets(const std::string& mountPath, const std::vector<std::string>& paths) {
+            AssetLoadResult result;
+            file::VirtualFileSystem fileSystem;
+            fileSystem.MountPath(mountPath);
+            for (const std::string& path : paths) {
+                const file::FileData data = fileSystem.Read(path);
+                result.checksum += GetAssetChecksum(data.GetData(), data.GetSize());
+                if (data.IsZeroCopy()) result.zeroCopyCount++;
+            }
+            return result;
+        }
+
+        void RunAssetLoading() {
+            const std::filesystem::path directory = std::filesystem::temp_directory_path() / "voxelfield-asset-benchmark";
+            const std::filesystem::path archiveName = std::filesystem::temp_directory_path() / "voxelfield-asset-benchmark.vfa";
+            const std::filesystem::path compressedArchiveName = std::filesystem::temp_directory_path() / "voxelfield-asset-benchmark-lz4.vfa";
+            std::filesystem::remove_all(directory);
+            // Words drawn from a small set compress about as well as SPIR-V does
+            std::mt19937 random(BENCHMARK_SEED);
+            std::uniform_int_distribution<uint32> sizeDistribution(1024, ASSET_MAX_FILE_SIZE), wordDistribution(0, 63);
+            std::vector<std::string> paths;
+            uint64 size = 0, referenceChecksum = 0;
+            for (uint32 fileIndex = 0; fileIndex < ASSET_FILE_COUNT; fileIndex++) {
+                const std::string& path = paths.emplace_back(util::Format(FORMAT("shaders/set-{}/asset-{}.spv"), fileIndex % 8, fileIndex));
+                std::filesystem::create_directories((directory / path).parent_path());
+                std::vector<uint32> words(sizeDistribution(random) / sizeof(uint32));
+                for (uint32& word : words) word = 0x07230203u + wordDistribution(random) * 0x10001u;
+                File* file = std::fopen((directory / path).string().c_str(), "wb");
+                std::fwrite(words.data(), sizeof(uint32), words.size(), file);
+                std::fclose(file);
+                size += words.size() * sizeof(uint32);
+                referenceChecksum += GetAssetChecksum(words.data(), words.size() * sizeof(uint32));
+            }
+            file::PackDirectory(directory.string(), archiveName.string(), false);
+            file::PackDirectory(directory.string(), compressedArchiveName.string(), true);
+            logging::Log(logging::LogType::INFORMATION_LOG,
+                         FORMAT("asset-loading: {} files of {:.1f} MB, packed into {:.1f} MB and {:.1f} MB compressed"), paths.size(),
+                         size / (1024.0 * 1024.0), std::filesystem::file_size(archiveName) / (1024.0 * 1024.0),
+                         std::filesystem::file_size(compressedArchiveName) / (1024.0 * 1024.0));
+            // Cold runs first ask the operating system to drop every file from its cache, warm ones read everything again
+            const auto measure = [&](const char* method, const auto& load) {
+                for (const char* scenario : {"cold", "warm"}) {
+                    if (scenario[0] == 'c') {
+                        for (const auto& entry : std::filesystem::recursive_directory_iterator(directory))
+                            if (entry.is_regular_file()) file::MappedFile::EvictFromCache(entry.path().string());
+                        file::MappedFile::EvictFromCache(archiveName.string());
+                        file::MappedFile::EvictFromCache(compressedArchiveName.string());
+                    }
+                    const Clock::time_point start = Clock::now();
+                    const AssetLoadResult result = load();
+                    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+                    logging::Log(logging::LogType::INFORMATION_LOG,
+                                 FORMAT("asset-loading: {:<10} {} {:.2f} ms, {:.0f} MB/s, {} of {} read in place, checksum {}"), method,
+                                 scenario, seconds * 1000.0, size / (1024.0 * 1024.0) / seconds, result.zeroCopyCount, paths.size(),
+                                 result.checksum == referenceChecksum ? "matches" : "differs");
+                }
+            };
+            measure("stream", [&] {
+                AssetLoadResult result;
+                for (const std::string& path : paths) {
+                    const std::vector<char> data = ReadFileWithStream((directory / path).string());
+                    result.checksum += GetAssetChecksum(data.data(), data.size());
+                }
+                return result;
+            });
+            measure("loose", [&] { return LoadAssets(directory.string(), paths); });
+            measure("archive", [&] { return LoadAssets(archiveName.string(), paths); });
+            measure("compressed", [&] { return LoadAssets(compressedArchiveName.string(), paths); });
+            std::filesystem::remove_all(directory);
+            std::filesystem::remove(archiveName);
+            std::filesystem::remove(compressedArchiveName);
+        }
+
+        struct IoMeasurement {
+            double seconds;
+            // Microseconds from submitting each read to its callback, or for blocking reads the call itself
+            std::vector<double> latencies;
+            uint32 mismatchCount;
+        };
+
+        void LogIoMeasurement(const char* method, const char* scenario, IoMeasurement& measurement) {
+            std::sort(measurement.latencies.begin(), measurement.latencies.end());
+            const auto percentile = [&](const double fraction) {
+                return measurement.latencies[static_cast<size_t>(fraction * (measurement.latencies.size() - 1))];
+            };
+            logging::Log(logging::LogType::INFORMATION_LOG,
+                         FORMAT("async-io: {:<15} {} {:.0f} reads/s, {:.1f} MB/s, latency median {:.1f} us, p99 {:.1f} us, {} reads "
+                                "differ"),
+                         method, scenario, measurement.latencies.size() / measurement.seconds,
+                         measurement.latencies.size() * IO_BENCHMARK_READ_SIZE / (1024.0 * 1024.0) / measurement.seconds,
+                         percentile(0.5), percentile(0.99), measurement.mismatchCount);
+        }
+
+        /// Streams every read of the benchmark through the service in batches, keeping a fixed number in flight, into a destination of
+        /// its own or a registered buffer that the callback gives back
+        IoMeasurement ReadWithService(file::IoService& service, const std::string& fileName, const std::vector<uint64>& offsets,
+                                      const std::vector<uint8>& contents, const bool isUsingRegisteredBuffers) {
+            IoMeasurement measurement{0.0, std::vector<double>(offsets.size()), 0};
+            std::vector<uint8> destination(offsets.size() * IO_BENCHMARK_READ_SIZE);
+            std::vector<Clock::time_point> submitTimes(offsets.size());
+            std::atomic<uint32> completedCount{0}, mismatchCount{0};
+            const uint32 fileId = service.OpenFile(fileName);
+            const Clock::time_point start = Clock::now();
+            for (size_t first = 0; first < offsets.size(); first += IO_BENCHMARK_BATCH_SIZE) {
+                const size_t last = std::min<size_t>(offsets.size(), first + IO_BENCHMARK_BATCH_SIZE);
+                while (last - completedCount.load(std::memory_order_acquire) > IO_BENCHMARK_IN_FLIGHT_COUNT) std::this_thread::yield();
+                for (size_t readIndex = first; readIndex < last; readIndex++) {
+                    file::IoReadRequest request{fileId, offsets[readIndex], IO_BENCHMARK_READ_SIZE, nullptr, INVALID_IO_BUFFER,
+                                                file::IoPriority::NORMAL, {}};
+                    if (isUsingRegisteredBuffers)
+                        request.bufferIndex = service.AcquireBuffer();
+                    else
+                        request.data = destination.data() + readIndex * IO_BENCHMARK_READ_SIZE;
+                    request.callback = [&, readIndex, bufferIndex = request.bufferIndex](const file::IoResult& result) {
+                        const std::chrono::duration<double, std::micro> latency = Clock::now() - submitTimes[readIndex];
+                        measurement.latencies[readIndex] = latency.count();
+                        if (result.status != file::IoStatus::COMPLETED || result.size != IO_BENCHMARK_READ_SIZE
+                            || std::memcmp(result.data, contents.data() + offsets[readIndex], IO_BENCHMARK_READ_SIZE) != 0)
+                            mismatchCount++;
+                        if (bufferIndex != INVALID_IO_BUFFER) service.ReleaseBuffer(bufferIndex);
+                        completedCount.fetch_add(1, std::memory_order_release);
+                    };
+                    submitTimes[readIndex] = Clock::now();
+                    service.Read(std::move(request));
+                }
+                service.Submit();
+            }
+            service.WaitForIdle();
+            measurement.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            measurement.mismatchCount = mismatchCount;
+            service.CloseFile(fileId);
+            return measurement;
+        }
+
+        void RunAsyncIo() {
+            const std::filesystem::path fileName = std::filesystem::temp_directory_path() / "voxelfield-io-benchmark.bin";
+            std::mt19937 random(BENCHMARK_SEED);
+            std::vector<uint8> contents(IO_BENCHMARK_FILE_SIZE);
+            for (uint8& byte : contents) byte = static_cast<uint8>(random());
+            {
+                File* file = std::fopen(fileName.string().c_str(), "wb");
+                std::fwrite(contents.data(), 1, contents.size(), file);
+                std::fclose(file);
+            }
+            std::uniform_int_distribution<uint64> offsetDistribution(0, IO_BENCHMARK_FILE_SIZE / IO_BENCHMARK_READ_SIZE - 1);
+            std::vector<uint64> offsets(IO_BENCHMARK_READ_COUNT);
+            for (uint64& offset : offsets) offset = offsetDistribution(random) * IO_BENCHMARK_READ_SIZE;
+            file::IoService uringService, threadPoolService(file::IoServiceOptions{IO_QUEUE_DEPTH, IO_REGISTERED_BUFFER_COUNT,
+                                                                                   IO_REGISTERED_BUFFER_SIZE, IO_FALLBACK_THREAD_COUNT,
+                                                                                   true});
+            const bool isUringAvailable = uringService.GetBackend() == file::IoBackend::IO_URING;
+            // Cold runs first ask the operating system to drop the file from its cache, warm ones read the same offsets again
+            const auto measure = [&](const char* method, const auto& read) {
+                for (const char* scenario : {"cold", "warm"}) {
+                    if (scenario[0] == 'c') file::MappedFile::EvictFromCache(fileName.string());
+                    IoMeasurement measurement = read();
+                    LogIoMeasurement(method, scenario, measurement);
+                }
+            };
+            // Opening a stream for every read is what file::ReadFile did for each file it was given
+            measure("stream", [&] {
+                IoMeasurement measurement{0.0, {}, 0};
+                std::vector<char> data(IO_BENCHMARK_READ_SIZE);
+                const Clock::time_point start = Clock::now();
+                for (const uint64 offset : offsets) {
+                    const Clock::time_point readStart = Clock::now();
+                    std::ifstream file(fileName, std::ios::binary);
+                    file.seekg(static_cast<std::streamoff>(offset));
+                    file.read(data.data(), IO_BENCHMARK_READ_SIZE);
+                    measurement.latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - readStart).count());
+                    if (std::memcmp(data.data(), contents.data() + offset, IO_BENCHMARK_READ_SIZE) != 0) measurement.mismatchCount++;
+                }
+                measurement.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+                return measurement;
+            });
+            if (isUringAvailable) {
+                measure("io_uring", [&] { return ReadWithService(uringService, fileName.string(), offsets, contents, false); });
+                measure("io_uring fixed", [&] { return ReadWithService(uringService, fileName.string(), offsets, contents, true); });
+            } else {
+                logging::Log(logging::LogType::WARNING_LOG, "async-io: io_uring is not available, only the thread pool is measured");
+            }
+            measure("thread pool", [&] { return ReadWithService(threadPoolService, fileName.string(), offsets, contents, false); });
+            // Low priority reads that are no longer needed, cancelled right after they were submitted
+            file::IoService& service = isUringAvailable ? uringService : threadPoolService;
+            const file::IoStatistics before = service.GetStatistics();
+            const uint32 fileId = service.OpenFile(fileName.string());
+            std::vector<uint8> destination(offsets.size() * IO_BENCHMARK_READ_SIZE);
+            std::vector<uint64> requestIds;
+            for (size_t readIndex = 0; readIndex < offsets.size(); readIndex++)
+                requestIds.push_back(service.Read({fileId, offsets[readIndex], IO_BENCHMARK_READ_SIZE,
+                                                   destination.data() + readIndex * IO_BENCHMARK_READ_SIZE, INVALID_IO_BUFFER,
+                                                   file::IoPriority::LOW, nullptr}));
+            service.Submit();
+            for (const uint64 requestId : requestIds) service.Cancel(requestId);
+            service.WaitForIdle();
+            service.CloseFile(fileId);
+            const file::IoStatistics after = service.GetStatistics();
+            logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("async-io: cancelled {} of {} low priority reads, {} completed first"),
+                         after.cancelledCount - before.cancelledCount, offsets.size(), after.completedCount - before.completedCount);
+            const file::IoStatistics statistics = service.GetStatistics();
+            logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("async-io: {} reads submitted with {} calls, {} failed"),
+                         statistics.readCount, statistics.submitCallCount, statistics.failedCount);
+            std::filesystem::remove(fileName);
+        }
+
+        /// Runs the frames and logs the time and heap allocations of each, the latter only when they are counted
+        template<typename Frame>
+        void MeasureFrames(const char* method, const Frame& frame) {
+#ifdef HEAP_COUNTING_ENABLED
+            const uint64 heapAllocationCount = memory::GetHeapAllocationCount();
+#endif
+            uint64 checksum = 0;
+            const Clock::time_point start = Clock::now();
+            for (uint32 frameIndex = 0; frameIndex < ALLOCATOR_FRAME_COUNT; frameIndex++) checksum += frame(frameIndex);
+            const double nanoseconds = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+#ifdef HEAP_COUNTING_ENABLED
+            const uint64 heapAllocations = memory::GetHeapAllocationCount() - heapAllocationCount;
+            logging::Log(logging::LogType::INFORMATION_LOG,
+                         FORMAT("allocators: {:<22} {:.2f} us per frame, {:.2f} heap allocations per frame, checksum {}"), method,
+                         nanoseconds / ALLOCATOR_FRAME_COUNT / 1000.0, static_cast<double>(heapAllocations) / ALLOCATOR_FRAME_COUNT, checksum);
+#else
+            logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("allocators: {:<22} {:.2f} us per frame, checksum {}"), method,
+                         nanoseconds / ALLOCATOR_FRAME_COUNT / 1000.0, checksum);
+#endif
+        }
+
+        void RunAllocators() {
+            // Temporary lists built and thrown away every frame, reserved up front like candidates or draw lists would be
+            const auto fillList = [](auto& list, const uint32 frameIndex) {
+                list.reserve(ALLOCATOR_LIST_SIZE);
+                for (uint32 elementIndex = 0; elementIndex < ALLOCATOR_LIST_SIZE; elementIndex++) list.push_back(frameIndex ^ elementIndex);
+                uint64 sum = 0;
+                for (const uint32 element : list) sum += element;
+                return sum;
+            };
+            MeasureFrames("heap lists", [&](const uint32 frameIndex) {
+                uint64 sum = 0;
+                for (uint32 listIndex = 0; listIndex < ALLOCATOR_LISTS_PER_FRAME; listIndex++) {
+                    std::vector<uint32> list;
+                    sum += fillList(list, frameIndex);
+                }
+                return sum;
+            });
+            memory::FrameArenas frameArenas;
+            frameArenas.Create(2);
+            MeasureFrames("frame arena lists", [&](const uint32 frameIndex) {
+                memory::LinearArena& arena = frameArenas.BeginFrame(frameIndex % 2);
+                uint64 sum = 0;
+                for (uint32 listIndex = 0; listIndex < ALLOCATOR_LISTS_PER_FRAME; listIndex++) {
+                    // Each list is done with before the next one, so they all reuse the same memory like the heap would
+                    const memory::ArenaMarker marker = arena.GetMarker();
+                    {
+                        memory::ArenaVector<uint32> list{memory::ArenaAllocator<uint32>(arena)};
+                        sum += fillList(list, frameIndex);
+                    }
+                    arena.ResetToMarker(marker);
+                }
+                return sum;
+            });
+            MeasureFrames("scratch stack lists", [&](const uint32 frameIndex) {
+                uint64 sum = 0;
+                for (uint32 listIndex = 0; listIndex < ALLOCATOR_LISTS_PER_FRAME; listIndex++) {
+                    memory::ScratchScope scratch;
+                    memory::ArenaVector<uint32> list{memory::ArenaAllocator<uint32>(scratch.GetArena())};
+                    sum += fillList(list, frameIndex);
+                }
+                return sum;
+            });
+            // Entries coming and going every frame, like the tasks of chunks being meshed
+            const auto churnMap = [](auto& map, const uint32 frameIndex) {
+                for (uint32 churnIndex = 0; churnIndex < ALLOCATOR_MAP_CHURN; churnIndex++) {
+                    const uint32 key = frameIndex * ALLOCATOR_MAP_CHURN + churnIndex;
+                    map.erase(key - ALLOCATOR_MAP_SIZE);
+                    map.emplace(key, key);
+                }
+                return static_cast<uint64>(map.size());
+            };
+            {
+                std::unordered_map<uint32, uint32> map;
+                map.reserve(ALLOCATOR_MAP_SIZE * 2);
+                MeasureFrames("heap map", [&](const uint32 frameIndex) { return churnMap(map, frameIndex); });
+            }
+            {
+                memory::NodePool nodePool;
+                std::unordered_map<uint32, uint32, std::hash<uint32>, std::equal_to<uint32>,
+                                   memory::PoolAllocator<std::pair<const uint32, uint32>>> map(
+                        memory::PoolAllocator<std::pair<const uint32, uint32>>{nodePool});
+                map.reserve(ALLOCATOR_MAP_SIZE * 2);
+                MeasureFrames("pool map", [&](const uint32 frameIndex) { return churnMap(map, frameIndex); });
+            }
+            // Objects created and destroyed within a frame
+            typedef std::array<uint64, 8> Object;
+            std::vector<Object*> objects(ALLOCATOR_LIST_SIZE);
+            MeasureFrames("heap objects", [&](const uint32 frameIndex) {
+                uint64 sum = 0;
+                for (uint32 objectIndex = 0; objectIndex < ALLOCATOR_LIST_SIZE; objectIndex++)
+                    objects[objectIndex] = new Object{frameIndex, objectIndex};
+                for (Object* object : objects) {
+                    sum += (*object)[0] + (*object)[1];
+                    delete object;
+                }
+                return sum;
+            });
+            memory::ObjectPool<Object> objectPool;
+            MeasureFrames("pool objects", [&](const uint32 frameIndex) {
+                uint64 sum = 0;
+                for (uint32 objectIndex = 0; objectIndex < ALLOCATOR_LIST_SIZE; objectIndex++)
+                    objects[objectIndex] = objectPool.Create(Object{frameIndex, objectIndex});
+                for (Object* object : objects) {
+                    sum += (*object)[0] + (*object)[1];
+                    objectPool.Destroy(object);
+                }
+                return sum;
+            });
+        }
+
+        double MeasureZones() {
+            const Clock::time_point start = Clock::now();
+            for (uint32 zoneIndex = 0; zoneIndex < TRACE_ZONE_COUNT; zoneIndex++) {
+                const profiling::ScopedZone zone("Benchmark zone");
+            }
+            return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / TRACE_ZONE_COUNT;
+        }
+
+        void RunTracing() {
+            // Zones are used directly so this measures the same with tracing compiled out of the rest of the build
+            const double idleNanoseconds = MeasureZones();
+            const std::filesystem::path fileName = std::filesystem::temp_directory_path() / "voxelfield-trace-benchmark.json";
+            profiling::ConfigureTracing({fileName.string(), 0, CAPTURE_UNTIL_EXIT});
+            const double capturingNanoseconds = MeasureZones();
+            const Clock::time_point exportStart = Clock::now();
+            profiling::FinishTracing();
+            const double exportMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - exportStart).count();
+            profiling::ConfigureTracing({});
+            logging::Log(logging::LogType::INFORMATION_LOG,
+                         FORMAT("tracing: {:.1f} ns per zone without a capture, {:.1f} ns while capturing, {:.1f} ms to write {} zones "
+                                "({} KB)"), idleNanoseconds, capturingNanoseconds, exportMilliseconds, TRACE_ZONE_COUNT,
+                         std::filesystem::file_size(fileName) / 1024);
+            std::filesystem::remove(fileName);
+        }
+    }
+
+    int Run(const std::string& name) {
+        const bool isAll = name == "all";
+        bool isFound = false, isPassing = true;
+        if (isAll || name == "chunk-random-access") {
+            RunRandomAccess();
+            isFound = true;
+        }
+        if (isAll || name == "chunk-iteration") {
+            RunIteration();
+            isFound = true;
+        }
+        if (isAll || name == "chunk-memory") {
+            isPassing = RunMemory() && isPassing;
+            isFound = true;
+        }
+        if (isAll || name == "chunk-meshing") {
+            RunMeshing();
+            isFound = true;
+        }
+        if (isAll || name == "chunk-editing") {
+            RunEditing();
+            isFound = true;
+        }
+        if (isAll || name == "terrain-generation") {
+            isPassing = RunTerrainGeneration() && isPassing;
+            isFound = true;
+        }
+        if (isAll || name == "region-io") {
+            isPassing = RunRegionIo() && isPassing;
+            isFound = true;
+        }
+        if (isAll || name == "logging") {
+            RunLogging();
+            isFound = true;
+        }
+        if (isAll || name == "formatting") {
+            RunFormatting();
+            isFound = true;
+        }
+        if (isAll || name == "asset-loading") {
+            RunAssetLoading();
+            isFound = true;
+        }
+        if (isAll || name == "async-io") {
+            RunAsyncIo();
+            isFound = true;
+        }
+        if (isAll || name == "allocators") {
+            RunAllocators();
+            isFound = true;
+        }
+        if (isAll || name == "tracing") {
+            RunTracing();
+            isFound = true;
+        }
+        if (isAll || name == "jobs") {
+            RunJobs();
+            isFound = true;
+        }
+        if (!isFound) {
+            logging::Log(logging::LogType::ERROR_LOG,
+                         FORMAT("Unknown benchmark {}, expected chunk-random-access, chunk-iteration, chunk-memory, chunk-meshing, "
+                                "chunk-editing, terrain-generation, region-io, jobs, logging, formatting, asset-loading, async-io, allocators, "
+                                "tracing or all"),
+                         name);
+            return EXIT_FAILURE;
+        }
+        return isPassing ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <string>
+
+namespace voxelfield::benchmarks {
+    /// Runs the named CPU benchmark, or every one of them for "all", and logs the results. Returns the process exit code.
+    int Run(const std::string& name);
+}
@@ -0,0 +1,232 @@
+#include "chunk.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace voxelfield::world {
+    namespace {
+        uint32 ReadIndex(const std::vector<uint64>& words, const uint32 bitsPerIndex, const uint32 blockIndex) {
+            const uint32 bitOffset = blockIndex * bitsPerIndex;
+            return static_cast<uint32>((words[bitOffset >> 6] >> (bitOffset & 63)) & ((1ull << bitsPerIndex) - 1));
+        }
+
+        void WriteIndex(std::vector<uint64>& words, const uint32 bitsPerIndex, const uint32 blockIndex, const uint32 value) {
+            const uint32 bitOffset = blockIndex * bitsPerIndex, shift = bitOffset & 63;
+            const uint64 mask = (1ull << bitsPerIndex) - 1;
+            uint64& word = words[bitOffset >> 6];
+            word = (word & ~(mask << shift)) | (static_cast<uint64>(value) << shift);
+        }
+
+        size_t GetWordCount(const uint32 bitsPerIndex) {
+            return static_cast<size_t>(CHUNK_VOLUME) * bitsPerIndex / 64;
+        }
+
+        // Counts how many blocks use each palette entry, false when an index points past the palette. Widths are template arguments
+        // so the shifts are constants, and interleaved histograms keep runs of one block from serializing on a single counter.
+        template<uint32 BitsPerIndex>
+        bool CountIndices(const std::vector<uint64>& words, std::vector<uint32>& paletteCounts) {
+            constexpr uint32 indicesPerWord = 64 / BitsPerIndex, valueCount = 1u << BitsPerIndex, histogramCount = 4;
+            constexpr uint64 mask = valueCount - 1;
+            uint32 histograms[histogramCount][valueCount] = {};
+            for (const uint64 word : words)
+                for (uint32 index = 0; index < indicesPerWord; index++)
+                    histograms[index % histogramCount][(word >> (index * BitsPerIndex)) & mask]++;
+            for (uint32 value = 0; value < valueCount; value++) {
+                const uint32 count = histograms[0][value] + histograms[1][value] + histograms[2][value] + histograms[3][value];
+                if (value < paletteCounts.size()) paletteCounts[value] = count;
+                else if (count > 0) return false;
+            }
+            return true;
+        }
+    }
+
+    Chunk::Chunk(const BlockId fillBlock) {
+        Fill(fillBlock);
+    }
+
+    BlockId Chunk::GetBlock(const uint32 blockIndex) const {
+        if (IsUniform()) return m_Palette.front();
+        const uint32 value = GetIndex(blockIndex);
+        return IsDirect() ? static_cast<BlockId>(value) : m_Palette[value];
+    }
+
+    void Chunk::SetBlock(const uint32 blockIndex, const BlockId block) {
+        if (IsDirect()) {
+            SetIndex(blockIndex, block);
+            return;
+        }
+        const uint32 previousValue = IsUniform() ? 0 : GetIndex(blockIndex);
+        if (m_Palette[previousValue] == block) return;
+        // Palettes stay small, a linear search beats hashing at these sizes
+        const auto paletteSize = static_cast<uint32>(m_Palette.size());
+        auto value = static_cast<uint32>(std::find(m_Palette.begin(), m_Palette.end(), block) - m_Palette.begin());
+        if (value == paletteSize) {
+            const auto freeValue = static_cast<uint32>(std::find(m_PaletteCounts.begin(), m_PaletteCounts.end(), 0u) - m_PaletteCounts.begin());
+            if (freeValue < paletteSize) {
+                value = freeValue;
+                m_Palette[value] = block;
+            } else {
+                value = AddPaletteEntry(block);
+                if (IsDirect()) {
+                    SetIndex(blockIndex, block);
+                    return;
+                }
+            }
+        }
+        SetIndex(blockIndex, value);
+        m_PaletteCounts[previousValue]--;
+        if (++m_PaletteCounts[value] == CHUNK_VOLUME) Fill(block);
+    }
+
+    void Chunk::Fill(const BlockId block) {
+        m_Palette.assign(1, block);
+        m_PaletteCounts.assign(1, CHUNK_VOLUME);
+        m_Words.clear();
+        m_Words.shrink_to_fit();
+        m_BitsPerIndex = 0;
+    }
+
+    void Chunk::Compact() {
+        if (IsUniform()) return;
+        std::vector<BlockId> blocks(CHUNK_VOLUME);
+        ForEachBlock([&](const uint32 blockIndex, const BlockId block) { blocks[blockIndex] = block; });
+        SetBlocks(blocks.data());
+    }
+
+    void Chunk::SetBlocks(const BlockId* blocks) {
+        // Runs of one block are long in most chunks, so the block before is checked ahead of searching the palette
+        std::vector<BlockId> palette{blocks[0]};
+        BlockId previousBlock = blocks[0];
+        for (uint32 blockIndex = 1; blockIndex < CHUNK_VOLUME && palette.size() <= 1u << MAX_PALETTE_BITS; blockIndex++) {
+            const BlockId block = blocks[blockIndex];
+            if (block == previousBlock) continue;
+            previousBlock = block;
+            if (std::find(palette.begin(), palette.end(), block) == palette.end()) palette.push_back(block);
+        }
+        if (palette.size() == 1) {
+            Fill(palette.front());
+            return;
+        }
+        uint32 bitsPerIndex = 1;
+        while ((1u << bitsPerIndex) < palette.size()) bitsPerIndex *= 2;
+        const bool isDirect = bitsPerIndex > MAX_PALETTE_BITS;
+        if (isDirect) {
+            bitsPerIndex = DIRECT_BITS;
+            palette.clear();
+        }
+        // Whole words are assembled in a register instead of read, masked and written back per block
+        const uint32 indicesPerWord = 64 / bitsPerIndex;
+        std::vector<uint64> words(GetWordCount(bitsPerIndex));
+        std::vector<uint32> paletteCounts(palette.size(), 0);
+        uint32 value = 0, blockIndex = 0;
+        for (uint64& word : words) {
+            word = 0;
+            for (uint32 index = 0; index < indicesPerWord; index++, blockIndex++) {
+                const BlockId block = blocks[blockIndex];
+                if (isDirect) {
+                    value = block;
+                } else {
+                    if (palette[value] != block)
+                        value = static_cast<uint32>(std::find(palette.begin(), palette.end(), block) - palette.begin());
+                    paletteCounts[value]++;
+                }
+                word |= static_cast<uint64>(value) << (index * bitsPerIndex);
+            }
+        }
+        palette.shrink_to_fit();
+        m_Palette = std::move(palette);
+        m_PaletteCounts = std::move(paletteCounts);
+        m_Words = std::move(words);
+        m_BitsPerIndex = bitsPerIndex;
+    }
+
+    size_t Chunk::GetMemoryUsage() const {
+        return m_Palette.capacity() * sizeof(BlockId) + m_PaletteCounts.capacity() * sizeof(uint32) + m_Words.capacity() * sizeof(uint64);
+    }
+
+    void Chunk::Serialize(std::vector<uint8>& data) const {
+        const auto paletteSize = static_cast<uint16>(m_Palette.size());
+        const size_t start = data.size();
+        data.resize(start + sizeof(uint8) + sizeof(uint16) + paletteSize * sizeof(BlockId) + m_Words.size() * sizeof(uint64));
+        uint8* destination = data.data() + start;
+        *destination++ = static_cast<uint8>(m_BitsPerIndex);
+        std::memcpy(destination, &paletteSize, sizeof(uint16));
+        destination += sizeof(uint16);
+        // Direct chunks have no palette and uniform ones no words, null data pointers must not reach memcpy
+        if (paletteSize > 0) std::memcpy(destination, m_Palette.data(), paletteSize * sizeof(BlockId));
+        destination += paletteSize * sizeof(BlockId);
+        if (!m_Words.empty()) std::memcpy(destination, m_Words.data(), m_Words.size() * sizeof(uint64));
+    }
+
+    bool Chunk::Deserialize(const uint8* data, const size_t size) {
+        if (size < sizeof(uint8) + sizeof(uint16)) return false;
+        const uint32 bitsPerIndex = *data++;
+        uint16 paletteSize;
+        std::memcpy(&paletteSize, data, sizeof(uint16));
+        data += sizeof(uint16);
+        const bool isDirect = bitsPerIndex == DIRECT_BITS;
+        const bool isValidWidth = bitsPerIndex == 0 || isDirect || (bitsPerIndex <= MAX_PALETTE_BITS && (bitsPerIndex & (bitsPerIndex - 1)) == 0);
+        const bool isValidPalette = isDirect ? paletteSize == 0 : paletteSize >= 1 && paletteSize <= 1u << bitsPerIndex;
+        const size_t wordCount = GetWordCount(bitsPerIndex);
+        if (!isValidWidth || !isValidPalette
+            || size != sizeof(uint8) + sizeof(uint16) + paletteSize * sizeof(BlockId) + wordCount * sizeof(uint64))
+            return false;
+        std::vector<BlockId> palette(paletteSize);
+        if (paletteSize > 0) std::memcpy(palette.data(), data, paletteSize * sizeof(BlockId));
+        data += paletteSize * sizeof(BlockId);
+        std::vector<uint64> words(wordCount);
+        if (wordCount > 0) std::memcpy(words.data(), data, wordCount * sizeof(uint64));
+        // Counts are not stored, they follow from the indices
+        std::vector<uint32> paletteCounts(paletteSize, 0);
+        if (bitsPerIndex == 0) {
+            paletteCounts.front() = CHUNK_VOLUME;
+        } else if (!isDirect) {
+            const bool isCounted = bitsPerIndex == 1 ? CountIndices<1>(words, paletteCounts)
+                                   : bitsPerIndex == 2 ? CountIndices<2>(words, paletteCounts)
+                                   : bitsPerIndex == 4 ? CountIndices<4>(words, paletteCounts) : CountIndices<8>(words, paletteCounts);
+            if (!isCounted) return false;
+        }
+        m_Palette = std::move(palette);
+        m_PaletteCounts = std::move(paletteCounts);
+        m_Words = std::move(words);
+        m_BitsPerIndex = bitsPerIndex;
+        return true;
+    }
+
+    uint32 Chunk::GetIndex(const uint32 blockIndex) const {
+        return ReadIndex(m_Words, m_BitsPerIndex, blockIndex);
+    }
+
+    void Chunk::SetIndex(const uint32 blockIndex, const uint32 value) {
+        WriteIndex(m_Words, m_BitsPerIndex, blockIndex, value);
+    }
+
+    uint32 Chunk::AddPaletteEntry(const BlockId block) {
+        if (m_Palette.size() == 1u << m_BitsPerIndex) {
+            const uint32 widerBits = m_BitsPerIndex == 0 ? 1 : m_BitsPerIndex * 2;
+            Resize(widerBits > MAX_PALETTE_BITS ? DIRECT_BITS : widerBits);
+            // Direct storage has no palette, the caller writes the block ID itself
+            if (IsDirect()) return 0;
+        }
+        m_Palette.push_back(block);
+        m_PaletteCounts.push_back(0);
+        return static_cast<uint32>(m_Palette.size() - 1);
+    }
+
+    void Chunk::Resize(const uint32 bitsPerIndex) {
+        std::vector<uint64> words(GetWordCount(bitsPerIndex), 0);
+        const bool isDirect = bitsPerIndex == DIRECT_BITS;
+        for (uint32 blockIndex = 0; blockIndex < CHUNK_VOLUME; blockIndex++) {
+            const uint32 value = IsUniform() ? 0 : GetIndex(blockIndex);
+            WriteIndex(words, bitsPerIndex, blockIndex, isDirect ? m_Palette[value] : value);
+        }
+        m_Words = std::move(words);
+        m_BitsPerIndex = bitsPerIndex;
+        if (isDirect) {
+            m_Palette.clear();
+            m_Palette.shrink_to_fit();
+            m_PaletteCounts.clear();
+            m_PaletteCounts.shrink_to_fit();
+        }
+    }
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vector>
+
+#include "type_definitions.hpp"
+
+#define CHUNK_SIZE_BITS 5u
+#define CHUNK_SIZE (1u << CHUNK_SIZE_BITS)
+#define CHUNK_VOLUME (CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE)
+#define AIR_BLOCK 0
+// Palettes up to this many bits per index, wider chunks store block IDs directly
+#define MAX_PALETTE_BITS 8u
+#define DIRECT_BITS 16u
+
+namespace voxelfield::world {
+    typedef uint16 BlockId;
+
+    /// Blocks of one chunk stored as indices into a per-chunk palette, packed into 64-bit words with as few bits as the palette needs.
+    /// Widths are powers of two so an index never straddles two words. A chunk of a single block type keeps no indices at all, and one
+    /// with more block types than eight bits can address stores the block IDs themselves.
+    class Chunk {
+    public:
+        explicit Chunk(BlockId fillBlock = AIR_BLOCK);
+
+        BlockId GetBlock(uint32 x, uint32 y, uint32 z) const {
+            return GetBlock(GetBlockIndex(x, y, z));
+        }
+
+        BlockId GetBlock(uint32 blockIndex) const;
+
+        void SetBlock(uint32 x, uint32 y, uint32 z, const BlockId block) {
+            SetBlock(GetBlockIndex(x, y, z), block);
+        }
+
+        void SetBlock(uint32 blockIndex, BlockId block);
+
+        /// Sets every block and drops the indices
+        void Fill(BlockId block);
+
+        /// Replaces every block from an array in block index order, building the narrowest storage in a single pass. For generating
+        /// whole chunks, which is far faster than setting blocks one by one as the palette grows.
+        void SetBlocks(const BlockId* blocks);
+
+        /// Rebuilds the palette from the blocks actually present and narrows the indices as far as that allows. Palettes reuse the
+        /// slots of block types that disappear and collapse on their own once one type covers the chunk, so this is mainly for
+        /// bringing chunks that went to direct storage back down.
+        void Compact();
+
+        /// Calls back with the block index and block of every block, in index order. Decodes whole words at a time, which is much
+        /// faster than calling GetBlock for each.
+        template<typename Callback>
+        void ForEachBlock(Callback&& callback) const {
+            if (m_BitsPerIndex == 0) {
+                for (uint32 blockIndex = 0; blockIndex < CHUNK_VOLUME; blockIndex++)
+                    callback(blockIndex, m_Palette.front());
+                return;
+            }
+            // Copied into locals, callbacks that store blocks could otherwise alias them and force a reload per block
+            const uint32 bitsPerIndex = m_BitsPerIndex, indicesPerWord = 64 / bitsPerIndex;
+            const uint64 mask = (1ull << bitsPerIndex) - 1;
+            const BlockId* palette = m_Palette.data();
+            const bool isDirect = IsDirect();
+            const uint64* words = m_Words.data();
+            const size_t wordCount = m_Words.size();
+            uint32 blockIndex = 0;
+            for (size_t wordIndex = 0; wordIndex < wordCount; wordIndex++) {
+                uint64 remaining = words[wordIndex];
+                for (uint32 index = 0; index < indicesPerWord; index++, remaining >>= bitsPerIndex) {
+                    const auto value = static_cast<uint32>(remaining & mask);
+                    callback(blockIndex++, isDirect ? static_cast<BlockId>(value) : palette[value]);
+                }
+            }
+        }
+
+        static uint32 GetBlockIndex(const uint32 x, const uint32 y, const uint32 z) {
+            // X varies fastest, then Z, so horizontal slices are contiguous
+            return (y << (CHUNK_SIZE_BITS * 2)) | (z << CHUNK_SIZE_BITS) | x;
+        }
+
+        bool IsUniform() const {
+            return m_BitsPerIndex == 0;
+        }
+
+        bool IsDirect() const {
+            return m_BitsPerIndex == DIRECT_BITS;
+        }
+
+        uint32 GetBitsPerIndex() const {
+            return m_BitsPerIndex;
+        }
+
+        /// Distinct block types the palette has room for, zero when block IDs are stored directly
+        uint32 GetPaletteSize() const {
+            return static_cast<uint32>(m_Palette.size());
+        }
+
+        /// Heap memory held by the chunk, not counting the object itself
+        size_t GetMemoryUsage() const;
+
+        /// Appends the storage width, palette and index words as they are in memory, so saving and loading skip any re-encoding
+        void Serialize(std::vector<uint8>& data) const;
+
+        /// Replaces the chunk with one written by Serialize, returns false and leaves the chunk alone when the data is malformed
+        bool Deserialize(const uint8* data, size_t size);
+
+    private:
+        std::vector<BlockId> m_Palette;
+        // How many blocks use each palette entry, an entry at zero is free to be reused
+        std::vector<uint32> m_PaletteCounts;
+        std::vector<uint64> m_Words;
+        uint32 m_BitsPerIndex = 0;
+
+        uint32 GetIndex(uint32 blockIndex) const;
+
+        void SetIndex(uint32 blockIndex, uint32 value);
+
+        uint32 AddPaletteEntry(BlockId block);
+
+        void Resize(uint32 bitsPerIndex);
+    };
+}
@@ -0,0 +1,385 @@
+#include "chunk_mesher.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MESHER_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MESHER_SSE2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace voxelfield::rendering {
+    namespace {
+        constexpr uint32 AXIS_COUNT = 3, CHUNK_AREA = CHUNK_SIZE * CHUNK_SIZE;
+        // Columns along each axis are indexed by a row and a bit coordinate, these are the voxel axes of those
+        constexpr uint32 ROW_AXES[AXIS_COUNT] = {1, 2, 1}, BIT_AXES[AXIS_COUNT] = {2, 0, 0};
+        // Distance between neighbouring blocks along each voxel axis in the block index, see Chunk::GetBlockIndex
+        constexpr uint32 BLOCK_STRIDES[AXIS_COUNT] = {1, CHUNK_AREA, CHUNK_SIZE};
+
+        uint32 CountTrailingZeros(const uint64 value) {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward64(&index, value);
+            return index;
+#else
+            return static_cast<uint32>(__builtin_ctzll(value));
+#endif
+        }
+
+        // Transposes a 32 by 32 bit matrix in place by swapping ever smaller off-diagonal blocks
+        void Transpose(uint32* rows) {
+            uint32 mask = 0x0000FFFFu;
+            for (uint32 width = 16; width != 0; width >>= 1, mask ^= mask << width) {
+                for (uint32 row = 0; row < 32; row = (row + width + 1) & ~width) {
+                    const uint32 swapped = ((rows[row] >> width) ^ rows[row + width]) & mask;
+                    rows[row] ^= swapped << width;
+                    rows[row + width] ^= swapped;
+                }
+            }
+        }
+
+        // Bit x of the result is set when the block at x of the row is solid
+        uint32 GetSolidRow(const world::BlockId* blocks) {
+            static_assert(CHUNK_SIZE == 32, "Rows are expected to fill exactly one mask");
+#if defined(MESHER_AVX2)
+            const __m256i air = _mm256_setzero_si256();
+            const __m256i lower = _mm256_cmpeq_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(blocks)), air),
+                    upper = _mm256_cmpeq_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(blocks + 16)), air);
+            // Packing works within 128-bit lanes, the permute puts the bytes back into block order
+            const __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(lower, upper), 0b11011000);
+            return ~static_cast<uint32>(_mm256_movemask_epi8(packed));
+#elif defined(MESHER_SSE2)
+            const __m128i air = _mm_setzero_si128();
+            const auto load = [&](const uint32 offset) {
+                return _mm_cmpeq_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks + offset)), air);
+            };
+            const auto lower = static_cast<uint32>(_mm_movemask_epi8(_mm_packs_epi16(load(0), load(8)))),
+                    upper = static_cast<uint32>(_mm_movemask_epi8(_mm_packs_epi16(load(16), load(24))));
+            return ~(lower | upper << 16);
+#else
+            uint32 row = 0;
+            for (uint32 x = 0; x < CHUNK_SIZE; x++)
+                row |= static_cast<uint32>(blocks[x] != AIR_BLOCK) << x;
+            return row;
+#endif
+        }
+
+        bool IsSolid(const world::Chunk& chunk, const uint32 x, const uint32 y, const uint32 z) {
+            return chunk.GetBlock(x, y, z) != AIR_BLOCK;
+        }
+
+        bool IsEmpty(const world::Chunk& chunk) {
+            return chunk.IsUniform() && chunk.GetBlock(0) == AIR_BLOCK;
+        }
+
+        void ClearMesh(ChunkMesh& mesh) {
+            mesh.vertices.clear();
+            mesh.indices.clear();
+            mesh.sliceQuadOffsets.assign(MESHER_SLICE_COUNT + 1, 0);
+            mesh.sliceQuadCounts.assign(MESHER_SLICE_COUNT, 0);
+            mesh.changedVertexRanges.clear();
+        }
+
+        // Slices without faces get no range, the first quad they gain moves the slices after them
+        uint32 GetSliceCapacity(const uint32 quadCount) {
+            return quadCount == 0 ? 0 : quadCount + quadCount / MESHER_SLICE_SLACK_DIVISOR + MESHER_MIN_SLICE_SLACK;
+        }
+
+        void AddChangedRange(ChunkMesh& mesh, const uint32 firstVertex, const uint32 vertexCount) {
+            std::vector<VertexRange>& ranges = mesh.changedVertexRanges;
+            if (!ranges.empty() && ranges.back().first + ranges.back().count == firstVertex)
+                ranges.back().count += vertexCount;
+            else
+                ranges.push_back({firstVertex, vertexCount});
+        }
+
+        void FillIndices(ChunkMesh& mesh) {
+            // Indices only depend on the quad, so existing ones stay valid and only new quads need theirs
+            static const uint32 quadIndices[6]{0, 1, 2, 2, 3, 0};
+            size_t indexCount = std::min<size_t>(mesh.indices.size(), mesh.vertices.size() / 4 * 6);
+            mesh.indices.resize(mesh.vertices.size() / 4 * 6);
+            for (; indexCount < mesh.indices.size(); indexCount++)
+                mesh.indices[indexCount] = static_cast<uint32>(indexCount / 6 * 4) + quadIndices[indexCount % 6];
+        }
+    }
+
+    ChunkNeighbours GetChunkNeighbours(const world::World& world, const world::ChunkPosition& position) {
+        return {
+                world.GetChunk({position.x + 1, position.y, position.z}), world.GetChunk({position.x - 1, position.y, position.z}),
+                world.GetChunk({position.x, position.y + 1, position.z}), world.GetChunk({position.x, position.y - 1, position.z}),
+                world.GetChunk({position.x, position.y, position.z + 1}), world.GetChunk({position.x, position.y, position.z - 1})
+        };
+    }
+
+    void ExtractBorders(const ChunkNeighbours& neighbours, ChunkBorders& borders) {
+        constexpr uint32 last = CHUNK_SIZE - 1;
+        for (uint32 direction = 0; direction < 2 * AXIS_COUNT; direction++) {
+            const world::Chunk* neighbour = neighbours[direction];
+            std::array<uint32, CHUNK_SIZE>& rows = borders[direction];
+            if (!neighbour || neighbour->IsUniform()) {
+                rows.fill(neighbour && neighbour->GetBlock(0) != AIR_BLOCK ? ~0u : 0u);
+                continue;
+            }
+            // The positive neighbour touches with its first layer and the negative one with its last
+            const uint32 layer = direction % 2 == 0 ? 0 : last;
+            for (uint32 row = 0; row < CHUNK_SIZE; row++) {
+                uint32 bits = 0;
+                for (uint32 bit = 0; bit < CHUNK_SIZE; bit++) {
+                    // X columns are indexed by Y and Z, Y columns by Z and X, Z columns by Y and X
+                    bool isSolid;
+                    switch (static_cast<FaceDirection>(direction)) {
+                        case FaceDirection::POSITIVE_X:
+                        case FaceDirection::NEGATIVE_X:
+                            isSolid = IsSolid(*neighbour, layer, row, bit);
+                            break;
+                        case FaceDirection::POSITIVE_Y:
+                        case FaceDirection::NEGATIVE_Y:
+                            isSolid = IsSolid(*neighbour, bit, layer, row);
+                            break;
+                        default:
+                            isSolid = IsSolid(*neighbour, bit, row, layer);
+                            break;
+                    }
+                    bits |= static_cast<uint32>(isSolid) << bit;
+                }
+                rows[row] = bits;
+            }
+        }
+    }
+
+    ChunkMesher::ChunkMesher()
+            : m_Blocks(CHUNK_VOLUME), m_Columns(AXIS_COUNT * MESHER_COLUMN_COUNT), m_Faces(2 * AXIS_COUNT * MESHER_COLUMN_COUNT),
+              m_Planes(2 * AXIS_COUNT * CHUNK_SIZE * CHUNK_SIZE) {}
+
+    void ChunkMesher::Mesh(const world::Chunk& chunk, const ChunkNeighbours& neighbours, ChunkMesh& mesh) {
+        if (!IsEmpty(chunk)) ExtractBorders(neighbours, m_Borders);
+        Mesh(chunk, m_Borders, mesh);
+    }
+
+    void ChunkMesher::Mesh(const world::Chunk& chunk, const ChunkBorders& borders, ChunkMesh& mesh) {
+        ClearMesh(mesh);
+        if (IsEmpty(chunk)) return;
+        const world::DirtySlices allSlices = world::DirtySlices::Full();
+        ClearMesh(m_SliceMesh);
+        BuildColumns(chunk, borders);
+        CullFaces();
+        BuildPlanes(allSlices);
+        MergeFaces(allSlices, m_SliceMesh);
+        LayOutSlices(allSlices, 0, mesh);
+        FillIndices(mesh);
+    }
+
+    void ChunkMesher::Remesh(const world::Chunk& chunk, const ChunkBorders& borders, const world::DirtySlices& slices, ChunkMesh& mesh) {
+        if (slices.IsFull() || mesh.sliceQuadOffsets.size() != MESHER_SLICE_COUNT + 1 || mesh.sliceQuadCounts.size() != MESHER_SLICE_COUNT ||
+            IsEmpty(chunk)) {
+            Mesh(chunk, borders, mesh);
+            return;
+        }
+        // Columns and culling are cheap next to merging, so they are redone whole and only the dirty layers are merged
+        ClearMesh(m_SliceMesh);
+        BuildColumns(chunk, borders);
+        CullFaces();
+        BuildPlanes(slices);
+        MergeFaces(slices, m_SliceMesh);
+        mesh.changedVertexRanges.clear();
+        const std::vector<uint32>& offsets = mesh.sliceQuadOffsets;
+        uint32 slice = 0;
+        for (; slice < MESHER_SLICE_COUNT; slice++) {
+            const uint32 axis = slice / CHUNK_SIZE / 2, layer = slice % CHUNK_SIZE;
+            if (!(slices.layers[axis] >> layer & 1u)) continue;
+            const uint32 quadCount = m_SliceMesh.sliceQuadOffsets[slice + 1] - m_SliceMesh.sliceQuadOffsets[slice],
+                    oldQuadCount = mesh.sliceQuadCounts[slice];
+            if (quadCount > offsets[slice + 1] - offsets[slice]) break;
+            ChunkVertex* sliceVertices = mesh.vertices.data() + offsets[slice] * 4;
+            const ChunkVertex* newVertices = m_SliceMesh.vertices.data() + m_SliceMesh.sliceQuadOffsets[slice] * 4;
+            // Dirty slices often come out the same, mostly the layers next to an edit. Empty slices have no vertices to compare.
+            if (quadCount == oldQuadCount && (quadCount == 0 || std::memcmp(newVertices, sliceVertices, quadCount * 4 * sizeof(ChunkVertex)) == 0))
+                continue;
+            std::copy_n(newVertices, quadCount * 4, sliceVertices);
+            // Quads the slice no longer uses turn back into padding
+            if (oldQuadCount > quadCount) std::fill(sliceVertices + quadCount * 4, sliceVertices + oldQuadCount * 4, ChunkVertex{});
+            mesh.sliceQuadCounts[slice] = quadCount;
+            AddChangedRange(mesh, offsets[slice] * 4, std::max(quadCount, oldQuadCount) * 4);
+        }
+        // A slice that outgrew its range moves every slice after it
+        if (slice < MESHER_SLICE_COUNT) LayOutSlices(slices, slice, mesh);
+        FillIndices(mesh);
+    }
+
+    void ChunkMesher::Mesh(const world::World& world, const world::ChunkPosition& position, ChunkMesh& mesh) {
+        const world::Chunk* chunk = world.GetChunk(position);
+        if (!chunk) {
+            ClearMesh(mesh);
+            return;
+        }
+        Mesh(*chunk, GetChunkNeighbours(world, position), mesh);
+    }
+
+    const char* ChunkMesher::GetInstructionSet() {
+#if defined(MESHER_AVX2)
+        return "AVX2";
+#elif defined(MESHER_SSE2)
+        return "SSE2";
+#else
+        return "scalar";
+#endif
+    }
+
+    void ChunkMesher::BuildColumns(const world::Chunk& chunk, const ChunkBorders& borders) {
+        if (chunk.IsUniform())
+            std::fill(m_Blocks.begin(), m_Blocks.end(), chunk.GetBlock(0));
+        else
+            chunk.ForEachBlock([&](const uint32 blockIndex, const world::BlockId block) { m_Blocks[blockIndex] = block; });
+        // Rows along X come straight out of the blocks, the two other axes are transposes of them
+        uint32 xRows[CHUNK_SIZE][CHUNK_SIZE], rows[CHUNK_SIZE];
+        for (uint32 y = 0; y < CHUNK_SIZE; y++)
+            for (uint32 z = 0; z < CHUNK_SIZE; z++)
+                xRows[y][z] = GetSolidRow(&m_Blocks[world::Chunk::GetBlockIndex(0, y, z)]);
+        uint64* xColumns = &m_Columns[0], * yColumns = &m_Columns[MESHER_COLUMN_COUNT], * zColumns = &m_Columns[2 * MESHER_COLUMN_COUNT];
+        for (uint32 y = 0; y < CHUNK_SIZE; y++) {
+            for (uint32 z = 0; z < CHUNK_SIZE; z++) xColumns[y * CHUNK_SIZE + z] = xRows[y][z];
+            std::copy(xRows[y], xRows[y] + CHUNK_SIZE, rows);
+            Transpose(rows);
+            for (uint32 x = 0; x < CHUNK_SIZE; x++) zColumns[y * CHUNK_SIZE + x] = rows[x];
+        }
+        for (uint32 z = 0; z < CHUNK_SIZE; z++) {
+            for (uint32 y = 0; y < CHUNK_SIZE; y++) rows[y] = xRows[y][z];
+            Transpose(rows);
+            for (uint32 x = 0; x < CHUNK_SIZE; x++) yColumns[z * CHUNK_SIZE + x] = rows[x];
+        }
+        // Bit zero is the last layer of the negative neighbour and the bit past the chunk the first layer of the positive one
+        uint64* columns[AXIS_COUNT] = {xColumns, yColumns, zColumns};
+        for (uint32 axis = 0; axis < AXIS_COUNT; axis++) {
+            const std::array<uint32, CHUNK_SIZE>& positiveRows = borders[2 * axis], & negativeRows = borders[2 * axis + 1];
+            for (uint32 row = 0; row < CHUNK_SIZE; row++) {
+                for (uint32 bit = 0; bit < CHUNK_SIZE; bit++) {
+                    uint64& column = columns[axis][row * CHUNK_SIZE + bit];
+                    column = column << 1 | (negativeRows[row] >> bit & 1u) | static_cast<uint64>(positiveRows[row] >> bit & 1u) << (CHUNK_SIZE + 1);
+                }
+            }
+        }
+    }
+
+    void ChunkMesher::CullFaces() {
+        // A face is visible where a solid bit is followed by an empty one, shifting back by one drops the padding
+        for (uint32 axis = 0; axis < AXIS_COUNT; axis++) {
+            const uint64* columns = &m_Columns[axis * MESHER_COLUMN_COUNT];
+            uint64* positiveFaces = &m_Faces[2 * axis * MESHER_COLUMN_COUNT], * negativeFaces = positiveFaces + MESHER_COLUMN_COUNT;
+            uint32 columnIndex = 0;
+#if defined(MESHER_AVX2)
+            const __m256i chunkMask = _mm256_set1_epi64x(0xFFFFFFFFll);
+            for (; columnIndex < MESHER_COLUMN_COUNT; columnIndex += 4) {
+                const __m256i column = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(columns + columnIndex));
+                const __m256i positive = _mm256_andnot_si256(_mm256_srli_epi64(column, 1), column),
+                        negative = _mm256_andnot_si256(_mm256_slli_epi64(column, 1), column);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(positiveFaces + columnIndex), _mm256_and_si256(_mm256_srli_epi64(positive, 1), chunkMask));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(negativeFaces + columnIndex), _mm256_and_si256(_mm256_srli_epi64(negative, 1), chunkMask));
+            }
+#elif defined(MESHER_SSE2)
+            const __m128i chunkMask = _mm_set1_epi32(-1), lowMask = _mm_unpacklo_epi32(chunkMask, _mm_setzero_si128());
+            for (; columnIndex < MESHER_COLUMN_COUNT; columnIndex += 2) {
+                const __m128i column = _mm_loadu_si128(reinterpret_cast<const __m128i*>(columns + columnIndex));
+                const __m128i positive = _mm_andnot_si128(_mm_srli_epi64(column, 1), column),
+                        negative = _mm_andnot_si128(_mm_slli_epi64(column, 1), column);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(positiveFaces + columnIndex), _mm_and_si128(_mm_srli_epi64(positive, 1), lowMask));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(negativeFaces + columnIndex), _mm_and_si128(_mm_srli_epi64(negative, 1), lowMask));
+            }
+#endif
+            for (; columnIndex < MESHER_COLUMN_COUNT; columnIndex++) {
+                const uint64 column = columns[columnIndex];
+                positiveFaces[columnIndex] = (column & ~(column >> 1)) >> 1 & 0xFFFFFFFFull;
+                negativeFaces[columnIndex] = (column & ~(column << 1)) >> 1 & 0xFFFFFFFFull;
+            }
+        }
+    }
+
+    void ChunkMesher::BuildPlanes(const world::DirtySlices& slices) {
+        std::fill(m_Planes.begin(), m_Planes.end(), 0u);
+        for (uint32 direction = 0; direction < 2 * AXIS_COUNT; direction++) {
+            // Face bits sit at their layer along the column
+            const uint64 layerMask = slices.layers[direction / 2];
+            const uint64* faces = &m_Faces[direction * MESHER_COLUMN_COUNT];
+            uint32* planes = &m_Planes[direction * CHUNK_SIZE * CHUNK_SIZE];
+            for (uint32 columnIndex = 0; columnIndex < MESHER_COLUMN_COUNT; columnIndex++) {
+                const uint32 row = columnIndex / CHUNK_SIZE, bit = 1u << columnIndex % CHUNK_SIZE;
+                for (uint64 remaining = faces[columnIndex] & layerMask; remaining; remaining &= remaining - 1)
+                    planes[CountTrailingZeros(remaining) * CHUNK_SIZE + row] |= bit;
+            }
+        }
+    }
+
+    void ChunkMesher::MergeFaces(const world::DirtySlices& slices, ChunkMesh& mesh) {
+        for (uint32 direction = 0; direction < 2 * AXIS_COUNT; direction++) {
+            const uint32 axis = direction / 2, rowAxis = ROW_AXES[axis], bitAxis = BIT_AXES[axis];
+            const uint32 layerStride = BLOCK_STRIDES[axis], rowStride = BLOCK_STRIDES[rowAxis], bitStride = BLOCK_STRIDES[bitAxis];
+            for (uint32 layer = 0; layer < CHUNK_SIZE; layer++) {
+                mesh.sliceQuadOffsets[direction * CHUNK_SIZE + layer] = static_cast<uint32>(mesh.vertices.size() / 4);
+                if (!(slices.layers[axis] >> layer & 1u)) continue;
+                uint32* rows = &m_Planes[(direction * CHUNK_SIZE + layer) * CHUNK_SIZE];
+                const world::BlockId* layerBlocks = &m_Blocks[layer * layerStride];
+                const auto getMaterial = [&](const uint32 row, const uint32 bit) { return layerBlocks[row * rowStride + bit * bitStride]; };
+                for (uint32 row = 0; row < CHUNK_SIZE; row++) {
+                    while (rows[row]) {
+                        // Widen along the row over set bits of the same material, then grow down while the next rows match
+                        const uint32 start = CountTrailingZeros(rows[row]);
+                        const world::BlockId material = getMaterial(row, start);
+                        const uint32 runLength = CountTrailingZeros(~(static_cast<uint64>(rows[row]) >> start));
+                        uint32 width = 1;
+                        while (width < runLength && getMaterial(row, start + width) == material) width++;
+                        const auto runMask = static_cast<uint32>(((1ull << width) - 1) << start);
+                        rows[row] &= ~runMask;
+                        uint32 height = 1;
+                        for (; row + height < CHUNK_SIZE && (rows[row + height] & runMask) == runMask; height++) {
+                            uint32 bit = start;
+                            while (bit < start + width && getMaterial(row + height, bit) == material) bit++;
+                            if (bit < start + width) break;
+                            rows[row + height] &= ~runMask;
+                        }
+                        uint32 position[AXIS_COUNT], size[AXIS_COUNT];
+                        position[axis] = layer;
+                        position[rowAxis] = row;
+                        position[bitAxis] = start;
+                        size[axis] = 1;
+                        size[rowAxis] = height;
+                        size[bitAxis] = width;
+                        AppendVoxelQuad(mesh.vertices, mesh.indices, position[0], position[1], position[2], size[0], size[1], size[2],
+                                        static_cast<FaceDirection>(direction), material);
+                    }
+                }
+            }
+        }
+        mesh.sliceQuadOffsets[MESHER_SLICE_COUNT] = static_cast<uint32>(mesh.vertices.size() / 4);
+    }
+
+    void ChunkMesher::LayOutSlices(const world::DirtySlices& slices, const uint32 firstSlice, ChunkMesh& mesh) {
+        std::vector<uint32>& offsets = mesh.sliceQuadOffsets;
+        const uint32 firstQuad = offsets[firstSlice];
+        uint32 quadCount = firstQuad;
+        m_SplicedVertices.clear();
+        for (uint32 slice = firstSlice; slice < MESHER_SLICE_COUNT; slice++) {
+            const uint32 axis = slice / CHUNK_SIZE / 2, layer = slice % CHUNK_SIZE;
+            const ChunkVertex* sliceVertices = mesh.vertices.data() + offsets[slice] * 4;
+            uint32& sliceQuadCount = mesh.sliceQuadCounts[slice];
+            if (slices.layers[axis] >> layer & 1u) {
+                sliceVertices = m_SliceMesh.vertices.data() + m_SliceMesh.sliceQuadOffsets[slice] * 4;
+                sliceQuadCount = m_SliceMesh.sliceQuadOffsets[slice + 1] - m_SliceMesh.sliceQuadOffsets[slice];
+            }
+            // Offsets are rewritten in place, only the old start of this slice is read before it is replaced
+            offsets[slice] = quadCount;
+            m_SplicedVertices.insert(m_SplicedVertices.end(), sliceVertices, sliceVertices + sliceQuadCount * 4);
+            const uint32 capacity = GetSliceCapacity(sliceQuadCount);
+            m_SplicedVertices.resize(m_SplicedVertices.size() + (capacity - sliceQuadCount) * 4, ChunkVertex{});
+            quadCount += capacity;
+        }
+        offsets[MESHER_SLICE_COUNT] = quadCount;
+        mesh.vertices.resize(firstQuad * 4);
+        mesh.vertices.insert(mesh.vertices.end(), m_SplicedVertices.begin(), m_SplicedVertices.end());
+        if (quadCount > firstQuad) AddChangedRange(mesh, firstQuad * 4, (quadCount - firstQuad) * 4);
+    }
+}
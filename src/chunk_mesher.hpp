@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "vertex.hpp"
+#include "world.hpp"
+
+// Columns along each axis, one for every pair of the two other coordinates
+#define MESHER_COLUMN_COUNT (CHUNK_SIZE * CHUNK_SIZE)
+// Layers of faces of one direction each, quads never span two of them
+#define MESHER_SLICE_COUNT (6 * CHUNK_SIZE)
+// Room left after the quads of every slice that has any, as a fraction of them plus a fixed number of quads
+#define MESHER_SLICE_SLACK_DIVISOR 8
+#define MESHER_MIN_SLICE_SLACK 1
+
+namespace voxelfield::rendering {
+    /// Every slice owns a range of quads with room to spare, unused quads are zeroed and collapse to a point. A remeshed
+    /// slice that still fits its range is rewritten in place, so an edit only changes the vertices of the slices it touched.
+    struct ChunkMesh {
+        std::vector<ChunkVertex> vertices;
+        // Six per quad of the whole capacity, they only depend on the position of the quad
+        std::vector<uint32> indices;
+        // First quad of the range of every slice in FaceDirection then layer order, followed by the quad capacity
+        std::vector<uint32> sliceQuadOffsets;
+        // Quads in use at the start of each slice's range
+        std::vector<uint32> sliceQuadCounts;
+        // Vertices that differ from the mesh that was remeshed in ascending order, everything after meshing from scratch
+        std::vector<VertexRange> changedVertexRanges;
+    };
+
+    inline size_t CountChangedVertices(const ChunkMesh& mesh) {
+        size_t vertexCount = 0;
+        for (const VertexRange& range : mesh.changedVertexRanges) vertexCount += range.count;
+        return vertexCount;
+    }
+
+    /// Chunks next to the one being meshed in FaceDirection order, missing ones count as air
+    typedef std::array<const world::Chunk*, 6> ChunkNeighbours;
+
+    /// Solid bits of the layer of each neighbour touching the chunk, in FaceDirection order. Rows and bits follow the columns of that
+    /// face's axis, which is all the mesher reads of a neighbour, so a chunk can be meshed from a copy without its neighbours resident.
+    typedef std::array<std::array<uint32, CHUNK_SIZE>, 6> ChunkBorders;
+
+    /// Resident neighbours of a chunk of the world, missing ones are null
+    ChunkNeighbours GetChunkNeighbours(const world::World& world, const world::ChunkPosition& position);
+
+    void ExtractBorders(const ChunkNeighbours& neighbours, ChunkBorders& borders);
+
+    /// Builds chunk meshes with binary greedy meshing. Solid voxels are turned into one bitmask per column along every axis, hidden
+    /// faces are culled with a shift and mask of each column, and the remaining faces are merged into the largest rectangles of one
+    /// material row by row. Scratch memory is kept between calls, so a mesher per thread meshes without allocating once the
+    /// mesh vectors have grown.
+    class ChunkMesher {
+    public:
+        ChunkMesher();
+
+        void Mesh(const world::Chunk& chunk, const ChunkNeighbours& neighbours, ChunkMesh& mesh);
+
+        void Mesh(const world::Chunk& chunk, const ChunkBorders& borders, ChunkMesh& mesh);
+
+        /// Rebuilds the faces of the dirty slices and keeps the quads of every other slice, which is much cheaper for edits of a
+        /// few blocks. The mesh has to be the previous one of the chunk, meshed from the same borders wherever no slice is dirty.
+        /// Slices from the first one that outgrew its range on are laid out again. Sets the vertex ranges that differ from the
+        /// previous mesh. Meshes from scratch when there is no previous mesh.
+        void Remesh(const world::Chunk& chunk, const ChunkBorders& borders, const world::DirtySlices& slices, ChunkMesh& mesh);
+
+        /// Meshes a resident chunk of the world against whichever of its neighbours are resident
+        void Mesh(const world::World& world, const world::ChunkPosition& position, ChunkMesh& mesh);
+
+        /// Instruction set the column passes were compiled for
+        static const char* GetInstructionSet();
+
+    private:
+        std::vector<world::BlockId> m_Blocks;
+        // Solid bits of each column per axis, padded with one bit of the neighbouring chunk on either end
+        std::vector<uint64> m_Columns;
+        // Visible faces per FaceDirection, indexed like the columns of their axis
+        std::vector<uint64> m_Faces;
+        // Visible faces per FaceDirection and layer along the normal, one row of bits per column index
+        std::vector<uint32> m_Planes;
+        ChunkBorders m_Borders;
+        // Quads of the meshed slices packed without slack, copied into the ranges of the mesh
+        ChunkMesh m_SliceMesh;
+        std::vector<ChunkVertex> m_SplicedVertices;
+
+        void BuildColumns(const world::Chunk& chunk, const ChunkBorders& borders);
+
+        void CullFaces();
+
+        /// Only sets the bits of the layers in each axis' mask
+        void BuildPlanes(const world::DirtySlices& slices);
+
+        /// Appends the quads of the layers in each axis' mask and records where each of those slices starts
+        void MergeFaces(const world::DirtySlices& slices, ChunkMesh& mesh);
+
+        /// Gives the slices from the first one on new ranges with fresh slack, taking the quads of dirty slices from the slice mesh
+        void LayOutSlices(const world::DirtySlices& slices, uint32 firstSlice, ChunkMesh& mesh);
+    };
+}
@@ -0,0 +1,203 @@
+#include "chunk_meshing_pipeline.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace voxelfield::rendering {
+    namespace {
+        math::Vector3 GetChunkCenter(const world::ChunkPosition& position) {
+            constexpr float halfSize = CHUNK_SIZE / 2.0f;
+            return {static_cast<float>(position.x) * CHUNK_SIZE + halfSize, static_cast<float>(position.y) * CHUNK_SIZE + halfSize,
+                    static_cast<float>(position.z) * CHUNK_SIZE + halfSize};
+        }
+
+        float GetDistance(const world::ChunkPosition& position, const math::Vector3& cameraPosition) {
+            const math::Vector3 offset = GetChunkCenter(position) - cameraPosition;
+            return std::sqrt(math::Dot(offset, offset));
+        }
+
+        bool IsInFrustum(const world::ChunkPosition& position, const std::array<math::Vector4, 6>& frustumPlanes) {
+            constexpr float halfSize = CHUNK_SIZE / 2.0f;
+            const math::Vector3 center = GetChunkCenter(position);
+            // Outside as soon as the corner furthest along a plane's normal is behind it
+            for (const math::Vector4& plane : frustumPlanes) {
+                const float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w
+                                       + halfSize * (std::abs(plane.x) + std::abs(plane.y) + std::abs(plane.z));
+                if (distance < 0.0f) return false;
+            }
+            return true;
+        }
+    }
+
+    ChunkMeshingPipeline::ChunkMeshingPipeline(jobs::JobSystem& jobSystem)
+            : m_JobSystem(jobSystem), m_Meshers(jobSystem.GetWorkerCount()), m_ActiveTasks(ActiveTaskMap::allocator_type(m_NodePool)) {}
+
+    ChunkMeshingPipeline::~ChunkMeshingPipeline() {
+        for (auto& [position, task] : m_ActiveTasks) task->isCancelled.store(true, std::memory_order_relaxed);
+        m_JobSystem.Wait(m_Counter);
+    }
+
+    void ChunkMeshingPipeline::MarkDirty(const world::ChunkPosition& position) {
+        m_DirtyChunks[position] = world::DirtySlices::Full();
+    }
+
+    void ChunkMeshingPipeline::MarkDirty(const world::ChunkPosition& position, const world::DirtySlices& slices) {
+        m_DirtyChunks[position].Merge(slices);
+    }
+
+    void ChunkMeshingPipeline::MarkDirtySlices(const world::DirtySliceMap& dirtySlices) {
+        for (const auto& [position, slices] : dirtySlices) MarkDirty(position, slices);
+    }
+
+    void ChunkMeshingPipeline::Cancel(const world::ChunkPosition& position) {
+        m_DirtyChunks.erase(position);
+        m_Meshes.erase(position);
+        if (const auto it = m_ActiveTasks.find(position); it != m_ActiveTasks.end()) {
+            CancelTask(it->second);
+            m_ActiveTasks.erase(it);
+        }
+    }
+
+    void ChunkMeshingPipeline::CancelTask(MeshingTask* task) {
+        if (task->isFinished) {
+            m_ReadyTasks.erase(std::find(m_ReadyTasks.begin(), m_ReadyTasks.end(), task));
+            RecycleTask(task);
+        } else {
+            // The job still owns the task until it finishes, it is recycled once collected
+            task->isCancelled.store(true, std::memory_order_relaxed);
+            m_InFlightCount--;
+        }
+    }
+
+    void ChunkMeshingPipeline::Update(const world::World& world, const math::Vector3& cameraPosition,
+                                      const std::array<math::Vector4, 6>& frustumPlanes, memory::LinearArena& frameArena,
+                                      const float range) {
+        TRACE_ZONE("ChunkMeshingPipeline::Update");
+        m_CameraPosition = cameraPosition;
+        m_FrustumPlanes = frustumPlanes;
+        CollectFinishedTasks();
+        const auto isOutOfRange = [&](const world::ChunkPosition& position) { return GetDistance(position, cameraPosition) > range; };
+        for (auto it = m_ActiveTasks.begin(); it != m_ActiveTasks.end();) {
+            if (isOutOfRange(it->first)) {
+                CancelTask(it->second);
+                it = m_ActiveTasks.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (auto it = m_Meshes.begin(); it != m_Meshes.end();)
+            it = isOutOfRange(it->first) ? m_Meshes.erase(it) : std::next(it);
+        // Chunks that are not resident are dropped as well, whatever loads them marks them dirty again. Chunks with an active task
+        // wait for it, their remesh builds on its mesh.
+        typedef std::pair<float, world::ChunkPosition> Candidate;
+        memory::ArenaVector<Candidate> candidates{memory::ArenaAllocator<Candidate>(frameArena)};
+        candidates.reserve(m_DirtyChunks.size());
+        for (auto it = m_DirtyChunks.begin(); it != m_DirtyChunks.end();) {
+            if (isOutOfRange(it->first) || !world.GetChunk(it->first)) {
+                it = m_DirtyChunks.erase(it);
+            } else {
+                if (!m_ActiveTasks.count(it->first)) candidates.emplace_back(GetPriority(it->first), it->first);
+                ++it;
+            }
+        }
+        const size_t jobLimit = static_cast<size_t>(m_JobSystem.GetWorkerCount()) * MESHING_JOBS_PER_WORKER;
+        if (m_InFlightCount >= jobLimit || candidates.empty()) return;
+        const size_t scheduleCount = std::min(jobLimit - m_InFlightCount, candidates.size());
+        std::partial_sort(candidates.begin(), candidates.begin() + scheduleCount, candidates.end(),
+                          [](const auto& left, const auto& right) { return left.first < right.first; });
+        for (size_t candidateIndex = 0; candidateIndex < scheduleCount; candidateIndex++) {
+            const auto& [priority, position] = candidates[candidateIndex];
+            const auto dirty = m_DirtyChunks.find(position);
+            Schedule(world, position, dirty->second, priority);
+            m_DirtyChunks.erase(dirty);
+        }
+    }
+
+    float ChunkMeshingPipeline::GetPriority(const world::ChunkPosition& position) const {
+        const float distance = GetDistance(position, m_CameraPosition);
+        return IsInFrustum(position, m_FrustumPlanes) ? distance : distance * MESHING_OUTSIDE_FRUSTUM_DISTANCE_SCALE;
+    }
+
+    ChunkMeshingPipeline::MeshingTask* ChunkMeshingPipeline::AcquireTask() {
+        if (m_FreeTasks.empty()) {
+            m_Tasks.push_back(std::make_unique<MeshingTask>());
+            return m_Tasks.back().get();
+        }
+        MeshingTask* task = m_FreeTasks.back();
+        m_FreeTasks.pop_back();
+        return task;
+    }
+
+    void ChunkMeshingPipeline::RecycleTask(MeshingTask* task) {
+        m_FreeTasks.push_back(task);
+    }
+
+    void ChunkMeshingPipeline::RetainMesh(MeshingTask* task) {
+        // Swapping hands the task the buffers of the mesh before, so neither side allocates once both have grown
+        ChunkMesh& mesh = m_Meshes[task->position];
+        mesh.vertices.swap(task->mesh.vertices);
+        mesh.sliceQuadOffsets.swap(task->mesh.sliceQuadOffsets);
+        mesh.sliceQuadCounts.swap(task->mesh.sliceQuadCounts);
+        m_ActiveTasks.erase(task->position);
+        RecycleTask(task);
+    }
+
+    void ChunkMeshingPipeline::Schedule(const world::World& world, const world::ChunkPosition& position, const world::DirtySlices& slices,
+                                        const float priority) {
+        MeshingTask* task = AcquireTask();
+        task->position = position;
+        task->priority = priority;
+        // Copies keep the capacity of the task's previous chunk, so this rarely allocates
+        task->chunk = *world.GetChunk(position);
+        ExtractBorders(GetChunkNeighbours(world, position), task->borders);
+        task->slices = slices;
+        // A recycled task still holds the mesh of some other chunk, without a last mesh of this one it has to start over
+        if (const auto mesh = m_Meshes.find(position); mesh != m_Meshes.end()) {
+            task->mesh.vertices.swap(mesh->second.vertices);
+            task->mesh.sliceQuadOffsets.swap(mesh->second.sliceQuadOffsets);
+            task->mesh.sliceQuadCounts.swap(mesh->second.sliceQuadCounts);
+            m_Meshes.erase(mesh);
+        } else {
+            task->slices = world::DirtySlices::Full();
+        }
+        task->isCancelled.store(false, std::memory_order_relaxed);
+        task->isFinished = false;
+        m_ActiveTasks[position] = task;
+        m_InFlightCount++;
+        // Tasks are recycled, but each one is only in flight once at a time
+        TRACE_FLOW_BEGIN("Meshing", reinterpret_cast<uintptr_t>(task));
+        m_JobSystem.Run([this, task] {
+            TRACE_ZONE("Mesh chunk");
+            TRACE_FLOW_END("Meshing", reinterpret_cast<uintptr_t>(task));
+            if (!task->isCancelled.load(std::memory_order_relaxed))
+                m_Meshers[m_JobSystem.GetWorkerIndex()].Remesh(task->chunk, task->borders, task->slices, task->mesh);
+            std::lock_guard<std::mutex> lock(m_FinishedMutex);
+            m_FinishedTasks.push_back(task);
+        }, &m_Counter);
+    }
+
+    void ChunkMeshingPipeline::CollectFinishedTasks() {
+        {
+            std::lock_guard<std::mutex> lock(m_FinishedMutex);
+            m_CollectedTasks.swap(m_FinishedTasks);
+        }
+        for (MeshingTask* task : m_CollectedTasks) {
+            // Cancelling removes the active entry, so one that was not cancelled is still the active task of its chunk
+            if (task->isCancelled.load(std::memory_order_relaxed)) {
+                RecycleTask(task);
+            } else {
+                task->isFinished = true;
+                m_InFlightCount--;
+                m_ReadyTasks.push_back(task);
+            }
+        }
+        m_CollectedTasks.clear();
+    }
+
+    void ChunkMeshingPipeline::SortReadyTasks() {
+        for (MeshingTask* task : m_ReadyTasks) task->priority = GetPriority(task->position);
+        std::sort(m_ReadyTasks.begin(), m_ReadyTasks.end(), [](const MeshingTask* left, const MeshingTask* right) {
+            return left->priority < right->priority;
+        });
+    }
+}
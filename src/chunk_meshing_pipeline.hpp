@@ -0,0 +1,154 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "chunk_mesher.hpp"
+#include "job_system.hpp"
+#include "memory_arena.hpp"
+#include "tracer.hpp"
+#include "vector_math.hpp"
+#include "world.hpp"
+
+// Distance from the camera in blocks past which chunks are neither meshed nor kept waiting for upload
+#define CHUNK_MESHING_RANGE 512.0f
+// Meshing jobs kept in flight per worker, few enough that new priorities take effect within a frame or two
+#define MESHING_JOBS_PER_WORKER 2
+// Chunks outside the frustum are meshed as if they were this many times further away
+#define MESHING_OUTSIDE_FRUSTUM_DISTANCE_SCALE 4.0f
+// Vertex and index bytes handed to the upload path per frame, at least one mesh goes through regardless
+#define MESH_UPLOAD_BUDGET_BYTES (4ull * 1024 * 1024)
+
+namespace voxelfield::rendering {
+    /// Meshes dirty chunks on the job system without stalling the frame. Once a frame the main thread ranks the dirty chunks by
+    /// distance to the camera and whether they are in the frustum, then copies the most urgent ones along with the border layers of
+    /// their neighbours, so workers mesh from snapshots while the world keeps changing. Chunks that leave the range have their jobs
+    /// cancelled, and finished meshes are handed out nearest first within a per-frame byte budget.
+    ///
+    /// The vertices of the last mesh handed out are kept per chunk, so a chunk with only a few dirty slices is remeshed by rebuilding
+    /// those and splicing them in. A chunk that changes while it is being meshed waits for that job and is then remeshed on top of it.
+    class ChunkMeshingPipeline {
+    public:
+        explicit ChunkMeshingPipeline(jobs::JobSystem& jobSystem);
+
+        /// Cancels everything in flight and waits for running jobs to notice
+        ~ChunkMeshingPipeline();
+
+        ChunkMeshingPipeline(const ChunkMeshingPipeline&) = delete;
+
+        ChunkMeshingPipeline& operator=(const ChunkMeshingPipeline&) = delete;
+
+        /// Queues the chunk to be meshed from scratch, for chunks that were loaded or whose neighbours were
+        void MarkDirty(const world::ChunkPosition& position);
+
+        /// Queues the slices for remeshing on top of the chunk's last mesh
+        void MarkDirty(const world::ChunkPosition& position, const world::DirtySlices& slices);
+
+        void MarkDirtySlices(const world::DirtySliceMap& dirtySlices);
+
+        /// Forgets the chunk and its last mesh, for when it is unloaded
+        void Cancel(const world::ChunkPosition& position);
+
+        /// Reprioritizes for the camera, drops chunks out of range and schedules meshing jobs until the in flight limit, called
+        /// once a frame from the main thread. Candidates are ranked in the frame arena.
+        void Update(const world::World& world, const math::Vector3& cameraPosition, const std::array<math::Vector4, 6>& frustumPlanes,
+                    memory::LinearArena& frameArena, float range = CHUNK_MESHING_RANGE);
+
+        /// Calls back with finished meshes, most urgent first, until the byte budget is spent. Empty meshes are handed out as well
+        /// so the caller can drop what it drew before. Returns the number of meshes handed out.
+        template<typename Callback>
+        size_t Upload(Callback&& upload, const uint64 byteBudget = MESH_UPLOAD_BUDGET_BYTES) {
+            TRACE_ZONE("ChunkMeshingPipeline::Upload");
+            CollectFinishedTasks();
+            SortReadyTasks();
+            size_t uploadedCount = 0;
+            uint64 uploadedSize = 0;
+            for (; uploadedCount < m_ReadyTasks.size() && (uploadedCount == 0 || uploadedSize < byteBudget); uploadedCount++) {
+                MeshingTask* task = m_ReadyTasks[uploadedCount];
+                uploadedSize += CountChangedVertices(task->mesh) * sizeof(ChunkVertex);
+                upload(task->position, static_cast<const ChunkMesh&>(task->mesh));
+                RetainMesh(task);
+            }
+            m_ReadyTasks.erase(m_ReadyTasks.begin(), m_ReadyTasks.begin() + uploadedCount);
+            return uploadedCount;
+        }
+
+        bool IsDirty(const world::ChunkPosition& position) const {
+            return m_DirtyChunks.count(position) > 0;
+        }
+
+        size_t GetDirtyCount() const {
+            return m_DirtyChunks.size();
+        }
+
+        size_t GetInFlightCount() const {
+            return m_InFlightCount;
+        }
+
+        size_t GetReadyCount() const {
+            return m_ReadyTasks.size();
+        }
+
+    private:
+        struct MeshingTask {
+            world::ChunkPosition position;
+            // Lower is more urgent
+            float priority;
+            world::Chunk chunk;
+            ChunkBorders borders;
+            world::DirtySlices slices;
+            // Starts out as the chunk's last mesh when only some slices are dirty
+            ChunkMesh mesh;
+            std::atomic<bool> isCancelled{false};
+            // Set once the main thread has collected the finished job, only touched by the main thread
+            bool isFinished;
+        };
+
+        typedef std::unordered_map<world::ChunkPosition, MeshingTask*, world::ChunkPositionHash, std::equal_to<world::ChunkPosition>,
+                                   memory::PoolAllocator<std::pair<const world::ChunkPosition, MeshingTask*>>> ActiveTaskMap;
+
+        jobs::JobSystem& m_JobSystem;
+        // One per worker, indexed by the worker running the job
+        std::vector<ChunkMesher> m_Meshers;
+        // Every task ever created, the rest of the containers only point into it. Tasks are recycled so meshes keep their capacity.
+        std::vector<std::unique_ptr<MeshingTask>> m_Tasks;
+        std::vector<MeshingTask*> m_FreeTasks;
+        world::DirtySliceMap m_DirtyChunks;
+        // Nodes of the active tasks come and go every frame, pooling them keeps that off the heap
+        memory::NodePool m_NodePool;
+        // Task of every chunk that is being meshed or waits for upload, at most one per chunk
+        ActiveTaskMap m_ActiveTasks;
+        std::vector<MeshingTask*> m_ReadyTasks;
+        size_t m_InFlightCount = 0;
+        // Vertices and slice offsets of the last mesh handed out for each chunk, without indices
+        std::unordered_map<world::ChunkPosition, ChunkMesh, world::ChunkPositionHash> m_Meshes;
+        // Written by workers as jobs finish, cancelled or not
+        std::mutex m_FinishedMutex;
+        std::vector<MeshingTask*> m_FinishedTasks;
+        std::vector<MeshingTask*> m_CollectedTasks;
+        jobs::Counter m_Counter;
+        math::Vector3 m_CameraPosition{};
+        std::array<math::Vector4, 6> m_FrustumPlanes{};
+
+        float GetPriority(const world::ChunkPosition& position) const;
+
+        MeshingTask* AcquireTask();
+
+        void RecycleTask(MeshingTask* task);
+
+        /// Keeps the mesh of an uploaded task as the chunk's last mesh and recycles the task
+        void RetainMesh(MeshingTask* task);
+
+        void CancelTask(MeshingTask* task);
+
+        void Schedule(const world::World& world, const world::ChunkPosition& position, const world::DirtySlices& slices, float priority);
+
+        void CollectFinishedTasks();
+
+        void SortReadyTasks();
+    };
+}
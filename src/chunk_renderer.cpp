@@ -0,0 +1,422 @@
+#include "chunk_renderer.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "logger.hpp"
+#include "string_util.hpp"
+#include "tracer.hpp"
+
+namespace voxelfield::rendering {
+    namespace {
+        ChunkRecord CreateChunkRecord(const math::Vector3& origin, const std::vector<ChunkVertex>& vertices, const size_t indexCount,
+                                      const memory::SubAllocation& vertexRange, const memory::SubAllocation& indexRange) {
+            // Bounds of the corners actually used, tighter than the whole chunk for sparse meshes
+            uint32 minimumX = std::numeric_limits<uint32>::max(), minimumY = minimumX, minimumZ = minimumX, maximumX = 0, maximumY = 0, maximumZ = 0;
+            for (const ChunkVertex& vertex : vertices) {
+                // Padding quads of the slice ranges, air is never meshed
+                if (vertex.materialData == 0) continue;
+                const uint32 x = vertex.positionData & MAX_CHUNK_VERTEX_COORDINATE,
+                        y = vertex.positionData >> CHUNK_VERTEX_Y_SHIFT & MAX_CHUNK_VERTEX_COORDINATE,
+                        z = vertex.positionData >> CHUNK_VERTEX_Z_SHIFT & MAX_CHUNK_VERTEX_COORDINATE;
+                minimumX = std::min(minimumX, x);
+                minimumY = std::min(minimumY, y);
+                minimumZ = std::min(minimumZ, z);
+                maximumX = std::max(maximumX, x);
+                maximumY = std::max(maximumY, y);
+                maximumZ = std::max(maximumZ, z);
+            }
+            return {
+                    {origin.x, origin.y, origin.z, 0.0f},
+                    {origin.x + minimumX, origin.y + minimumY, origin.z + minimumZ, 0.0f},
+                    {origin.x + maximumX, origin.y + maximumY, origin.z + maximumZ, 0.0f},
+                    static_cast<uint32>(indexCount),
+                    static_cast<uint32>(indexRange.offset),
+                    static_cast<int32>(vertexRange.offset),
+                    0
+            };
+        }
+    }
+
+    void ChunkRenderer::Create(const VkDevice logicalDeviceHandle, memory::DeviceMemoryAllocator& memoryAllocator,
+                               memory::UploadManager& uploadManager, PipelineRegistry& pipelineRegistry,
+                               const std::vector<uint32>& queueFamilyIndices, const uint32 framesInFlight) {
+        TRACE_ZONE("ChunkRenderer::Create");
+        m_LogicalDeviceHandle = logicalDeviceHandle;
+        m_MemoryAllocator = &memoryAllocator;
+        m_UploadManager = &uploadManager;
+        m_FramesInFlight = framesInFlight;
+        m_VertexBufferAllocation = memoryAllocator.CreateBuffer(
+                sizeof(ChunkVertex) * CHUNK_VERTEX_BUFFER_CAPACITY, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                queueFamilyIndices, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memory::MemoryPoolType::PERSISTENT, m_VertexBufferHandle);
+        m_IndexBufferAllocation = memoryAllocator.CreateBuffer(
+                sizeof(uint32) * CHUNK_INDEX_BUFFER_CAPACITY, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                queueFamilyIndices, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memory::MemoryPoolType::PERSISTENT, m_IndexBufferHandle);
+        m_ChunkRecordAllocation = memoryAllocator.CreateBuffer(
+                sizeof(ChunkRecord) * MAX_RENDERED_CHUNKS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                queueFamilyIndices, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memory::MemoryPoolType::PERSISTENT, m_ChunkRecordBufferHandle);
+        m_VisibilityAllocation = memoryAllocator.CreateBuffer(
+                sizeof(uint32) * MAX_RENDERED_CHUNKS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                queueFamilyIndices, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memory::MemoryPoolType::PERSISTENT, m_VisibilityBufferHandle);
+        m_VertexAllocator = std::make_unique<memory::FreeListSubAllocator>(CHUNK_VERTEX_BUFFER_CAPACITY);
+        m_IndexAllocator = std::make_unique<memory::FreeListSubAllocator>(CHUNK_INDEX_BUFFER_CAPACITY);
+        m_Frames.resize(framesInFlight);
+        for (FrameResources& frame : m_Frames) {
+            // Only the graphics queue touches the indirect arguments
+            const std::vector<uint32> graphicsQueueFamilyIndex{queueFamilyIndices.front()};
+            frame.drawCommandAllocation = memoryAllocator.CreateBuffer(
+                    sizeof(VkDrawIndexedIndirectCommand) * MAX_RENDERED_CHUNKS * static_cast<uint32>(CullPhase::COUNT), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                    graphicsQueueFamilyIndex, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memory::MemoryPoolType::PERSISTENT,
+                    frame.drawCommandBufferHandle);
+            frame.drawCountAllocation = memoryAllocator.CreateBuffer(
+                    sizeof(uint32) * static_cast<uint32>(CullPhase::COUNT), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    graphicsQueueFamilyIndex, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memory::MemoryPoolType::PERSISTENT,
+                    frame.drawCountBufferHandle);
+            // Written by the CPU right before recording, the frame's fence guarantees the GPU is done reading the previous values
+            frame.uniformAllocation = memoryAllocator.CreateBuffer(
+                    sizeof(CullUniforms), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, graphicsQueueFamilyIndex,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, memory::MemoryPoolType::PERSISTENT,
+                    frame.uniformBufferHandle);
+            frame.patchStagingAllocation = memoryAllocator.CreateBuffer(
+                    CHUNK_PATCH_STAGING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, graphicsQueueFamilyIndex,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, memory::MemoryPoolType::PERSISTENT,
+                    frame.patchStagingBufferHandle);
+        }
+        CreateDescriptors();
+        CreatePipelineLayouts();
+        m_CullPipelineHandle = pipelineRegistry.GetComputePipeline({pipelineRegistry.GetShaderModule("shaders/cull.spv"), m_CullPipelineLayoutHandle});
+        logging::Log(logging::LogType::INFORMATION_LOG,
+                     FORMAT("Successfully created chunk renderer for up to {} chunks, {} vertices and {} indices"), MAX_RENDERED_CHUNKS,
+                     CHUNK_VERTEX_BUFFER_CAPACITY, CHUNK_INDEX_BUFFER_CAPACITY);
+    }
+
+    void ChunkRenderer::CreateDescriptors() {
+        const std::array<VkDescriptorSetLayoutBinding, 6> bindings{
+                // Chunk records, read by culling and by the vertex shader for the chunk origin
+                VkDescriptorSetLayoutBinding{0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT, nullptr},
+                // Draw commands, draw counts and the visibility of last frame
+                VkDescriptorSetLayoutBinding{1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+                VkDescriptorSetLayoutBinding{2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+                VkDescriptorSetLayoutBinding{3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+                VkDescriptorSetLayoutBinding{4, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+                // Hi-Z pyramid, written once a frame has one to bind
+                VkDescriptorSetLayoutBinding{5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}
+        };
+        VkDescriptorSetLayoutCreateInfo layoutCreationInformation{
+                VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+                nullptr,
+                0,
+                static_cast<uint32>(bindings.size()), bindings.data()
+        };
+        if (const VkResult result = vkCreateDescriptorSetLayout(m_LogicalDeviceHandle, &layoutCreationInformation, nullptr, &m_DescriptorSetLayoutHandle);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create chunk descriptor set layout"), result));
+        }
+        const std::array<VkDescriptorPoolSize, 3> poolSizes{
+                VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 * m_FramesInFlight},
+                VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_FramesInFlight},
+                VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_FramesInFlight}
+        };
+        VkDescriptorPoolCreateInfo poolCreationInformation{
+                VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+                nullptr,
+                0,
+                m_FramesInFlight,
+                static_cast<uint32>(poolSizes.size()), poolSizes.data()
+        };
+        if (const VkResult result = vkCreateDescriptorPool(m_LogicalDeviceHandle, &poolCreationInformation, nullptr, &m_DescriptorPoolHandle);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create chunk descriptor pool"), result));
+        }
+        const std::vector<VkDescriptorSetLayout> setLayouts(m_FramesInFlight, m_DescriptorSetLayoutHandle);
+        std::vector<VkDescriptorSet> descriptorSets(m_FramesInFlight);
+        VkDescriptorSetAllocateInfo allocationInformation{
+                VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+                nullptr,
+                m_DescriptorPoolHandle,
+                m_FramesInFlight, setLayouts.data()
+        };
+        if (const VkResult result = vkAllocateDescriptorSets(m_LogicalDeviceHandle, &allocationInformation, descriptorSets.data());
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not allocate chunk descriptor sets"), result));
+        }
+        for (uint32 frameIndex = 0; frameIndex < m_FramesInFlight; frameIndex++) {
+            FrameResources& frame = m_Frames[frameIndex];
+            frame.descriptorSetHandle = descriptorSets[frameIndex];
+            const std::array<VkDescriptorBufferInfo, 5> bufferInformation{
+                    VkDescriptorBufferInfo{m_ChunkRecordBufferHandle, 0, VK_WHOLE_SIZE},
+                    VkDescriptorBufferInfo{frame.drawCommandBufferHandle, 0, VK_WHOLE_SIZE},
+                    VkDescriptorBufferInfo{frame.drawCountBufferHandle, 0, VK_WHOLE_SIZE},
+                    VkDescriptorBufferInfo{m_VisibilityBufferHandle, 0, VK_WHOLE_SIZE},
+                    VkDescriptorBufferInfo{frame.uniformBufferHandle, 0, VK_WHOLE_SIZE}
+            };
+            std::array<VkWriteDescriptorSet, 5> writes{};
+            for (uint32 binding = 0; binding < writes.size(); binding++) {
+                writes[binding] = {
+                        VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                        nullptr,
+                        frame.descriptorSetHandle,
+                        binding, 0, 1,
+                        binding == 4 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                        nullptr, &bufferInformation[binding], nullptr
+                };
+            }
+            vkUpdateDescriptorSets(m_LogicalDeviceHandle, static_cast<uint32>(writes.size()), writes.data(), 0, nullptr);
+        }
+    }
+
+    void ChunkRenderer::BindDepthPyramid(FrameResources& frame, const HiZPyramid& depthPyramid) {
+        if (frame.boundPyramidViewHandle == depthPyramid.GetImageViewHandle()) return;
+        VkDescriptorImageInfo imageInformation{depthPyramid.GetSamplerHandle(), depthPyramid.GetImageViewHandle(), VK_IMAGE_LAYOUT_GENERAL};
+        VkWriteDescriptorSet write{
+                VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                nullptr,
+                frame.descriptorSetHandle,
+                5, 0, 1,
+                VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                &imageInformation, nullptr, nullptr
+        };
+        vkUpdateDescriptorSets(m_LogicalDeviceHandle, 1, &write, 0, nullptr);
+        frame.boundPyramidViewHandle = depthPyramid.GetImageViewHandle();
+    }
+
+    void ChunkRenderer::CreatePipelineLayouts() {
+        VkPushConstantRange cullPushConstantRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants)};
+        VkPipelineLayoutCreateInfo cullLayoutCreationInformation{
+                VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+                nullptr,
+                0,
+                1, &m_DescriptorSetLayoutHandle,
+                1, &cullPushConstantRange
+        };
+        if (const VkResult result = vkCreatePipelineLayout(m_LogicalDeviceHandle, &cullLayoutCreationInformation, nullptr, &m_CullPipelineLayoutHandle);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create chunk culling pipeline layout"), result));
+        }
+        VkPushConstantRange drawPushConstantRange{VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ChunkPushConstants)};
+        VkPipelineLayoutCreateInfo drawLayoutCreationInformation{
+                VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+                nullptr,
+                0,
+                1, &m_DescriptorSetLayoutHandle,
+                1, &drawPushConstantRange
+        };
+        if (const VkResult result = vkCreatePipelineLayout(m_LogicalDeviceHandle, &drawLayoutCreationInformation, nullptr, &m_DrawPipelineLayoutHandle);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create chunk draw pipeline layout"), result));
+        }
+    }
+
+    void ChunkRenderer::Release() {
+        if (m_LogicalDeviceHandle == VK_NULL_HANDLE) return;
+        vkDestroyPipelineLayout(m_LogicalDeviceHandle, m_DrawPipelineLayoutHandle, nullptr);
+        vkDestroyPipelineLayout(m_LogicalDeviceHandle, m_CullPipelineLayoutHandle, nullptr);
+        vkDestroyDescriptorPool(m_LogicalDeviceHandle, m_DescriptorPoolHandle, nullptr);
+        vkDestroyDescriptorSetLayout(m_LogicalDeviceHandle, m_DescriptorSetLayoutHandle, nullptr);
+        for (FrameResources& frame : m_Frames) {
+            vkDestroyBuffer(m_LogicalDeviceHandle, frame.drawCommandBufferHandle, nullptr);
+            vkDestroyBuffer(m_LogicalDeviceHandle, frame.drawCountBufferHandle, nullptr);
+            vkDestroyBuffer(m_LogicalDeviceHandle, frame.uniformBufferHandle, nullptr);
+            vkDestroyBuffer(m_LogicalDeviceHandle, frame.patchStagingBufferHandle, nullptr);
+            m_MemoryAllocator->Free(frame.drawCommandAllocation);
+            m_MemoryAllocator->Free(frame.drawCountAllocation);
+            m_MemoryAllocator->Free(frame.uniformAllocation);
+            m_MemoryAllocator->Free(frame.patchStagingAllocation);
+        }
+        m_Frames.clear();
+        vkDestroyBuffer(m_LogicalDeviceHandle, m_VertexBufferHandle, nullptr);
+        vkDestroyBuffer(m_LogicalDeviceHandle, m_IndexBufferHandle, nullptr);
+        vkDestroyBuffer(m_LogicalDeviceHandle, m_ChunkRecordBufferHandle, nullptr);
+        vkDestroyBuffer(m_LogicalDeviceHandle, m_VisibilityBufferHandle, nullptr);
+        m_MemoryAllocator->Free(m_VertexBufferAllocation);
+        m_MemoryAllocator->Free(m_IndexBufferAllocation);
+        m_MemoryAllocator->Free(m_ChunkRecordAllocation);
+        m_MemoryAllocator->Free(m_VisibilityAllocation);
+        m_VertexAllocator.reset();
+        m_IndexAllocator.reset();
+        m_ChunkAllocations.clear();
+        m_FreeChunkIds.clear();
+        m_RetiredChunks.clear();
+        m_PatchData.clear();
+        m_PendingPatches.clear();
+        m_PendingRemovals.clear();
+        m_ChunkSlotCount = 0;
+        m_LogicalDeviceHandle = VK_NULL_HANDLE;
+    }
+
+    std::optional<uint32> ChunkRenderer::AddChunk(const math::Vector3& origin, const std::vector<ChunkVertex>& vertices,
+                                                  const std::vector<uint32>& indices) {
+        if (indices.empty()) return std::nullopt;
+        if (m_FreeChunkIds.empty() && m_ChunkSlotCount == MAX_RENDERED_CHUNKS) {
+            logging::Log(logging::LogType::WARNING_LOG, "Reached the chunk renderer limit of chunk records");
+            return std::nullopt;
+        }
+        const std::optional<memory::SubAllocation> vertexRange = m_VertexAllocator->Allocate(vertices.size(), 1);
+        if (!vertexRange) {
+            logging::Log(logging::LogType::WARNING_LOG, "Shared chunk vertex buffer is full");
+            return std::nullopt;
+        }
+        const std::optional<memory::SubAllocation> indexRange = m_IndexAllocator->Allocate(indices.size(), 1);
+        if (!indexRange) {
+            m_VertexAllocator->Free(vertexRange.value());
+            logging::Log(logging::LogType::WARNING_LOG, "Shared chunk index buffer is full");
+            return std::nullopt;
+        }
+        uint32 chunkId;
+        if (m_FreeChunkIds.empty()) {
+            chunkId = m_ChunkSlotCount++;
+            m_ChunkAllocations.emplace_back();
+        } else {
+            chunkId = m_FreeChunkIds.back();
+            m_FreeChunkIds.pop_back();
+        }
+        m_ChunkAllocations[chunkId] = {vertexRange.value(), indexRange.value()};
+        const ChunkRecord record = CreateChunkRecord(origin, vertices, indices.size(), vertexRange.value(), indexRange.value());
+        m_UploadManager->Upload(m_VertexBufferHandle, vertexRange->offset * sizeof(ChunkVertex), vertices.data(), vertices.size() * sizeof(ChunkVertex));
+        m_UploadManager->Upload(m_IndexBufferHandle, indexRange->offset * sizeof(uint32), indices.data(), indices.size() * sizeof(uint32));
+        m_UploadManager->Upload(m_ChunkRecordBufferHandle, chunkId * sizeof(ChunkRecord), &record, sizeof(record));
+        // New chunks start out visible so they land in the next depth prepass, the late phase corrects this within a frame
+        const uint32 initialVisibility = 1;
+        m_UploadManager->Upload(m_VisibilityBufferHandle, chunkId * sizeof(uint32), &initialVisibility, sizeof(initialVisibility));
+        return chunkId;
+    }
+
+    bool ChunkRenderer::UpdateChunk(const uint32 chunkId, const math::Vector3& origin, const std::vector<ChunkVertex>& vertices,
+                                    const std::vector<uint32>& indices, const std::vector<VertexRange>& changedVertexRanges) {
+        const ChunkAllocation& allocation = m_ChunkAllocations[chunkId];
+        if (indices.empty() || vertices.size() > allocation.vertices.size || indices.size() > allocation.indices.size) return false;
+        VkDeviceSize vertexSize = 0;
+        for (const VertexRange& range : changedVertexRanges) vertexSize += range.count * sizeof(ChunkVertex);
+        if (m_PatchData.size() + vertexSize + sizeof(ChunkRecord) > CHUNK_PATCH_STAGING_SIZE) return false;
+        for (const VertexRange& range : changedVertexRanges)
+            QueuePatch(m_VertexBufferHandle, (allocation.vertices.offset + range.first) * sizeof(ChunkVertex), vertices.data() + range.first,
+                       range.count * sizeof(ChunkVertex));
+        const ChunkRecord record = CreateChunkRecord(origin, vertices, indices.size(), allocation.vertices, allocation.indices);
+        QueuePatch(m_ChunkRecordBufferHandle, chunkId * sizeof(ChunkRecord), &record, sizeof(record));
+        return true;
+    }
+
+    void ChunkRenderer::QueuePatch(const VkBuffer destinationHandle, const VkDeviceSize destinationOffset, const void* data, const VkDeviceSize size) {
+        if (size == 0) return;
+        const size_t sourceOffset = m_PatchData.size();
+        m_PatchData.resize(sourceOffset + size);
+        std::memcpy(m_PatchData.data() + sourceOffset, data, size);
+        m_PendingPatches.push_back({destinationHandle, {sourceOffset, destinationOffset, size}});
+    }
+
+    void ChunkRenderer::RecordPatches(const VkCommandBuffer commandBufferHandle, FrameResources& frame) {
+        if (m_PendingPatches.empty() && m_PendingRemovals.empty()) return;
+        // The frame's fence has signalled, so the GPU is done with what was staged the last time this frame recorded
+        if (!m_PatchData.empty()) std::memcpy(frame.patchStagingAllocation.mapping, m_PatchData.data(), m_PatchData.size());
+        // Barriers cover every command submitted to the queue before them, so earlier frames finish reading the old mesh first
+        VkMemoryBarrier readBarrier{
+                VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                nullptr,
+                VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_ACCESS_TRANSFER_WRITE_BIT
+        };
+        vkCmdPipelineBarrier(commandBufferHandle,
+                             VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &readBarrier, 0, nullptr, 0, nullptr);
+        for (const PendingPatch& patch : m_PendingPatches)
+            vkCmdCopyBuffer(commandBufferHandle, frame.patchStagingBufferHandle, patch.destinationHandle, 1, &patch.region);
+        // Only the index count is cleared, culling skips records without indices
+        for (const uint32 chunkId : m_PendingRemovals)
+            vkCmdFillBuffer(commandBufferHandle, m_ChunkRecordBufferHandle, chunkId * sizeof(ChunkRecord) + offsetof(ChunkRecord, indexCount),
+                            sizeof(uint32), 0);
+        VkMemoryBarrier writeBarrier{
+                VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                nullptr,
+                VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT
+        };
+        vkCmdPipelineBarrier(commandBufferHandle, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 1, &writeBarrier, 0, nullptr, 0, nullptr);
+        m_PatchData.clear();
+        m_PendingPatches.clear();
+        m_PendingRemovals.clear();
+    }
+
+    void ChunkRenderer::RemoveChunk(const uint32 chunkId) {
+        // Clearing it through the transfer queue would race patches of the same record recorded on the graphics queue
+        m_PendingRemovals.push_back(chunkId);
+        m_RetiredChunks.push_back({chunkId, m_FrameNumber});
+    }
+
+    void ChunkRenderer::BeginFrame(const uint64 frameNumber) {
+        m_FrameNumber = frameNumber;
+        m_RetiredChunks.erase(std::remove_if(m_RetiredChunks.begin(), m_RetiredChunks.end(), [&](const RetiredChunk& retired) {
+            if (m_FrameNumber < retired.retiredFrameNumber + m_FramesInFlight) return false;
+            const ChunkAllocation& allocation = m_ChunkAllocations[retired.chunkId];
+            m_VertexAllocator->Free(allocation.vertices);
+            m_IndexAllocator->Free(allocation.indices);
+            m_FreeChunkIds.push_back(retired.chunkId);
+            return true;
+        }), m_RetiredChunks.end());
+    }
+
+    void ChunkRenderer::RecordCulling(const VkCommandBuffer commandBufferHandle, const uint32 frameIndex, const math::Matrix4& viewProjection,
+                                      const CullPhase phase, const HiZPyramid& depthPyramid) {
+        FrameResources& frame = m_Frames[frameIndex];
+        if (phase == CullPhase::EARLY) {
+            RecordPatches(commandBufferHandle, frame);
+            BindDepthPyramid(frame, depthPyramid);
+            const VkExtent2D pyramidExtent = depthPyramid.GetExtent();
+            const CullUniforms uniforms{
+                    viewProjection,
+                    math::ExtractFrustumPlanes(viewProjection),
+                    static_cast<float>(pyramidExtent.width), static_cast<float>(pyramidExtent.height),
+                    m_ChunkSlotCount, 0
+            };
+            std::memcpy(frame.uniformAllocation.mapping, &uniforms, sizeof(uniforms));
+            vkCmdFillBuffer(commandBufferHandle, frame.drawCountBufferHandle, 0, VK_WHOLE_SIZE, 0);
+            // Also orders this frame's reads of the visibility after the writes of the previous frame's late phase
+            VkMemoryBarrier clearBarrier{
+                    VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                    nullptr,
+                    VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                    VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+            };
+            vkCmdPipelineBarrier(commandBufferHandle, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+        }
+        if (m_ChunkSlotCount > 0) {
+            const CullPushConstants pushConstants{phase};
+            vkCmdBindPipeline(commandBufferHandle, VK_PIPELINE_BIND_POINT_COMPUTE, m_CullPipelineHandle);
+            vkCmdBindDescriptorSets(commandBufferHandle, VK_PIPELINE_BIND_POINT_COMPUTE, m_CullPipelineLayoutHandle, 0, 1, &frame.descriptorSetHandle,
+                                    0, nullptr);
+            vkCmdPushConstants(commandBufferHandle, m_CullPipelineLayoutHandle, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+            vkCmdDispatch(commandBufferHandle, (m_ChunkSlotCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+        }
+        // The late phase reads the visibility the early phase read, so its writes wait for those too
+        VkMemoryBarrier cullBarrier{
+                VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                nullptr,
+                VK_ACCESS_SHADER_WRITE_BIT,
+                VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+        };
+        vkCmdPipelineBarrier(commandBufferHandle, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+    }
+
+    void ChunkRenderer::RecordDraw(const VkCommandBuffer commandBufferHandle, const uint32 frameIndex, const CullPhase phase) const {
+        if (m_ChunkSlotCount == 0) return;
+        const FrameResources& frame = m_Frames[frameIndex];
+        vkCmdBindDescriptorSets(commandBufferHandle, VK_PIPELINE_BIND_POINT_GRAPHICS, m_DrawPipelineLayoutHandle, 0, 1, &frame.descriptorSetHandle,
+                                0, nullptr);
+        const VkDeviceSize vertexBufferOffset = 0;
+        vkCmdBindVertexBuffers(commandBufferHandle, 0, 1, &m_VertexBufferHandle, &vertexBufferOffset);
+        vkCmdBindIndexBuffer(commandBufferHandle, m_IndexBufferHandle, 0, VK_INDEX_TYPE_UINT32);
+        // The chunk ID travels as the first instance so the vertex shader can look up the chunk origin
+        const auto listIndex = static_cast<uint32>(phase);
+        vkCmdDrawIndexedIndirectCount(commandBufferHandle, frame.drawCommandBufferHandle,
+                                      sizeof(VkDrawIndexedIndirectCommand) * MAX_RENDERED_CHUNKS * listIndex,
+                                      frame.drawCountBufferHandle, sizeof(uint32) * listIndex, m_ChunkSlotCount,
+                                      sizeof(VkDrawIndexedIndirectCommand));
+    }
+}
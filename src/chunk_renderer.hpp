@@ -0,0 +1,165 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "type_definitions.hpp"
+#include "vector_math.hpp"
+#include "vertex.hpp"
+#include "sub_allocator.hpp"
+#include "device_memory_allocator.hpp"
+#include "upload_manager.hpp"
+#include "pipeline_registry.hpp"
+#include "hiz_pyramid.hpp"
+
+#define MAX_RENDERED_CHUNKS 131072u
+// Capacities of the shared mesh buffers in vertices and indices
+#define CHUNK_VERTEX_BUFFER_CAPACITY (8u * 1024 * 1024)
+#define CHUNK_INDEX_BUFFER_CAPACITY (12u * 1024 * 1024)
+#define CULL_WORKGROUP_SIZE 64u
+// Host memory per frame in flight for patching meshes in place, chunks past it are uploaded anew
+#define CHUNK_PATCH_STAGING_SIZE (4ull * 1024 * 1024)
+
+namespace voxelfield::rendering {
+    /// Per-chunk entry of the storage buffer read by cull.comp and shader.vert, laid out to match std430
+    struct ChunkRecord {
+        math::Vector4 origin, boundsMinimum, boundsMaximum;
+        // An index count of zero marks a free slot
+        uint32 indexCount, firstIndex;
+        int32 vertexOffset;
+        uint32 padding;
+    };
+
+    static_assert(sizeof(ChunkRecord) == 64, "Chunk records have to match the std430 layout in the shaders");
+
+    /// Culling runs twice a frame. The early phase picks the chunks visible last frame for the depth prepass, the late phase tests
+    /// every chunk against the Hi-Z pyramid built from that prepass and picks what the main pass draws.
+    enum class CullPhase : uint32 {
+        EARLY, LATE, COUNT
+    };
+
+    /// Per-frame culling inputs, laid out to match std140. Too large for the guaranteed push constant space.
+    struct CullUniforms {
+        math::Matrix4 viewProjection;
+        std::array<math::Vector4, 6> frustumPlanes;
+        float pyramidWidth, pyramidHeight;
+        uint32 chunkCount, padding;
+    };
+
+    static_assert(sizeof(CullUniforms) == 176, "Cull uniforms have to match the std140 layout in cull.comp");
+
+    struct CullPushConstants {
+        CullPhase phase;
+    };
+
+    /// Keeps every chunk mesh in one shared vertex and index buffer and draws all of them with a single indirect draw. A compute
+    /// pass frustum and occlusion culls the chunk records each frame and compacts the visible ones into the indirect argument buffer,
+    /// so the CPU records the same handful of commands whether ten or a hundred thousand chunks are loaded.
+    class ChunkRenderer {
+    public:
+        void Create(VkDevice logicalDeviceHandle, memory::DeviceMemoryAllocator& memoryAllocator, memory::UploadManager& uploadManager,
+                    PipelineRegistry& pipelineRegistry, const std::vector<uint32>& queueFamilyIndices, uint32 framesInFlight);
+
+        void Release();
+
+        /// Uploads a mesh with positions relative to the origin and returns its chunk ID. Returns nothing when the mesh is empty
+        /// or the shared buffers have no room left.
+        std::optional<uint32> AddChunk(const math::Vector3& origin, const std::vector<ChunkVertex>& vertices, const std::vector<uint32>& indices);
+
+        /// Overwrites the changed vertex ranges of the chunk's mesh when the new mesh fits the ranges of the old one. Indices only
+        /// depend on the quad, so the ones uploaded with the chunk stay valid. The copies are recorded on the graphics queue at the
+        /// start of the next frame, ordered after every earlier frame that reads the old mesh. Returns false when the mesh does not
+        /// fit or the patch staging memory is used up, the caller replaces the chunk then.
+        bool UpdateChunk(uint32 chunkId, const math::Vector3& origin, const std::vector<ChunkVertex>& vertices, const std::vector<uint32>& indices,
+                         const std::vector<VertexRange>& changedVertexRanges);
+
+        /// Stops drawing the chunk from the next frame recorded on, its buffer space is reused once no frame in flight can still read
+        /// it. The record is cleared on the graphics queue like patches are, so it stays ordered after earlier patches of the chunk.
+        void RemoveChunk(uint32 chunkId);
+
+        /// Reclaims the space of removed chunks, called once the fence of the oldest frame in flight has signalled
+        void BeginFrame(uint64 frameNumber);
+
+        /// Records the culling dispatch of one phase, has to happen outside the render pass that draws its list. The late phase
+        /// expects the pyramid to have been built from the depth of the early list.
+        void RecordCulling(VkCommandBuffer commandBufferHandle, uint32 frameIndex, const math::Matrix4& viewProjection, CullPhase phase,
+                           const HiZPyramid& depthPyramid);
+
+        /// Binds the shared buffers and issues the indirect draw of a phase's list, the caller binds the pipeline and pushes the view projection
+        void RecordDraw(VkCommandBuffer commandBufferHandle, uint32 frameIndex, CullPhase phase) const;
+
+        VkPipelineLayout GetDrawPipelineLayout() const {
+            return m_DrawPipelineLayoutHandle;
+        }
+
+        uint32 GetChunkCount() const {
+            return m_ChunkSlotCount - static_cast<uint32>(m_FreeChunkIds.size());
+        }
+
+    private:
+        struct ChunkAllocation {
+            memory::SubAllocation vertices, indices;
+        };
+
+        struct RetiredChunk {
+            uint32 chunkId;
+            uint64 retiredFrameNumber;
+        };
+
+        struct PendingPatch {
+            VkBuffer destinationHandle;
+            // Source offsets are into the patch data
+            VkBufferCopy region;
+        };
+
+        // Indirect arguments are written by the GPU every frame, so each frame in flight gets its own. Both phases share the
+        // buffers, each list starts MAX_RENDERED_CHUNKS commands and one count after the previous.
+        struct FrameResources {
+            VkBuffer drawCommandBufferHandle = VK_NULL_HANDLE, drawCountBufferHandle = VK_NULL_HANDLE, uniformBufferHandle = VK_NULL_HANDLE,
+                    patchStagingBufferHandle = VK_NULL_HANDLE;
+            memory::DeviceAllocation drawCommandAllocation, drawCountAllocation, uniformAllocation, patchStagingAllocation;
+            VkDescriptorSet descriptorSetHandle = VK_NULL_HANDLE;
+            // The pyramid changes on resize, the set is only rewritten once this frame's previous submission has finished with it
+            VkImageView boundPyramidViewHandle = VK_NULL_HANDLE;
+        };
+
+        VkDevice m_LogicalDeviceHandle = VK_NULL_HANDLE;
+        memory::DeviceMemoryAllocator* m_MemoryAllocator = nullptr;
+        memory::UploadManager* m_UploadManager = nullptr;
+        uint32 m_FramesInFlight = 0;
+        VkBuffer m_VertexBufferHandle = VK_NULL_HANDLE, m_IndexBufferHandle = VK_NULL_HANDLE, m_ChunkRecordBufferHandle = VK_NULL_HANDLE,
+                m_VisibilityBufferHandle = VK_NULL_HANDLE;
+        memory::DeviceAllocation m_VertexBufferAllocation, m_IndexBufferAllocation, m_ChunkRecordAllocation, m_VisibilityAllocation;
+        // Sub-allocate in units of vertices and indices rather than bytes
+        std::unique_ptr<memory::FreeListSubAllocator> m_VertexAllocator, m_IndexAllocator;
+        std::vector<ChunkAllocation> m_ChunkAllocations;
+        std::vector<uint32> m_FreeChunkIds;
+        std::vector<RetiredChunk> m_RetiredChunks;
+        // Patches queued since the last frame was recorded, copied into that frame's staging buffer when it records
+        std::vector<uint8> m_PatchData;
+        std::vector<PendingPatch> m_PendingPatches;
+        // Chunks removed since the last frame was recorded, their index counts are cleared along with the patches
+        std::vector<uint32> m_PendingRemovals;
+        // One past the highest chunk ID handed out, culling covers this many records
+        uint32 m_ChunkSlotCount = 0;
+        uint64 m_FrameNumber = 0;
+        std::vector<FrameResources> m_Frames;
+        VkDescriptorSetLayout m_DescriptorSetLayoutHandle = VK_NULL_HANDLE;
+        VkDescriptorPool m_DescriptorPoolHandle = VK_NULL_HANDLE;
+        VkPipelineLayout m_CullPipelineLayoutHandle = VK_NULL_HANDLE, m_DrawPipelineLayoutHandle = VK_NULL_HANDLE;
+        VkPipeline m_CullPipelineHandle = VK_NULL_HANDLE;
+
+        void CreateDescriptors();
+
+        void CreatePipelineLayouts();
+
+        void BindDepthPyramid(FrameResources& frame, const HiZPyramid& depthPyramid);
+
+        void QueuePatch(VkBuffer destinationHandle, VkDeviceSize destinationOffset, const void* data, VkDeviceSize size);
+
+        void RecordPatches(VkCommandBuffer commandBufferHandle, FrameResources& frame);
+    };
+}
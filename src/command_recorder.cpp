@@ -0,0 +1,64 @@
+#include "command_recorder.hpp"
+
+#include <stdexcept>
+
+#include "logger.hpp"
+#include "string_util.hpp"
+#include "tracer.hpp"
+
+namespace voxelfield::rendering {
+    void CommandRecorder::Create(const VkDevice logicalDeviceHandle, const uint32 queueFamilyIndex, const uint32 framesInFlight) {
+        TRACE_ZONE("CommandRecorder::Create");
+        m_LogicalDeviceHandle = logicalDeviceHandle;
+        m_FramePoolHandles.resize(framesInFlight);
+        m_PrimaryCommandBufferHandles.resize(framesInFlight);
+        for (uint32 frameIndex = 0; frameIndex < framesInFlight; frameIndex++) {
+            VkCommandPoolCreateInfo poolCreationInformation{
+                    VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                    nullptr,
+                    VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+                    queueFamilyIndex
+            };
+            if (const VkResult result = vkCreateCommandPool(m_LogicalDeviceHandle, &poolCreationInformation, nullptr, &m_FramePoolHandles[frameIndex]);
+                    result != VK_SUCCESS) {
+                throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create Vulkan command pool"), result));
+            }
+            VkCommandBufferAllocateInfo commandBufferAllocationInformation{
+                    VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                    nullptr,
+                    m_FramePoolHandles[frameIndex],
+                    VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                    1
+            };
+            if (const VkResult result = vkAllocateCommandBuffers(m_LogicalDeviceHandle, &commandBufferAllocationInformation,
+                                                                 &m_PrimaryCommandBufferHandles[frameIndex]); result != VK_SUCCESS) {
+                throw std::runtime_error(util::Format(FORMAT("Error code {}, could not allocate Vulkan command buffers"), result));
+            }
+        }
+        logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Successfully created command recorder for {} frames in flight"), framesInFlight);
+    }
+
+    void CommandRecorder::Release() {
+        if (m_LogicalDeviceHandle == VK_NULL_HANDLE) return;
+        // Destroying a pool frees every command buffer allocated from it
+        for (const VkCommandPool poolHandle : m_FramePoolHandles) vkDestroyCommandPool(m_LogicalDeviceHandle, poolHandle, nullptr);
+        m_FramePoolHandles.clear();
+        m_PrimaryCommandBufferHandles.clear();
+        m_LogicalDeviceHandle = VK_NULL_HANDLE;
+    }
+
+    VkCommandBuffer CommandRecorder::BeginFrame(const uint32 frameIndex) {
+        vkResetCommandPool(m_LogicalDeviceHandle, m_FramePoolHandles[frameIndex], 0);
+        const VkCommandBuffer primaryHandle = m_PrimaryCommandBufferHandles[frameIndex];
+        VkCommandBufferBeginInfo beginInfo{
+                VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                nullptr,
+                VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+                nullptr
+        };
+        if (const VkResult result = vkBeginCommandBuffer(primaryHandle, &beginInfo); result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, failed to begin command buffer"), result));
+        }
+        return primaryHandle;
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include "type_definitions.hpp"
+
+namespace voxelfield::rendering {
+    /// Records the primary command buffer of every frame from a command pool per frame. The pool of a frame is reset as a whole once
+    /// that frame's fence has signalled, which is far cheaper than resetting buffers one by one. Chunks go out in one indirect draw
+    /// per phase, so there is nothing left to spread over secondary command buffers on other threads.
+    class CommandRecorder {
+    public:
+        void Create(VkDevice logicalDeviceHandle, uint32 queueFamilyIndex, uint32 framesInFlight);
+
+        void Release();
+
+        /// Resets the pool of the frame, the frame's previous submission must have completed
+        VkCommandBuffer BeginFrame(uint32 frameIndex);
+
+    private:
+        VkDevice m_LogicalDeviceHandle = VK_NULL_HANDLE;
+        std::vector<VkCommandPool> m_FramePoolHandles;
+        std::vector<VkCommandBuffer> m_PrimaryCommandBufferHandles;
+    };
+}
@@ -0,0 +1,132 @@
+#include "compression.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace voxelfield::compression {
+    namespace {
+        // Limits set by the block format, the last bytes are always literals so decoders can copy without checks near the end
+        constexpr size_t MIN_MATCH = 4;
+        constexpr size_t LAST_LITERALS = 5;
+        constexpr size_t MATCH_FIND_LIMIT = 12;
+        constexpr size_t MAX_OFFSET = 65535;
+        // Misses in a row before the match finder starts skipping ahead, data that does not compress goes through quickly
+        constexpr uint32 SKIP_TRIGGER = 6;
+
+        uint32 Read32(const uint8* data) {
+            uint32 value;
+            std::memcpy(&value, data, sizeof(uint32));
+            return value;
+        }
+
+        uint32 Hash(const uint32 sequence) {
+            return (sequence * 2654435761u) >> (32 - COMPRESSION_HASH_BITS);
+        }
+
+        uint8* WriteLength(uint8* destination, size_t length) {
+            for (; length >= 255; length -= 255) *destination++ = 255;
+            *destination++ = static_cast<uint8>(length);
+            return destination;
+        }
+
+        uint8* WriteLiterals(uint8* destination, uint8* token, const uint8* literals, const size_t literalLength) {
+            *token = static_cast<uint8>((literalLength < 15 ? literalLength : 15) << 4);
+            if (literalLength >= 15) destination = WriteLength(destination, literalLength - 15);
+            std::memcpy(destination, literals, literalLength);
+            return destination + literalLength;
+        }
+
+        bool ReadLength(const uint8*& source, const uint8* sourceEnd, size_t& length) {
+            uint8 byte;
+            do {
+                if (source == sourceEnd) return false;
+                byte = *source++;
+                length += byte;
+            } while (byte == 255);
+            return true;
+        }
+    }
+
+    size_t GetMaxCompressedSize(const size_t size) {
+        return size + size / 255 + 16;
+    }
+
+    size_t Compress(const uint8* source, const size_t size, uint8* destination) {
+        uint8* output = destination;
+        size_t anchor = 0;
+        if (size > MATCH_FIND_LIMIT) {
+            std::array<uint32, 1u << COMPRESSION_HASH_BITS> positions{};
+            const size_t matchEndLimit = size - LAST_LITERALS, matchStartLimit = size - MATCH_FIND_LIMIT;
+            size_t position = 1;
+            uint32 missCount = 0;
+            while (position <= matchStartLimit) {
+                const uint32 sequence = Read32(source + position);
+                uint32& slot = positions[Hash(sequence)];
+                size_t candidate = slot;
+                slot = static_cast<uint32>(position);
+                if (position - candidate > MAX_OFFSET || Read32(source + candidate) != sequence) {
+                    position += 1 + (missCount++ >> SKIP_TRIGGER);
+                    continue;
+                }
+                missCount = 0;
+                while (position > anchor && candidate > 0 && source[position - 1] == source[candidate - 1]) {
+                    position--;
+                    candidate--;
+                }
+                size_t matchLength = MIN_MATCH;
+                while (position + matchLength < matchEndLimit && source[position + matchLength] == source[candidate + matchLength])
+                    matchLength++;
+                uint8* token = output++;
+                output = WriteLiterals(output, token, source + anchor, position - anchor);
+                const auto offset = static_cast<uint16>(position - candidate);
+                *output++ = static_cast<uint8>(offset);
+                *output++ = static_cast<uint8>(offset >> 8);
+                const size_t lengthCode = matchLength - MIN_MATCH;
+                *token |= static_cast<uint8>(lengthCode < 15 ? lengthCode : 15);
+                if (lengthCode >= 15) output = WriteLength(output, lengthCode - 15);
+                position += matchLength;
+                anchor = position;
+            }
+        }
+        uint8* token = output++;
+        output = WriteLiterals(output, token, source + anchor, size - anchor);
+        return static_cast<size_t>(output - destination);
+    }
+
+    bool Decompress(const uint8* source, const size_t size, uint8* destination, const size_t decompressedSize) {
+        const uint8* sourceEnd = source + size;
+        uint8* output = destination;
+        const uint8* outputEnd = destination + decompressedSize;
+        while (source < sourceEnd) {
+            const uint8 token = *source++;
+            size_t literalLength = token >> 4;
+            if (literalLength == 15 && !ReadLength(source, sourceEnd, literalLength)) return false;
+            if (literalLength > static_cast<size_t>(sourceEnd - source) || literalLength > static_cast<size_t>(outputEnd - output))
+                return false;
+            std::memcpy(output, source, literalLength);
+            source += literalLength;
+            output += literalLength;
+            // Only the last sequence ends after its literals
+            if (source == sourceEnd) break;
+            if (sourceEnd - source < 2) return false;
+            const size_t offset = source[0] | static_cast<size_t>(source[1]) << 8;
+            source += 2;
+            size_t matchLength = token & 15;
+            if (matchLength == 15 && !ReadLength(source, sourceEnd, matchLength)) return false;
+            matchLength += MIN_MATCH;
+            if (offset == 0 || offset > static_cast<size_t>(output - destination) || matchLength > static_cast<size_t>(outputEnd - output))
+                return false;
+            // Matches closer than their length repeat the last offset bytes, which is how runs are encoded. Any whole number of
+            // periods back holds the same bytes, so the copies double in size and never overlap.
+            size_t copiedLength = 0;
+            for (size_t step = offset; copiedLength < matchLength; step *= 2) {
+                const size_t length = std::min(step, matchLength - copiedLength);
+                std::memcpy(output + copiedLength, output + copiedLength - step, length);
+                copiedLength += length;
+            }
+            output += matchLength;
+        }
+        return output == outputEnd;
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+
+#include "type_definitions.hpp"
+
+// Positions remembered by the match finder, as a power of two
+#define COMPRESSION_HASH_BITS 12u
+
+namespace voxelfield::compression {
+    /// Worst case output of Compress for input of the given size, incompressible data grows slightly
+    size_t GetMaxCompressedSize(size_t size);
+
+    /// Compresses into the LZ4 block format with a greedy single probe match finder, which trades ratio for speed much like the
+    /// reference fast mode. The destination needs room for GetMaxCompressedSize bytes. Returns the compressed size.
+    size_t Compress(const uint8* source, size_t size, uint8* destination);
+
+    /// Decompresses a block written by Compress, or by any LZ4 block compressor. Checks every length and offset against both
+    /// buffers, so corrupt input returns false rather than reading or writing out of bounds.
+    bool Decompress(const uint8* source, size_t size, uint8* destination, size_t decompressedSize);
+}
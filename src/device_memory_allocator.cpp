@@ -0,0 +1,235 @@
+#include "device_memory_allocator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "logger.hpp"
+#include "string_util.hpp"
+#include "tracer.hpp"
+
+namespace voxelfield::memory {
+    static const char* GetPoolName(const MemoryPoolType poolType) {
+        switch (poolType) {
+            case MemoryPoolType::PERSISTENT:
+                return "persistent";
+            case MemoryPoolType::STREAMING:
+                return "streaming";
+            default:
+                return "unknown";
+        }
+    }
+
+    void DeviceMemoryAllocator::Create(const VkPhysicalDevice physicalDeviceHandle, const VkDevice logicalDeviceHandle,
+                                       const VkPhysicalDeviceLimits& limits) {
+        TRACE_ZONE("DeviceMemoryAllocator::Create");
+        m_LogicalDeviceHandle = logicalDeviceHandle;
+        vkGetPhysicalDeviceMemoryProperties(physicalDeviceHandle, &m_MemoryProperties);
+        m_BufferImageGranularity = std::max<VkDeviceSize>(limits.bufferImageGranularity, 1);
+        m_NonCoherentAtomSize = std::max<VkDeviceSize>(limits.nonCoherentAtomSize, 1);
+        m_MaxAllocationCount = limits.maxMemoryAllocationCount;
+    }
+
+    void DeviceMemoryAllocator::Release() {
+        for (auto& poolBlocks : m_Blocks) {
+            for (auto& block : poolBlocks)
+                ReleaseBlock(*block);
+            poolBlocks.clear();
+        }
+    }
+
+    uint32 DeviceMemoryAllocator::FindMemoryTypeIndex(const uint32 memoryTypeBits, const VkMemoryPropertyFlags requiredProperties,
+                                                      const VkMemoryPropertyFlags preferredProperties) const {
+        std::optional<uint32> fallbackMemoryTypeIndex;
+        for (uint32 i = 0; i < m_MemoryProperties.memoryTypeCount; i++) {
+            const VkMemoryPropertyFlags propertyFlags = m_MemoryProperties.memoryTypes[i].propertyFlags;
+            if (!(memoryTypeBits & (1u << i)) || (propertyFlags & requiredProperties) != requiredProperties) continue;
+            if ((propertyFlags & preferredProperties) == preferredProperties) return i;
+            if (!fallbackMemoryTypeIndex.has_value()) fallbackMemoryTypeIndex = i;
+        }
+        if (!fallbackMemoryTypeIndex.has_value())
+            throw std::runtime_error("Failed to find suitable memory type");
+        return fallbackMemoryTypeIndex.value();
+    }
+
+    DeviceMemoryBlock& DeviceMemoryAllocator::CreateBlock(const MemoryPoolType poolType, const uint32 memoryTypeIndex, const VkDeviceSize size,
+                                                          const bool isDedicated) {
+        if (m_MaxAllocationCount && m_DeviceAllocationCount >= m_MaxAllocationCount) {
+            throw std::runtime_error(util::Format(FORMAT("Reached the limit of {} device memory allocations"), m_MaxAllocationCount));
+        }
+        VkMemoryAllocateInfo memoryAllocationInformation{
+                VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                nullptr,
+                size,
+                memoryTypeIndex
+        };
+        VkDeviceMemory memoryHandle;
+        if (const VkResult result = vkAllocateMemory(m_LogicalDeviceHandle, &memoryAllocationInformation, nullptr, &memoryHandle);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not allocate {} bytes of device memory"), result, size));
+        }
+        m_DeviceAllocationCount++;
+        void* mapping = nullptr;
+        if (m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            if (const VkResult result = vkMapMemory(m_LogicalDeviceHandle, memoryHandle, 0, VK_WHOLE_SIZE, 0, &mapping); result != VK_SUCCESS) {
+                vkFreeMemory(m_LogicalDeviceHandle, memoryHandle, nullptr);
+                m_DeviceAllocationCount--;
+                throw std::runtime_error(util::Format(FORMAT("Error code {}, could not map device memory block"), result));
+            }
+        }
+        std::unique_ptr<SubAllocator> subAllocator;
+        if (isDedicated)
+            subAllocator = std::make_unique<FreeListSubAllocator>(size);
+        else if (poolType == MemoryPoolType::STREAMING)
+            subAllocator = std::make_unique<BuddySubAllocator>(size, BUDDY_MINIMUM_BLOCK_SIZE);
+        else
+            subAllocator = std::make_unique<FreeListSubAllocator>(size);
+        auto& poolBlocks = m_Blocks[static_cast<size_t>(poolType)];
+        poolBlocks.push_back(std::make_unique<DeviceMemoryBlock>(
+                DeviceMemoryBlock{memoryHandle, size, mapping, memoryTypeIndex, poolType, isDedicated, std::move(subAllocator)}));
+        return *poolBlocks.back();
+    }
+
+    void DeviceMemoryAllocator::ReleaseBlock(DeviceMemoryBlock& block) {
+        // Freeing implicitly unmaps
+        vkFreeMemory(m_LogicalDeviceHandle, block.memoryHandle, nullptr);
+        m_DeviceAllocationCount--;
+    }
+
+    DeviceAllocation DeviceMemoryAllocator::Allocate(const VkMemoryRequirements& memoryRequirements, const VkMemoryPropertyFlags requiredProperties,
+                                                     const MemoryPoolType poolType, const VkMemoryPropertyFlags preferredProperties) {
+        const uint32 memoryTypeIndex = FindMemoryTypeIndex(memoryRequirements.memoryTypeBits, requiredProperties, preferredProperties);
+        const VkMemoryPropertyFlags propertyFlags = m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+        // Aligning everything to the buffer image granularity lets linear and optimal resources share a block
+        VkDeviceSize alignment = std::max(memoryRequirements.alignment, m_BufferImageGranularity);
+        if ((propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+            alignment = std::max(alignment, m_NonCoherentAtomSize);
+        const VkDeviceSize size = AlignUp(memoryRequirements.size, alignment);
+        DeviceMemoryBlock* block = nullptr;
+        std::optional<SubAllocation> subAllocation;
+        if (size > DEVICE_MEMORY_BLOCK_SIZE) {
+            block = &CreateBlock(poolType, memoryTypeIndex, size, true);
+            subAllocation = block->subAllocator->Allocate(size, alignment);
+        } else {
+            for (auto& candidateBlock : m_Blocks[static_cast<size_t>(poolType)]) {
+                if (candidateBlock->memoryTypeIndex != memoryTypeIndex || candidateBlock->isDedicated) continue;
+                if ((subAllocation = candidateBlock->subAllocator->Allocate(size, alignment))) {
+                    block = candidateBlock.get();
+                    break;
+                }
+            }
+            if (!block) {
+                block = &CreateBlock(poolType, memoryTypeIndex, DEVICE_MEMORY_BLOCK_SIZE, false);
+                subAllocation = block->subAllocator->Allocate(size, alignment);
+            }
+        }
+        if (!subAllocation.has_value()) {
+            throw std::runtime_error(util::Format(FORMAT("Could not sub-allocate {} bytes from the {} pool"), size, GetPoolName(poolType)));
+        }
+        return {
+                block->memoryHandle,
+                subAllocation->offset,
+                memoryRequirements.size,
+                block->mapping ? static_cast<char*>(block->mapping) + subAllocation->offset : nullptr,
+                block,
+                subAllocation.value()
+        };
+    }
+
+    DeviceAllocation DeviceMemoryAllocator::AllocateForBuffer(const VkBuffer bufferHandle, const VkMemoryPropertyFlags requiredProperties,
+                                                              const MemoryPoolType poolType, const VkMemoryPropertyFlags preferredProperties) {
+        VkMemoryRequirements memoryRequirements;
+        vkGetBufferMemoryRequirements(m_LogicalDeviceHandle, bufferHandle, &memoryRequirements);
+        DeviceAllocation allocation = Allocate(memoryRequirements, requiredProperties, poolType, preferredProperties);
+        if (const VkResult result = vkBindBufferMemory(m_LogicalDeviceHandle, bufferHandle, allocation.memoryHandle, allocation.offset);
+                result != VK_SUCCESS) {
+            Free(allocation);
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not bind buffer memory"), result));
+        }
+        return allocation;
+    }
+
+    DeviceAllocation DeviceMemoryAllocator::CreateBuffer(const VkDeviceSize size, const VkBufferUsageFlags usage,
+                                                         const std::vector<uint32>& queueFamilyIndices, const VkMemoryPropertyFlags requiredProperties,
+                                                         const MemoryPoolType poolType, VkBuffer& bufferHandle) {
+        std::vector<uint32> uniqueQueueFamilyIndices(queueFamilyIndices);
+        std::sort(uniqueQueueFamilyIndices.begin(), uniqueQueueFamilyIndices.end());
+        uniqueQueueFamilyIndices.erase(std::unique(uniqueQueueFamilyIndices.begin(), uniqueQueueFamilyIndices.end()), uniqueQueueFamilyIndices.end());
+        const bool isConcurrent = uniqueQueueFamilyIndices.size() > 1;
+        VkBufferCreateInfo bufferCreationInformation{
+                VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                nullptr,
+                0,
+                size,
+                usage,
+                isConcurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+                isConcurrent ? static_cast<uint32>(uniqueQueueFamilyIndices.size()) : 0u,
+                isConcurrent ? uniqueQueueFamilyIndices.data() : nullptr
+        };
+        if (const VkResult result = vkCreateBuffer(m_LogicalDeviceHandle, &bufferCreationInformation, nullptr, &bufferHandle);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create Vulkan buffer of {} bytes"), result, size));
+        }
+        try {
+            return AllocateForBuffer(bufferHandle, requiredProperties, poolType);
+        } catch (...) {
+            vkDestroyBuffer(m_LogicalDeviceHandle, bufferHandle, nullptr);
+            bufferHandle = VK_NULL_HANDLE;
+            throw;
+        }
+    }
+
+    DeviceAllocation DeviceMemoryAllocator::AllocateForImage(const VkImage imageHandle, const VkMemoryPropertyFlags requiredProperties,
+                                                             const MemoryPoolType poolType, const VkMemoryPropertyFlags preferredProperties) {
+        VkMemoryRequirements memoryRequirements;
+        vkGetImageMemoryRequirements(m_LogicalDeviceHandle, imageHandle, &memoryRequirements);
+        DeviceAllocation allocation = Allocate(memoryRequirements, requiredProperties, poolType, preferredProperties);
+        if (const VkResult result = vkBindImageMemory(m_LogicalDeviceHandle, imageHandle, allocation.memoryHandle, allocation.offset);
+                result != VK_SUCCESS) {
+            Free(allocation);
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not bind image memory"), result));
+        }
+        return allocation;
+    }
+
+    void DeviceMemoryAllocator::Free(DeviceAllocation& allocation) {
+        DeviceMemoryBlock* block = allocation.block;
+        if (!block) return;
+        block->subAllocator->Free(allocation.subAllocation);
+        allocation = {};
+        if (block->isDedicated && block->subAllocator->GetAllocationCount() == 0) {
+            auto& poolBlocks = m_Blocks[static_cast<size_t>(block->poolType)];
+            ReleaseBlock(*block);
+            poolBlocks.erase(std::find_if(poolBlocks.begin(), poolBlocks.end(), [block](const auto& candidateBlock) {
+                return candidateBlock.get() == block;
+            }));
+        }
+    }
+
+    DeviceMemoryStatistics DeviceMemoryAllocator::GetStatistics(const MemoryPoolType poolType) const {
+        DeviceMemoryStatistics statistics{};
+        for (const auto& block : m_Blocks[static_cast<size_t>(poolType)]) {
+            const SubAllocator& subAllocator = *block->subAllocator;
+            statistics.blockCount++;
+            statistics.allocationCount += subAllocator.GetAllocationCount();
+            statistics.reservedSize += block->size;
+            statistics.usedSize += subAllocator.GetUsedSize();
+            statistics.freeSize += subAllocator.GetFreeSize();
+            statistics.largestFreeRange = std::max(statistics.largestFreeRange, subAllocator.GetLargestFreeRange());
+        }
+        statistics.fragmentation = statistics.freeSize
+                                   ? 1.0f - static_cast<float>(statistics.largestFreeRange) / static_cast<float>(statistics.freeSize)
+                                   : 0.0f;
+        return statistics;
+    }
+
+    void DeviceMemoryAllocator::LogStatistics() const {
+        for (size_t poolIndex = 0; poolIndex < static_cast<size_t>(MemoryPoolType::COUNT); poolIndex++) {
+            const auto poolType = static_cast<MemoryPoolType>(poolIndex);
+            const DeviceMemoryStatistics statistics = GetStatistics(poolType);
+            logging::Log(logging::LogType::INFORMATION_LOG,
+                         FORMAT("[Device memory] {:<10} {} blocks, {} allocations, {:.2f} of {:.2f} MiB used, {:.1f}% fragmented"),
+                         GetPoolName(poolType), statistics.blockCount, statistics.allocationCount, statistics.usedSize / (1024.0 * 1024.0),
+                         statistics.reservedSize / (1024.0 * 1024.0), statistics.fragmentation * 100.0f);
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "type_definitions.hpp"
+#include "sub_allocator.hpp"
+
+#define DEVICE_MEMORY_BLOCK_SIZE (64ull * 1024 * 1024)
+#define BUDDY_MINIMUM_BLOCK_SIZE 256ull
+
+namespace voxelfield::memory {
+    enum class MemoryPoolType : uint8 {
+        // Resources that live as long as the device such as chunk geometry buffers, free-list allocation
+        PERSISTENT,
+        // Resources that are created and destroyed constantly such as render targets recreated on every resize, buddy allocation
+        STREAMING,
+        COUNT
+    };
+
+    struct DeviceMemoryBlock {
+        VkDeviceMemory memoryHandle;
+        VkDeviceSize size;
+        void* mapping;
+        uint32 memoryTypeIndex;
+        MemoryPoolType poolType;
+        // Allocations larger than the pool's block size get a block of their own, released as soon as it empties
+        bool isDedicated;
+        std::unique_ptr<SubAllocator> subAllocator;
+    };
+
+    struct DeviceAllocation {
+        VkDeviceMemory memoryHandle = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0, size = 0;
+        // Host pointer to the start of the allocation, only set for host visible memory
+        void* mapping = nullptr;
+        DeviceMemoryBlock* block = nullptr;
+        SubAllocation subAllocation{};
+    };
+
+    struct DeviceMemoryStatistics {
+        uint32 blockCount, allocationCount;
+        VkDeviceSize reservedSize, usedSize, freeSize, largestFreeRange;
+        // One minus the largest free range over all free space, zero means the free space is contiguous
+        float fragmentation;
+    };
+
+    /// Takes large blocks of device memory per memory type and pool and sub-allocates buffers and images out of them,
+    /// instead of calling vkAllocateMemory for every resource. Host visible blocks stay persistently mapped.
+    class DeviceMemoryAllocator {
+    public:
+        void Create(VkPhysicalDevice physicalDeviceHandle, VkDevice logicalDeviceHandle, const VkPhysicalDeviceLimits& limits);
+
+        void Release();
+
+        DeviceAllocation Allocate(const VkMemoryRequirements& memoryRequirements, VkMemoryPropertyFlags requiredProperties,
+                                  MemoryPoolType poolType, VkMemoryPropertyFlags preferredProperties = 0);
+
+        DeviceAllocation AllocateForBuffer(VkBuffer bufferHandle, VkMemoryPropertyFlags requiredProperties, MemoryPoolType poolType,
+                                           VkMemoryPropertyFlags preferredProperties = 0);
+
+        /// Creates a buffer and binds memory to it. With more than one distinct queue family the buffer is shared concurrently,
+        /// so transfer and graphics queues can both use it without ownership transfer barriers.
+        DeviceAllocation CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, const std::vector<uint32>& queueFamilyIndices,
+                                      VkMemoryPropertyFlags requiredProperties, MemoryPoolType poolType, VkBuffer& bufferHandle);
+
+        DeviceAllocation AllocateForImage(VkImage imageHandle, VkMemoryPropertyFlags requiredProperties, MemoryPoolType poolType,
+                                          VkMemoryPropertyFlags preferredProperties = 0);
+
+        void Free(DeviceAllocation& allocation);
+
+        uint32 FindMemoryTypeIndex(uint32 memoryTypeBits, VkMemoryPropertyFlags requiredProperties, VkMemoryPropertyFlags preferredProperties = 0) const;
+
+        DeviceMemoryStatistics GetStatistics(MemoryPoolType poolType) const;
+
+        void LogStatistics() const;
+
+    private:
+        VkDevice m_LogicalDeviceHandle = VK_NULL_HANDLE;
+        VkPhysicalDeviceMemoryProperties m_MemoryProperties{};
+        VkDeviceSize m_BufferImageGranularity = 1, m_NonCoherentAtomSize = 1;
+        uint32 m_MaxAllocationCount = 0, m_DeviceAllocationCount = 0;
+        std::array<std::vector<std::unique_ptr<DeviceMemoryBlock>>, static_cast<size_t>(MemoryPoolType::COUNT)> m_Blocks;
+
+        DeviceMemoryBlock& CreateBlock(MemoryPoolType poolType, uint32 memoryTypeIndex, VkDeviceSize size, bool isDedicated);
+
+        void ReleaseBlock(DeviceMemoryBlock& block);
+    };
+}
@@ -0,0 +1,133 @@
+#include "frame_pacing.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace voxelfield::rendering {
+    std::optional<FramePacingProfile> ParseFramePacingProfile(const std::string& name) {
+        if (name == "low-latency") return FramePacingProfile::LOW_LATENCY;
+        if (name == "throughput") return FramePacingProfile::THROUGHPUT;
+        if (name == "power-saving") return FramePacingProfile::POWER_SAVING;
+        return std::nullopt;
+    }
+
+    const char* GetFramePacingProfileName(const FramePacingProfile profile) {
+        switch (profile) {
+            case FramePacingProfile::LOW_LATENCY:
+                return "low-latency";
+            case FramePacingProfile::THROUGHPUT:
+                return "throughput";
+            case FramePacingProfile::POWER_SAVING:
+                return "power-saving";
+        }
+        return "unknown";
+    }
+
+    uint32 ClampSwapchainImageCount(const uint32 imageCount, const VkSurfaceCapabilitiesKHR& surfaceCapabilities) {
+        const uint32 clampedImageCount = std::max(imageCount, surfaceCapabilities.minImageCount);
+        return surfaceCapabilities.maxImageCount > 0 ? std::min(clampedImageCount, surfaceCapabilities.maxImageCount) : clampedImageCount;
+    }
+
+    FramePacingSettings SelectFramePacingSettings(const FramePacingProfile profile, const std::vector<VkPresentModeKHR>& supportedPresentationModes,
+                                                  const VkSurfaceCapabilitiesKHR* surfaceCapabilities) {
+        const auto isSupported = [&](const VkPresentModeKHR presentMode) {
+            return std::find(supportedPresentationModes.begin(), supportedPresentationModes.end(), presentMode) != supportedPresentationModes.end();
+        };
+        // FIFO is the only mode every device has to support
+        const auto pickPresentMode = [&](const std::initializer_list<VkPresentModeKHR> preferredModes) {
+            for (const VkPresentModeKHR presentMode : preferredModes)
+                if (isSupported(presentMode)) return presentMode;
+            return VK_PRESENT_MODE_FIFO_KHR;
+        };
+        FramePacingSettings settings;
+        const uint32 minImageCount = surfaceCapabilities ? surfaceCapabilities->minImageCount : 2;
+        switch (profile) {
+            case FramePacingProfile::LOW_LATENCY:
+                // The CPU waits for the previous frame before sampling input, mailbox then shows the newest finished image without tearing
+                settings.presentMode = pickPresentMode({VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR});
+                settings.framesInFlight = 1;
+                settings.imageCount = settings.presentMode == VK_PRESENT_MODE_MAILBOX_KHR ? minImageCount + 1 : minImageCount;
+                break;
+            case FramePacingProfile::THROUGHPUT:
+                settings.presentMode = pickPresentMode({VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR});
+                settings.framesInFlight = MAX_FRAMES_IN_FLIGHT;
+                settings.imageCount = minImageCount + 1;
+                break;
+            case FramePacingProfile::POWER_SAVING:
+                settings.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+                settings.framesInFlight = 2;
+                settings.imageCount = minImageCount;
+                break;
+        }
+        if (surfaceCapabilities)
+            settings.imageCount = ClampSwapchainImageCount(settings.imageCount, *surfaceCapabilities);
+        return settings;
+    }
+
+    void FrameLimiter::SetFrameRate(const double framesPerSecond) {
+        m_FramePeriod = framesPerSecond > 0.0
+                        ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / framesPerSecond))
+                        : Clock::duration{0};
+        m_NextDeadline = Clock::now();
+    }
+
+    double FrameLimiter::Wait(const SleepFunction& sleepUntil) {
+        if (!IsEnabled()) return 0.0;
+        const Clock::time_point waitStart = Clock::now();
+        // Running late by more than a frame starts a new schedule instead of rushing to catch up
+        if (waitStart - m_NextDeadline > m_FramePeriod)
+            m_NextDeadline = waitStart;
+        const auto spinMargin = std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double, std::milli>(FRAME_LIMITER_SPIN_MARGIN_MILLISECONDS));
+        if (m_NextDeadline - waitStart > spinMargin) {
+            if (sleepUntil) sleepUntil(m_NextDeadline - spinMargin);
+            std::this_thread::sleep_until(m_NextDeadline - spinMargin);
+        }
+        while (Clock::now() < m_NextDeadline)
+            std::this_thread::yield();
+        m_NextDeadline += m_FramePeriod;
+        return std::chrono::duration<double, std::milli>(Clock::now() - waitStart).count();
+    }
+
+    void LatencyTracker::Create(const uint32 framesInFlight, profiling::FrameStatistics& frameStatistics) {
+        m_FrameStatistics = &frameStatistics;
+        m_LatencyMetric = frameStatistics.AddMetric("latency");
+        m_InputSamples.assign(framesInFlight, std::nullopt);
+    }
+
+    void LatencyTracker::MarkInputSampled(const uint32 frameIndex) {
+        m_InputSamples[frameIndex] = InputSample{Clock::now(), m_FrameStatistics->GetFrameCount()};
+    }
+
+    void LatencyTracker::Poll(const VkDevice logicalDeviceHandle, const std::vector<VkFence>& inFlightFenceHandles) {
+        const Clock::time_point now = Clock::now();
+        for (size_t frameIndex = 0; frameIndex < m_InputSamples.size(); frameIndex++) {
+            if (m_InputSamples[frameIndex].has_value() && vkGetFenceStatus(logicalDeviceHandle, inFlightFenceHandles[frameIndex]) == VK_SUCCESS)
+                RecordCompletion(frameIndex, now);
+        }
+    }
+
+    void LatencyTracker::WaitUntil(const VkDevice logicalDeviceHandle, const std::vector<VkFence>& inFlightFenceHandles, const Clock::time_point deadline) {
+        while (true) {
+            // Frames go through a single queue, so the oldest pending one is the next to finish
+            std::optional<size_t> oldestFrameIndex;
+            for (size_t frameIndex = 0; frameIndex < m_InputSamples.size(); frameIndex++) {
+                const std::optional<InputSample>& sample = m_InputSamples[frameIndex];
+                if (sample.has_value() && (!oldestFrameIndex || sample->frameNumber < m_InputSamples[oldestFrameIndex.value()]->frameNumber))
+                    oldestFrameIndex = frameIndex;
+            }
+            const Clock::time_point now = Clock::now();
+            if (!oldestFrameIndex || now >= deadline) return;
+            const auto timeout = static_cast<uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now).count());
+            if (vkWaitForFences(logicalDeviceHandle, 1, &inFlightFenceHandles[oldestFrameIndex.value()], VK_TRUE, timeout) != VK_SUCCESS) return;
+            RecordCompletion(oldestFrameIndex.value(), Clock::now());
+        }
+    }
+
+    void LatencyTracker::RecordCompletion(const size_t frameIndex, const Clock::time_point completionTime) {
+        std::optional<InputSample>& sample = m_InputSamples[frameIndex];
+        m_FrameStatistics->RecordFrame(sample->frameNumber, m_LatencyMetric,
+                                       std::chrono::duration<double, std::milli>(completionTime - sample->time).count());
+        sample.reset();
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "type_definitions.hpp"
+#include "frame_statistics.hpp"
+
+#define MAX_FRAMES_IN_FLIGHT 3
+// Sleeping is only trusted up to this close to the deadline, the rest is spun
+#define FRAME_LIMITER_SPIN_MARGIN_MILLISECONDS 1.5
+
+namespace voxelfield::rendering {
+    enum class FramePacingProfile {
+        LOW_LATENCY, THROUGHPUT, POWER_SAVING
+    };
+
+    struct FramePacingOptions {
+        FramePacingProfile profile = FramePacingProfile::THROUGHPUT;
+        // Zero leaves the frame rate uncapped
+        double frameRateLimit = 0.0;
+    };
+
+    struct FramePacingSettings {
+        VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+        uint32 imageCount = 0, framesInFlight = 2;
+    };
+
+    std::optional<FramePacingProfile> ParseFramePacingProfile(const std::string& name);
+
+    const char* GetFramePacingProfileName(FramePacingProfile profile);
+
+    /// Resolves a profile against what the surface supports, headless rendering passes no surface capabilities
+    FramePacingSettings SelectFramePacingSettings(FramePacingProfile profile, const std::vector<VkPresentModeKHR>& supportedPresentationModes,
+                                                  const VkSurfaceCapabilitiesKHR* surfaceCapabilities);
+
+    uint32 ClampSwapchainImageCount(uint32 imageCount, const VkSurfaceCapabilitiesKHR& surfaceCapabilities);
+
+    /// Caps the frame rate by sleeping for most of the frame and spinning for the last stretch, which keeps the
+    /// deadline accurate to well under a millisecond without burning a core for the whole wait.
+    class FrameLimiter {
+    public:
+        typedef std::function<void(std::chrono::steady_clock::time_point)> SleepFunction;
+
+        void SetFrameRate(double framesPerSecond);
+
+        /// Blocks until the next frame is due and returns how long it waited in milliseconds. The sleeping part can be handed
+        /// to a function that blocks on something else until the given time, whatever it leaves over is still slept.
+        double Wait(const SleepFunction& sleepUntil = nullptr);
+
+        bool IsEnabled() const {
+            return m_FramePeriod.count() > 0;
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        Clock::duration m_FramePeriod{0};
+        Clock::time_point m_NextDeadline;
+    };
+
+    /// Measures the time from when a frame samples input until its rendering is observed complete. Presentation itself is not
+    /// observable without extensions, so for FIFO this leaves out the wait for vertical blank. A completion is only as precise
+    /// as the poll that observes it, so polls go right after every blocking wait and submit, and the limiter sleeps in the fences.
+    /// Each sample lands in the statistics row of the frame that sampled the input, not the one that happened to observe it.
+    class LatencyTracker {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        void Create(uint32 framesInFlight, profiling::FrameStatistics& frameStatistics);
+
+        void MarkInputSampled(uint32 frameIndex);
+
+        /// Records every sampled frame whose fence has signalled by now without blocking
+        void Poll(VkDevice logicalDeviceHandle, const std::vector<VkFence>& inFlightFenceHandles);
+
+        /// Blocks on the pending fences in submission order until the deadline, recording each one the moment it signals
+        void WaitUntil(VkDevice logicalDeviceHandle, const std::vector<VkFence>& inFlightFenceHandles, Clock::time_point deadline);
+
+    private:
+        struct InputSample {
+            Clock::time_point time;
+            uint64 frameNumber;
+        };
+
+        profiling::FrameStatistics* m_FrameStatistics = nullptr;
+        uint32 m_LatencyMetric = 0;
+        std::vector<std::optional<InputSample>> m_InputSamples;
+
+        void RecordCompletion(size_t frameIndex, Clock::time_point completionTime);
+    };
+}
@@ -0,0 +1,117 @@
+#include "frame_statistics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+#include "logger.hpp"
+#include "string_util.hpp"
+
+namespace voxelfield::profiling {
+    FrameStatistics::FrameStatistics(const uint32 capacity, const double summaryIntervalSeconds)
+            : m_Rows(capacity), m_Scratch(capacity),
+              m_SummaryInterval(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(summaryIntervalSeconds))),
+              m_LastSummaryTime(Clock::now()) {
+        AddMetric("frame");
+        AddMetric("cpu");
+        AddMetric("present");
+        AddMetric("gpu");
+        ClearCurrentRow();
+    }
+
+    uint32 FrameStatistics::AddMetric(const char* name, const char* unit) {
+        if (m_MetricCount == MAX_FRAME_METRICS) {
+            throw std::runtime_error(util::Format(FORMAT("Too many frame metrics, could not add {}"), name));
+        }
+        m_MetricNames[m_MetricCount] = name;
+        m_MetricUnits[m_MetricCount] = unit;
+        return m_MetricCount++;
+    }
+
+    void FrameStatistics::EndFrame() {
+        m_Rows[m_NextRowIndex] = m_CurrentRow;
+        m_NextRowIndex = (m_NextRowIndex + 1) % static_cast<uint32>(m_Rows.size());
+        m_RowCount = std::min(m_RowCount + 1, static_cast<uint32>(m_Rows.size()));
+        m_FrameCount++;
+        ClearCurrentRow();
+        if (const Clock::time_point now = Clock::now(); now - m_LastSummaryTime >= m_SummaryInterval) {
+            m_LastSummaryTime = now;
+            LogSummary();
+        }
+    }
+
+    void FrameStatistics::RecordFrame(const uint64 frameNumber, const uint32 metricIndex, const double value) {
+        if (frameNumber == m_FrameCount) {
+            Record(metricIndex, value);
+            return;
+        }
+        const uint64 framesAgo = m_FrameCount - frameNumber;
+        if (frameNumber > m_FrameCount || framesAgo > m_RowCount) return;
+        const auto capacity = static_cast<uint32>(m_Rows.size());
+        m_Rows[(m_NextRowIndex + capacity - static_cast<uint32>(framesAgo)) % capacity][metricIndex] = static_cast<float>(value);
+    }
+
+    MetricSummary FrameStatistics::Summarize(const uint32 metricIndex) {
+        uint32 sampleCount = 0;
+        double sum = 0.0;
+        for (uint32 rowIndex = 0; rowIndex < m_RowCount; rowIndex++) {
+            const float sample = m_Rows[rowIndex][metricIndex];
+            if (std::isnan(sample)) continue;
+            m_Scratch[sampleCount++] = sample;
+            sum += sample;
+        }
+        if (sampleCount == 0) return {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0};
+        const auto begin = m_Scratch.begin(), end = begin + sampleCount;
+        std::sort(begin, end);
+        // Nearest-rank percentiles over the rolling window
+        const auto percentile = [&](const double fraction) {
+            const auto rank = static_cast<uint32>(std::ceil(fraction * sampleCount));
+            return m_Scratch[std::clamp(rank, 1u, sampleCount) - 1];
+        };
+        return {
+                m_Scratch.front(),
+                static_cast<float>(sum / sampleCount),
+                percentile(0.50),
+                percentile(0.95),
+                percentile(0.99),
+                m_Scratch[sampleCount - 1],
+                sampleCount
+        };
+    }
+
+    void FrameStatistics::LogSummary() {
+        for (uint32 metricIndex = 0; metricIndex < m_MetricCount; metricIndex++) {
+            const MetricSummary summary = Summarize(metricIndex);
+            if (summary.sampleCount == 0) continue;
+            logging::Log(logging::LogType::INFORMATION_LOG,
+                         FORMAT("[Frame statistics] {:<8} min {:.3f} avg {:.3f} p50 {:.3f} p95 {:.3f} p99 {:.3f} max {:.3f} {} over "
+                                "{} frames"), m_MetricNames[metricIndex], summary.minimum, summary.average, summary.median,
+                         summary.percentile95, summary.percentile99, summary.maximum, m_MetricUnits[metricIndex], summary.sampleCount);
+        }
+    }
+
+    void FrameStatistics::WriteCsv(const std::string& fileName) const {
+        std::ofstream file(fileName);
+        if (!file.is_open()) {
+            throw std::runtime_error(util::Format(FORMAT("Could not open frame statistics file {} for writing"), fileName));
+        }
+        file << "frame";
+        for (uint32 metricIndex = 0; metricIndex < m_MetricCount; metricIndex++)
+            file << ',' << m_MetricNames[metricIndex] << '_' << m_MetricUnits[metricIndex];
+        file << '\n';
+        // Oldest row first, the ring only holds the most recent frames once it has wrapped
+        const uint32 firstRowIndex = m_RowCount < m_Rows.size() ? 0 : m_NextRowIndex;
+        const uint64 firstFrame = m_FrameCount - m_RowCount;
+        for (uint32 rowOffset = 0; rowOffset < m_RowCount; rowOffset++) {
+            const Row& row = m_Rows[(firstRowIndex + rowOffset) % m_Rows.size()];
+            file << firstFrame + rowOffset;
+            for (uint32 metricIndex = 0; metricIndex < m_MetricCount; metricIndex++) {
+                file << ',';
+                if (!std::isnan(row[metricIndex])) file << row[metricIndex];
+            }
+            file << '\n';
+        }
+        logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Wrote {} frames of statistics to {}"), m_RowCount, fileName);
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "type_definitions.hpp"
+
+#define DEFAULT_FRAME_STATISTICS_CAPACITY 8192
+#define MAX_FRAME_METRICS 16
+#define FRAME_STATISTICS_FILE_NAME "frame_statistics.csv"
+
+namespace voxelfield::profiling {
+    enum FrameMetric : uint32 {
+        FRAME_TIME_METRIC, CPU_TIME_METRIC, PRESENT_TIME_METRIC, GPU_TIME_METRIC, BUILTIN_FRAME_METRIC_COUNT
+    };
+
+    struct MetricSummary {
+        float minimum, average, median, percentile95, percentile99, maximum;
+        uint32 sampleCount;
+    };
+
+    /// Fixed-capacity ring of per-frame timings in milliseconds, or of other per-frame quantities in their own unit. Every buffer is allocated up front, so recording a frame never
+    /// allocates or touches the console. A summary over the rolling window is logged every interval and the window can be dumped to CSV.
+    class FrameStatistics {
+    public:
+        explicit FrameStatistics(uint32 capacity = DEFAULT_FRAME_STATISTICS_CAPACITY, double summaryIntervalSeconds = 5.0);
+
+        /// Registers an additional metric column, must be called before recording starts
+        uint32 AddMetric(const char* name, const char* unit = "ms");
+
+        void Record(uint32 metricIndex, double value) {
+            m_CurrentRow[metricIndex] = static_cast<float>(value);
+        }
+
+        /// Records into the row of an earlier frame, numbered by the frame count when it was current. Rows that already left the ring are dropped.
+        void RecordFrame(uint64 frameNumber, uint32 metricIndex, double value);
+
+        /// Commits the current row into the ring and logs a summary if the interval elapsed
+        void EndFrame();
+
+        MetricSummary Summarize(uint32 metricIndex);
+
+        void LogSummary();
+
+        void WriteCsv(const std::string& fileName) const;
+
+        uint32 GetMetricCount() const {
+            return m_MetricCount;
+        }
+
+        uint64 GetFrameCount() const {
+            return m_FrameCount;
+        }
+
+    private:
+        typedef std::array<float, MAX_FRAME_METRICS> Row;
+        typedef std::chrono::steady_clock Clock;
+
+        std::array<const char*, MAX_FRAME_METRICS> m_MetricNames{}, m_MetricUnits{};
+        uint32 m_MetricCount = 0;
+        std::vector<Row> m_Rows;
+        std::vector<float> m_Scratch;
+        Row m_CurrentRow;
+        uint32 m_NextRowIndex = 0, m_RowCount = 0;
+        uint64 m_FrameCount = 0;
+        Clock::duration m_SummaryInterval;
+        Clock::time_point m_LastSummaryTime;
+
+        void ClearCurrentRow() {
+            m_CurrentRow.fill(std::numeric_limits<float>::quiet_NaN());
+        }
+    };
+}
@@ -1,5 +1,7 @@
 #include "game.hpp"
 
+#include <filesystem>
+
 int main(int numberOfArguments, char** arguments) {
     return voxelfield::Game::Run(numberOfArguments, arguments);
 }
@@ -7,14 +9,116 @@ int main(int numberOfArguments, char** arguments) {
 namespace voxelfield {
     int Game::Run(int numberOfArguments, char** arguments) {
         const std::string gameName = "Voxelfield";
+        std::optional<window::HeadlessOptions> headlessOptions;
+        rendering::FramePacingOptions framePacingOptions;
+        logging::LoggerOptions loggerOptions;
+        profiling::TraceOptions traceOptions;
+        file::VirtualFileSystem fileSystem;
+        for (int argumentIndex = 1; argumentIndex < numberOfArguments; argumentIndex++) {
+            const std::string argument = arguments[argumentIndex];
+            if (argument == "--headless") {
+                if (!headlessOptions) headlessOptions.emplace();
+            } else if (argument == "--frames" && argumentIndex + 1 < numberOfArguments) {
+                if (!headlessOptions) headlessOptions.emplace();
+                headlessOptions->frameCount = static_cast<uint32>(std::stoul(arguments[++argumentIndex]));
+            } else if (argument == "--readback") {
+                if (!headlessOptions) headlessOptions.emplace();
+                headlessOptions->isReadbackEnabled = true;
+            } else if (argument == "--frame-pacing" && argumentIndex + 1 < numberOfArguments) {
+                const std::string profileName = arguments[++argumentIndex];
+                if (const std::optional<rendering::FramePacingProfile> profile = rendering::ParseFramePacingProfile(profileName))
+                    framePacingOptions.profile = profile.value();
+                else
+                    logging::Log(logging::LogType::WARNING_LOG,
+                                 FORMAT("Unknown frame pacing profile {}, expected low-latency, throughput or power-saving"), profileName);
+            } else if (argument == "--fps-limit" && argumentIndex + 1 < numberOfArguments) {
+                framePacingOptions.frameRateLimit = std::stod(arguments[++argumentIndex]);
+            } else if (argument == "--log-file" && argumentIndex + 1 < numberOfArguments) {
+                loggerOptions.fileName = arguments[++argumentIndex];
+                try {
+                    logging::Configure(loggerOptions);
+                } catch (const std::exception& exception) {
+                    logging::Log(logging::LogType::ERROR_LOG, exception.what());
+                    return EXIT_FAILURE;
+                }
+            } else if (argument == "--log-overflow" && argumentIndex + 1 < numberOfArguments) {
+                const std::string policyName = arguments[++argumentIndex];
+                if (policyName == "drop" || policyName == "block") {
+                    loggerOptions.overflowPolicy = policyName == "drop"
+                                                   ? logging::OverflowPolicy::DROP_RECORDS
+                                                   : logging::OverflowPolicy::BLOCK_PRODUCER;
+                    logging::Configure(loggerOptions);
+                } else {
+                    logging::Log(logging::LogType::WARNING_LOG, FORMAT("Unknown log overflow policy {}, expected drop or block"),
+                                 policyName);
+                }
+            } else if (argument == "--assets" && argumentIndex + 1 < numberOfArguments) {
+                try {
+                    fileSystem.MountPath(arguments[++argumentIndex]);
+                } catch (const std::exception& exception) {
+                    logging::Log(logging::LogType::ERROR_LOG, exception.what());
+                    return EXIT_FAILURE;
+                }
+            } else if ((argument == "--pack-assets" || argument == "--pack-compressed-assets") && argumentIndex + 2 < numberOfArguments) {
+                const std::string directory = arguments[++argumentIndex];
+                try {
+                    file::PackDirectory(directory, arguments[++argumentIndex], argument == "--pack-compressed-assets");
+                } catch (const std::exception& exception) {
+                    logging::Log(logging::LogType::ERROR_LOG, exception.what());
+                    return EXIT_FAILURE;
+                }
+                return EXIT_SUCCESS;
+            } else if (argument == "--trace" && argumentIndex + 1 < numberOfArguments) {
+                traceOptions.fileName = arguments[++argumentIndex];
+            } else if (argument == "--trace-frames" && argumentIndex + 2 < numberOfArguments) {
+                traceOptions.firstFrame = std::stoull(arguments[++argumentIndex]);
+                traceOptions.frameCount = std::stoull(arguments[++argumentIndex]);
+            } else if (argument == "--benchmark" && argumentIndex + 1 < numberOfArguments) {
+                // CPU benchmarks need neither a window nor a device
+                return benchmarks::Run(arguments[++argumentIndex]);
+            }
+        }
+        // Assets are looked for after the mounts given on the command line, in the working directory and then next to the executable,
+        // packed before loose in each
+        try {
+            std::vector<std::filesystem::path> assetDirectories{std::filesystem::current_path()};
+            const std::filesystem::path executableDirectory = std::filesystem::absolute(arguments[0]).parent_path();
+            if (!std::filesystem::equivalent(assetDirectories.front(), executableDirectory)) assetDirectories.push_back(executableDirectory);
+            for (const std::filesystem::path& directory : assetDirectories) {
+                const std::filesystem::path archiveName = directory / ASSET_ARCHIVE_FILE_NAME;
+                if (std::filesystem::is_regular_file(archiveName)) fileSystem.MountPath(archiveName.string());
+                fileSystem.MountPath(directory.string());
+            }
+        } catch (const std::exception& exception) {
+            logging::Log(logging::LogType::ERROR_LOG, exception.what());
+            return EXIT_FAILURE;
+        }
+#ifdef TRACING_ENABLED
+        // Capturing from the first frame starts here, so the window opening is in the trace
+        profiling::ConfigureTracing(traceOptions);
+#else
+        if (!traceOptions.fileName.empty())
+            logging::Log(logging::LogType::WARNING_LOG, "Tracing is compiled out of release builds, no trace will be written");
+#endif
         Application application(gameName);
-        window::VulkanWindow window(application, gameName);
+        jobs::JobSystem jobSystem;
+        window::VulkanWindow window(application, gameName, jobSystem, fileSystem, framePacingOptions, headlessOptions);
         try {
             window.Open();
-            window.Loop();
+            if (headlessOptions)
+                window.RunHeadless();
+            else
+                window.Loop();
+            profiling::FinishTracing();
         } catch (const std::exception& exception) {
             logging::Log(logging::LogType::ERROR_LOG, exception.what());
-            MessageBox(nullptr, exception.what(), gameName.c_str(), MB_ICONERROR);
+            // What led up to the error is the most interesting part of a capture
+            profiling::FinishTracing();
+            logging::Flush();
+#ifdef _WIN32
+            if (!headlessOptions)
+                MessageBox(nullptr, exception.what(), gameName.c_str(), MB_ICONERROR);
+#endif
             return EXIT_FAILURE;
         }
         return EXIT_SUCCESS;
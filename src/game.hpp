@@ -4,6 +4,7 @@
 
 #include "application.hpp"
 #include "vulkan_window.hpp"
+#include "benchmarks.hpp"
 
 namespace voxelfield {
     class Game {
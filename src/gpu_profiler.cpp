@@ -0,0 +1,92 @@
+#include "gpu_profiler.hpp"
+
+#include <stdexcept>
+
+#include "logger.hpp"
+#include "string_util.hpp"
+
+namespace voxelfield::profiling {
+    void GpuProfiler::Create(const VkDevice logicalDeviceHandle, const VkPhysicalDeviceLimits& limits, const uint32 timestampValidBits,
+                             FrameStatistics& frameStatistics) {
+        m_LogicalDeviceHandle = logicalDeviceHandle;
+        m_FrameStatistics = &frameStatistics;
+        m_ZoneMetrics[GPU_PROFILER_FRAME_ZONE] = GPU_TIME_METRIC;
+        m_ZoneCount = 1;
+        if (!limits.timestampComputeAndGraphics || timestampValidBits == 0) {
+            logging::Log(logging::LogType::WARNING_LOG, "Device does not support timestamp queries, GPU timings will not be reported");
+            return;
+        }
+        m_TimestampMask = timestampValidBits >= 64 ? ~0ull : (1ull << timestampValidBits) - 1;
+        m_TimestampPeriod = limits.timestampPeriod;
+        VkQueryPoolCreateInfo queryPoolCreationInformation{
+                VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+                nullptr,
+                0,
+                VK_QUERY_TYPE_TIMESTAMP,
+                MAX_GPU_PROFILER_SLOTS * MAX_GPU_PROFILER_ZONES * 2,
+                0
+        };
+        if (const VkResult result = vkCreateQueryPool(m_LogicalDeviceHandle, &queryPoolCreationInformation, nullptr, &m_QueryPoolHandle);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create Vulkan timestamp query pool"), result));
+        }
+        logging::Log(logging::LogType::INFORMATION_LOG, "Successfully created GPU timestamp profiler");
+    }
+
+    void GpuProfiler::Release() {
+        if (m_QueryPoolHandle != VK_NULL_HANDLE)
+            vkDestroyQueryPool(m_LogicalDeviceHandle, m_QueryPoolHandle, nullptr);
+        m_QueryPoolHandle = VK_NULL_HANDLE;
+    }
+
+    uint32 GpuProfiler::AddZone(const char* name) {
+        if (m_ZoneCount == MAX_GPU_PROFILER_ZONES) {
+            throw std::runtime_error(util::Format(FORMAT("Too many GPU profiler zones, could not add {}"), name));
+        }
+        m_ZoneMetrics[m_ZoneCount] = m_FrameStatistics->AddMetric(name);
+        return m_ZoneCount++;
+    }
+
+    void GpuProfiler::BeginFrame(const VkCommandBuffer commandBufferHandle, const uint32 slot) {
+        if (!IsEnabled() || slot >= MAX_GPU_PROFILER_SLOTS) return;
+        vkCmdResetQueryPool(commandBufferHandle, m_QueryPoolHandle, GetQueryIndex(slot, 0), MAX_GPU_PROFILER_ZONES * 2);
+        m_SlotFrameNumbers[slot] = m_FrameStatistics->GetFrameCount();
+        BeginZone(commandBufferHandle, slot, GPU_PROFILER_FRAME_ZONE);
+    }
+
+    void GpuProfiler::EndFrame(const VkCommandBuffer commandBufferHandle, const uint32 slot) {
+        EndZone(commandBufferHandle, slot, GPU_PROFILER_FRAME_ZONE);
+    }
+
+    void GpuProfiler::BeginZone(const VkCommandBuffer commandBufferHandle, const uint32 slot, const uint32 zone) {
+        if (!IsEnabled() || slot >= MAX_GPU_PROFILER_SLOTS) return;
+        vkCmdWriteTimestamp(commandBufferHandle, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_QueryPoolHandle, GetQueryIndex(slot, zone));
+    }
+
+    void GpuProfiler::EndZone(const VkCommandBuffer commandBufferHandle, const uint32 slot, const uint32 zone) {
+        if (!IsEnabled() || slot >= MAX_GPU_PROFILER_SLOTS) return;
+        vkCmdWriteTimestamp(commandBufferHandle, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_QueryPoolHandle, GetQueryIndex(slot, zone) + 1);
+    }
+
+    bool GpuProfiler::Resolve(const uint32 slot) {
+        if (!IsEnabled() || slot >= MAX_GPU_PROFILER_SLOTS) return true;
+        // Pairs of (timestamp, availability) for the begin and end query of every zone
+        std::array<uint64, MAX_GPU_PROFILER_ZONES * 4> results{};
+        const VkResult result = vkGetQueryPoolResults(m_LogicalDeviceHandle, m_QueryPoolHandle, GetQueryIndex(slot, 0), m_ZoneCount * 2,
+                                                      sizeof(results), results.data(), sizeof(uint64) * 2,
+                                                      VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if (result != VK_SUCCESS && result != VK_NOT_READY) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not read GPU timestamp queries"), result));
+        }
+        if (!results[GPU_PROFILER_FRAME_ZONE * 4 + 3]) return false;
+        for (uint32 zone = 0; zone < m_ZoneCount; zone++) {
+            const uint64 begin = results[zone * 4], isBeginAvailable = results[zone * 4 + 1],
+                    end = results[zone * 4 + 2], isEndAvailable = results[zone * 4 + 3];
+            // Zones that were not recorded in this slot stay unavailable after the reset
+            if (!isBeginAvailable || !isEndAvailable) continue;
+            const double nanoseconds = static_cast<double>((end - begin) & m_TimestampMask) * m_TimestampPeriod;
+            m_FrameStatistics->RecordFrame(m_SlotFrameNumbers[slot], m_ZoneMetrics[zone], nanoseconds / 1e6);
+        }
+        return true;
+    }
+}
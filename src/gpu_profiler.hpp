@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <array>
+
+#include "type_definitions.hpp"
+#include "frame_statistics.hpp"
+
+#define MAX_GPU_PROFILER_ZONES 8
+#define MAX_GPU_PROFILER_SLOTS 8
+#define GPU_PROFILER_FRAME_ZONE 0
+
+namespace voxelfield::profiling {
+    /// Brackets recorded GPU work with timestamp queries. Each command buffer slot owns its own range of the query pool and the results
+    /// are read back without waiting once the fence of that slot's submission has signalled. Timings arrive a few frames late and are
+    /// recorded into the statistics row of the frame that recorded them.
+    /// Zone zero always spans the whole command buffer and is reported as the GPU frame time.
+    class GpuProfiler {
+    public:
+        void Create(VkDevice logicalDeviceHandle, const VkPhysicalDeviceLimits& limits, uint32 timestampValidBits, FrameStatistics& frameStatistics);
+
+        void Release();
+
+        /// Registers a named zone that is reported as its own frame statistics metric
+        uint32 AddZone(const char* name);
+
+        void BeginFrame(VkCommandBuffer commandBufferHandle, uint32 slot);
+
+        void EndFrame(VkCommandBuffer commandBufferHandle, uint32 slot);
+
+        void BeginZone(VkCommandBuffer commandBufferHandle, uint32 slot, uint32 zone);
+
+        void EndZone(VkCommandBuffer commandBufferHandle, uint32 slot, uint32 zone);
+
+        /// Records every zone of the slot whose timestamps are available, returns false if the results are not ready yet
+        bool Resolve(uint32 slot);
+
+        bool IsEnabled() const {
+            return m_QueryPoolHandle != VK_NULL_HANDLE;
+        }
+
+    private:
+        VkDevice m_LogicalDeviceHandle = VK_NULL_HANDLE;
+        VkQueryPool m_QueryPoolHandle = VK_NULL_HANDLE;
+        FrameStatistics* m_FrameStatistics = nullptr;
+        std::array<uint32, MAX_GPU_PROFILER_ZONES> m_ZoneMetrics{};
+        std::array<uint64, MAX_GPU_PROFILER_SLOTS> m_SlotFrameNumbers{};
+        uint32 m_ZoneCount = 0;
+        uint64 m_TimestampMask = 0;
+        double m_TimestampPeriod = 0.0;
+
+        static uint32 GetQueryIndex(const uint32 slot, const uint32 zone) {
+            return (slot * MAX_GPU_PROFILER_ZONES + zone) * 2;
+        }
+    };
+}
@@ -0,0 +1,273 @@
+#include "hiz_pyramid.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+#include "logger.hpp"
+#include "string_util.hpp"
+#include "tracer.hpp"
+
+namespace voxelfield::rendering {
+    namespace {
+        uint32 PreviousPowerOfTwo(uint32 value) {
+            uint32 result = 1;
+            while (result * 2 <= value) result *= 2;
+            return result;
+        }
+    }
+
+    void HiZPyramid::Create(const VkDevice logicalDeviceHandle, memory::DeviceMemoryAllocator& memoryAllocator, PipelineRegistry& pipelineRegistry,
+                            const uint32 framesInFlight) {
+        TRACE_ZONE("HiZPyramid::Create");
+        m_LogicalDeviceHandle = logicalDeviceHandle;
+        m_MemoryAllocator = &memoryAllocator;
+        m_FramesInFlight = framesInFlight;
+        // A linear fetch with max reduction returns the furthest of the four texels around the sample point instead of their average
+        VkSamplerReductionModeCreateInfo reductionModeCreationInformation{
+                VK_STRUCTURE_TYPE_SAMPLER_REDUCTION_MODE_CREATE_INFO,
+                nullptr,
+                VK_SAMPLER_REDUCTION_MODE_MAX
+        };
+        VkSamplerCreateInfo samplerCreationInformation{
+                VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+                &reductionModeCreationInformation,
+                0,
+                VK_FILTER_LINEAR, VK_FILTER_LINEAR,
+                VK_SAMPLER_MIPMAP_MODE_NEAREST,
+                VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                0.0f,
+                VK_FALSE, 1.0f,
+                VK_FALSE, VK_COMPARE_OP_ALWAYS,
+                0.0f, VK_LOD_CLAMP_NONE,
+                VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,
+                VK_FALSE
+        };
+        if (const VkResult result = vkCreateSampler(m_LogicalDeviceHandle, &samplerCreationInformation, nullptr, &m_SamplerHandle);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create Hi-Z sampler"), result));
+        }
+        const std::array<VkDescriptorSetLayoutBinding, 2> bindings{
+                // The depth buffer for the first level, the level above for every other
+                VkDescriptorSetLayoutBinding{0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+                VkDescriptorSetLayoutBinding{1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}
+        };
+        VkDescriptorSetLayoutCreateInfo layoutCreationInformation{
+                VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+                nullptr,
+                0,
+                static_cast<uint32>(bindings.size()), bindings.data()
+        };
+        if (const VkResult result = vkCreateDescriptorSetLayout(m_LogicalDeviceHandle, &layoutCreationInformation, nullptr, &m_DescriptorSetLayoutHandle);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create Hi-Z descriptor set layout"), result));
+        }
+        VkPushConstantRange pushConstantRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(HiZPushConstants)};
+        VkPipelineLayoutCreateInfo pipelineLayoutCreationInformation{
+                VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+                nullptr,
+                0,
+                1, &m_DescriptorSetLayoutHandle,
+                1, &pushConstantRange
+        };
+        if (const VkResult result = vkCreatePipelineLayout(m_LogicalDeviceHandle, &pipelineLayoutCreationInformation, nullptr, &m_PipelineLayoutHandle);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create Hi-Z pipeline layout"), result));
+        }
+        m_PipelineHandle = pipelineRegistry.GetComputePipeline({pipelineRegistry.GetShaderModule("shaders/hiz.spv"), m_PipelineLayoutHandle});
+    }
+
+    void HiZPyramid::Release() {
+        if (m_LogicalDeviceHandle == VK_NULL_HANDLE) return;
+        for (Targets& retired : m_RetiredTargets)
+            ReleaseTargets(retired);
+        m_RetiredTargets.clear();
+        ReleaseTargets(m_Targets);
+        m_Targets = {};
+        vkDestroyPipelineLayout(m_LogicalDeviceHandle, m_PipelineLayoutHandle, nullptr);
+        vkDestroyDescriptorSetLayout(m_LogicalDeviceHandle, m_DescriptorSetLayoutHandle, nullptr);
+        vkDestroySampler(m_LogicalDeviceHandle, m_SamplerHandle, nullptr);
+        m_LogicalDeviceHandle = VK_NULL_HANDLE;
+    }
+
+    void HiZPyramid::SetDepthTarget(const VkImageView depthImageViewHandle, const VkExtent2D depthExtent, const uint64 frameNumber) {
+        if (m_Targets.imageHandle != VK_NULL_HANDLE) {
+            m_Targets.retiredFrameNumber = frameNumber;
+            m_RetiredTargets.push_back(std::move(m_Targets));
+        }
+        m_Targets = CreateTargets(depthImageViewHandle, depthExtent);
+        logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Successfully created Hi-Z pyramid of {}x{} with {} levels"),
+                     m_Targets.extent.width, m_Targets.extent.height, static_cast<uint32>(m_Targets.levelViewHandles.size()));
+    }
+
+    void HiZPyramid::BeginFrame(const uint64 frameNumber) {
+        m_RetiredTargets.erase(std::remove_if(m_RetiredTargets.begin(), m_RetiredTargets.end(), [&](Targets& retired) {
+            if (frameNumber < retired.retiredFrameNumber + m_FramesInFlight) return false;
+            ReleaseTargets(retired);
+            return true;
+        }), m_RetiredTargets.end());
+    }
+
+    HiZPyramid::Targets HiZPyramid::CreateTargets(const VkImageView depthImageViewHandle, const VkExtent2D depthExtent) const {
+        Targets targets;
+        // Rounding down keeps every level after the first exactly half the one above, so their texels cover two by two whole texels of
+        // the level before. The first level is less than twice as small as the depth buffer, its texels overlap up to three depth
+        // texels each way and the shader takes the furthest of all of them.
+        targets.extent = {PreviousPowerOfTwo(depthExtent.width), PreviousPowerOfTwo(depthExtent.height)};
+        targets.depthExtent = depthExtent;
+        uint32 levelCount = 1;
+        while (std::max(targets.extent.width, targets.extent.height) >> levelCount) levelCount++;
+        VkImageCreateInfo imageCreationInformation{
+                VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+                nullptr,
+                0,
+                VK_IMAGE_TYPE_2D,
+                HIZ_FORMAT,
+                {targets.extent.width, targets.extent.height, 1},
+                levelCount, 1,
+                VK_SAMPLE_COUNT_1_BIT,
+                VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+                VK_SHARING_MODE_EXCLUSIVE,
+                0, nullptr,
+                VK_IMAGE_LAYOUT_UNDEFINED
+        };
+        if (const VkResult result = vkCreateImage(m_LogicalDeviceHandle, &imageCreationInformation, nullptr, &targets.imageHandle);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create Hi-Z image"), result));
+        }
+        // Resized along with the depth target while the retired pyramid is still in flight
+        targets.allocation = m_MemoryAllocator->AllocateForImage(targets.imageHandle, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                                 memory::MemoryPoolType::STREAMING);
+        targets.imageViewHandle = CreateImageView(targets.imageHandle, 0, levelCount);
+        targets.levelViewHandles.resize(levelCount);
+        for (uint32 level = 0; level < levelCount; level++)
+            targets.levelViewHandles[level] = CreateImageView(targets.imageHandle, level, 1);
+        const std::array<VkDescriptorPoolSize, 2> poolSizes{
+                VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, levelCount},
+                VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, levelCount}
+        };
+        VkDescriptorPoolCreateInfo poolCreationInformation{
+                VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+                nullptr,
+                0,
+                levelCount,
+                static_cast<uint32>(poolSizes.size()), poolSizes.data()
+        };
+        if (const VkResult result = vkCreateDescriptorPool(m_LogicalDeviceHandle, &poolCreationInformation, nullptr, &targets.descriptorPoolHandle);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create Hi-Z descriptor pool"), result));
+        }
+        const std::vector<VkDescriptorSetLayout> setLayouts(levelCount, m_DescriptorSetLayoutHandle);
+        targets.levelDescriptorSetHandles.resize(levelCount);
+        VkDescriptorSetAllocateInfo allocationInformation{
+                VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+                nullptr,
+                targets.descriptorPoolHandle,
+                levelCount, setLayouts.data()
+        };
+        if (const VkResult result = vkAllocateDescriptorSets(m_LogicalDeviceHandle, &allocationInformation, targets.levelDescriptorSetHandles.data());
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not allocate Hi-Z descriptor sets"), result));
+        }
+        for (uint32 level = 0; level < levelCount; level++) {
+            const std::array<VkDescriptorImageInfo, 2> imageInformation{
+                    level == 0
+                    ? VkDescriptorImageInfo{m_SamplerHandle, depthImageViewHandle, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL}
+                    : VkDescriptorImageInfo{m_SamplerHandle, targets.levelViewHandles[level - 1], VK_IMAGE_LAYOUT_GENERAL},
+                    VkDescriptorImageInfo{VK_NULL_HANDLE, targets.levelViewHandles[level], VK_IMAGE_LAYOUT_GENERAL}
+            };
+            const std::array<VkWriteDescriptorSet, 2> writes{
+                    VkWriteDescriptorSet{
+                            VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                            nullptr,
+                            targets.levelDescriptorSetHandles[level],
+                            0, 0, 1,
+                            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                            &imageInformation[0], nullptr, nullptr
+                    },
+                    VkWriteDescriptorSet{
+                            VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                            nullptr,
+                            targets.levelDescriptorSetHandles[level],
+                            1, 0, 1,
+                            VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                            &imageInformation[1], nullptr, nullptr
+                    }
+            };
+            vkUpdateDescriptorSets(m_LogicalDeviceHandle, static_cast<uint32>(writes.size()), writes.data(), 0, nullptr);
+        }
+        return targets;
+    }
+
+    VkImageView HiZPyramid::CreateImageView(const VkImage imageHandle, const uint32 baseLevel, const uint32 levelCount) const {
+        VkImageViewCreateInfo imageViewCreationInformation{
+                VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+                nullptr,
+                0,
+                imageHandle,
+                VK_IMAGE_VIEW_TYPE_2D,
+                HIZ_FORMAT,
+                {VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY},
+                {VK_IMAGE_ASPECT_COLOR_BIT, baseLevel, levelCount, 0, 1}
+        };
+        VkImageView imageViewHandle;
+        if (const VkResult result = vkCreateImageView(m_LogicalDeviceHandle, &imageViewCreationInformation, nullptr, &imageViewHandle);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create Hi-Z image view"), result));
+        }
+        return imageViewHandle;
+    }
+
+    void HiZPyramid::ReleaseTargets(Targets& targets) const {
+        if (targets.imageHandle == VK_NULL_HANDLE) return;
+        vkDestroyDescriptorPool(m_LogicalDeviceHandle, targets.descriptorPoolHandle, nullptr);
+        for (const VkImageView levelViewHandle : targets.levelViewHandles)
+            vkDestroyImageView(m_LogicalDeviceHandle, levelViewHandle, nullptr);
+        vkDestroyImageView(m_LogicalDeviceHandle, targets.imageViewHandle, nullptr);
+        vkDestroyImage(m_LogicalDeviceHandle, targets.imageHandle, nullptr);
+        m_MemoryAllocator->Free(targets.allocation);
+    }
+
+    void HiZPyramid::RecordDiscard(const VkCommandBuffer commandBufferHandle) const {
+        // The previous contents are never needed, transitioning from undefined every frame also orders the rebuild after last frame's reads
+        VkImageMemoryBarrier layoutBarrier{
+                VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                nullptr,
+                VK_ACCESS_SHADER_READ_BIT,
+                VK_ACCESS_SHADER_WRITE_BIT,
+                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                m_Targets.imageHandle,
+                {VK_IMAGE_ASPECT_COLOR_BIT, 0, static_cast<uint32>(m_Targets.levelViewHandles.size()), 0, 1}
+        };
+        vkCmdPipelineBarrier(commandBufferHandle, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                             0, nullptr, 0, nullptr, 1, &layoutBarrier);
+    }
+
+    void HiZPyramid::RecordBuild(const VkCommandBuffer commandBufferHandle) const {
+        vkCmdBindPipeline(commandBufferHandle, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineHandle);
+        for (uint32 level = 0; level < m_Targets.levelViewHandles.size(); level++) {
+            const uint32 levelWidth = std::max(m_Targets.extent.width >> level, 1u), levelHeight = std::max(m_Targets.extent.height >> level, 1u);
+            const HiZPushConstants pushConstants{
+                    level == 0 ? m_Targets.depthExtent.width : std::max(m_Targets.extent.width >> (level - 1), 1u),
+                    level == 0 ? m_Targets.depthExtent.height : std::max(m_Targets.extent.height >> (level - 1), 1u),
+                    levelWidth, levelHeight
+            };
+            vkCmdBindDescriptorSets(commandBufferHandle, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayoutHandle, 0, 1,
+                                    &m_Targets.levelDescriptorSetHandles[level], 0, nullptr);
+            vkCmdPushConstants(commandBufferHandle, m_PipelineLayoutHandle, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+            vkCmdDispatch(commandBufferHandle, (levelWidth + HIZ_WORKGROUP_SIZE - 1) / HIZ_WORKGROUP_SIZE,
+                          (levelHeight + HIZ_WORKGROUP_SIZE - 1) / HIZ_WORKGROUP_SIZE, 1);
+            // Each level reads the one written just before, the last barrier makes the whole pyramid visible to the occlusion test
+            VkMemoryBarrier levelBarrier{
+                    VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                    nullptr,
+                    VK_ACCESS_SHADER_WRITE_BIT,
+                    VK_ACCESS_SHADER_READ_BIT
+            };
+            vkCmdPipelineBarrier(commandBufferHandle, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                                 1, &levelBarrier, 0, nullptr, 0, nullptr);
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include "type_definitions.hpp"
+#include "device_memory_allocator.hpp"
+#include "pipeline_registry.hpp"
+
+#define HIZ_FORMAT VK_FORMAT_R32_SFLOAT
+#define HIZ_WORKGROUP_SIZE 8u
+
+namespace voxelfield::rendering {
+    struct HiZPushConstants {
+        uint32 inputWidth, inputHeight, outputWidth, outputHeight;
+    };
+
+    /// Mip chain of the depth buffer where every texel holds the furthest depth of the area it covers. Levels are reduced with a max
+    /// sampler, so one fetch at the right level tells whether anything drawn so far is in front of a whole screen-space rectangle.
+    /// The first level gathers every depth texel it overlaps instead, as the depth buffer is rarely twice its size.
+    class HiZPyramid {
+    public:
+        void Create(VkDevice logicalDeviceHandle, memory::DeviceMemoryAllocator& memoryAllocator, PipelineRegistry& pipelineRegistry,
+                    uint32 framesInFlight);
+
+        void Release();
+
+        /// Rebuilds the pyramid for a new depth buffer, the old one is kept until no frame in flight can still be reading it
+        void SetDepthTarget(VkImageView depthImageViewHandle, VkExtent2D depthExtent, uint64 frameNumber);
+
+        /// Destroys pyramids replaced by SetDepthTarget, called once the fence of the oldest frame in flight has signalled
+        void BeginFrame(uint64 frameNumber);
+
+        /// Moves the pyramid into the general layout it is used in, has to be recorded before anything binds it in a frame
+        void RecordDiscard(VkCommandBuffer commandBufferHandle) const;
+
+        /// Records the reduction of every level, expects the depth writes to be visible to compute shaders
+        void RecordBuild(VkCommandBuffer commandBufferHandle) const;
+
+        VkImageView GetImageViewHandle() const {
+            return m_Targets.imageViewHandle;
+        }
+
+        VkSampler GetSamplerHandle() const {
+            return m_SamplerHandle;
+        }
+
+        VkExtent2D GetExtent() const {
+            return m_Targets.extent;
+        }
+
+    private:
+        // Everything that depends on the size of the depth buffer
+        struct Targets {
+            VkImage imageHandle = VK_NULL_HANDLE;
+            memory::DeviceAllocation allocation;
+            // View of the whole chain for sampling, plus one view per level to reduce into
+            VkImageView imageViewHandle = VK_NULL_HANDLE;
+            std::vector<VkImageView> levelViewHandles;
+            VkDescriptorPool descriptorPoolHandle = VK_NULL_HANDLE;
+            std::vector<VkDescriptorSet> levelDescriptorSetHandles;
+            VkExtent2D extent{}, depthExtent{};
+            uint64 retiredFrameNumber = 0;
+        };
+
+        VkDevice m_LogicalDeviceHandle = VK_NULL_HANDLE;
+        memory::DeviceMemoryAllocator* m_MemoryAllocator = nullptr;
+        uint32 m_FramesInFlight = 0;
+        VkSampler m_SamplerHandle = VK_NULL_HANDLE;
+        VkDescriptorSetLayout m_DescriptorSetLayoutHandle = VK_NULL_HANDLE;
+        VkPipelineLayout m_PipelineLayoutHandle = VK_NULL_HANDLE;
+        VkPipeline m_PipelineHandle = VK_NULL_HANDLE;
+        Targets m_Targets;
+        std::vector<Targets> m_RetiredTargets;
+
+        Targets CreateTargets(VkImageView depthImageViewHandle, VkExtent2D depthExtent) const;
+
+        void ReleaseTargets(Targets& targets) const;
+
+        VkImageView CreateImageView(VkImage imageHandle, uint32 baseLevel, uint32 levelCount) const;
+    };
+}
@@ -0,0 +1,592 @@
+#include "io_service.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef IO_URING_AVAILABLE
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+#include "job_system.hpp"
+#include "logger.hpp"
+#include "string_util.hpp"
+#include "tracer.hpp"
+
+namespace voxelfield::file {
+    namespace {
+        constexpr uint32 INVALID_SLOT = UINT32_MAX;
+        // Completions of operations that are not reads, told apart by user data no request ID can have
+        constexpr uint64 CANCEL_USER_DATA = UINT64_MAX, STOP_USER_DATA = UINT64_MAX - 1;
+        // Probed operations, io_uring only knows about a few dozen
+        constexpr uint32 PROBE_OPERATION_COUNT = 256;
+
+        uint64 GetRequestId(const uint32 generation, const uint32 slotIndex) {
+            return static_cast<uint64>(generation) << 32 | slotIndex;
+        }
+
+#ifdef _WIN32
+        void* const CLOSED_FILE = nullptr;
+
+        uint32 ReadAt(void* file, uint8* data, const uint32 size, const uint64 offset, int32& error) {
+            // Positional read on a synchronous handle, it does not move a shared file pointer
+            OVERLAPPED overlapped{};
+            overlapped.Offset = static_cast<DWORD>(offset);
+            overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+            DWORD readSize = 0;
+            if (!ReadFile(static_cast<HANDLE>(file), data, size, &readSize, &overlapped) && GetLastError() != ERROR_HANDLE_EOF)
+                error = static_cast<int32>(GetLastError());
+            return readSize;
+        }
+#else
+        const int CLOSED_FILE = -1;
+
+        uint32 ReadAt(const int file, uint8* data, const uint32 size, const uint64 offset, int32& error) {
+            uint32 readSize = 0;
+            while (readSize < size) {
+                const ssize_t result = pread(file, data + readSize, size - readSize, static_cast<off_t>(offset + readSize));
+                if (result < 0 && errno == EINTR) continue;
+                if (result < 0) error = errno;
+                if (result <= 0) break;
+                readSize += static_cast<uint32>(result);
+            }
+            return readSize;
+        }
+#endif
+    }
+
+#ifdef IO_URING_AVAILABLE
+
+    /// Rings shared with the kernel. The submission tail and completion head are only written by the service, under its mutex.
+    struct IoService::Uring {
+        int descriptor = -1;
+        void* submissionRing = MAP_FAILED;
+        void* completionRing = MAP_FAILED;
+        size_t submissionRingSize = 0, completionRingSize = 0, entriesSize = 0;
+        io_uring_sqe* entries = static_cast<io_uring_sqe*>(MAP_FAILED);
+        uint32* submissionHead;
+        uint32* submissionTail;
+        uint32* submissionArray;
+        uint32 submissionMask, submissionEntryCount;
+        uint32* completionHead;
+        uint32* completionTail;
+        uint32 completionMask;
+        io_uring_cqe* completions;
+    };
+
+#else
+
+    struct IoService::Uring {
+    };
+
+#endif
+
+    IoService::IoService(const IoServiceOptions& options, jobs::JobSystem* jobSystem) : m_Options(options), m_JobSystem(jobSystem) {
+        m_Options.queueDepth = std::max(m_Options.queueDepth, 1u);
+        m_BufferMemory.reset(new uint8[static_cast<size_t>(m_Options.registeredBufferCount) * m_Options.registeredBufferSize]);
+        for (uint32 bufferIndex = m_Options.registeredBufferCount; bufferIndex-- > 0;) m_FreeBuffers.push_back(bufferIndex);
+#ifdef IO_URING_AVAILABLE
+        if (!m_Options.isUringDisabled && CreateUring()) {
+            m_Backend = IoBackend::IO_URING;
+            m_Threads.emplace_back(&IoService::CompletionLoop, this);
+            logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Reading files through io_uring with a queue depth of {}"),
+                         m_Options.queueDepth);
+            return;
+        }
+#endif
+        const uint32 threadCount = std::max(m_Options.fallbackThreadCount, 1u);
+        for (uint32 threadIndex = 0; threadIndex < threadCount; threadIndex++) m_Threads.emplace_back(&IoService::WorkerLoop, this);
+        logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Reading files on {} threads"), threadCount);
+    }
+
+    IoService::~IoService() {
+        // Reads that were never started are cancelled, the ones in flight are waited on
+        std::vector<std::pair<IoCallback, IoResult>> cancelled;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            std::vector<uint32> slotIndices = std::move(m_QueuedSlots);
+            for (std::deque<uint32>& pendingSlots : m_PendingSlots) {
+                slotIndices.insert(slotIndices.end(), pendingSlots.begin(), pendingSlots.end());
+                pendingSlots.clear();
+            }
+            for (const uint32 slotIndex : slotIndices) {
+                IoCallback callback;
+                const IoResult result = Finish(slotIndex, IoStatus::CANCELLED, 0, 0, callback);
+                cancelled.emplace_back(std::move(callback), result);
+            }
+        }
+        for (auto& [callback, result] : cancelled) Dispatch(std::move(callback), result);
+        WaitForIdle();
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_IsStopping = true;
+#ifdef IO_URING_AVAILABLE
+            if (m_Backend == IoBackend::IO_URING) {
+                // The completion thread only wakes up for a completion, so it is sent one
+                Uring& ring = *m_Uring;
+                const uint32 index = *ring.submissionTail & ring.submissionMask;
+                std::memset(&ring.entries[index], 0, sizeof(io_uring_sqe));
+                ring.entries[index].opcode = IORING_OP_NOP;
+                ring.entries[index].user_data = STOP_USER_DATA;
+                ring.submissionArray[index] = index;
+                __atomic_store_n(ring.submissionTail, *ring.submissionTail + 1, __ATOMIC_RELEASE);
+                if (const int error = SubmitUring(); error != 0)
+                    logging::Log(logging::LogType::ERROR_LOG, FORMAT("Error code {}, could not stop io_uring completion thread"), error);
+            }
+#endif
+        }
+        m_WorkAvailable.notify_all();
+        for (std::thread& thread : m_Threads) thread.join();
+        ReleaseUring();
+        for (const NativeFile file : m_Files) {
+            if (file == CLOSED_FILE) continue;
+#ifdef _WIN32
+            CloseHandle(static_cast<HANDLE>(file));
+#else
+            close(file);
+#endif
+        }
+    }
+
+    uint32 IoService::OpenFile(const std::string& fileName) {
+#ifdef _WIN32
+        HANDLE fileHandle = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (fileHandle == INVALID_HANDLE_VALUE)
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not open file with name {}"), GetLastError(), fileName));
+        const NativeFile file = fileHandle;
+#else
+        const NativeFile file = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file < 0) throw std::runtime_error(util::Format(FORMAT("Error code {}, could not open file with name {}"), errno, fileName));
+#endif
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        const auto closedFile = std::find(m_Files.begin(), m_Files.end(), CLOSED_FILE);
+        if (closedFile != m_Files.end()) {
+            *closedFile = file;
+            return static_cast<uint32>(closedFile - m_Files.begin());
+        }
+        m_Files.push_back(file);
+        return static_cast<uint32>(m_Files.size() - 1);
+    }
+
+    void IoService::CloseFile(const uint32 fileId) {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (fileId >= m_Files.size() || m_Files[fileId] == CLOSED_FILE) return;
+#ifdef _WIN32
+        CloseHandle(static_cast<HANDLE>(m_Files[fileId]));
+#else
+        close(m_Files[fileId]);
+#endif
+        m_Files[fileId] = CLOSED_FILE;
+    }
+
+    uint32 IoService::AcquireBuffer() {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_FreeBuffers.empty()) return INVALID_IO_BUFFER;
+        const uint32 bufferIndex = m_FreeBuffers.back();
+        m_FreeBuffers.pop_back();
+        return bufferIndex;
+    }
+
+    void IoService::ReleaseBuffer(const uint32 bufferIndex) {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_FreeBuffers.push_back(bufferIndex);
+    }
+
+    uint64 IoService::Read(IoReadRequest request) {
+        if (request.bufferIndex != INVALID_IO_BUFFER && request.size > m_Options.registeredBufferSize)
+            throw std::runtime_error(util::Format(FORMAT("Read of {} bytes does not fit a registered buffer of {} bytes"), request.size,
+                                                  m_Options.registeredBufferSize));
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (request.fileId >= m_Files.size() || m_Files[request.fileId] == CLOSED_FILE)
+            throw std::runtime_error(util::Format(FORMAT("Read of file {} which is not open"), request.fileId));
+        uint32 slotIndex;
+        if (m_FreeSlots.empty()) {
+            slotIndex = static_cast<uint32>(m_Slots.size());
+            m_Slots.emplace_back();
+        } else {
+            slotIndex = m_FreeSlots.back();
+            m_FreeSlots.pop_back();
+        }
+        RequestSlot& slot = m_Slots[slotIndex];
+        slot.request = std::move(request);
+        slot.isInFlight = slot.isCancelRequested = false;
+        m_QueuedSlots.push_back(slotIndex);
+        {
+            std::lock_guard<std::mutex> idleLock(m_IdleMutex);
+            m_OutstandingCount++;
+        }
+        m_ReadCount.fetch_add(1, std::memory_order_relaxed);
+        return GetRequestId(slot.generation, slotIndex);
+    }
+
+    void IoService::Submit() {
+        TRACE_ZONE("IoService::Submit");
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        if (m_QueuedSlots.empty()) {
+#ifdef IO_URING_AVAILABLE
+            // Entries the kernel turned away before stay in the ring until a submit hands them over again
+            if (m_Backend == IoBackend::IO_URING) {
+                if (const int error = SubmitUring(); error != 0)
+                    throw std::runtime_error(util::Format(FORMAT("Error code {}, could not submit reads to io_uring"), error));
+            }
+#endif
+            return;
+        }
+        for (const uint32 slotIndex : m_QueuedSlots) {
+            TRACE_FLOW_BEGIN("Read", GetRequestId(m_Slots[slotIndex].generation, slotIndex));
+            m_PendingSlots[static_cast<size_t>(m_Slots[slotIndex].request.priority)].push_back(slotIndex);
+        }
+        m_QueuedSlots.clear();
+        m_SubmitCallCount.fetch_add(1, std::memory_order_relaxed);
+#ifdef IO_URING_AVAILABLE
+        if (m_Backend == IoBackend::IO_URING) {
+            FillUring();
+            if (const int error = SubmitUring(); error != 0)
+                throw std::runtime_error(util::Format(FORMAT("Error code {}, could not submit reads to io_uring"), error));
+            return;
+        }
+#endif
+        lock.unlock();
+        m_WorkAvailable.notify_all();
+    }
+
+    bool IoService::Cancel(const uint64 requestId) {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        RequestSlot* slot = FindSlot(requestId);
+        if (!slot || slot->isCancelRequested) return false;
+        const auto slotIndex = static_cast<uint32>(requestId);
+        if (!slot->isInFlight) {
+            const auto queuedSlot = std::find(m_QueuedSlots.begin(), m_QueuedSlots.end(), slotIndex);
+            if (queuedSlot != m_QueuedSlots.end()) {
+                m_QueuedSlots.erase(queuedSlot);
+            } else {
+                std::deque<uint32>& pendingSlots = m_PendingSlots[static_cast<size_t>(slot->request.priority)];
+                pendingSlots.erase(std::find(pendingSlots.begin(), pendingSlots.end(), slotIndex));
+            }
+            IoCallback callback;
+            const IoResult result = Finish(slotIndex, IoStatus::CANCELLED, 0, 0, callback);
+            lock.unlock();
+            Dispatch(std::move(callback), result);
+            return true;
+        }
+        // Whatever the read completes with, it is reported as cancelled
+        slot->isCancelRequested = true;
+#ifdef IO_URING_AVAILABLE
+        if (m_Backend == IoBackend::IO_URING
+            && *m_Uring->submissionTail - __atomic_load_n(m_Uring->submissionHead, __ATOMIC_ACQUIRE) < m_Uring->submissionEntryCount) {
+            Uring& ring = *m_Uring;
+            const uint32 index = *ring.submissionTail & ring.submissionMask;
+            std::memset(&ring.entries[index], 0, sizeof(io_uring_sqe));
+            ring.entries[index].opcode = IORING_OP_ASYNC_CANCEL;
+            ring.entries[index].addr = requestId;
+            ring.entries[index].user_data = CANCEL_USER_DATA;
+            ring.submissionArray[index] = index;
+            __atomic_store_n(ring.submissionTail, *ring.submissionTail + 1, __ATOMIC_RELEASE);
+            if (const int error = SubmitUring(); error != 0)
+                throw std::runtime_error(util::Format(FORMAT("Error code {}, could not submit cancellation to io_uring"), error));
+        }
+#endif
+        return true;
+    }
+
+    void IoService::WaitForIdle() {
+        Submit();
+        std::unique_lock<std::mutex> lock(m_IdleMutex);
+        // Without reads in flight no completion comes to retry entries the kernel turned away, so this submits them again
+        const auto isIdle = [this] { return m_OutstandingCount == 0; };
+        while (!m_Idle.wait_for(lock, std::chrono::milliseconds(IO_RESUBMIT_INTERVAL_MILLISECONDS), isIdle)) {
+            lock.unlock();
+            Submit();
+            lock.lock();
+        }
+    }
+
+    IoStatistics IoService::GetStatistics() const {
+        return {m_ReadCount.load(std::memory_order_relaxed), m_CompletedCount.load(std::memory_order_relaxed),
+                m_FailedCount.load(std::memory_order_relaxed), m_CancelledCount.load(std::memory_order_relaxed),
+                m_SubmitCallCount.load(std::memory_order_relaxed)};
+    }
+
+    IoService::RequestSlot* IoService::FindSlot(const uint64 requestId) {
+        const auto slotIndex = static_cast<uint32>(requestId);
+        if (slotIndex >= m_Slots.size() || m_Slots[slotIndex].generation != static_cast<uint32>(requestId >> 32)) return nullptr;
+        return &m_Slots[slotIndex];
+    }
+
+    uint32 IoService::TakePendingSlot() {
+        for (std::deque<uint32>& pendingSlots : m_PendingSlots) {
+            if (pendingSlots.empty()) continue;
+            const uint32 slotIndex = pendingSlots.front();
+            pendingSlots.pop_front();
+            return slotIndex;
+        }
+        return INVALID_SLOT;
+    }
+
+    IoResult IoService::Finish(const uint32 slotIndex, const IoStatus status, const int32 error, const uint32 size, IoCallback& callback) {
+        RequestSlot& slot = m_Slots[slotIndex];
+        const IoReadRequest& request = slot.request;
+        const IoResult result{GetRequestId(slot.generation, slotIndex), status, error, size,
+                              request.bufferIndex == INVALID_IO_BUFFER ? request.data : GetBufferData(request.bufferIndex)};
+        callback = std::move(slot.request.callback);
+        slot.request.callback = nullptr;
+        // IDs of the finished read no longer match the slot, so a late cancel finds nothing
+        slot.generation++;
+        slot.isInFlight = false;
+        m_FreeSlots.push_back(slotIndex);
+        switch (status) {
+            case IoStatus::COMPLETED:
+                m_CompletedCount.fetch_add(1, std::memory_order_relaxed);
+                break;
+            case IoStatus::FAILED:
+                m_FailedCount.fetch_add(1, std::memory_order_relaxed);
+                break;
+            case IoStatus::CANCELLED:
+                m_CancelledCount.fetch_add(1, std::memory_order_relaxed);
+                break;
+        }
+        return result;
+    }
+
+    void IoService::Dispatch(IoCallback callback, const IoResult& result) {
+        TRACE_ZONE("IoService::Dispatch");
+        TRACE_FLOW_END("Read", result.requestId);
+        if (callback) {
+            if (m_JobSystem)
+                m_JobSystem->Run([callback = std::move(callback), result] { callback(result); });
+            else
+                callback(result);
+        }
+        std::lock_guard<std::mutex> lock(m_IdleMutex);
+        if (--m_OutstandingCount == 0) m_Idle.notify_all();
+    }
+
+    void IoService::WorkerLoop() {
+        TRACE_THREAD_NAME("IO worker");
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        while (true) {
+            const uint32 slotIndex = TakePendingSlot();
+            if (slotIndex == INVALID_SLOT) {
+                if (m_IsStopping) return;
+                m_WorkAvailable.wait(lock);
+                continue;
+            }
+            RequestSlot& slot = m_Slots[slotIndex];
+            slot.isInFlight = true;
+            const NativeFile file = m_Files[slot.request.fileId];
+            uint8* data = slot.request.bufferIndex == INVALID_IO_BUFFER ? slot.request.data : GetBufferData(slot.request.bufferIndex);
+            const uint32 size = slot.request.size;
+            const uint64 offset = slot.request.offset;
+            lock.unlock();
+            int32 error = 0;
+            uint32 readSize;
+            {
+                TRACE_ZONE("Positional read");
+                readSize = ReadAt(file, data, size, offset, error);
+            }
+            lock.lock();
+            // The slot vector may have grown while reading
+            const IoStatus status = m_Slots[slotIndex].isCancelRequested ? IoStatus::CANCELLED
+                                                                         : error == 0 ? IoStatus::COMPLETED : IoStatus::FAILED;
+            IoCallback callback;
+            const IoResult result = Finish(slotIndex, status, error, readSize, callback);
+            lock.unlock();
+            Dispatch(std::move(callback), result);
+            lock.lock();
+        }
+    }
+
+#ifdef IO_URING_AVAILABLE
+
+    bool IoService::CreateUring() {
+        m_Uring = std::make_unique<Uring>();
+        Uring& ring = *m_Uring;
+        // Room for a completion of every read and of a cancellation for each of them
+        io_uring_params parameters{};
+        parameters.flags = IORING_SETUP_CQSIZE;
+        parameters.cq_entries = m_Options.queueDepth * 4;
+        ring.descriptor = static_cast<int>(syscall(__NR_io_uring_setup, m_Options.queueDepth, &parameters));
+        if (ring.descriptor < 0) {
+            logging::Log(logging::LogType::WARNING_LOG, FORMAT("Error code {}, io_uring is not available, reading files on threads"),
+                         errno);
+            m_Uring.reset();
+            return false;
+        }
+        // Reads into buffers that are not registered need IORING_OP_READ, which the first kernels with io_uring lack
+        std::vector<uint8> probeMemory(sizeof(io_uring_probe) + PROBE_OPERATION_COUNT * sizeof(io_uring_probe_op));
+        auto* probe = reinterpret_cast<io_uring_probe*>(probeMemory.data());
+        if (syscall(__NR_io_uring_register, ring.descriptor, IORING_REGISTER_PROBE, probe, PROBE_OPERATION_COUNT) < 0
+            || probe->ops_len <= IORING_OP_READ || !(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED)) {
+            logging::Log(logging::LogType::WARNING_LOG, "Kernel io_uring does not support reads, reading files on threads");
+            ReleaseUring();
+            return false;
+        }
+        ring.submissionRingSize = parameters.sq_off.array + parameters.sq_entries * sizeof(uint32);
+        ring.completionRingSize = parameters.cq_off.cqes + parameters.cq_entries * sizeof(io_uring_cqe);
+        const bool isSingleMapping = parameters.features & IORING_FEAT_SINGLE_MMAP;
+        if (isSingleMapping) ring.submissionRingSize = ring.completionRingSize = std::max(ring.submissionRingSize, ring.completionRingSize);
+        ring.submissionRing = mmap(nullptr, ring.submissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.descriptor,
+                                   IORING_OFF_SQ_RING);
+        if (ring.submissionRing != MAP_FAILED && isSingleMapping)
+            ring.completionRing = ring.submissionRing;
+        else if (ring.submissionRing != MAP_FAILED)
+            ring.completionRing = mmap(nullptr, ring.completionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.descriptor,
+                                       IORING_OFF_CQ_RING);
+        ring.entriesSize = parameters.sq_entries * sizeof(io_uring_sqe);
+        if (ring.completionRing != MAP_FAILED)
+            ring.entries = static_cast<io_uring_sqe*>(mmap(nullptr, ring.entriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                                           ring.descriptor, IORING_OFF_SQES));
+        if (ring.entries == MAP_FAILED) {
+            logging::Log(logging::LogType::WARNING_LOG, FORMAT("Error code {}, could not map io_uring, reading files on threads"), errno);
+            ReleaseUring();
+            return false;
+        }
+        auto* submissionRing = static_cast<uint8*>(ring.submissionRing);
+        auto* completionRing = static_cast<uint8*>(ring.completionRing);
+        ring.submissionHead = reinterpret_cast<uint32*>(submissionRing + parameters.sq_off.head);
+        ring.submissionTail = reinterpret_cast<uint32*>(submissionRing + parameters.sq_off.tail);
+        ring.submissionArray = reinterpret_cast<uint32*>(submissionRing + parameters.sq_off.array);
+        ring.submissionMask = *reinterpret_cast<uint32*>(submissionRing + parameters.sq_off.ring_mask);
+        ring.submissionEntryCount = parameters.sq_entries;
+        ring.completionHead = reinterpret_cast<uint32*>(completionRing + parameters.cq_off.head);
+        ring.completionTail = reinterpret_cast<uint32*>(completionRing + parameters.cq_off.tail);
+        ring.completionMask = *reinterpret_cast<uint32*>(completionRing + parameters.cq_off.ring_mask);
+        ring.completions = reinterpret_cast<io_uring_cqe*>(completionRing + parameters.cq_off.cqes);
+        // Registering pins the pages once, instead of on every read. It counts against the locked memory limit on older kernels,
+        // reads into the buffers still work when it fails, just without the fixed variant.
+        std::vector<iovec> buffers(m_Options.registeredBufferCount);
+        for (uint32 bufferIndex = 0; bufferIndex < m_Options.registeredBufferCount; bufferIndex++)
+            buffers[bufferIndex] = {GetBufferData(bufferIndex), m_Options.registeredBufferSize};
+        if (!buffers.empty()) {
+            m_IsBufferRegistered = syscall(__NR_io_uring_register, ring.descriptor, IORING_REGISTER_BUFFERS, buffers.data(),
+                                           static_cast<unsigned>(buffers.size())) == 0;
+            if (!m_IsBufferRegistered)
+                logging::Log(logging::LogType::WARNING_LOG, FORMAT("Error code {}, could not register {} buffers with io_uring"), errno,
+                             buffers.size());
+        }
+        return true;
+    }
+
+    void IoService::ReleaseUring() {
+        if (!m_Uring) return;
+        Uring& ring = *m_Uring;
+        if (ring.entries != MAP_FAILED) munmap(ring.entries, ring.entriesSize);
+        if (ring.completionRing != MAP_FAILED && ring.completionRing != ring.submissionRing)
+            munmap(ring.completionRing, ring.completionRingSize);
+        if (ring.submissionRing != MAP_FAILED) munmap(ring.submissionRing, ring.submissionRingSize);
+        // Closing the ring also drops the registered buffers
+        if (ring.descriptor >= 0) close(ring.descriptor);
+        m_Uring.reset();
+    }
+
+    uint32 IoService::FillUring() {
+        Uring& ring = *m_Uring;
+        uint32 tail = *ring.submissionTail;
+        const uint32 head = __atomic_load_n(ring.submissionHead, __ATOMIC_ACQUIRE);
+        uint32 addedCount = 0;
+        while (m_InFlightCount < m_Options.queueDepth && tail - head < ring.submissionEntryCount) {
+            const uint32 slotIndex = TakePendingSlot();
+            if (slotIndex == INVALID_SLOT) break;
+            RequestSlot& slot = m_Slots[slotIndex];
+            const IoReadRequest& request = slot.request;
+            const uint32 index = tail & ring.submissionMask;
+            io_uring_sqe& entry = ring.entries[index];
+            std::memset(&entry, 0, sizeof(io_uring_sqe));
+            entry.opcode = IORING_OP_READ;
+            entry.fd = m_Files[request.fileId];
+            entry.off = request.offset;
+            entry.len = request.size;
+            entry.user_data = GetRequestId(slot.generation, slotIndex);
+            if (request.bufferIndex == INVALID_IO_BUFFER) {
+                entry.addr = reinterpret_cast<uintptr_t>(request.data);
+            } else {
+                entry.addr = reinterpret_cast<uintptr_t>(GetBufferData(request.bufferIndex));
+                if (m_IsBufferRegistered) {
+                    entry.opcode = IORING_OP_READ_FIXED;
+                    entry.buf_index = static_cast<uint16>(request.bufferIndex);
+                }
+            }
+            ring.submissionArray[index] = index;
+            slot.isInFlight = true;
+            m_InFlightCount++;
+            tail++;
+            addedCount++;
+        }
+        __atomic_store_n(ring.submissionTail, tail, __ATOMIC_RELEASE);
+        return addedCount;
+    }
+
+    int IoService::SubmitUring() {
+        const Uring& ring = *m_Uring;
+        const uint32 submitCount = *ring.submissionTail - __atomic_load_n(ring.submissionHead, __ATOMIC_ACQUIRE);
+        if (submitCount == 0) return 0;
+        while (syscall(__NR_io_uring_enter, ring.descriptor, submitCount, 0, 0, nullptr, 0) < 0) {
+            if (errno == EINTR) continue;
+            // Entries the kernel could not take yet stay in the ring, the next completion or Submit call hands them over again
+            return errno == EAGAIN || errno == EBUSY ? 0 : errno;
+        }
+        return 0;
+    }
+
+    void IoService::CompletionLoop() {
+        TRACE_THREAD_NAME("IO completion");
+        Uring& ring = *m_Uring;
+        std::vector<std::pair<IoCallback, IoResult>> finished;
+        bool isStopping = false;
+        while (!isStopping) {
+            if (syscall(__NR_io_uring_enter, ring.descriptor, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR)
+                logging::Log(logging::LogType::ERROR_LOG, FORMAT("Error code {}, could not wait on io_uring"), errno);
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                uint32 head = *ring.completionHead;
+                const uint32 tail = __atomic_load_n(ring.completionTail, __ATOMIC_ACQUIRE);
+                for (; head != tail; head++) {
+                    const io_uring_cqe& completion = ring.completions[head & ring.completionMask];
+                    if (completion.user_data == STOP_USER_DATA) isStopping = true;
+                    if (completion.user_data == STOP_USER_DATA || completion.user_data == CANCEL_USER_DATA) continue;
+                    const auto slotIndex = static_cast<uint32>(completion.user_data);
+                    m_InFlightCount--;
+                    IoStatus status = completion.res >= 0 ? IoStatus::COMPLETED : IoStatus::FAILED;
+                    if (completion.res == -ECANCELED || m_Slots[slotIndex].isCancelRequested) status = IoStatus::CANCELLED;
+                    IoCallback callback;
+                    const IoResult result = Finish(slotIndex, status, completion.res < 0 ? -completion.res : 0,
+                                                   completion.res > 0 ? static_cast<uint32>(completion.res) : 0, callback);
+                    finished.emplace_back(std::move(callback), result);
+                }
+                __atomic_store_n(ring.completionHead, head, __ATOMIC_RELEASE);
+                // Reads held back by the queue depth take the places of the ones that finished, entries the kernel turned away
+                // before go along with them
+                if (FillUring() > 0) m_SubmitCallCount.fetch_add(1, std::memory_order_relaxed);
+                if (const int error = SubmitUring(); error != 0)
+                    logging::Log(logging::LogType::ERROR_LOG, FORMAT("Error code {}, could not submit reads to io_uring"), error);
+            }
+            for (auto& [callback, result] : finished) Dispatch(std::move(callback), result);
+            finished.clear();
+        }
+    }
+
+#else
+
+    bool IoService::CreateUring() {
+        return false;
+    }
+
+    void IoService::ReleaseUring() {
+    }
+
+#endif
+}
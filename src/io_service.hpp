@@ -0,0 +1,203 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "type_definitions.hpp"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+// Reads go through io_uring when the kernel supports it, through the thread pool otherwise
+#define IO_URING_AVAILABLE
+#endif
+
+// Reads handed to the kernel or the pool at once, further ones wait in the service until one completes
+#define IO_QUEUE_DEPTH 256u
+// Buffers registered with the kernel up front, so reads into them skip mapping the pages on every request
+#define IO_REGISTERED_BUFFER_COUNT 64u
+#define IO_REGISTERED_BUFFER_SIZE (64u << 10)
+#define IO_FALLBACK_THREAD_COUNT 4u
+// How often waiting for idle submits again, in case the kernel turned entries away while nothing was in flight
+#define IO_RESUBMIT_INTERVAL_MILLISECONDS 10
+#define INVALID_IO_BUFFER UINT32_MAX
+#define INVALID_IO_REQUEST 0ull
+
+namespace voxelfield::jobs {
+    class JobSystem;
+}
+
+namespace voxelfield::file {
+    enum class IoPriority : uint8 {
+        // Needed as soon as possible, such as chunks next to the camera
+        HIGH,
+        NORMAL,
+        // Speculative, such as chunks prefetched ahead of the camera
+        LOW,
+        COUNT
+    };
+
+    enum class IoStatus : uint8 {
+        COMPLETED, FAILED, CANCELLED
+    };
+
+    enum class IoBackend : uint8 {
+        IO_URING, THREAD_POOL
+    };
+
+    struct IoResult {
+        uint64 requestId;
+        IoStatus status;
+        // Operating system error code when the read failed
+        int32 error;
+        // Bytes read, fewer than asked for when the read went past the end of the file
+        uint32 size;
+        uint8* data;
+    };
+
+    typedef std::function<void(const IoResult&)> IoCallback;
+
+    struct IoReadRequest {
+        uint32 fileId;
+        uint64 offset;
+        uint32 size;
+        // Where the data goes, ignored when a registered buffer is given
+        uint8* data = nullptr;
+        uint32 bufferIndex = INVALID_IO_BUFFER;
+        IoPriority priority = IoPriority::NORMAL;
+        IoCallback callback;
+    };
+
+    struct IoServiceOptions {
+        uint32 queueDepth = IO_QUEUE_DEPTH;
+        uint32 registeredBufferCount = IO_REGISTERED_BUFFER_COUNT, registeredBufferSize = IO_REGISTERED_BUFFER_SIZE;
+        uint32 fallbackThreadCount = IO_FALLBACK_THREAD_COUNT;
+        // Uses the thread pool even where io_uring works, for comparing the two
+        bool isUringDisabled = false;
+    };
+
+    struct IoStatistics {
+        uint64 readCount, completedCount, failedCount, cancelledCount;
+        // System calls made to submit, fewer than reads when they were batched
+        uint64 submitCallCount;
+    };
+
+    /// Reads parts of files asynchronously without a thread per read. On Linux reads are batched into an io_uring driven through the
+    /// raw system calls, and a single completion thread reaps them; elsewhere, or when the kernel lacks io_uring, a small pool of
+    /// threads does positional reads. Reads are queued until Submit, are handed over highest priority first, and can be cancelled
+    /// until their callback runs.
+    class IoService {
+    public:
+        /// Callbacks are run as jobs when a job system is given, otherwise on the service's own threads where they have to be short
+        explicit IoService(const IoServiceOptions& options = {}, jobs::JobSystem* jobSystem = nullptr);
+
+        ~IoService();
+
+        IoService(const IoService&) = delete;
+
+        IoService& operator=(const IoService&) = delete;
+
+        /// Throws when the file can not be opened
+        uint32 OpenFile(const std::string& fileName);
+
+        /// No read of the file may be outstanding
+        void CloseFile(uint32 fileId);
+
+        /// Claims one of the registered buffers, INVALID_IO_BUFFER when all of them are in use
+        uint32 AcquireBuffer();
+
+        void ReleaseBuffer(uint32 bufferIndex);
+
+        uint8* GetBufferData(uint32 bufferIndex) const {
+            return m_BufferMemory.get() + static_cast<size_t>(bufferIndex) * m_Options.registeredBufferSize;
+        }
+
+        uint32 GetBufferSize() const {
+            return m_Options.registeredBufferSize;
+        }
+
+        /// Queues a read, it is not started before the next Submit. The destination has to stay valid until the callback runs.
+        uint64 Read(IoReadRequest request);
+
+        /// Starts every queued read, highest priority first, with a single system call for as many as fit the queue depth
+        void Submit();
+
+        /// Returns false when the read already completed. A cancelled read still gets its callback, with IoStatus::CANCELLED, and
+        /// one already in the kernel may have written its destination by then.
+        bool Cancel(uint64 requestId);
+
+        /// Submits queued reads and blocks until every read has completed and its callback was run or scheduled
+        void WaitForIdle();
+
+        IoBackend GetBackend() const {
+            return m_Backend;
+        }
+
+        IoStatistics GetStatistics() const;
+
+    private:
+#ifdef _WIN32
+        typedef void* NativeFile;
+#else
+        typedef int NativeFile;
+#endif
+        struct Uring;
+
+        struct RequestSlot {
+            IoReadRequest request;
+            uint32 generation = 1;
+            bool isInFlight = false, isCancelRequested = false;
+        };
+
+        IoServiceOptions m_Options;
+        jobs::JobSystem* m_JobSystem;
+        IoBackend m_Backend = IoBackend::THREAD_POOL;
+        std::unique_ptr<Uring> m_Uring;
+        std::unique_ptr<uint8[]> m_BufferMemory;
+        bool m_IsBufferRegistered = false;
+        std::vector<uint32> m_FreeBuffers;
+        std::vector<NativeFile> m_Files;
+        mutable std::mutex m_Mutex;
+        std::vector<RequestSlot> m_Slots;
+        std::vector<uint32> m_FreeSlots;
+        // Reads queued since the last submit, and submitted ones waiting for room in the queue per priority
+        std::vector<uint32> m_QueuedSlots;
+        std::deque<uint32> m_PendingSlots[static_cast<size_t>(IoPriority::COUNT)];
+        uint32 m_InFlightCount = 0;
+        bool m_IsStopping = false;
+        std::condition_variable m_WorkAvailable;
+        std::mutex m_IdleMutex;
+        std::condition_variable m_Idle;
+        uint64 m_OutstandingCount = 0;
+        std::vector<std::thread> m_Threads;
+        std::atomic<uint64> m_ReadCount{0}, m_CompletedCount{0}, m_FailedCount{0}, m_CancelledCount{0}, m_SubmitCallCount{0};
+
+        bool CreateUring();
+
+        void ReleaseUring();
+
+        RequestSlot* FindSlot(uint64 requestId);
+
+        uint32 TakePendingSlot();
+
+        /// Moves pending reads into the ring until it holds the queue depth, returns how many were added
+        uint32 FillUring();
+
+        /// Hands every entry added to the ring to the kernel, returns the error code when it refused them
+        int SubmitUring();
+
+        void CompletionLoop();
+
+        void WorkerLoop();
+
+        /// Frees the slot and builds the result of its read, called with the mutex held
+        IoResult Finish(uint32 slotIndex, IoStatus status, int32 error, uint32 size, IoCallback& callback);
+
+        void Dispatch(IoCallback callback, const IoResult& result);
+    };
+}
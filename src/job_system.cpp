@@ -0,0 +1,325 @@
+#include "job_system.hpp"
+
+#include <string>
+
+#include "logger.hpp"
+#include "string_util.hpp"
+#include "tracer.hpp"
+
+namespace voxelfield::jobs {
+    namespace {
+        // Finished jobs are kept per thread for reuse instead of going back to the heap
+        constexpr size_t MAX_CACHED_JOBS = 256;
+
+        thread_local const JobSystem* t_JobSystem = nullptr;
+        thread_local uint32 t_WorkerIndex = INVALID_WORKER_INDEX;
+        // Nested waits run jobs inside jobs, only the outermost one counts towards busy time
+        thread_local uint32 t_ExecutionDepth = 0;
+        thread_local uint32 t_StealSeed = 0;
+
+        struct JobCache {
+            std::vector<Job*> jobs;
+
+            ~JobCache() {
+                for (Job* job : jobs) delete job;
+            }
+        };
+
+        thread_local JobCache t_CachedJobs;
+
+        Job* AllocateJob(std::function<void()>&& function, Counter* counter) {
+            Job* job;
+            if (t_CachedJobs.jobs.empty()) {
+                job = new Job;
+            } else {
+                job = t_CachedJobs.jobs.back();
+                t_CachedJobs.jobs.pop_back();
+            }
+            job->function = std::move(function);
+            job->counter = counter;
+            return job;
+        }
+
+        void FreeJob(Job* job) {
+            if (t_CachedJobs.jobs.size() < MAX_CACHED_JOBS) {
+                job->function = nullptr;
+                t_CachedJobs.jobs.push_back(job);
+            } else {
+                delete job;
+            }
+        }
+
+        uint32 NextStealSeed() {
+            // Xorshift, enough to spread out which victim each thief tries first
+            uint32 seed = t_StealSeed;
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            return t_StealSeed = seed;
+        }
+    }
+
+    bool WorkStealingQueue::Push(Job* job) {
+        const int64_t bottom = m_Bottom.load(std::memory_order_relaxed), top = m_Top.load(std::memory_order_acquire);
+        if (bottom - top >= JOB_QUEUE_CAPACITY) return false;
+        m_Jobs[bottom & (JOB_QUEUE_CAPACITY - 1)].store(job, std::memory_order_relaxed);
+        m_Bottom.store(bottom + 1, std::memory_order_release);
+        return true;
+    }
+
+    Job* WorkStealingQueue::Pop() {
+        const int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+        m_Bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = m_Top.load(std::memory_order_relaxed);
+        if (top > bottom) {
+            m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        Job* job = m_Jobs[bottom & (JOB_QUEUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (top == bottom) {
+            // Last job, a thief may be taking it at the same time
+            if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) job = nullptr;
+            m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    Job* WorkStealingQueue::Steal() {
+        int64_t top = m_Top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t bottom = m_Bottom.load(std::memory_order_acquire);
+        if (top >= bottom) return nullptr;
+        Job* job = m_Jobs[top & (JOB_QUEUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+        return job;
+    }
+
+    size_t WorkStealingQueue::GetSize() const {
+        const int64_t bottom = m_Bottom.load(std::memory_order_relaxed), top = m_Top.load(std::memory_order_relaxed);
+        return static_cast<size_t>(std::max<int64_t>(bottom - top, 0));
+    }
+
+    JobSystem::JobSystem(const uint32 workerCount)
+            : m_WorkerCount(std::max(workerCount, 2u)), m_LastUtilizationTime(Clock::now()),
+              m_PreviousMainThreadSystem(t_JobSystem), m_PreviousMainThreadIndex(t_WorkerIndex) {
+        // Two workers at least, with only the main thread nothing would run while it is not waiting
+        for (uint32 workerIndex = 0; workerIndex < m_WorkerCount; workerIndex++)
+            m_Workers.push_back(std::make_unique<Worker>());
+        t_JobSystem = this;
+        t_WorkerIndex = 0;
+        t_StealSeed = 1;
+        TRACE_THREAD_NAME("Main");
+        for (uint32 workerIndex = 1; workerIndex < m_WorkerCount; workerIndex++)
+            m_Threads.emplace_back(&JobSystem::WorkerLoop, this, workerIndex);
+        logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Successfully created job system with {} workers"), m_WorkerCount);
+    }
+
+    JobSystem::~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(m_SleepMutex);
+            m_IsStopping = true;
+        }
+        m_WorkAvailable.notify_all();
+        for (std::thread& thread : m_Threads) thread.join();
+        // Jobs that never ran are dropped, nothing can wait on them any more
+        for (const std::unique_ptr<Worker>& worker : m_Workers)
+            while (Job* job = worker->queue.Steal()) delete job;
+        for (Job* job : m_OverflowJobs) delete job;
+        for (Job* job : m_MainThreadJobs) delete job;
+        t_JobSystem = m_PreviousMainThreadSystem;
+        t_WorkerIndex = m_PreviousMainThreadIndex;
+    }
+
+    void JobSystem::Run(std::function<void()> function, Counter* counter) {
+        if (counter) counter->m_Value.fetch_add(1, std::memory_order_relaxed);
+        Schedule(AllocateJob(std::move(function), counter));
+    }
+
+    void JobSystem::RunAfter(Counter& dependency, std::function<void()> function, Counter* counter) {
+        if (counter) counter->m_Value.fetch_add(1, std::memory_order_relaxed);
+        Job* job = AllocateJob(std::move(function), counter);
+        {
+            std::lock_guard<std::mutex> lock(dependency.m_Mutex);
+            if (dependency.m_Value.load(std::memory_order_acquire) != 0) {
+                dependency.m_Continuations.push_back(job);
+                return;
+            }
+        }
+        Schedule(job);
+    }
+
+    void JobSystem::RunOnMainThread(std::function<void()> function, Counter* counter) {
+        if (counter) counter->m_Value.fetch_add(1, std::memory_order_relaxed);
+        Job* job = AllocateJob(std::move(function), counter);
+        std::lock_guard<std::mutex> lock(m_MainThreadMutex);
+        m_MainThreadJobs.push_back(job);
+    }
+
+    void JobSystem::Wait(Counter& counter) {
+        const uint32 workerIndex = GetWorkerIndex();
+        while (!counter.IsDone()) {
+            // Threads the system does not own have no command pools or other per-worker state, so they only wait
+            if (workerIndex == INVALID_WORKER_INDEX) {
+                std::this_thread::yield();
+            } else if (Job* job = FindJob(workerIndex)) {
+                Execute(job, workerIndex);
+            } else if (workerIndex == 0) {
+                ExecuteMainThreadJobs();
+                std::this_thread::yield();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        // Pairs with the lock the last job finishes under
+        std::lock_guard<std::mutex> lock(counter.m_Mutex);
+    }
+
+    void JobSystem::EndFrame() {
+        ExecuteMainThreadJobs();
+        if (Clock::now() - m_LastUtilizationTime >= std::chrono::duration<double>(JOB_UTILIZATION_INTERVAL_SECONDS))
+            LogUtilization();
+    }
+
+    void JobSystem::ExecuteMainThreadJobs() {
+        // Taken out as a whole, jobs queued by these run next time so a job that requeues itself can not stall the frame. A local list
+        // also keeps this safe to reenter from a main thread job that waits.
+        std::vector<Job*> jobs;
+        {
+            std::lock_guard<std::mutex> lock(m_MainThreadMutex);
+            if (m_MainThreadJobs.empty()) return;
+            jobs.swap(m_MainThreadJobs);
+        }
+        for (Job* job : jobs) Execute(job, 0);
+    }
+
+    std::vector<WorkerUtilization> JobSystem::SampleUtilization() {
+        const Clock::time_point now = Clock::now();
+        const double elapsedNanoseconds = std::max(std::chrono::duration<double, std::nano>(now - m_LastUtilizationTime).count(), 1.0);
+        m_LastUtilizationTime = now;
+        std::vector<WorkerUtilization> utilization;
+        utilization.reserve(m_WorkerCount);
+        for (const std::unique_ptr<Worker>& worker : m_Workers) {
+            const uint64 busyNanoseconds = worker->busyNanoseconds.load(std::memory_order_relaxed),
+                    jobCount = worker->jobCount.load(std::memory_order_relaxed), stealCount = worker->stealCount.load(std::memory_order_relaxed);
+            utilization.push_back({
+                    std::min((busyNanoseconds - worker->sampledBusyNanoseconds) / elapsedNanoseconds, 1.0),
+                    jobCount - worker->sampledJobCount,
+                    stealCount - worker->sampledStealCount
+            });
+            worker->sampledBusyNanoseconds = busyNanoseconds;
+            worker->sampledJobCount = jobCount;
+            worker->sampledStealCount = stealCount;
+        }
+        return utilization;
+    }
+
+    void JobSystem::LogUtilization() {
+        const std::vector<WorkerUtilization> utilization = SampleUtilization();
+        std::string busyList;
+        uint64 jobCount = 0, stealCount = 0;
+        double busySum = 0.0;
+        for (const WorkerUtilization& worker : utilization) {
+            busyList += util::Format(FORMAT(" {:.0f}%"), worker.busyFraction * 100.0);
+            jobCount += worker.jobCount;
+            stealCount += worker.stealCount;
+            busySum += worker.busyFraction;
+        }
+        // A low average with jobs still queued points at dependencies serializing work, a high one at more work than cores
+        logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("[Job system] busy{}, average {:.0f}%, {} jobs, {} stolen, {} queued"),
+                     busyList, busySum / utilization.size() * 100.0, jobCount, stealCount, m_QueuedJobCount.load(std::memory_order_relaxed));
+    }
+
+    uint32 JobSystem::GetWorkerIndex() const {
+        return t_JobSystem == this ? t_WorkerIndex : INVALID_WORKER_INDEX;
+    }
+
+    void JobSystem::Schedule(Job* job) {
+        // Counted before it is visible, so a worker taking it right away can not bring the count below zero
+        m_QueuedJobCount.fetch_add(1);
+        const uint32 workerIndex = GetWorkerIndex();
+        if (workerIndex == INVALID_WORKER_INDEX || !m_Workers[workerIndex]->queue.Push(job)) {
+            std::lock_guard<std::mutex> lock(m_OverflowMutex);
+            m_OverflowJobs.push_back(job);
+        }
+        // Sleepers check the queued count under the mutex, taking it here means a notification can not slip in before they wait
+        if (m_SleepingCount.load() > 0) {
+            std::lock_guard<std::mutex> lock(m_SleepMutex);
+            m_WorkAvailable.notify_one();
+        }
+    }
+
+    Job* JobSystem::FindJob(const uint32 workerIndex) {
+        if (m_QueuedJobCount.load(std::memory_order_relaxed) == 0) return nullptr;
+        Job* job = m_Workers[workerIndex]->queue.Pop();
+        if (!job) {
+            const uint32 firstVictim = NextStealSeed() % m_WorkerCount;
+            for (uint32 victimOffset = 0; victimOffset < m_WorkerCount && !job; victimOffset++) {
+                const uint32 victimIndex = (firstVictim + victimOffset) % m_WorkerCount;
+                if (victimIndex == workerIndex) continue;
+                job = m_Workers[victimIndex]->queue.Steal();
+            }
+            if (job) m_Workers[workerIndex]->stealCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (!job) {
+            std::lock_guard<std::mutex> lock(m_OverflowMutex);
+            if (!m_OverflowJobs.empty()) {
+                job = m_OverflowJobs.back();
+                m_OverflowJobs.pop_back();
+            }
+        }
+        if (job) m_QueuedJobCount.fetch_sub(1, std::memory_order_relaxed);
+        return job;
+    }
+
+    void JobSystem::Execute(Job* job, const uint32 workerIndex) {
+        Worker& worker = *m_Workers[workerIndex];
+        const bool isOutermost = t_ExecutionDepth++ == 0;
+        const Clock::time_point start = isOutermost ? Clock::now() : Clock::time_point{};
+        job->function();
+        if (isOutermost) {
+            const auto busyNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+            worker.busyNanoseconds.fetch_add(static_cast<uint64>(busyNanoseconds), std::memory_order_relaxed);
+        }
+        t_ExecutionDepth--;
+        worker.jobCount.fetch_add(1, std::memory_order_relaxed);
+        Counter* counter = job->counter;
+        FreeJob(job);
+        Finish(counter);
+    }
+
+    void JobSystem::Finish(Counter* counter) {
+        if (!counter) return;
+        std::vector<Job*> continuations;
+        {
+            std::lock_guard<std::mutex> lock(counter->m_Mutex);
+            if (counter->m_Value.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+            continuations.swap(counter->m_Continuations);
+        }
+        for (Job* continuation : continuations) Schedule(continuation);
+    }
+
+    void JobSystem::WorkerLoop(const uint32 workerIndex) {
+        t_JobSystem = this;
+        t_WorkerIndex = workerIndex;
+        t_StealSeed = workerIndex * 2654435761u + 1;
+        TRACE_THREAD_NAME(util::Format(FORMAT("Worker {}"), workerIndex).GetString());
+        uint32 idleSpinCount = 0;
+        while (!m_IsStopping.load(std::memory_order_relaxed)) {
+            if (Job* job = FindJob(workerIndex)) {
+                Execute(job, workerIndex);
+                idleSpinCount = 0;
+                continue;
+            }
+            if (++idleSpinCount < JOB_IDLE_SPIN_COUNT) {
+                std::this_thread::yield();
+                continue;
+            }
+            idleSpinCount = 0;
+            std::unique_lock<std::mutex> lock(m_SleepMutex);
+            m_SleepingCount.fetch_add(1);
+            m_WorkAvailable.wait(lock, [&] { return m_IsStopping.load() || m_QueuedJobCount.load() > 0; });
+            m_SleepingCount.fetch_sub(1);
+        }
+    }
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "type_definitions.hpp"
+
+// Per-worker deque capacity, jobs pushed past it go to the shared overflow queue
+#define JOB_QUEUE_CAPACITY 4096
+// Times an idle worker yields and looks for work again before going to sleep
+#define JOB_IDLE_SPIN_COUNT 64
+// Parallel for splits its range into about this many batches per worker so stolen batches even out uneven work
+#define PARALLEL_FOR_BATCHES_PER_WORKER 4
+#define JOB_UTILIZATION_INTERVAL_SECONDS 5.0
+#define INVALID_WORKER_INDEX UINT32_MAX
+
+namespace voxelfield::jobs {
+    class JobSystem;
+
+    struct Job;
+
+    /// Number of jobs still outstanding for something to wait on. A job given a counter increments it when scheduled and decrements
+    /// it when finished, and continuations scheduled after a counter run once it drops to zero.
+    class Counter {
+    public:
+        Counter() = default;
+
+        Counter(const Counter&) = delete;
+
+        Counter& operator=(const Counter&) = delete;
+
+        bool IsDone() const {
+            return m_Value.load(std::memory_order_acquire) == 0;
+        }
+
+    private:
+        friend class JobSystem;
+
+        std::atomic<uint32> m_Value{0};
+        // Held while the last job finishes, so a waiter that saw zero can not destroy the counter under it
+        std::mutex m_Mutex;
+        std::vector<Job*> m_Continuations;
+    };
+
+    struct Job {
+        std::function<void()> function;
+        Counter* counter;
+    };
+
+    /// Chase-Lev deque of a single owner. The owner pushes and pops at the bottom without locking, other workers steal from the top
+    /// and only contend on the last job with a compare and swap.
+    class WorkStealingQueue {
+    public:
+        bool Push(Job* job);
+
+        Job* Pop();
+
+        Job* Steal();
+
+        size_t GetSize() const;
+
+    private:
+        static_assert((JOB_QUEUE_CAPACITY & (JOB_QUEUE_CAPACITY - 1)) == 0, "Queue capacity has to be a power of two");
+
+        alignas(64) std::atomic<int64_t> m_Top{0};
+        alignas(64) std::atomic<int64_t> m_Bottom{0};
+        std::atomic<Job*> m_Jobs[JOB_QUEUE_CAPACITY]{};
+    };
+
+    struct WorkerUtilization {
+        // Fraction of the interval spent running jobs
+        double busyFraction;
+        uint64 jobCount, stealCount;
+    };
+
+    /// Runs jobs on one worker per hardware thread. The thread that creates the system is worker zero, it runs jobs while it waits
+    /// on a counter and executes the jobs that have to stay on the main thread once per frame. Every other worker has a thread of its
+    /// own that takes jobs from its deque first and steals from the others when it runs dry, sleeping only after a short spin.
+    class JobSystem {
+    public:
+        explicit JobSystem(uint32 workerCount = std::thread::hardware_concurrency());
+
+        ~JobSystem();
+
+        JobSystem(const JobSystem&) = delete;
+
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        void Run(std::function<void()> function, Counter* counter = nullptr);
+
+        /// Schedules the job once every job counted by the dependency has finished
+        void RunAfter(Counter& dependency, std::function<void()> function, Counter* counter = nullptr);
+
+        /// Queues a job for the next EndFrame, for work that has to happen on the thread that owns the window and the queues
+        void RunOnMainThread(std::function<void()> function, Counter* counter = nullptr);
+
+        /// Runs other jobs until the counter reaches zero, on the main thread this includes main thread jobs
+        void Wait(Counter& counter);
+
+        /// Calls the body with consecutive [first, last) batches covering the range and returns once all of them are done. Batches
+        /// are sized from the worker count unless a grain size is given, never going below the minimum.
+        template<typename Body>
+        void ParallelFor(const size_t count, Body&& body, size_t grainSize = 0, const size_t minimumGrainSize = 1) {
+            if (count == 0) return;
+            if (grainSize == 0) grainSize = (count + m_WorkerCount * PARALLEL_FOR_BATCHES_PER_WORKER - 1) / (m_WorkerCount * PARALLEL_FOR_BATCHES_PER_WORKER);
+            grainSize = std::max(grainSize, minimumGrainSize);
+            Counter counter;
+            // The first batch is left for the calling thread, it would only wait otherwise
+            for (size_t first = grainSize; first < count; first += grainSize) {
+                const size_t last = std::min(count, first + grainSize);
+                Run([&body, first, last] { body(first, last); }, &counter);
+            }
+            body(size_t{0}, std::min(count, grainSize));
+            Wait(counter);
+        }
+
+        /// Runs the main thread jobs and logs worker utilization once per interval, called every iteration of the window loop
+        void EndFrame();
+
+        void ExecuteMainThreadJobs();
+
+        /// Utilization of every worker since the last call
+        std::vector<WorkerUtilization> SampleUtilization();
+
+        void LogUtilization();
+
+        uint32 GetWorkerCount() const {
+            return m_WorkerCount;
+        }
+
+        /// Index of the calling thread among the workers, INVALID_WORKER_INDEX for threads the system does not own
+        uint32 GetWorkerIndex() const;
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        struct alignas(64) Worker {
+            WorkStealingQueue queue;
+            std::atomic<uint64> busyNanoseconds{0}, jobCount{0}, stealCount{0};
+            // Values at the last utilization sample, only touched by the main thread
+            uint64 sampledBusyNanoseconds = 0, sampledJobCount = 0, sampledStealCount = 0;
+        };
+
+        uint32 m_WorkerCount;
+        std::vector<std::unique_ptr<Worker>> m_Workers;
+        std::vector<std::thread> m_Threads;
+        // Jobs pushed from threads without a deque or past a full one
+        std::mutex m_OverflowMutex;
+        std::vector<Job*> m_OverflowJobs;
+        std::mutex m_MainThreadMutex;
+        std::vector<Job*> m_MainThreadJobs;
+        std::atomic<uint32> m_QueuedJobCount{0}, m_SleepingCount{0};
+        std::atomic<bool> m_IsStopping{false};
+        std::mutex m_SleepMutex;
+        std::condition_variable m_WorkAvailable;
+        Clock::time_point m_LastUtilizationTime;
+        const JobSystem* m_PreviousMainThreadSystem;
+        uint32 m_PreviousMainThreadIndex;
+
+        void Schedule(Job* job);
+
+        Job* FindJob(uint32 workerIndex);
+
+        void Execute(Job* job, uint32 workerIndex);
+
+        void Finish(Counter* counter);
+
+        void WorkerLoop(uint32 workerIndex);
+    };
+}
@@ -1,7 +1,265 @@
 #include "logger.hpp"
 
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
 namespace voxelfield::logging {
-    void Log(LogType logType, const std::string& message) {
-        (logType == LogType::ERROR_LOG ? std::cerr : std::cout) << message << std::endl;
+    namespace {
+        static_assert((LOG_RING_CAPACITY & (LOG_RING_CAPACITY - 1)) == 0, "Ring capacity has to be a power of two");
+
+        // Single producer, single consumer ring of records. The owning thread fills the slot at the tail and publishes it by moving
+        // the tail, the background thread reads from the head and hands slots back by moving the head.
+        struct RecordRing {
+            alignas(64) std::atomic<uint64> head{0};
+            // Producer's copy of the head, only reloaded when the ring looks full
+            alignas(64) uint64 cachedHead = 0;
+            std::atomic<uint64> tail{0};
+            std::atomic<uint64> droppedCount{0};
+            // Set when the owning thread exits, the ring is removed once it is empty
+            std::atomic<bool> isRetired{false};
+            alignas(64) LogRecord records[LOG_RING_CAPACITY];
+        };
+
+        const char* GetLogTypeName(const LogType logType) {
+            switch (logType) {
+                case LogType::INFORMATION_LOG:
+                    return "INFO";
+                case LogType::WARNING_LOG:
+                    return "WARN";
+                default:
+                    return "ERROR";
+            }
+        }
+
+        class Logger {
+        public:
+            Logger() : m_StartTimestamp(GetTimestamp()), m_StartTime(Clock::now()), m_Thread(&Logger::WriteLoop, this) {
+            }
+
+            ~Logger() {
+                {
+                    std::lock_guard<std::mutex> lock(m_Mutex);
+                    m_IsStopping = true;
+                }
+                m_FlushRequested.notify_one();
+                m_Thread.join();
+                if (m_File) std::fclose(m_File);
+            }
+
+            RecordRing* AddRing() {
+                auto ring = std::make_unique<RecordRing>();
+                RecordRing* ringPointer = ring.get();
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Rings.push_back(std::move(ring));
+                return ringPointer;
+            }
+
+            OverflowPolicy GetOverflowPolicy() const {
+                return m_OverflowPolicy.load(std::memory_order_relaxed);
+            }
+
+            void Configure(const LoggerOptions& options) {
+                Flush();
+                File* file = nullptr;
+                if (!options.fileName.empty()) {
+                    file = std::fopen(options.fileName.c_str(), "ab");
+                    if (!file)
+                        throw std::runtime_error(util::Format(FORMAT("Could not open log file with name {}"), options.fileName));
+                }
+                std::lock_guard<std::mutex> lock(m_FileMutex);
+                if (m_File) std::fclose(m_File);
+                m_File = file;
+                m_OverflowPolicy.store(options.overflowPolicy, std::memory_order_relaxed);
+            }
+
+            void Flush() {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                const uint64 flushIndex = ++m_RequestedFlushIndex;
+                m_FlushRequested.notify_one();
+                m_Flushed.wait(lock, [&] { return m_FlushedIndex >= flushIndex; });
+            }
+
+            uint64 GetDroppedCount() {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                uint64 droppedCount = m_RetiredDroppedCount;
+                for (const auto& ring : m_Rings) droppedCount += ring->droppedCount.load(std::memory_order_relaxed);
+                return droppedCount;
+            }
+
+        private:
+            typedef std::chrono::steady_clock Clock;
+
+            int64_t m_StartTimestamp;
+            Clock::time_point m_StartTime;
+            double m_TicksPerSecond = 0.0;
+            std::mutex m_Mutex;
+            // Held by the background thread while it writes, so the file is not swapped out from under it
+            std::mutex m_FileMutex;
+            std::condition_variable m_FlushRequested, m_Flushed;
+            // Rings are only added or removed with the mutex held, and only the background thread removes them
+            std::vector<std::unique_ptr<RecordRing>> m_Rings;
+            // Copy of the ring list taken with the mutex held, the rings stay alive since only the background thread removes them
+            std::vector<RecordRing*> m_WriteRings;
+            File* m_File = nullptr;
+            std::atomic<OverflowPolicy> m_OverflowPolicy{OverflowPolicy::BLOCK_PRODUCER};
+            uint64 m_RequestedFlushIndex = 0, m_FlushedIndex = 0;
+            uint64 m_RetiredDroppedCount = 0, m_ReportedDroppedCount = 0;
+            bool m_IsStopping = false;
+            std::vector<const LogRecord*> m_PendingRecords;
+            std::vector<uint64> m_Tails;
+            char m_Line[MAX_MESSAGE_LENGTH * 2];
+            std::thread m_Thread;
+
+            void WriteLoop() {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                while (true) {
+                    m_FlushRequested.wait_for(lock, std::chrono::milliseconds(LOG_FLUSH_INTERVAL_MILLISECONDS), [&] {
+                        return m_IsStopping || m_RequestedFlushIndex > m_FlushedIndex;
+                    });
+                    // Whatever was logged before a flush was requested is in the rings by now
+                    const uint64 flushIndex = m_RequestedFlushIndex;
+                    const bool isStopping = m_IsStopping;
+                    m_WriteRings.clear();
+                    for (const auto& ring : m_Rings) m_WriteRings.push_back(ring.get());
+                    // Formatting and writing go without the mutex, a thread logging for the first time would wait on the I/O otherwise
+                    lock.unlock();
+                    WriteRecords();
+                    lock.lock();
+                    RemoveDrainedRings();
+                    m_FlushedIndex = flushIndex;
+                    m_Flushed.notify_all();
+                    if (isStopping) return;
+                }
+            }
+
+            // Writes every published record in timestamp order across the copied rings, called without the mutex
+            void WriteRecords() {
+                std::lock_guard<std::mutex> lock(m_FileMutex);
+                const double elapsedSeconds = std::chrono::duration<double>(Clock::now() - m_StartTime).count();
+                if (elapsedSeconds > 0.0) m_TicksPerSecond = (GetTimestamp() - m_StartTimestamp) / elapsedSeconds;
+                m_PendingRecords.clear();
+                m_Tails.resize(m_WriteRings.size());
+                for (size_t ringIndex = 0; ringIndex < m_WriteRings.size(); ringIndex++) {
+                    RecordRing& ring = *m_WriteRings[ringIndex];
+                    const uint64 head = ring.head.load(std::memory_order_relaxed);
+                    m_Tails[ringIndex] = ring.tail.load(std::memory_order_acquire);
+                    for (uint64 index = head; index < m_Tails[ringIndex]; index++)
+                        m_PendingRecords.push_back(&ring.records[index & (LOG_RING_CAPACITY - 1)]);
+                }
+                std::stable_sort(m_PendingRecords.begin(), m_PendingRecords.end(), [](const LogRecord* left, const LogRecord* right) {
+                    return left->timestamp < right->timestamp;
+                });
+                for (const LogRecord* record : m_PendingRecords) WriteRecord(*record);
+                // Slots are only handed back once written, formatting reads strings straight out of them
+                for (size_t ringIndex = 0; ringIndex < m_WriteRings.size(); ringIndex++)
+                    m_WriteRings[ringIndex]->head.store(m_Tails[ringIndex], std::memory_order_release);
+                // Only this thread changes the retired count, so it is read without the mutex
+                uint64 droppedCount = m_RetiredDroppedCount;
+                for (const RecordRing* ring : m_WriteRings) droppedCount += ring->droppedCount.load(std::memory_order_relaxed);
+                if (droppedCount > m_ReportedDroppedCount) {
+                    WriteLine(LogType::WARNING_LOG, GetTimestamp(),
+                              util::Format(FORMAT("Dropped {} log records because a ring was full, {} in total"),
+                                           droppedCount - m_ReportedDroppedCount, droppedCount).GetString());
+                    m_ReportedDroppedCount = droppedCount;
+                }
+                if (m_PendingRecords.empty()) return;
+                if (m_File) {
+                    std::fflush(m_File);
+                } else {
+                    std::fflush(stdout);
+                    std::fflush(stderr);
+                }
+            }
+
+            // Rings of threads that exited go once they are drained, the tail can not move any more. Called with the mutex held.
+            void RemoveDrainedRings() {
+                for (auto it = m_Rings.begin(); it != m_Rings.end();) {
+                    RecordRing& ring = **it;
+                    if (ring.isRetired.load(std::memory_order_acquire)
+                        && ring.head.load(std::memory_order_relaxed) == ring.tail.load(std::memory_order_acquire)) {
+                        m_RetiredDroppedCount += ring.droppedCount.load(std::memory_order_relaxed);
+                        it = m_Rings.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+            }
+
+            void WriteRecord(const LogRecord& record) {
+                record.formatter(record, m_Line, sizeof(m_Line));
+                WriteLine(record.logType, record.timestamp, m_Line);
+            }
+
+            void WriteLine(const LogType logType, const int64_t timestamp, const char* line) {
+                if (m_File) {
+                    const double seconds = m_TicksPerSecond > 0.0 ? (timestamp - m_StartTimestamp) / m_TicksPerSecond : 0.0;
+                    std::fprintf(m_File, "[%12.6f] %-5s %s\n", seconds, GetLogTypeName(logType), line);
+                } else {
+                    std::FILE* stream = logType == LogType::ERROR_LOG ? stderr : stdout;
+                    std::fputs(line, stream);
+                    std::fputc('\n', stream);
+                }
+            }
+        };
+
+        Logger& GetLogger() {
+            static Logger logger;
+            return logger;
+        }
+
+        // Gives the thread's ring back when the thread exits
+        struct RingOwner {
+            RecordRing* ring = nullptr;
+
+            ~RingOwner() {
+                if (ring) ring->isRetired.store(true, std::memory_order_release);
+            }
+        };
+
+        thread_local RingOwner t_RingOwner;
+    }
+
+    void Configure(const LoggerOptions& options) {
+        GetLogger().Configure(options);
+    }
+
+    void Flush() {
+        GetLogger().Flush();
+    }
+
+    uint64 GetDroppedCount() {
+        return GetLogger().GetDroppedCount();
+    }
+
+    void Log(const LogType logType, const std::string_view message) {
+        Log(logType, FORMAT("{}"), message);
+    }
+
+    LogRecord* BeginRecord() {
+        Logger& logger = GetLogger();
+        RecordRing* ring = t_RingOwner.ring;
+        if (!ring) ring = t_RingOwner.ring = logger.AddRing();
+        const uint64 tail = ring->tail.load(std::memory_order_relaxed);
+        while (tail - ring->cachedHead >= LOG_RING_CAPACITY) {
+            ring->cachedHead = ring->head.load(std::memory_order_acquire);
+            if (tail - ring->cachedHead < LOG_RING_CAPACITY) break;
+            if (logger.GetOverflowPolicy() == OverflowPolicy::DROP_RECORDS) {
+                ring->droppedCount.store(ring->droppedCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            std::this_thread::yield();
+        }
+        return &ring->records[tail & (LOG_RING_CAPACITY - 1)];
+    }
+
+    void EndRecord() {
+        RecordRing* ring = t_RingOwner.ring;
+        ring->tail.store(ring->tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
     }
-}
\ No newline at end of file
+}
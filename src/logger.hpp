@@ -1,18 +1,184 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <tuple>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+// Records are stamped with the time stamp counter, a fraction of what reading the steady clock costs
+#define LOG_TIMESTAMP_COUNTER
+#endif
 
 #include "type_definitions.hpp"
 #include "string_util.hpp"
 
 #define MAX_MESSAGE_LENGTH 512
+// Size of every record in the rings, arguments and copied strings have to fit in what the header leaves
+#define LOG_RECORD_SIZE 640
+// Records each thread can have waiting before the overflow policy kicks in, a power of two
+#define LOG_RING_CAPACITY 256
+// How long the background thread sleeps when every ring is empty
+#define LOG_FLUSH_INTERVAL_MILLISECONDS 2
 
 namespace voxelfield::logging {
     enum class LogType : uint8 {
         INFORMATION_LOG, WARNING_LOG, ERROR_LOG
     };
 
-    void Log(LogType logType, const std::string& message);
-}
+    /// What a thread does when its ring is full
+    enum class OverflowPolicy : uint8 {
+        // Record is thrown away and counted, the caller never waits on the output
+        DROP_RECORDS,
+        // Caller yields until the background thread has made room
+        BLOCK_PRODUCER
+    };
+
+    struct LoggerOptions {
+        // Records go to standard output and errors to standard error when empty
+        std::string fileName;
+        OverflowPolicy overflowPolicy = OverflowPolicy::BLOCK_PRODUCER;
+    };
+
+    struct LogRecord;
+
+    typedef void (* RecordFormatter)(const LogRecord& record, char* output, size_t outputSize);
+
+    /// Everything needed to write a line later. Arguments are copied into the payload in binary form, strings byte for byte, and the
+    /// formatter instantiated for the format and their types writes them on the background thread.
+    struct LogRecord {
+        int64_t timestamp;
+        RecordFormatter formatter;
+        const char* format;
+        LogType logType;
+        alignas(8) uint8 payload[LOG_RECORD_SIZE - 32];
+    };
+
+    static_assert(sizeof(LogRecord) == LOG_RECORD_SIZE, "Log record has to be exactly the record size");
+
+    /// Sets where records are written and what happens on overflow. Records logged before are flushed to the previous output.
+    void Configure(const LoggerOptions& options);
+
+    /// Blocks until every record logged before the call is written
+    void Flush();
+
+    /// Records dropped across every thread since the program started
+    uint64 GetDroppedCount();
 
+    /// Logs text that is already formatted, it is copied into the record and cut short when it does not fit. Only FORMAT literals
+    /// are kept as a pointer, a character array may be a buffer that changes or goes away before the background thread reads it.
+    void Log(LogType logType, std::string_view message);
+
+    /// Queues a record of the format and its arguments for the background thread without formatting anything on the calling thread.
+    /// The format is checked against the arguments at compile time like with util::Format. Arguments are copied in binary form,
+    /// strings byte for byte, and cut short when they do not fit the record.
+    template<typename Literal, typename... Arguments>
+    std::enable_if_t<std::is_base_of_v<util::FormatLiteral, Literal>> Log(LogType logType, Literal format, const Arguments& ... arguments);
+
+    // Everything below is only used by the templates above
+
+    LogRecord* BeginRecord();
+
+    void EndRecord();
+
+    /// Ticks of the time stamp counter, or of the steady clock where there is none. The background thread measures the tick rate
+    /// against the steady clock to write seconds.
+    inline int64_t GetTimestamp() {
+#ifdef LOG_TIMESTAMP_COUNTER
+        return static_cast<int64_t>(__rdtsc());
+#else
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+
+    template<typename Argument>
+    constexpr bool IsString() {
+        return util::GetArgumentKind<Argument>() == util::ArgumentKind::STRING;
+    }
+
+    /// Strings are kept as views into the record, everything else as it was passed
+    template<typename Argument>
+    using StoredArgument = std::conditional_t<IsString<Argument>(), std::string_view, Argument>;
+
+    template<typename Argument>
+    constexpr size_t GetMinimumEncodedSize() {
+        // Strings need at least their length
+        if constexpr (IsString<Argument>()) return sizeof(uint16);
+        else return sizeof(Argument);
+    }
+
+    template<typename Argument>
+    void EncodeArgument(uint8*& cursor, const uint8* end, const Argument& argument) {
+        if constexpr (IsString<Argument>()) {
+            // Room for the length of every string after this one is reserved up front, see Log
+            std::string_view string;
+            if constexpr (std::is_pointer_v<Argument>) string = argument ? std::string_view(argument) : std::string_view("(null)");
+            else string = argument;
+            const auto length = static_cast<uint16>(std::min(string.size(), static_cast<size_t>(end - cursor) - sizeof(uint16)));
+            std::memcpy(cursor, &length, sizeof(uint16));
+            std::memcpy(cursor + sizeof(uint16), string.data(), length);
+            cursor += sizeof(uint16) + length;
+        } else {
+            std::memcpy(cursor, &argument, sizeof(Argument));
+            cursor += sizeof(Argument);
+        }
+    }
+
+    template<typename Stored>
+    Stored DecodeArgument(const uint8*& cursor) {
+        if constexpr (std::is_same_v<Stored, std::string_view>) {
+            uint16 length;
+            std::memcpy(&length, cursor, sizeof(uint16));
+            const std::string_view string(reinterpret_cast<const char*>(cursor + sizeof(uint16)), length);
+            cursor += sizeof(uint16) + length;
+            return string;
+        } else {
+            Stored argument;
+            std::memcpy(&argument, cursor, sizeof(Stored));
+            cursor += sizeof(Stored);
+            return argument;
+        }
+    }
+
+    template<typename Literal, typename... Stored>
+    void FormatRecord(const LogRecord& record, char* output, const size_t outputSize) {
+        const uint8* cursor = record.payload;
+        // Braced initialization decodes the arguments from left to right
+        const std::tuple<Stored...> decoded{DecodeArgument<Stored>(cursor)...};
+        std::apply([&](const auto& ... values) { util::FormatTo(output, outputSize, Literal{}, values...); }, decoded);
+    }
+
+    template<typename Literal, typename... Arguments>
+    std::enable_if_t<std::is_base_of_v<util::FormatLiteral, Literal>> Log(const LogType logType, Literal, const Arguments& ... arguments) {
+        // Checks the format against the arguments where it is used instead of inside the formatter
+        typedef util::CheckedFormat<Literal, std::decay_t<Arguments>...> Checked;
+        static_assert(((std::is_trivially_copyable_v<std::decay_t<Arguments>> || IsString<std::decay_t<Arguments>>()) && ...),
+                      "Arguments have to be copyable byte for byte");
+        constexpr size_t payloadSize = sizeof(LogRecord::payload);
+        static_assert((GetMinimumEncodedSize<std::decay_t<Arguments>>() + ... + 0) <= payloadSize, "Arguments do not fit in a log record");
+        LogRecord* record = BeginRecord();
+        if (!record) return;
+        record->timestamp = GetTimestamp();
+        record->formatter = &FormatRecord<Literal, StoredArgument<std::decay_t<Arguments>>...>;
+        record->format = Checked::LITERAL.data();
+        record->logType = logType;
+        if constexpr (sizeof...(Arguments) > 0) {
+            uint8* cursor = record->payload;
+            size_t reservedSize = (GetMinimumEncodedSize<std::decay_t<Arguments>>() + ... + 0);
+            // Each argument may use the space that is not reserved for the ones after it
+            ((reservedSize -= GetMinimumEncodedSize<std::decay_t<Arguments>>(),
+              EncodeArgument(cursor, record->payload + payloadSize - reservedSize, util::GetFormatValue(arguments))), ...);
+        }
+        EndRecord();
+    }
+}
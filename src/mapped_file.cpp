@@ -0,0 +1,135 @@
+#include "mapped_file.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "logger.hpp"
+#include "string_util.hpp"
+
+namespace voxelfield::file {
+    MappedFile::MappedFile(const std::string& fileName) {
+        Open(fileName);
+    }
+
+    MappedFile::~MappedFile() {
+        Close();
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            Close();
+            m_Data = std::exchange(other.m_Data, nullptr);
+            m_Size = std::exchange(other.m_Size, 0);
+            m_IsOpen = std::exchange(other.m_IsOpen, false);
+#ifdef _WIN32
+            m_FileHandle = std::exchange(other.m_FileHandle, nullptr);
+            m_MappingHandle = std::exchange(other.m_MappingHandle, nullptr);
+#endif
+        }
+        return *this;
+    }
+
+#ifdef _WIN32
+
+    void MappedFile::Open(const std::string& fileName) {
+        Close();
+        // Sharing writes lets the file be appended to while it is mapped
+        HANDLE fileHandle = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (fileHandle == INVALID_HANDLE_VALUE)
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not open file with name {}"), GetLastError(), fileName));
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(fileHandle, &fileSize)) {
+            const DWORD error = GetLastError();
+            CloseHandle(fileHandle);
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not get size of file with name {}"), error, fileName));
+        }
+        m_FileHandle = fileHandle;
+        m_Size = static_cast<size_t>(fileSize.QuadPart);
+        m_IsOpen = true;
+        if (m_Size == 0) return;
+        m_MappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_MappingHandle) m_Data = static_cast<const uint8*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+        if (!m_Data) {
+            const DWORD error = GetLastError();
+            Close();
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not map file with name {}"), error, fileName));
+        }
+    }
+
+    void MappedFile::Close() {
+        if (m_Data) UnmapViewOfFile(m_Data);
+        if (m_MappingHandle) CloseHandle(m_MappingHandle);
+        if (m_FileHandle) CloseHandle(m_FileHandle);
+        m_Data = nullptr;
+        m_MappingHandle = m_FileHandle = nullptr;
+        m_Size = 0;
+        m_IsOpen = false;
+    }
+
+    void MappedFile::EvictFromCache(const std::string& fileName) {
+        // Opening a file unbuffered makes the cache manager flush and drop the pages it holds for it
+        HANDLE fileHandle = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                                        OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, nullptr);
+        if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+    }
+
+#else
+
+    void MappedFile::Open(const std::string& fileName) {
+        Close();
+        const int fileDescriptor = open(fileName.c_str(), O_RDONLY);
+        if (fileDescriptor < 0)
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not open file with name {}"), errno, fileName));
+        struct stat fileStatus{};
+        if (fstat(fileDescriptor, &fileStatus) != 0) {
+            const int error = errno;
+            close(fileDescriptor);
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not get size of file with name {}"), error, fileName));
+        }
+        m_Size = static_cast<size_t>(fileStatus.st_size);
+        if (m_Size > 0) {
+            void* data = mmap(nullptr, m_Size, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+            if (data == MAP_FAILED) {
+                const int error = errno;
+                close(fileDescriptor);
+                m_Size = 0;
+                throw std::runtime_error(util::Format(FORMAT("Error code {}, could not map file with name {}"), error, fileName));
+            }
+            m_Data = static_cast<const uint8*>(data);
+        }
+        // The mapping holds its own reference to the file
+        close(fileDescriptor);
+        m_IsOpen = true;
+    }
+
+    void MappedFile::Close() {
+        if (m_Data) munmap(const_cast<uint8*>(m_Data), m_Size);
+        m_Data = nullptr;
+        m_Size = 0;
+        m_IsOpen = false;
+    }
+
+    void MappedFile::EvictFromCache(const std::string& fileName) {
+        const int fileDescriptor = open(fileName.c_str(), O_RDONLY);
+        if (fileDescriptor < 0) return;
+        posix_fadvise(fileDescriptor, 0, 0, POSIX_FADV_DONTNEED);
+        close(fileDescriptor);
+    }
+
+#endif
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+
+#include "type_definitions.hpp"
+
+namespace voxelfield::file {
+    /// Read only view of a whole file mapped into memory, so reading from it is a pointer access and pages are only loaded from disk
+    /// when first touched. The view does not grow with the file, reopen it to see data written since.
+    class MappedFile {
+    public:
+        MappedFile() = default;
+
+        explicit MappedFile(const std::string& fileName);
+
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        MappedFile(MappedFile&& other) noexcept;
+
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        /// Maps the file as it is now, replacing any earlier view. Throws when the file can not be opened or mapped.
+        void Open(const std::string& fileName);
+
+        void Close();
+
+        /// Null for an empty file, which has nothing to map
+        const uint8* GetData() const {
+            return m_Data;
+        }
+
+        size_t GetSize() const {
+            return m_Size;
+        }
+
+        bool IsOpen() const {
+            return m_IsOpen;
+        }
+
+        /// Asks the operating system to drop the cached pages of the file, so the next read goes to the disk. Only a hint, for
+        /// measuring cold loads.
+        static void EvictFromCache(const std::string& fileName);
+
+    private:
+        const uint8* m_Data = nullptr;
+        size_t m_Size = 0;
+        bool m_IsOpen = false;
+#ifdef _WIN32
+        // Handles kept as pointers so the header does not pull in windows.h
+        void* m_FileHandle = nullptr;
+        void* m_MappingHandle = nullptr;
+#endif
+    };
+}
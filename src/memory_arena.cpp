@@ -0,0 +1,153 @@
+#include "memory_arena.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+
+#include "sub_allocator.hpp"
+
+namespace voxelfield::memory {
+    namespace {
+        thread_local uint32 t_ScratchScopeDepth = 0;
+    }
+
+    LinearArena::LinearArena(const size_t capacity) : m_Capacity(capacity) {
+        if (m_Capacity > 0) m_Block.reset(new uint8[m_Capacity]);
+    }
+
+    LinearArena::~LinearArena() {
+        for (const Overflow& overflow : m_Overflows) ::operator delete(overflow.data, std::align_val_t(overflow.alignment));
+    }
+
+    void* LinearArena::AllocateOverflow(const size_t size, const size_t alignment) {
+        m_Statistics.overflowSize += size;
+        m_Statistics.overflowCount++;
+        void* data = ::operator new(std::max<size_t>(size, 1), std::align_val_t(alignment));
+        m_Overflows.push_back({data, alignment});
+        return data;
+    }
+
+    void LinearArena::Reset() {
+        if (!m_Overflows.empty()) {
+            for (const Overflow& overflow : m_Overflows) ::operator delete(overflow.data, std::align_val_t(overflow.alignment));
+            m_Overflows.clear();
+            // Doubling at least keeps a workload that creeps upwards from regrowing on every reset
+            m_Capacity = std::max({m_Capacity * 2, m_RequiredCapacity, m_PeakRequiredCapacity});
+            m_Block.reset(new uint8[m_Capacity]);
+        }
+        m_Head = 0;
+        m_RequiredCapacity = m_PeakRequiredCapacity = 0;
+        m_Statistics = {};
+    }
+
+    void FrameArenas::Create(const uint32 framesInFlight, const size_t capacity) {
+        m_Arenas.clear();
+        for (uint32 frameIndex = 0; frameIndex < framesInFlight; frameIndex++) m_Arenas.emplace_back(capacity);
+        m_CurrentIndex = 0;
+    }
+
+    LinearArena& FrameArenas::BeginFrame(const uint32 frameIndex) {
+        m_CurrentIndex = frameIndex;
+        m_Arenas[frameIndex].Reset();
+        return m_Arenas[frameIndex];
+    }
+
+    LinearArena& GetScratchArena() {
+        thread_local LinearArena scratchArena(SCRATCH_STACK_SIZE);
+        return scratchArena;
+    }
+
+    ScratchScope::ScratchScope() : m_Arena(GetScratchArena()), m_Marker(m_Arena.GetMarker()), m_IsOutermost(t_ScratchScopeDepth++ == 0) {
+    }
+
+    ScratchScope::~ScratchScope() {
+        t_ScratchScopeDepth--;
+        if (m_IsOutermost)
+            m_Arena.Reset();
+        else
+            m_Arena.ResetToMarker(m_Marker);
+    }
+
+    FixedSizePool::FixedSizePool(const size_t blockSize, const size_t alignment, const size_t blocksPerChunk)
+            : m_Alignment(std::max(alignment, alignof(FreeBlock))), m_BlocksPerChunk(std::max<size_t>(blocksPerChunk, 1)) {
+        // Free blocks hold the link to the next one, and every block of a chunk has to stay aligned
+        m_BlockSize = AlignUp(std::max(blockSize, sizeof(FreeBlock)), m_Alignment);
+    }
+
+    FixedSizePool::~FixedSizePool() {
+        for (void* chunk : m_Chunks) ::operator delete(chunk, std::align_val_t(m_Alignment));
+    }
+
+    void FixedSizePool::AllocateChunk() {
+        auto* chunk = static_cast<uint8*>(::operator new(m_BlockSize * m_BlocksPerChunk, std::align_val_t(m_Alignment)));
+        m_Chunks.push_back(chunk);
+        // Linked back to front, so blocks are handed out in address order
+        for (size_t blockIndex = m_BlocksPerChunk; blockIndex-- > 0;) {
+            auto* block = reinterpret_cast<FreeBlock*>(chunk + blockIndex * m_BlockSize);
+            block->next = m_FreeList;
+            m_FreeList = block;
+        }
+    }
+
+    FixedSizePool* NodePool::GetPool(const size_t size, const size_t alignment) {
+        if (size > NODE_POOL_MAX_SIZE || alignment > NODE_POOL_SIZE_CLASS) return nullptr;
+        std::unique_ptr<FixedSizePool>& pool = m_Pools[(std::max<size_t>(size, 1) - 1) / NODE_POOL_SIZE_CLASS];
+        if (!pool) pool = std::make_unique<FixedSizePool>(AlignUp(size, NODE_POOL_SIZE_CLASS), NODE_POOL_SIZE_CLASS);
+        return pool.get();
+    }
+
+#ifdef HEAP_COUNTING_ENABLED
+
+    namespace {
+        std::atomic<uint64> g_HeapAllocationCount{0};
+    }
+
+    uint64 GetHeapAllocationCount() {
+        return g_HeapAllocationCount.load(std::memory_order_relaxed);
+    }
+
+#endif
+}
+
+#ifdef HEAP_COUNTING_ENABLED
+
+// Array and nothrow forms call these, so replacing them counts every allocation made through new
+void* operator new(const std::size_t size) {
+    voxelfield::memory::g_HeapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* data = std::malloc(size > 0 ? size : 1)) return data;
+    throw std::bad_alloc();
+}
+
+void* operator new(const std::size_t size, const std::align_val_t alignment) {
+    voxelfield::memory::g_HeapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    const auto alignmentSize = static_cast<std::size_t>(alignment);
+#ifdef _WIN32
+    if (void* data = _aligned_malloc(size > 0 ? size : 1, alignmentSize)) return data;
+#else
+    void* data;
+    if (posix_memalign(&data, std::max(alignmentSize, sizeof(void*)), size > 0 ? size : 1) == 0) return data;
+#endif
+    throw std::bad_alloc();
+}
+
+void operator delete(void* data) noexcept {
+    std::free(data);
+}
+
+void operator delete(void* data, std::size_t) noexcept {
+    std::free(data);
+}
+
+void operator delete(void* data, std::align_val_t) noexcept {
+#ifdef _WIN32
+    _aligned_free(data);
+#else
+    std::free(data);
+#endif
+}
+
+void operator delete(void* data, std::size_t, const std::align_val_t alignment) noexcept {
+    operator delete(data, alignment);
+}
+
+#endif
@@ -0,0 +1,335 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "type_definitions.hpp"
+
+// Starting size of the arena of each frame in flight, it grows to fit the largest frame once one overflows it
+#define FRAME_ARENA_SIZE (1u << 20)
+// Starting size of the scratch stack of each thread
+#define SCRATCH_STACK_SIZE (256u << 10)
+// Blocks a pool takes from the heap at once when its free list runs dry
+#define POOL_BLOCKS_PER_CHUNK 256u
+// Node pools have a size class every this many bytes up to the largest one, bigger nodes go to the heap
+#define NODE_POOL_SIZE_CLASS 16u
+#define NODE_POOL_MAX_SIZE 256u
+
+namespace voxelfield::memory {
+    struct ArenaStatistics {
+        // Every allocation since the last reset, including the ones that overflowed
+        uint64 allocatedSize, allocationCount;
+        // Allocations that did not fit in the block and went to the heap
+        uint64 overflowSize, overflowCount;
+    };
+
+    /// Position in an arena to free back to, with the capacity the arena needed up to it so what was freed is not counted twice
+    struct ArenaMarker {
+        size_t head, requiredCapacity;
+    };
+
+    /// Bump allocator over a block it owns. Allocating moves an offset, nothing is freed on its own and Reset frees everything at
+    /// once. Allocations that do not fit go to the heap and the block is regrown on the next reset to hold all of them, so a
+    /// steady workload stops touching the heap after its first reset. Used by one thread at a time.
+    class LinearArena {
+    public:
+        explicit LinearArena(size_t capacity = 0);
+
+        ~LinearArena();
+
+        LinearArena(const LinearArena&) = delete;
+
+        LinearArena& operator=(const LinearArena&) = delete;
+
+        LinearArena(LinearArena&& other) noexcept = default;
+
+        LinearArena& operator=(LinearArena&& other) noexcept = default;
+
+        /// Alignment has to be a power of two
+        void* Allocate(const size_t size, const size_t alignment = alignof(std::max_align_t)) {
+            // Aligned by address, the block itself is only aligned for fundamental types
+            const auto blockAddress = reinterpret_cast<uintptr_t>(m_Block.get());
+            const size_t offset = ((blockAddress + m_Head + alignment - 1) & ~(alignment - 1)) - blockAddress;
+            m_Statistics.allocatedSize += size;
+            m_Statistics.allocationCount++;
+            m_RequiredCapacity += size + alignment - 1;
+            if (m_Block && offset + size <= m_Capacity) {
+                m_Head = offset + size;
+                return m_Block.get() + offset;
+            }
+            return AllocateOverflow(size, alignment);
+        }
+
+        template<typename T>
+        T* Allocate(const size_t count) {
+            return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+        }
+
+        /// Constant time unless something overflowed since the last reset
+        void Reset();
+
+        ArenaMarker GetMarker() const {
+            return {m_Head, m_RequiredCapacity};
+        }
+
+        /// Frees everything allocated in the block since the marker was taken, overflowed allocations stay until the next reset.
+        /// Memory that is reused this way does not grow the block on the next reset.
+        void ResetToMarker(const ArenaMarker& marker) {
+            m_PeakRequiredCapacity = std::max(m_PeakRequiredCapacity, m_RequiredCapacity);
+            m_Head = marker.head;
+            m_RequiredCapacity = marker.requiredCapacity;
+        }
+
+        size_t GetCapacity() const {
+            return m_Capacity;
+        }
+
+        const ArenaStatistics& GetStatistics() const {
+            return m_Statistics;
+        }
+
+    private:
+        struct Overflow {
+            void* data;
+            size_t alignment;
+        };
+
+        std::unique_ptr<uint8[]> m_Block;
+        size_t m_Capacity = 0, m_Head = 0;
+        // Block size that would have held everything live since the last reset, and the most that was ever live at once
+        size_t m_RequiredCapacity = 0, m_PeakRequiredCapacity = 0;
+        std::vector<Overflow> m_Overflows;
+        ArenaStatistics m_Statistics{};
+
+        void* AllocateOverflow(size_t size, size_t alignment);
+    };
+
+    /// One arena per frame in flight. The arena of a frame is only reset once the frame's fence has signalled, so what it allocated
+    /// stays valid for everything that frame hands to the GPU or to jobs.
+    class FrameArenas {
+    public:
+        void Create(uint32 framesInFlight, size_t capacity = FRAME_ARENA_SIZE);
+
+        /// Resets the arena of the frame, called once its fence has signalled
+        LinearArena& BeginFrame(uint32 frameIndex);
+
+        LinearArena& GetCurrent() {
+            return m_Arenas[m_CurrentIndex];
+        }
+
+    private:
+        std::vector<LinearArena> m_Arenas;
+        uint32 m_CurrentIndex = 0;
+    };
+
+    /// Stack of the calling thread for temporaries, created the first time a thread uses it
+    LinearArena& GetScratchArena();
+
+    /// Frees everything allocated from the scratch stack of the thread while it was alive. The outermost scope of a thread resets
+    /// the stack, which regrows it if anything overflowed.
+    class ScratchScope {
+    public:
+        ScratchScope();
+
+        ~ScratchScope();
+
+        ScratchScope(const ScratchScope&) = delete;
+
+        ScratchScope& operator=(const ScratchScope&) = delete;
+
+        LinearArena& GetArena() const {
+            return m_Arena;
+        }
+
+    private:
+        LinearArena& m_Arena;
+        const ArenaMarker m_Marker;
+        bool m_IsOutermost;
+    };
+
+    /// Hands out blocks of one size carved from larger chunks of the heap. Freed blocks go on a free list and are handed out again
+    /// first, chunks are only returned when the pool is destroyed.
+    class FixedSizePool {
+    public:
+        explicit FixedSizePool(size_t blockSize, size_t alignment = alignof(std::max_align_t),
+                               size_t blocksPerChunk = POOL_BLOCKS_PER_CHUNK);
+
+        ~FixedSizePool();
+
+        FixedSizePool(const FixedSizePool&) = delete;
+
+        FixedSizePool& operator=(const FixedSizePool&) = delete;
+
+        void* Allocate() {
+            if (!m_FreeList) AllocateChunk();
+            FreeBlock* block = m_FreeList;
+            m_FreeList = block->next;
+            m_LiveCount++;
+            return block;
+        }
+
+        void Free(void* block) {
+            auto* freeBlock = static_cast<FreeBlock*>(block);
+            freeBlock->next = m_FreeList;
+            m_FreeList = freeBlock;
+            m_LiveCount--;
+        }
+
+        size_t GetBlockSize() const {
+            return m_BlockSize;
+        }
+
+        size_t GetAlignment() const {
+            return m_Alignment;
+        }
+
+        size_t GetLiveCount() const {
+            return m_LiveCount;
+        }
+
+        size_t GetCapacity() const {
+            return m_Chunks.size() * m_BlocksPerChunk;
+        }
+
+    private:
+        struct FreeBlock {
+            FreeBlock* next;
+        };
+
+        size_t m_BlockSize, m_Alignment, m_BlocksPerChunk;
+        std::vector<void*> m_Chunks;
+        FreeBlock* m_FreeList = nullptr;
+        size_t m_LiveCount = 0;
+
+        void AllocateChunk();
+    };
+
+    /// Pool of objects of one type, constructed and destroyed in place
+    template<typename T>
+    class ObjectPool {
+    public:
+        explicit ObjectPool(const size_t blocksPerChunk = POOL_BLOCKS_PER_CHUNK) : m_Pool(sizeof(T), alignof(T), blocksPerChunk) {}
+
+        template<typename... Arguments>
+        T* Create(Arguments&& ... arguments) {
+            return new(m_Pool.Allocate()) T(std::forward<Arguments>(arguments)...);
+        }
+
+        void Destroy(T* object) {
+            object->~T();
+            m_Pool.Free(object);
+        }
+
+        size_t GetLiveCount() const {
+            return m_Pool.GetLiveCount();
+        }
+
+    private:
+        FixedSizePool m_Pool;
+    };
+
+    /// Pools for every size class, created as nodes of that size are first asked for
+    class NodePool {
+    public:
+        /// Null for nodes larger than the largest size class
+        FixedSizePool* GetPool(size_t size, size_t alignment);
+
+    private:
+        std::array<std::unique_ptr<FixedSizePool>, NODE_POOL_MAX_SIZE / NODE_POOL_SIZE_CLASS> m_Pools;
+    };
+
+    /// Allocator for standard containers that takes memory from an arena. Deallocation does nothing, the memory comes back when the
+    /// arena is reset, so containers should reserve what they need instead of growing repeatedly.
+    template<typename T>
+    class ArenaAllocator {
+    public:
+        typedef T value_type;
+
+        explicit ArenaAllocator(LinearArena& arena) noexcept : m_Arena(&arena) {}
+
+        template<typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) noexcept : m_Arena(other.GetArena()) {}
+
+        T* allocate(const size_t count) {
+            return m_Arena->Allocate<T>(count);
+        }
+
+        void deallocate(T*, size_t) noexcept {
+        }
+
+        LinearArena* GetArena() const noexcept {
+            return m_Arena;
+        }
+
+        template<typename U>
+        bool operator==(const ArenaAllocator<U>& other) const noexcept {
+            return m_Arena == other.GetArena();
+        }
+
+        template<typename U>
+        bool operator!=(const ArenaAllocator<U>& other) const noexcept {
+            return m_Arena != other.GetArena();
+        }
+
+    private:
+        LinearArena* m_Arena;
+    };
+
+    template<typename T>
+    using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+    /// Allocator for node based containers such as maps and lists. Single nodes come from the pool of their size, arrays such as
+    /// the buckets of an unordered map go to the heap, which only happens when the container grows.
+    template<typename T>
+    class PoolAllocator {
+    public:
+        typedef T value_type;
+
+        explicit PoolAllocator(NodePool& nodePool) noexcept : m_NodePool(&nodePool) {}
+
+        template<typename U>
+        PoolAllocator(const PoolAllocator<U>& other) noexcept : m_NodePool(other.GetNodePool()) {}
+
+        T* allocate(const size_t count) {
+            if (count == 1)
+                if (FixedSizePool* pool = m_NodePool->GetPool(sizeof(T), alignof(T))) return static_cast<T*>(pool->Allocate());
+            return std::allocator<T>().allocate(count);
+        }
+
+        void deallocate(T* data, const size_t count) noexcept {
+            if (count == 1)
+                if (FixedSizePool* pool = m_NodePool->GetPool(sizeof(T), alignof(T))) return pool->Free(data);
+            std::allocator<T>().deallocate(data, count);
+        }
+
+        NodePool* GetNodePool() const noexcept {
+            return m_NodePool;
+        }
+
+        template<typename U>
+        bool operator==(const PoolAllocator<U>& other) const noexcept {
+            return m_NodePool == other.GetNodePool();
+        }
+
+        template<typename U>
+        bool operator!=(const PoolAllocator<U>& other) const noexcept {
+            return m_NodePool != other.GetNodePool();
+        }
+
+    private:
+        NodePool* m_NodePool;
+    };
+
+#ifdef HEAP_COUNTING_ENABLED
+
+    /// Allocations made through the global operator new since the program started, which is replaced to count them
+    uint64 GetHeapAllocationCount();
+
+#endif
+}
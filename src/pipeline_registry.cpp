@@ -0,0 +1,381 @@
+#include "pipeline_registry.hpp"
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "logger.hpp"
+#include "string_util.hpp"
+#include "tracer.hpp"
+
+namespace voxelfield::rendering {
+    namespace {
+        constexpr uint64 FNV_OFFSET_BASIS = 14695981039346656037ull, FNV_PRIME = 1099511628211ull;
+        // Mixed into compute hashes so they can share the pipeline map with graphics pipelines
+        constexpr uint32 COMPUTE_PIPELINE_HASH_TAG = 0x504D4F43u; // "COMP"
+
+        uint64 HashBytes(const void* data, const size_t size, uint64 hash = FNV_OFFSET_BASIS) {
+            const auto* bytes = static_cast<const uint8*>(data);
+            for (size_t byteIndex = 0; byteIndex < size; byteIndex++) {
+                hash ^= bytes[byteIndex];
+                hash *= FNV_PRIME;
+            }
+            return hash;
+        }
+
+        // Fields are fed one by one so struct padding never ends up in the hash
+        template<typename T>
+        void HashValue(uint64& hash, const T value) {
+            hash = HashBytes(&value, sizeof(value), hash);
+        }
+    }
+
+    uint64 HashPipelineDescription(const GraphicsPipelineDescription& description) {
+        uint64 hash = FNV_OFFSET_BASIS;
+        HashValue(hash, description.vertexShader.hash);
+        HashValue(hash, description.fragmentShader.hash);
+        HashValue(hash, description.vertexBindings.size());
+        for (const VkVertexInputBindingDescription& binding : description.vertexBindings) {
+            HashValue(hash, binding.binding);
+            HashValue(hash, binding.stride);
+            HashValue(hash, binding.inputRate);
+        }
+        HashValue(hash, description.vertexAttributes.size());
+        for (const VkVertexInputAttributeDescription& attribute : description.vertexAttributes) {
+            HashValue(hash, attribute.location);
+            HashValue(hash, attribute.binding);
+            HashValue(hash, attribute.format);
+            HashValue(hash, attribute.offset);
+        }
+        HashValue(hash, description.topology);
+        HashValue(hash, description.polygonMode);
+        HashValue(hash, description.cullMode);
+        HashValue(hash, description.frontFace);
+        HashValue(hash, description.isDepthTestEnabled);
+        HashValue(hash, description.isDepthWriteEnabled);
+        HashValue(hash, description.depthCompareOperation);
+        const VkPipelineColorBlendAttachmentState& blend = description.colorBlendAttachment;
+        HashValue(hash, blend.blendEnable);
+        HashValue(hash, blend.srcColorBlendFactor);
+        HashValue(hash, blend.dstColorBlendFactor);
+        HashValue(hash, blend.colorBlendOp);
+        HashValue(hash, blend.srcAlphaBlendFactor);
+        HashValue(hash, blend.dstAlphaBlendFactor);
+        HashValue(hash, blend.alphaBlendOp);
+        HashValue(hash, blend.colorWriteMask);
+        HashValue(hash, description.layoutHandle);
+        HashValue(hash, description.subpass);
+        HashValue(hash, description.colorAttachmentFormats.size());
+        for (const VkFormat format : description.colorAttachmentFormats)
+            HashValue(hash, format);
+        HashValue(hash, description.depthAttachmentFormat);
+        HashValue(hash, description.sampleCount);
+        return hash;
+    }
+
+    uint64 HashPipelineDescription(const ComputePipelineDescription& description) {
+        uint64 hash = FNV_OFFSET_BASIS;
+        HashValue(hash, COMPUTE_PIPELINE_HASH_TAG);
+        HashValue(hash, description.computeShader.hash);
+        HashValue(hash, description.layoutHandle);
+        return hash;
+    }
+
+    void PipelineRegistry::Create(const VkDevice logicalDeviceHandle, const VkPhysicalDeviceProperties& deviceProperties,
+                                  const file::VirtualFileSystem& fileSystem, const std::string& cacheFileName) {
+        TRACE_ZONE("PipelineRegistry::Create");
+        m_LogicalDeviceHandle = logicalDeviceHandle;
+        m_DeviceProperties = deviceProperties;
+        m_FileSystem = &fileSystem;
+        m_CacheFileName = cacheFileName;
+        const std::vector<char> initialData = LoadValidatedCacheData();
+        VkPipelineCacheCreateInfo cacheCreationInformation{
+                VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+                nullptr,
+                0,
+                initialData.size(), initialData.empty() ? nullptr : initialData.data()
+        };
+        if (const VkResult result = vkCreatePipelineCache(m_LogicalDeviceHandle, &cacheCreationInformation, nullptr, &m_CacheHandle);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create Vulkan pipeline cache"), result));
+        }
+        logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Successfully created pipeline cache with {} bytes of initial data"),
+                     initialData.size());
+    }
+
+    std::vector<char> PipelineRegistry::LoadValidatedCacheData() const {
+        std::ifstream file(m_CacheFileName, std::ios::binary);
+        if (!file.is_open()) return {};
+        CacheFileHeader fileHeader{};
+        file.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader));
+        if (!file || fileHeader.magic != PIPELINE_CACHE_FILE_MAGIC) {
+            logging::Log(logging::LogType::WARNING_LOG, "Ignoring pipeline cache file with unknown format");
+            return {};
+        }
+        if (fileHeader.driverVersion != m_DeviceProperties.driverVersion) {
+            logging::Log(logging::LogType::INFORMATION_LOG, "Ignoring pipeline cache from a different driver version");
+            return {};
+        }
+        // The size comes from the file itself, so it is checked against what is left before anything is allocated for it
+        const std::streampos dataStart = file.tellg();
+        file.seekg(0, std::ios::end);
+        const std::streamoff remainingSize = file.tellg() - dataStart;
+        file.seekg(dataStart);
+        if (!file || remainingSize < 0 || fileHeader.dataSize > static_cast<uint64>(remainingSize)) {
+            logging::Log(logging::LogType::WARNING_LOG, "Ignoring truncated or corrupted pipeline cache file");
+            return {};
+        }
+        std::vector<char> data(fileHeader.dataSize);
+        file.read(data.data(), data.size());
+        if (!file || HashBytes(data.data(), data.size()) != fileHeader.dataHash) {
+            logging::Log(logging::LogType::WARNING_LOG, "Ignoring truncated or corrupted pipeline cache file");
+            return {};
+        }
+        // Layout of VkPipelineCacheHeaderVersionOne
+        std::array<uint32, 4> vulkanHeader{};
+        std::array<uint8, VK_UUID_SIZE> cacheUuid{};
+        if (data.size() < sizeof(vulkanHeader) + cacheUuid.size()) return {};
+        std::memcpy(vulkanHeader.data(), data.data(), sizeof(vulkanHeader));
+        std::memcpy(cacheUuid.data(), data.data() + sizeof(vulkanHeader), cacheUuid.size());
+        const auto[headerSize, headerVersion, vendorId, deviceId] = vulkanHeader;
+        if (headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || headerSize < sizeof(vulkanHeader) + cacheUuid.size() ||
+            vendorId != m_DeviceProperties.vendorID || deviceId != m_DeviceProperties.deviceID ||
+            std::memcmp(cacheUuid.data(), m_DeviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+            logging::Log(logging::LogType::INFORMATION_LOG, "Ignoring pipeline cache from a different device");
+            return {};
+        }
+        return data;
+    }
+
+    void PipelineRegistry::SaveCache() const {
+        size_t dataSize;
+        if (vkGetPipelineCacheData(m_LogicalDeviceHandle, m_CacheHandle, &dataSize, nullptr) != VK_SUCCESS) return;
+        std::vector<char> data(dataSize);
+        if (vkGetPipelineCacheData(m_LogicalDeviceHandle, m_CacheHandle, &dataSize, data.data()) != VK_SUCCESS) return;
+        data.resize(dataSize);
+        const CacheFileHeader fileHeader{PIPELINE_CACHE_FILE_MAGIC, m_DeviceProperties.driverVersion, data.size(), HashBytes(data.data(), data.size())};
+        // Written next to the old cache and swapped in, a crash halfway through never leaves a broken file behind
+        const std::string temporaryFileName = m_CacheFileName + ".tmp";
+        {
+            std::ofstream file(temporaryFileName, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                logging::Log(logging::LogType::WARNING_LOG, FORMAT("Could not open {} to save the pipeline cache"), temporaryFileName);
+                return;
+            }
+            file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+            file.write(data.data(), data.size());
+        }
+        std::remove(m_CacheFileName.c_str());
+        if (std::rename(temporaryFileName.c_str(), m_CacheFileName.c_str()) != 0) {
+            logging::Log(logging::LogType::WARNING_LOG, "Could not replace the pipeline cache file");
+            return;
+        }
+        logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Saved {} bytes of pipeline cache, {} registry hits and {} misses"),
+                     data.size(), m_HitCount, m_MissCount);
+    }
+
+    void PipelineRegistry::Release() {
+        if (m_LogicalDeviceHandle == VK_NULL_HANDLE) return;
+        SaveCache();
+        for (const auto&[hash, pipelineHandle] : m_Pipelines)
+            vkDestroyPipeline(m_LogicalDeviceHandle, pipelineHandle, nullptr);
+        for (const auto&[fileName, shaderModule] : m_ShaderModules)
+            vkDestroyShaderModule(m_LogicalDeviceHandle, shaderModule.handle, nullptr);
+        vkDestroyPipelineCache(m_LogicalDeviceHandle, m_CacheHandle, nullptr);
+        m_Pipelines.clear();
+        m_ShaderModules.clear();
+        m_LogicalDeviceHandle = VK_NULL_HANDLE;
+    }
+
+    ShaderModule PipelineRegistry::GetShaderModule(const std::string& fileName) {
+        if (auto it = m_ShaderModules.find(fileName); it != m_ShaderModules.end())
+            return it->second;
+        // Archive entries and mappings are aligned well past the four bytes SPIR-V needs, so the code is handed over in place
+        const file::FileData shaderSource = m_FileSystem->Read(fileName);
+        VkShaderModuleCreateInfo creationInformation{
+                VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+                nullptr,
+                0,
+                shaderSource.GetSize(),
+                reinterpret_cast<const uint32*>(shaderSource.GetData())
+        };
+        ShaderModule shaderModule{VK_NULL_HANDLE, HashBytes(shaderSource.GetData(), shaderSource.GetSize())};
+        if (const VkResult result = vkCreateShaderModule(m_LogicalDeviceHandle, &creationInformation, nullptr, &shaderModule.handle);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create Vulkan shader module {}"), result, fileName));
+        }
+        m_ShaderModules.emplace(fileName, shaderModule);
+        return shaderModule;
+    }
+
+    VkPipeline PipelineRegistry::GetGraphicsPipeline(const GraphicsPipelineDescription& description) {
+        // A 64 bit state hash is treated as unique, a collision between two live descriptions is not a realistic concern
+        const uint64 hash = HashPipelineDescription(description);
+        if (auto it = m_Pipelines.find(hash); it != m_Pipelines.end()) {
+            m_HitCount++;
+            return it->second;
+        }
+        m_MissCount++;
+        const std::array<VkPipelineShaderStageCreateInfo, 2> shaderStates{
+                VkPipelineShaderStageCreateInfo{
+                        VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                        nullptr,
+                        0,
+                        VK_SHADER_STAGE_VERTEX_BIT,
+                        description.vertexShader.handle,
+                        "main",
+                        nullptr
+                },
+                VkPipelineShaderStageCreateInfo{
+                        VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                        nullptr,
+                        0,
+                        VK_SHADER_STAGE_FRAGMENT_BIT,
+                        description.fragmentShader.handle,
+                        "main",
+                        nullptr
+                }
+        };
+        VkPipelineVertexInputStateCreateInfo vertexInputStateCreationInformation{
+                VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+                nullptr,
+                0,
+                static_cast<uint32>(description.vertexBindings.size()), description.vertexBindings.data(),
+                static_cast<uint32>(description.vertexAttributes.size()), description.vertexAttributes.data()
+        };
+        VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreationInformation{
+                VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+                nullptr,
+                0,
+                description.topology,
+                VK_FALSE
+        };
+        // Viewport and scissor are set while recording so pipelines survive swapchain resizes
+        VkPipelineViewportStateCreateInfo viewportStateCreationInformation{
+                VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+                nullptr,
+                0,
+                1, nullptr,
+                1, nullptr
+        };
+        VkPipelineRasterizationStateCreateInfo rasterizationStateCreationInformation{
+                VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+                nullptr,
+                0,
+                VK_FALSE,
+                VK_FALSE,
+                description.polygonMode,
+                description.cullMode,
+                description.frontFace,
+                VK_FALSE,
+                0.0f, 0.0f, 0.0f,
+                1.0f
+        };
+        VkPipelineMultisampleStateCreateInfo multisampleStateCreationInformation{
+                VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+                nullptr,
+                0,
+                description.sampleCount,
+                VK_FALSE,
+                1.0f,
+                nullptr,
+                VK_FALSE,
+                VK_FALSE
+        };
+        VkPipelineDepthStencilStateCreateInfo depthStencilStateCreationInformation{
+                VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+                nullptr,
+                0,
+                static_cast<VkBool32>(description.isDepthTestEnabled),
+                static_cast<VkBool32>(description.isDepthWriteEnabled),
+                description.depthCompareOperation,
+                VK_FALSE,
+                VK_FALSE,
+                {},
+                {},
+                0.0f, 1.0f
+        };
+        const std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments(description.colorAttachmentFormats.size(),
+                                                                                     description.colorBlendAttachment);
+        VkPipelineColorBlendStateCreateInfo colorBlendStateCreationInformation{
+                VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+                nullptr,
+                0,
+                VK_FALSE,
+                VK_LOGIC_OP_COPY,
+                static_cast<uint32>(colorBlendAttachments.size()),
+                colorBlendAttachments.data(),
+                {0.0f, 0.0f, 0.0f, 0.0f}
+        };
+        const std::array<VkDynamicState, 2> dynamicStates{VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+        VkPipelineDynamicStateCreateInfo dynamicStateCreationInformation{
+                VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+                nullptr,
+                0,
+                static_cast<uint32>(dynamicStates.size()), dynamicStates.data()
+        };
+        VkGraphicsPipelineCreateInfo pipelineCreationInformation{
+                VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+                nullptr,
+                0,
+                description.fragmentShader.handle == VK_NULL_HANDLE ? 1u : 2u,
+                shaderStates.data(),
+                &vertexInputStateCreationInformation,
+                &inputAssemblyCreationInformation,
+                nullptr,
+                &viewportStateCreationInformation,
+                &rasterizationStateCreationInformation,
+                &multisampleStateCreationInformation,
+                description.depthAttachmentFormat == VK_FORMAT_UNDEFINED ? nullptr : &depthStencilStateCreationInformation,
+                &colorBlendStateCreationInformation,
+                &dynamicStateCreationInformation,
+                description.layoutHandle,
+                description.renderPassHandle,
+                description.subpass,
+                VK_NULL_HANDLE,
+                -1
+        };
+        VkPipeline pipelineHandle;
+        if (const VkResult result = vkCreateGraphicsPipelines(m_LogicalDeviceHandle, m_CacheHandle, 1, &pipelineCreationInformation, nullptr,
+                                                              &pipelineHandle); result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create Vulkan pipeline"), result));
+        }
+        m_Pipelines.emplace(hash, pipelineHandle);
+        return pipelineHandle;
+    }
+
+    VkPipeline PipelineRegistry::GetComputePipeline(const ComputePipelineDescription& description) {
+        const uint64 hash = HashPipelineDescription(description);
+        if (auto it = m_Pipelines.find(hash); it != m_Pipelines.end()) {
+            m_HitCount++;
+            return it->second;
+        }
+        m_MissCount++;
+        VkComputePipelineCreateInfo pipelineCreationInformation{
+                VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+                nullptr,
+                0,
+                {
+                        VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                        nullptr,
+                        0,
+                        VK_SHADER_STAGE_COMPUTE_BIT,
+                        description.computeShader.handle,
+                        "main",
+                        nullptr
+                },
+                description.layoutHandle,
+                VK_NULL_HANDLE,
+                -1
+        };
+        VkPipeline pipelineHandle;
+        if (const VkResult result = vkCreateComputePipelines(m_LogicalDeviceHandle, m_CacheHandle, 1, &pipelineCreationInformation, nullptr,
+                                                             &pipelineHandle); result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create Vulkan compute pipeline"), result));
+        }
+        m_Pipelines.emplace(hash, pipelineHandle);
+        return pipelineHandle;
+    }
+}
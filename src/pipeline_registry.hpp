@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "type_definitions.hpp"
+#include "virtual_file_system.hpp"
+
+#define PIPELINE_CACHE_FILE_NAME "pipeline_cache.bin"
+#define PIPELINE_CACHE_FILE_MAGIC 0x43504656u // "VFPC"
+
+namespace voxelfield::rendering {
+    struct ShaderModule {
+        VkShaderModule handle = VK_NULL_HANDLE;
+        // Hash of the SPIR-V, stays the same across launches unlike the handle
+        uint64 hash = 0;
+    };
+
+    /// Everything that goes into a graphics pipeline. Pipelines work with any render pass compatible with the one they were created
+    /// against, so the attachment formats are hashed instead of the render pass handle.
+    struct GraphicsPipelineDescription {
+        ShaderModule vertexShader, fragmentShader;
+        std::vector<VkVertexInputBindingDescription> vertexBindings;
+        std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+        VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+        VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+        VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+        bool isDepthTestEnabled = false, isDepthWriteEnabled = false;
+        VkCompareOp depthCompareOperation = VK_COMPARE_OP_LESS_OR_EQUAL;
+        VkPipelineColorBlendAttachmentState colorBlendAttachment{
+                VK_FALSE,
+                VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO,
+                VK_BLEND_OP_ADD,
+                VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO,
+                VK_BLEND_OP_ADD,
+                VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+        };
+        VkPipelineLayout layoutHandle = VK_NULL_HANDLE;
+        VkRenderPass renderPassHandle = VK_NULL_HANDLE;
+        uint32 subpass = 0;
+        std::vector<VkFormat> colorAttachmentFormats;
+        VkFormat depthAttachmentFormat = VK_FORMAT_UNDEFINED;
+        VkSampleCountFlagBits sampleCount = VK_SAMPLE_COUNT_1_BIT;
+    };
+
+    struct ComputePipelineDescription {
+        ShaderModule computeShader;
+        VkPipelineLayout layoutHandle = VK_NULL_HANDLE;
+    };
+
+    uint64 HashPipelineDescription(const GraphicsPipelineDescription& description);
+
+    uint64 HashPipelineDescription(const ComputePipelineDescription& description);
+
+    /// Owns every pipeline and shader module and hands out existing pipelines for state it has seen before. Misses compile through a
+    /// VkPipelineCache that is written to disk on release and reloaded on the next launch if it was produced by the same device and driver.
+    class PipelineRegistry {
+    public:
+        void Create(VkDevice logicalDeviceHandle, const VkPhysicalDeviceProperties& deviceProperties, const file::VirtualFileSystem& fileSystem,
+                    const std::string& cacheFileName = PIPELINE_CACHE_FILE_NAME);
+
+        void Release();
+
+        /// Loads and caches a SPIR-V shader module by its path in the file system
+        ShaderModule GetShaderModule(const std::string& fileName);
+
+        VkPipeline GetGraphicsPipeline(const GraphicsPipelineDescription& description);
+
+        VkPipeline GetComputePipeline(const ComputePipelineDescription& description);
+
+        void SaveCache() const;
+
+        VkPipelineCache GetCacheHandle() const {
+            return m_CacheHandle;
+        }
+
+    private:
+        // Prepended to the driver's cache data, the driver version is not part of the Vulkan cache header
+        struct CacheFileHeader {
+            uint32 magic, driverVersion;
+            uint64 dataSize, dataHash;
+        };
+
+        VkDevice m_LogicalDeviceHandle = VK_NULL_HANDLE;
+        VkPhysicalDeviceProperties m_DeviceProperties{};
+        const file::VirtualFileSystem* m_FileSystem = nullptr;
+        std::string m_CacheFileName;
+        VkPipelineCache m_CacheHandle = VK_NULL_HANDLE;
+        std::unordered_map<std::string, ShaderModule> m_ShaderModules;
+        std::unordered_map<uint64, VkPipeline> m_Pipelines;
+        uint32 m_HitCount = 0, m_MissCount = 0;
+
+        std::vector<char> LoadValidatedCacheData() const;
+    };
+}
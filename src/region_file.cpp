@@ -0,0 +1,180 @@
+#include "region_file.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "compression.hpp"
+#include "logger.hpp"
+#include "string_util.hpp"
+
+namespace voxelfield::world {
+    namespace {
+        bool Seek(File* file, const uint64 offset) {
+#ifdef _WIN32
+            return _fseeki64(file, static_cast<long long>(offset), SEEK_SET) == 0;
+#else
+            return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+        }
+
+        File* OpenForWriting(const std::string& fileName) {
+            File* file = std::fopen(fileName.c_str(), "r+b");
+            if (!file) throw std::runtime_error(util::Format(FORMAT("Could not open region file with name {}"), fileName));
+            return file;
+        }
+
+        void WriteHeader(File* file, const RegionHeader& header, const std::string& fileName) {
+            if (!Seek(file, 0) || std::fwrite(&header, sizeof(RegionHeader), 1, file) != 1)
+                throw std::runtime_error(util::Format(FORMAT("Could not write header of region file with name {}"), fileName));
+        }
+    }
+
+    RegionFile::RegionFile(std::string fileName) : m_FileName(std::move(fileName)) {
+        if (!std::filesystem::exists(m_FileName)) {
+            File* file = std::fopen(m_FileName.c_str(), "wb");
+            if (!file) throw std::runtime_error(util::Format(FORMAT("Could not create region file with name {}"), m_FileName));
+            RegionHeader header{REGION_MAGIC, REGION_VERSION, {}};
+            WriteHeader(file, header, m_FileName);
+            std::fclose(file);
+        }
+        m_View.Open(m_FileName);
+        m_FileSize = m_View.GetSize();
+        if (m_FileSize < sizeof(RegionHeader))
+            throw std::runtime_error(util::Format(FORMAT("File with name {} is too small to be a region file"), m_FileName));
+        std::memcpy(&m_Header, m_View.GetData(), sizeof(RegionHeader));
+        if (m_Header.magic != REGION_MAGIC || m_Header.version != REGION_VERSION)
+            throw std::runtime_error(util::Format(FORMAT("File with name {} is not a version {} region file"), m_FileName, REGION_VERSION));
+        for (const RegionEntry& entry : m_Header.entries) {
+            if (entry.size == 0) continue;
+            if (entry.offset < sizeof(RegionHeader) || static_cast<uint64>(entry.offset) + entry.compressedSize > m_FileSize)
+                throw std::runtime_error(util::Format(FORMAT("Region file with name {} has an entry outside of the file"), m_FileName));
+            m_LiveSize += entry.compressedSize;
+        }
+        m_File = OpenForWriting(m_FileName);
+    }
+
+    RegionFile::~RegionFile() {
+        if (m_File) std::fclose(m_File);
+    }
+
+    const uint8* RegionFile::GetPayload(const uint32 chunkIndex, RegionEntry& entry) {
+        entry = m_Header.entries[chunkIndex];
+        if (entry.size == 0) return nullptr;
+        // The view is only as long as the file was when it was mapped
+        if (static_cast<uint64>(entry.offset) + entry.compressedSize > m_View.GetSize()) m_View.Open(m_FileName);
+        return m_View.GetData() + entry.offset;
+    }
+
+    void RegionFile::WritePayload(const uint32 chunkIndex, const uint8* payload, const uint32 compressedSize, const uint32 size) {
+        if (m_FileSize + compressedSize > std::numeric_limits<uint32>::max())
+            throw std::runtime_error(util::Format(FORMAT("Region file with name {} is full"), m_FileName));
+        RegionEntry& entry = m_Header.entries[chunkIndex];
+        const RegionEntry previousEntry = entry;
+        // Payload first, so the entry never points at data that is not on disk yet
+        Write(m_FileSize, payload, compressedSize);
+        entry = {static_cast<uint32>(m_FileSize), compressedSize, size};
+        Write(offsetof(RegionHeader, entries) + chunkIndex * sizeof(RegionEntry), &entry, sizeof(RegionEntry));
+        std::fflush(m_File);
+        m_FileSize += compressedSize;
+        m_LiveSize += compressedSize;
+        if (previousEntry.size > 0) m_LiveSize -= previousEntry.compressedSize;
+        const uint64 deadSize = m_FileSize - sizeof(RegionHeader) - m_LiveSize;
+        if (deadSize > REGION_COMPACTION_MIN_DEAD_BYTES && deadSize > m_LiveSize) Compact();
+    }
+
+    void RegionFile::Compact() {
+        if (m_View.GetSize() < m_FileSize) m_View.Open(m_FileName);
+        const std::string compactedFileName = m_FileName + ".compacting";
+        File* compactedFile = std::fopen(compactedFileName.c_str(), "wb");
+        if (!compactedFile)
+            throw std::runtime_error(util::Format(FORMAT("Could not create region file with name {}"), compactedFileName));
+        RegionHeader header = m_Header;
+        uint64 offset = sizeof(RegionHeader);
+        bool isWritten = Seek(compactedFile, offset);
+        for (RegionEntry& entry : header.entries) {
+            if (entry.size == 0) continue;
+            isWritten = isWritten && std::fwrite(m_View.GetData() + entry.offset, 1, entry.compressedSize, compactedFile) == entry.compressedSize;
+            entry.offset = static_cast<uint32>(offset);
+            offset += entry.compressedSize;
+        }
+        isWritten = isWritten && Seek(compactedFile, 0) && std::fwrite(&header, sizeof(RegionHeader), 1, compactedFile) == 1;
+        isWritten = std::fclose(compactedFile) == 0 && isWritten;
+        if (!isWritten)
+            throw std::runtime_error(util::Format(FORMAT("Could not write region file with name {}"), compactedFileName));
+        // Nothing may hold the old file open while it is replaced
+        m_View.Close();
+        std::fclose(m_File);
+        m_File = nullptr;
+        std::error_code error;
+        std::filesystem::rename(compactedFileName, m_FileName, error);
+        if (error)
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not replace region file with name {}"), error.value(),
+                                                  m_FileName));
+        m_Header = header;
+        m_FileSize = offset;
+        m_File = OpenForWriting(m_FileName);
+        m_View.Open(m_FileName);
+    }
+
+    void RegionFile::Write(const uint64 offset, const void* data, const size_t size) {
+        if (!Seek(m_File, offset) || std::fwrite(data, 1, size, m_File) != size)
+            throw std::runtime_error(util::Format(FORMAT("Could not write region file with name {}"), m_FileName));
+    }
+
+    RegionStorage::RegionStorage(std::string directory) : m_Directory(std::move(directory)) {
+        std::filesystem::create_directories(m_Directory);
+    }
+
+    bool RegionStorage::LoadChunk(World& world, const ChunkPosition& position) {
+        RegionFile* region = GetRegion(RegionFile::GetRegionPosition(position), false);
+        if (!region) return false;
+        RegionEntry entry;
+        const uint8* payload = region->GetPayload(RegionFile::GetChunkIndex(position), entry);
+        if (!payload) return false;
+        m_Buffer.resize(entry.size);
+        m_LastCompressedSize = entry.compressedSize;
+        if (!compression::Decompress(payload, entry.compressedSize, m_Buffer.data(), entry.size)
+            || !world.GetOrCreateChunk(position).Deserialize(m_Buffer.data(), entry.size))
+            throw std::runtime_error(util::Format(FORMAT("Chunk at {}, {}, {} in region file with name {} is corrupt"), position.x,
+                                                  position.y, position.z, region->GetFileName()));
+        return true;
+    }
+
+    void RegionStorage::SaveChunk(const Chunk& chunk, const ChunkPosition& position) {
+        m_Buffer.clear();
+        chunk.Serialize(m_Buffer);
+        m_CompressedBuffer.resize(compression::GetMaxCompressedSize(m_Buffer.size()));
+        m_LastCompressedSize = compression::Compress(m_Buffer.data(), m_Buffer.size(), m_CompressedBuffer.data());
+        GetRegion(RegionFile::GetRegionPosition(position), true)->WritePayload(
+                RegionFile::GetChunkIndex(position), m_CompressedBuffer.data(), static_cast<uint32>(m_LastCompressedSize),
+                static_cast<uint32>(m_Buffer.size()));
+    }
+
+    std::string RegionStorage::GetRegionFileName(const ChunkPosition& regionPosition) const {
+        return (std::filesystem::path(m_Directory)
+                / util::Format(FORMAT("region.{}.{}.{}.vfr"), regionPosition.x, regionPosition.y, regionPosition.z).GetView()).string();
+    }
+
+    RegionFile* RegionStorage::GetRegion(const ChunkPosition& regionPosition, const bool isCreating) {
+        if (const auto it = m_Regions.find(regionPosition); it != m_Regions.end()) {
+            it->second.lastUse = ++m_UseCount;
+            return it->second.file.get();
+        }
+        const std::string fileName = GetRegionFileName(regionPosition);
+        if (!isCreating && !std::filesystem::exists(fileName)) return nullptr;
+        if (m_Regions.size() >= MAX_OPEN_REGIONS) {
+            const auto leastRecent = std::min_element(m_Regions.begin(), m_Regions.end(), [](const auto& left, const auto& right) {
+                return left.second.lastUse < right.second.lastUse;
+            });
+            m_Regions.erase(leastRecent);
+        }
+        auto file = std::make_unique<RegionFile>(fileName);
+        return m_Regions.emplace(regionPosition, OpenRegion{std::move(file), ++m_UseCount}).first->second.file.get();
+    }
+}
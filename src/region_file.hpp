@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mapped_file.hpp"
+#include "world.hpp"
+
+#define REGION_SIZE_BITS 3u
+// Chunks along each side of a region
+#define REGION_SIZE (1u << REGION_SIZE_BITS)
+#define REGION_VOLUME (REGION_SIZE * REGION_SIZE * REGION_SIZE)
+// Spells VFR1 in the first bytes of the file
+#define REGION_MAGIC 0x31524656u
+#define REGION_VERSION 1u
+// Dead payload bytes a region file holds before it is compacted, it is also compacted once they outweigh the live ones
+#define REGION_COMPACTION_MIN_DEAD_BYTES (1ull << 20)
+// Region files kept open by a storage before the least recently used one is closed
+#define MAX_OPEN_REGIONS 64
+
+namespace voxelfield::world {
+    /// Where the compressed payload of a chunk lies in its region file, all zero for chunks that were never saved
+    struct RegionEntry {
+        uint32 offset;
+        uint32 compressedSize;
+        uint32 size;
+    };
+
+    struct RegionHeader {
+        uint32 magic;
+        uint32 version;
+        std::array<RegionEntry, REGION_VOLUME> entries;
+    };
+
+    /// Chunks of a cube of REGION_SIZE chunks on a side in one file, a header table of payload offsets followed by the payloads.
+    /// Payloads are only ever appended and the entry then rewritten to point at them, so a crash mid write leaves the previous
+    /// payload in place. Reads go through a memory mapping of the file. Space of replaced payloads is reclaimed by compacting into a
+    /// new file that is renamed over the old one.
+    class RegionFile {
+    public:
+        /// Opens the region file, creating an empty one when there is none. Throws when the file is not a region file or its table
+        /// points outside of it.
+        explicit RegionFile(std::string fileName);
+
+        ~RegionFile();
+
+        RegionFile(const RegionFile&) = delete;
+
+        RegionFile& operator=(const RegionFile&) = delete;
+
+        /// Returns the mapped payload of the chunk, or null when it was never saved. Stays valid until the next write, or the next
+        /// read of a payload written since the file was last mapped.
+        const uint8* GetPayload(uint32 chunkIndex, RegionEntry& entry);
+
+        /// Appends the payload and points the chunk's entry at it, compacting the file when enough dead payloads have piled up
+        void WritePayload(uint32 chunkIndex, const uint8* payload, uint32 compressedSize, uint32 size);
+
+        /// Rewrites the file with only the live payloads
+        void Compact();
+
+        bool HasChunk(const uint32 chunkIndex) const {
+            return m_Header.entries[chunkIndex].size > 0;
+        }
+
+        uint64 GetFileSize() const {
+            return m_FileSize;
+        }
+
+        /// Bytes of payloads some entry points at
+        uint64 GetLiveSize() const {
+            return m_LiveSize;
+        }
+
+        const std::string& GetFileName() const {
+            return m_FileName;
+        }
+
+        static uint32 GetChunkIndex(const ChunkPosition& position) {
+            constexpr int32 localMask = REGION_SIZE - 1;
+            return static_cast<uint32>((position.y & localMask) << (REGION_SIZE_BITS * 2) | (position.z & localMask) << REGION_SIZE_BITS
+                                       | (position.x & localMask));
+        }
+
+        static ChunkPosition GetRegionPosition(const ChunkPosition& position) {
+            return {position.x >> REGION_SIZE_BITS, position.y >> REGION_SIZE_BITS, position.z >> REGION_SIZE_BITS};
+        }
+
+    private:
+        std::string m_FileName;
+        File* m_File = nullptr;
+        file::MappedFile m_View;
+        RegionHeader m_Header{};
+        uint64 m_FileSize = 0;
+        uint64 m_LiveSize = 0;
+
+        void Write(uint64 offset, const void* data, size_t size);
+    };
+
+    /// Saves and loads chunks through the region files of one directory, compressed with LZ4. Loading is a lookup in the mapped
+    /// header table and a decompression straight out of the mapping.
+    class RegionStorage {
+    public:
+        explicit RegionStorage(std::string directory);
+
+        /// Loads the chunk into the world, replacing what is resident there. Returns false when the chunk was never saved and throws
+        /// when its payload is corrupt.
+        bool LoadChunk(World& world, const ChunkPosition& position);
+
+        void SaveChunk(const Chunk& chunk, const ChunkPosition& position);
+
+        /// Compressed bytes of the last chunk loaded or saved, for reporting
+        size_t GetLastCompressedSize() const {
+            return m_LastCompressedSize;
+        }
+
+        size_t GetOpenRegionCount() const {
+            return m_Regions.size();
+        }
+
+        std::string GetRegionFileName(const ChunkPosition& regionPosition) const;
+
+    private:
+        struct OpenRegion {
+            std::unique_ptr<RegionFile> file;
+            uint64 lastUse;
+        };
+
+        std::string m_Directory;
+        std::unordered_map<ChunkPosition, OpenRegion, ChunkPositionHash> m_Regions;
+        uint64 m_UseCount = 0;
+        std::vector<uint8> m_Buffer;
+        std::vector<uint8> m_CompressedBuffer;
+        size_t m_LastCompressedSize = 0;
+
+        /// Returns null when loading from a region that has no file yet
+        RegionFile* GetRegion(const ChunkPosition& regionPosition, bool isCreating);
+    };
+}
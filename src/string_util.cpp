@@ -1,14 +1,197 @@
 #include "string_util.hpp"
 
-#include <vector>
+#include <charconv>
+#include <cstdint>
+
+// Case returning the name of the enumerator as written
+#define ENUM_NAME_CASE(value) case value: return #value;
 
 namespace voxelfield::util {
-    std::string Format(const std::string& format, const unsigned int length, ...) {
-        va_list arguments;
-        std::vector<char> output(length);
-        va_start(arguments, length);
-        std::vsnprintf(output.data(), length, format.c_str(), arguments);
-        va_end(arguments);
-        return output.data();
+    namespace {
+        // Enough for any integer and floating point numbers up to the precision limit below in scientific notation
+        constexpr size_t NUMBER_BUFFER_SIZE = 128;
+        constexpr int MAX_FLOATING_POINT_PRECISION = 64;
+
+        /// Pads numbers to the width, zeros go between the sign and the digits
+        void WriteNumber(FormatWriter& writer, const FormatSpecification& specification, const char* text, size_t length) {
+            const size_t paddingLength = specification.width > length ? specification.width - length : 0;
+            if (specification.alignment == '<') {
+                writer.Append(text, length);
+                writer.Append(' ', paddingLength);
+            } else if (specification.isZeroPadded) {
+                if (length > 0 && (text[0] == '-' || text[0] == '+')) {
+                    writer.Append(text, 1);
+                    text++;
+                    length--;
+                }
+                writer.Append('0', paddingLength);
+                writer.Append(text, length);
+            } else {
+                writer.Append(' ', paddingLength);
+                writer.Append(text, length);
+            }
+        }
+
+        template<typename FloatingPoint>
+        void WriteFloatingPointNumber(FormatWriter& writer, const FormatSpecification& specification, const FloatingPoint value) {
+            char text[NUMBER_BUFFER_SIZE];
+            char* const end = text + NUMBER_BUFFER_SIZE;
+            const int precision = std::min(specification.precision < 0 ? 6 : specification.precision, MAX_FLOATING_POINT_PRECISION);
+            std::to_chars_result result{};
+            switch (specification.type) {
+                case 'f':
+                    result = std::to_chars(text, end, value, std::chars_format::fixed, precision);
+                    // Fixed notation of huge numbers runs past the buffer
+                    if (result.ec != std::errc()) result = std::to_chars(text, end, value, std::chars_format::scientific, precision);
+                    break;
+                case 'e':
+                    result = std::to_chars(text, end, value, std::chars_format::scientific, precision);
+                    break;
+                case 'g':
+                    result = std::to_chars(text, end, value, std::chars_format::general, precision);
+                    break;
+                default:
+                    // Shortest text that reads back as the same number unless a precision is given
+                    result = specification.precision < 0
+                             ? std::to_chars(text, end, value)
+                             : std::to_chars(text, end, value, std::chars_format::general, precision);
+                    break;
+            }
+            if (result.ec == std::errc()) WriteNumber(writer, specification, text, static_cast<size_t>(result.ptr - text));
+        }
+    }
+
+    void WriteSigned(FormatWriter& writer, const FormatSpecification& specification, const int64_t value) {
+        char text[NUMBER_BUFFER_SIZE];
+        const std::to_chars_result result = std::to_chars(text, text + NUMBER_BUFFER_SIZE, value);
+        WriteNumber(writer, specification, text, static_cast<size_t>(result.ptr - text));
+    }
+
+    void WriteUnsigned(FormatWriter& writer, const FormatSpecification& specification, const uint64 value) {
+        char text[NUMBER_BUFFER_SIZE];
+        const bool isHexadecimal = specification.type == 'x' || specification.type == 'X';
+        const std::to_chars_result result = std::to_chars(text, text + NUMBER_BUFFER_SIZE, value, isHexadecimal ? 16 : 10);
+        if (specification.type == 'X')
+            for (char* character = text; character < result.ptr; character++)
+                if (*character >= 'a' && *character <= 'f') *character = static_cast<char>(*character - 'a' + 'A');
+        WriteNumber(writer, specification, text, static_cast<size_t>(result.ptr - text));
+    }
+
+    void WriteFloatingPoint(FormatWriter& writer, const FormatSpecification& specification, const float value) {
+        WriteFloatingPointNumber(writer, specification, value);
+    }
+
+    void WriteFloatingPoint(FormatWriter& writer, const FormatSpecification& specification, const double value) {
+        WriteFloatingPointNumber(writer, specification, value);
+    }
+
+    void WriteString(FormatWriter& writer, const FormatSpecification& specification, std::string_view value) {
+        if (specification.precision >= 0) value = value.substr(0, static_cast<size_t>(specification.precision));
+        const size_t paddingLength = specification.width > value.size() ? specification.width - value.size() : 0;
+        if (specification.alignment == '>') writer.Append(' ', paddingLength);
+        writer.Append(value.data(), value.size());
+        if (specification.alignment != '>') writer.Append(' ', paddingLength);
+    }
+
+    void WritePointer(FormatWriter& writer, const FormatSpecification& specification, const void* value) {
+        char text[NUMBER_BUFFER_SIZE] = "0x";
+        const std::to_chars_result result = std::to_chars(text + 2, text + NUMBER_BUFFER_SIZE, reinterpret_cast<uintptr_t>(value), 16);
+        WriteNumber(writer, specification, text, static_cast<size_t>(result.ptr - text));
+    }
+
+    const char* GetEnumName(const VkResult result) {
+        switch (result) {
+            ENUM_NAME_CASE(VK_SUCCESS)
+            ENUM_NAME_CASE(VK_NOT_READY)
+            ENUM_NAME_CASE(VK_TIMEOUT)
+            ENUM_NAME_CASE(VK_EVENT_SET)
+            ENUM_NAME_CASE(VK_EVENT_RESET)
+            ENUM_NAME_CASE(VK_INCOMPLETE)
+            ENUM_NAME_CASE(VK_ERROR_OUT_OF_HOST_MEMORY)
+            ENUM_NAME_CASE(VK_ERROR_OUT_OF_DEVICE_MEMORY)
+            ENUM_NAME_CASE(VK_ERROR_INITIALIZATION_FAILED)
+            ENUM_NAME_CASE(VK_ERROR_DEVICE_LOST)
+            ENUM_NAME_CASE(VK_ERROR_MEMORY_MAP_FAILED)
+            ENUM_NAME_CASE(VK_ERROR_LAYER_NOT_PRESENT)
+            ENUM_NAME_CASE(VK_ERROR_EXTENSION_NOT_PRESENT)
+            ENUM_NAME_CASE(VK_ERROR_FEATURE_NOT_PRESENT)
+            ENUM_NAME_CASE(VK_ERROR_INCOMPATIBLE_DRIVER)
+            ENUM_NAME_CASE(VK_ERROR_TOO_MANY_OBJECTS)
+            ENUM_NAME_CASE(VK_ERROR_FORMAT_NOT_SUPPORTED)
+            ENUM_NAME_CASE(VK_ERROR_FRAGMENTED_POOL)
+            ENUM_NAME_CASE(VK_ERROR_UNKNOWN)
+            ENUM_NAME_CASE(VK_ERROR_OUT_OF_POOL_MEMORY)
+            ENUM_NAME_CASE(VK_ERROR_INVALID_EXTERNAL_HANDLE)
+            ENUM_NAME_CASE(VK_ERROR_FRAGMENTATION)
+            ENUM_NAME_CASE(VK_ERROR_INVALID_OPAQUE_CAPTURE_ADDRESS)
+            ENUM_NAME_CASE(VK_ERROR_SURFACE_LOST_KHR)
+            ENUM_NAME_CASE(VK_ERROR_NATIVE_WINDOW_IN_USE_KHR)
+            ENUM_NAME_CASE(VK_SUBOPTIMAL_KHR)
+            ENUM_NAME_CASE(VK_ERROR_OUT_OF_DATE_KHR)
+            ENUM_NAME_CASE(VK_ERROR_INCOMPATIBLE_DISPLAY_KHR)
+            ENUM_NAME_CASE(VK_ERROR_VALIDATION_FAILED_EXT)
+            default:
+                return nullptr;
+        }
+    }
+
+    const char* GetEnumName(const VkFormat format) {
+        // Formats the engine uses or is likely to be handed by a surface, everything else is written as a number
+        switch (format) {
+            ENUM_NAME_CASE(VK_FORMAT_UNDEFINED)
+            ENUM_NAME_CASE(VK_FORMAT_R8G8B8A8_UNORM)
+            ENUM_NAME_CASE(VK_FORMAT_R8G8B8A8_UINT)
+            ENUM_NAME_CASE(VK_FORMAT_R8G8B8A8_SRGB)
+            ENUM_NAME_CASE(VK_FORMAT_B8G8R8A8_UNORM)
+            ENUM_NAME_CASE(VK_FORMAT_B8G8R8A8_SRGB)
+            ENUM_NAME_CASE(VK_FORMAT_A2B10G10R10_UNORM_PACK32)
+            ENUM_NAME_CASE(VK_FORMAT_R16G16B16A16_UINT)
+            ENUM_NAME_CASE(VK_FORMAT_R16G16B16A16_SFLOAT)
+            ENUM_NAME_CASE(VK_FORMAT_R32_UINT)
+            ENUM_NAME_CASE(VK_FORMAT_R32_SFLOAT)
+            ENUM_NAME_CASE(VK_FORMAT_R32G32_UINT)
+            ENUM_NAME_CASE(VK_FORMAT_R32G32B32_SFLOAT)
+            ENUM_NAME_CASE(VK_FORMAT_R32G32B32A32_SFLOAT)
+            ENUM_NAME_CASE(VK_FORMAT_D16_UNORM)
+            ENUM_NAME_CASE(VK_FORMAT_D32_SFLOAT)
+            ENUM_NAME_CASE(VK_FORMAT_D24_UNORM_S8_UINT)
+            ENUM_NAME_CASE(VK_FORMAT_D32_SFLOAT_S8_UINT)
+            default:
+                return nullptr;
+        }
+    }
+
+    const char* GetEnumName(const VkPresentModeKHR presentMode) {
+        switch (presentMode) {
+            ENUM_NAME_CASE(VK_PRESENT_MODE_IMMEDIATE_KHR)
+            ENUM_NAME_CASE(VK_PRESENT_MODE_MAILBOX_KHR)
+            ENUM_NAME_CASE(VK_PRESENT_MODE_FIFO_KHR)
+            ENUM_NAME_CASE(VK_PRESENT_MODE_FIFO_RELAXED_KHR)
+            default:
+                return nullptr;
+        }
+    }
+
+    const char* GetEnumName(const VkPhysicalDeviceType deviceType) {
+        switch (deviceType) {
+            ENUM_NAME_CASE(VK_PHYSICAL_DEVICE_TYPE_OTHER)
+            ENUM_NAME_CASE(VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU)
+            ENUM_NAME_CASE(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+            ENUM_NAME_CASE(VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU)
+            ENUM_NAME_CASE(VK_PHYSICAL_DEVICE_TYPE_CPU)
+            default:
+                return nullptr;
+        }
+    }
+
+    const char* GetEnumName(const VkDebugUtilsMessageSeverityFlagBitsEXT severity) {
+        switch (severity) {
+            ENUM_NAME_CASE(VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT)
+            ENUM_NAME_CASE(VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT)
+            ENUM_NAME_CASE(VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+            ENUM_NAME_CASE(VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
+            default:
+                return nullptr;
+        }
     }
 }
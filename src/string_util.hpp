@@ -1,8 +1,415 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <string>
-#include <cstdarg>
+#include <string_view>
+#include <type_traits>
+
+#include <vulkan/vulkan.h>
+
+#include "type_definitions.hpp"
+
+// Capacity of the stack buffer Format writes into, longer text is cut short
+#define FORMAT_BUFFER_SIZE 512
+
+/// Wraps a string literal so its placeholders can be parsed and checked against the arguments at compile time. Placeholders are
+/// {} or {:spec}, where spec is an optional < or > alignment, 0 to pad numbers with zeros, a width, a .precision for floating point
+/// numbers and strings, and a type of d, x or X for integers, f, e or g for floating point numbers, s for strings and p for
+/// pointers. Braces are escaped by doubling them.
+#define FORMAT(literal) [] {                                \
+            struct Literal : voxelfield::util::FormatLiteral {  \
+                static constexpr std::string_view Get() {       \
+                    return literal;                             \
+                }                                               \
+            };                                                  \
+            return Literal{};                                   \
+        }()
 
 namespace voxelfield::util {
-    std::string Format(const std::string& format, unsigned int length, ...);
-}
\ No newline at end of file
+    /// Base of the types FORMAT wraps literals in
+    struct FormatLiteral {
+    };
+
+    // Names written for Vulkan enumerations, null for values without one. Enumerations of other namespaces get names the same way
+    // with a GetEnumName overload found by argument dependent lookup.
+
+    const char* GetEnumName(VkResult result);
+
+    const char* GetEnumName(VkFormat format);
+
+    const char* GetEnumName(VkPresentModeKHR presentMode);
+
+    const char* GetEnumName(VkPhysicalDeviceType deviceType);
+
+    const char* GetEnumName(VkDebugUtilsMessageSeverityFlagBitsEXT severity);
+
+    enum class ArgumentKind : uint8 {
+        UNSUPPORTED, SIGNED_INTEGER, UNSIGNED_INTEGER, BOOLEAN, CHARACTER, FLOATING_POINT, STRING, POINTER, NAMED_ENUMERATION
+    };
+
+    struct FormatSpecification {
+        // Left or right, none for the default of the type, strings to the left and everything else to the right
+        char alignment = '\0';
+        bool isZeroPadded = false;
+        uint16 width = 0;
+        int32 precision = -1;
+        char type = '\0';
+    };
+
+    /// Literal text followed by at most one argument
+    struct FormatSegment {
+        uint16 literalBegin = 0, literalLength = 0;
+        bool hasArgument = false;
+        FormatSpecification specification;
+    };
+
+    template<size_t Capacity>
+    struct ParsedFormat {
+        std::array<FormatSegment, Capacity> segments{};
+        size_t segmentCount = 0, argumentCount = 0;
+        bool isValid = true;
+    };
+
+    template<typename Enumeration, typename = void>
+    struct HasEnumName : std::false_type {
+    };
+
+    template<typename Enumeration>
+    struct HasEnumName<Enumeration, std::void_t<decltype(GetEnumName(std::declval<Enumeration>()))>> : std::true_type {
+    };
+
+    /// How an argument of the type is written, takes decayed types
+    template<typename Value>
+    constexpr ArgumentKind GetArgumentKind() {
+        if constexpr (std::is_same_v<Value, bool>) {
+            return ArgumentKind::BOOLEAN;
+        } else if constexpr (std::is_same_v<Value, char>) {
+            return ArgumentKind::CHARACTER;
+        } else if constexpr (std::is_enum_v<Value>) {
+            if constexpr (HasEnumName<Value>::value) return ArgumentKind::NAMED_ENUMERATION;
+            else return GetArgumentKind<std::underlying_type_t<Value>>();
+        } else if constexpr (std::is_integral_v<Value>) {
+            return std::is_signed_v<Value> ? ArgumentKind::SIGNED_INTEGER : ArgumentKind::UNSIGNED_INTEGER;
+        } else if constexpr (std::is_floating_point_v<Value>) {
+            return ArgumentKind::FLOATING_POINT;
+        } else if constexpr (std::is_same_v<Value, const char*> || std::is_same_v<Value, char*> || std::is_same_v<Value, std::string>
+                             || std::is_same_v<Value, std::string_view>) {
+            return ArgumentKind::STRING;
+        } else if constexpr (std::is_pointer_v<Value>) {
+            return ArgumentKind::POINTER;
+        } else {
+            return ArgumentKind::UNSUPPORTED;
+        }
+    }
+
+    constexpr bool IsSpecificationValid(const ArgumentKind kind, const FormatSpecification& specification) {
+        const char type = specification.type;
+        const bool isNumber = kind == ArgumentKind::SIGNED_INTEGER || kind == ArgumentKind::UNSIGNED_INTEGER
+                              || kind == ArgumentKind::FLOATING_POINT;
+        if (specification.isZeroPadded && !isNumber) return false;
+        if (specification.precision >= 0 && kind != ArgumentKind::FLOATING_POINT && kind != ArgumentKind::STRING) return false;
+        switch (kind) {
+            case ArgumentKind::SIGNED_INTEGER:
+            case ArgumentKind::UNSIGNED_INTEGER:
+                return type == '\0' || type == 'd' || type == 'x' || type == 'X';
+            case ArgumentKind::BOOLEAN:
+            case ArgumentKind::CHARACTER:
+                return type == '\0' || type == 'd';
+            case ArgumentKind::FLOATING_POINT:
+                return type == '\0' || type == 'f' || type == 'e' || type == 'g';
+            case ArgumentKind::STRING:
+                return type == '\0' || type == 's';
+            case ArgumentKind::POINTER:
+                return type == '\0' || type == 'p';
+            case ArgumentKind::NAMED_ENUMERATION:
+                return type == '\0' || type == 's' || type == 'd' || type == 'x' || type == 'X';
+            default:
+                return false;
+        }
+    }
+
+    /// Most segments a format can have, every brace can end one
+    constexpr size_t CountFormatSegments(const std::string_view format) {
+        size_t segmentCount = 1;
+        for (const char character : format)
+            if (character == '{' || character == '}') segmentCount++;
+        return segmentCount;
+    }
+
+    constexpr bool IsDigit(const char character) {
+        return character >= '0' && character <= '9';
+    }
+
+    /// Parses what follows the opening brace of a placeholder up to and including the closing one
+    constexpr bool ParseSpecification(const std::string_view format, size_t& index, FormatSpecification& specification) {
+        if (index < format.size() && format[index] == '}') {
+            index++;
+            return true;
+        }
+        if (index >= format.size() || format[index++] != ':') return false;
+        if (index < format.size() && (format[index] == '<' || format[index] == '>')) specification.alignment = format[index++];
+        if (index < format.size() && format[index] == '0') {
+            specification.isZeroPadded = true;
+            index++;
+        }
+        uint32 width = 0;
+        for (; index < format.size() && IsDigit(format[index]); index++) {
+            width = width * 10 + (format[index] - '0');
+            if (width > UINT16_MAX) return false;
+        }
+        specification.width = static_cast<uint16>(width);
+        if (index < format.size() && format[index] == '.') {
+            index++;
+            if (index >= format.size() || !IsDigit(format[index])) return false;
+            specification.precision = 0;
+            for (; index < format.size() && IsDigit(format[index]); index++) {
+                specification.precision = specification.precision * 10 + (format[index] - '0');
+                if (specification.precision > UINT16_MAX) return false;
+            }
+        }
+        if (index < format.size() && format[index] != '}') specification.type = format[index++];
+        return index < format.size() && format[index++] == '}';
+    }
+
+    template<size_t Capacity>
+    constexpr ParsedFormat<Capacity> ParseFormat(const std::string_view format) {
+        ParsedFormat<Capacity> parsed;
+        size_t literalBegin = 0, index = 0;
+        const auto addSegment = [&](const size_t literalEnd, const bool hasArgument) {
+            FormatSegment& segment = parsed.segments[parsed.segmentCount++];
+            segment.literalBegin = static_cast<uint16>(literalBegin);
+            segment.literalLength = static_cast<uint16>(literalEnd - literalBegin);
+            segment.hasArgument = hasArgument;
+            return &segment;
+        };
+        if (format.size() > UINT16_MAX) parsed.isValid = false;
+        while (parsed.isValid && index < format.size()) {
+            const char character = format[index];
+            if ((character == '{' || character == '}') && index + 1 < format.size() && format[index + 1] == character) {
+                // Escaped brace, the literal runs up to and including the first of the two
+                addSegment(index + 1, false);
+                index += 2;
+                literalBegin = index;
+            } else if (character == '{') {
+                FormatSegment* segment = addSegment(index, true);
+                index++;
+                parsed.isValid = ParseSpecification(format, index, segment->specification);
+                parsed.argumentCount++;
+                literalBegin = index;
+            } else {
+                parsed.isValid = character != '}';
+                index++;
+            }
+        }
+        if (parsed.isValid && literalBegin < format.size()) addSegment(format.size(), false);
+        return parsed;
+    }
+
+    template<size_t Capacity, size_t KindCount>
+    constexpr bool AreSpecificationsValid(const ParsedFormat<Capacity>& parsed, const ArgumentKind (& kinds)[KindCount]) {
+        size_t argumentIndex = 0;
+        for (size_t segmentIndex = 0; segmentIndex < parsed.segmentCount; segmentIndex++) {
+            const FormatSegment& segment = parsed.segments[segmentIndex];
+            if (segment.hasArgument && (argumentIndex >= KindCount || !IsSpecificationValid(kinds[argumentIndex++], segment.specification)))
+                return false;
+        }
+        return true;
+    }
+
+    /// Parses the format of a literal type made by FORMAT once per program and fails to compile when its placeholders do not fit the
+    /// arguments. Takes decayed argument types.
+    template<typename Literal, typename... Arguments>
+    struct CheckedFormat {
+        static_assert(std::is_base_of_v<FormatLiteral, Literal>, "Formats have to be string literals wrapped in FORMAT");
+
+        static constexpr std::string_view LITERAL = Literal::Get();
+        static constexpr auto PARSED = ParseFormat<CountFormatSegments(Literal::Get())>(Literal::Get());
+        // Last one keeps the array from being empty
+        static constexpr ArgumentKind KINDS[] = {GetArgumentKind<Arguments>()..., ArgumentKind::UNSUPPORTED};
+
+        static_assert(((GetArgumentKind<Arguments>() != ArgumentKind::UNSUPPORTED) && ...),
+                      "Only numbers, booleans, characters, enumerations, strings and pointers can be formatted");
+        static_assert(PARSED.isValid, "Format has an unmatched brace or a malformed placeholder");
+        static_assert(PARSED.argumentCount == sizeof...(Arguments), "Format has a different number of placeholders than arguments");
+        static_assert(AreSpecificationsValid(PARSED, KINDS), "Format has a placeholder specification its argument type does not take");
+    };
+
+    /// Writes into a buffer of a fixed size, dropping what does not fit and keeping room for the terminator
+    class FormatWriter {
+    public:
+        FormatWriter(char* buffer, const size_t size) : m_Begin(buffer), m_Cursor(buffer), m_End(size > 0 ? buffer + size - 1 : buffer) {
+        }
+
+        void Append(const char* text, size_t length) {
+            length = std::min(length, static_cast<size_t>(m_End - m_Cursor));
+            std::memcpy(m_Cursor, text, length);
+            m_Cursor += length;
+        }
+
+        void Append(const char character, size_t count) {
+            count = std::min(count, static_cast<size_t>(m_End - m_Cursor));
+            std::memset(m_Cursor, character, count);
+            m_Cursor += count;
+        }
+
+        /// Terminates the text if there is a buffer at all and returns its length
+        size_t Finish(const size_t size) {
+            if (size > 0) *m_Cursor = '\0';
+            return static_cast<size_t>(m_Cursor - m_Begin);
+        }
+
+    private:
+        char* m_Begin;
+        char* m_Cursor;
+        char* m_End;
+    };
+
+    void WriteSigned(FormatWriter& writer, const FormatSpecification& specification, int64_t value);
+
+    void WriteUnsigned(FormatWriter& writer, const FormatSpecification& specification, uint64 value);
+
+    void WriteFloatingPoint(FormatWriter& writer, const FormatSpecification& specification, float value);
+
+    void WriteFloatingPoint(FormatWriter& writer, const FormatSpecification& specification, double value);
+
+    void WriteString(FormatWriter& writer, const FormatSpecification& specification, std::string_view value);
+
+    void WritePointer(FormatWriter& writer, const FormatSpecification& specification, const void* value);
+
+    template<typename Integer>
+    void WriteInteger(FormatWriter& writer, const FormatSpecification& specification, const Integer value) {
+        // Hexadecimal shows the bits of the type, negative numbers included
+        if constexpr (std::is_signed_v<Integer>) {
+            if (specification.type == 'x' || specification.type == 'X')
+                WriteUnsigned(writer, specification, static_cast<std::make_unsigned_t<Integer>>(value));
+            else
+                WriteSigned(writer, specification, value);
+        } else {
+            WriteUnsigned(writer, specification, value);
+        }
+    }
+
+    template<typename Value>
+    void WriteArgument(FormatWriter& writer, const FormatSpecification& specification, const Value& value) {
+        constexpr ArgumentKind kind = GetArgumentKind<Value>();
+        if constexpr (kind == ArgumentKind::BOOLEAN) {
+            if (specification.type == 'd') WriteUnsigned(writer, specification, value ? 1 : 0);
+            else WriteString(writer, specification, value ? "true" : "false");
+        } else if constexpr (kind == ArgumentKind::CHARACTER) {
+            if (specification.type == 'd') WriteSigned(writer, specification, value);
+            else WriteString(writer, specification, std::string_view(&value, 1));
+        } else if constexpr (kind == ArgumentKind::NAMED_ENUMERATION) {
+            const char* name = specification.type == '\0' || specification.type == 's' ? GetEnumName(value) : nullptr;
+            if (name) {
+                WriteString(writer, specification, name);
+            } else {
+                FormatSpecification numberSpecification = specification;
+                if (numberSpecification.type == 's') numberSpecification.type = '\0';
+                WriteInteger(writer, numberSpecification, static_cast<std::underlying_type_t<Value>>(value));
+            }
+        } else if constexpr (std::is_enum_v<Value>) {
+            WriteInteger(writer, specification, static_cast<std::underlying_type_t<Value>>(value));
+        } else if constexpr (kind == ArgumentKind::SIGNED_INTEGER || kind == ArgumentKind::UNSIGNED_INTEGER) {
+            WriteInteger(writer, specification, value);
+        } else if constexpr (std::is_same_v<Value, float>) {
+            WriteFloatingPoint(writer, specification, value);
+        } else if constexpr (kind == ArgumentKind::FLOATING_POINT) {
+            WriteFloatingPoint(writer, specification, static_cast<double>(value));
+        } else if constexpr (std::is_same_v<Value, const char*> || std::is_same_v<Value, char*>) {
+            WriteString(writer, specification, value ? std::string_view(value) : std::string_view("(null)"));
+        } else if constexpr (kind == ArgumentKind::STRING) {
+            WriteString(writer, specification, value);
+        } else {
+            WritePointer(writer, specification, value);
+        }
+    }
+
+    template<typename Value>
+    const Value& GetFormatValue(const Value& value) {
+        return value;
+    }
+
+    template<size_t Length>
+    const char* GetFormatValue(const char (& value)[Length]) {
+        return value;
+    }
+
+    /// Writes the parsed format, shared between every format with the same argument types
+    template<typename... Arguments>
+    size_t FormatSegments(char* buffer, const size_t size, const char* format, const FormatSegment* segments, const size_t segmentCount,
+                          const Arguments& ... arguments) {
+        FormatWriter writer(buffer, size);
+        size_t segmentIndex = 0;
+        const auto writeNext = [&](const auto& argument) {
+            while (true) {
+                const FormatSegment& segment = segments[segmentIndex++];
+                writer.Append(format + segment.literalBegin, segment.literalLength);
+                if (segment.hasArgument) {
+                    WriteArgument(writer, segment.specification, argument);
+                    return;
+                }
+            }
+        };
+        (writeNext(GetFormatValue(arguments)), ...);
+        for (; segmentIndex < segmentCount; segmentIndex++)
+            writer.Append(format + segments[segmentIndex].literalBegin, segments[segmentIndex].literalLength);
+        return writer.Finish(size);
+    }
+
+    /// Formats into the buffer without allocating, cutting the text short when it does not fit. The text is always terminated and
+    /// its length returned.
+    template<typename Literal, typename... Arguments>
+    size_t FormatTo(char* buffer, const size_t size, Literal, const Arguments& ... arguments) {
+        typedef CheckedFormat<Literal, std::decay_t<Arguments>...> Checked;
+        return FormatSegments(buffer, size, Checked::LITERAL.data(), Checked::PARSED.segments.data(), Checked::PARSED.segmentCount,
+                              arguments...);
+    }
+
+    template<size_t Size, typename Literal, typename... Arguments>
+    std::enable_if_t<std::is_base_of_v<FormatLiteral, Literal>, size_t>
+    FormatTo(char (& buffer)[Size], const Literal literal, const Arguments& ... arguments) {
+        return FormatTo(buffer, Size, literal, arguments...);
+    }
+
+    /// Text formatted into a buffer on the stack. Converts to a string view, or to a string where one is needed such as for exceptions.
+    template<size_t Capacity>
+    class FormatBuffer {
+    public:
+        template<typename Literal, typename... Arguments>
+        explicit FormatBuffer(const Literal literal, const Arguments& ... arguments)
+                : m_Length(FormatTo(m_Data, Capacity, literal, arguments...)) {
+        }
+
+        const char* GetString() const {
+            return m_Data;
+        }
+
+        std::string_view GetView() const {
+            return {m_Data, m_Length};
+        }
+
+        size_t GetLength() const {
+            return m_Length;
+        }
+
+        operator std::string_view() const {
+            return GetView();
+        }
+
+        operator std::string() const {
+            return std::string(m_Data, m_Length);
+        }
+
+    private:
+        char m_Data[Capacity];
+        size_t m_Length;
+    };
+
+    /// Formats into a buffer on the stack of FORMAT_BUFFER_SIZE
+    template<typename Literal, typename... Arguments>
+    FormatBuffer<FORMAT_BUFFER_SIZE> Format(const Literal literal, const Arguments& ... arguments) {
+        return FormatBuffer<FORMAT_BUFFER_SIZE>(literal, arguments...);
+    }
+}
@@ -0,0 +1,121 @@
+#include "sub_allocator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace voxelfield::memory {
+    FreeListSubAllocator::FreeListSubAllocator(const uint64 capacity) : SubAllocator(capacity) {
+        m_FreeRanges.emplace(0, capacity);
+    }
+
+    std::optional<SubAllocation> FreeListSubAllocator::Allocate(const uint64 size, const uint64 alignment) {
+        if (size == 0) return std::nullopt;
+        auto bestRange = m_FreeRanges.end();
+        uint64 bestRangeWaste = UINT64_MAX;
+        for (auto range = m_FreeRanges.begin(); range != m_FreeRanges.end(); ++range) {
+            const auto& [rangeOffset, rangeSize] = *range;
+            const uint64 padding = AlignUp(rangeOffset, alignment) - rangeOffset;
+            if (padding + size > rangeSize) continue;
+            const uint64 waste = rangeSize - size;
+            if (waste < bestRangeWaste) {
+                bestRange = range;
+                bestRangeWaste = waste;
+                if (waste == padding) break;
+            }
+        }
+        if (bestRange == m_FreeRanges.end()) return std::nullopt;
+        const auto [rangeOffset, rangeSize] = *bestRange;
+        m_FreeRanges.erase(bestRange);
+        const uint64 offset = AlignUp(rangeOffset, alignment), end = offset + size, rangeEnd = rangeOffset + rangeSize;
+        // Alignment padding and the tail stay available as their own ranges
+        if (offset > rangeOffset) m_FreeRanges.emplace(rangeOffset, offset - rangeOffset);
+        if (rangeEnd > end) m_FreeRanges.emplace(end, rangeEnd - end);
+        m_UsedSize += size;
+        m_AllocationCount++;
+        return SubAllocation{offset, size};
+    }
+
+    void FreeListSubAllocator::Free(const SubAllocation& allocation) {
+        uint64 offset = allocation.offset, size = allocation.size;
+        auto next = m_FreeRanges.lower_bound(offset);
+        if (next != m_FreeRanges.end() && offset + size == next->first) {
+            size += next->second;
+            next = m_FreeRanges.erase(next);
+        }
+        if (next != m_FreeRanges.begin()) {
+            if (auto previous = std::prev(next); previous->first + previous->second == offset) {
+                offset = previous->first;
+                size += previous->second;
+                m_FreeRanges.erase(previous);
+            }
+        }
+        m_FreeRanges.emplace(offset, size);
+        m_UsedSize -= allocation.size;
+        m_AllocationCount--;
+    }
+
+    uint64 FreeListSubAllocator::GetLargestFreeRange() const {
+        uint64 largestRange = 0;
+        for (const auto& [rangeOffset, rangeSize] : m_FreeRanges)
+            largestRange = std::max(largestRange, rangeSize);
+        return largestRange;
+    }
+
+    BuddySubAllocator::BuddySubAllocator(const uint64 capacity, const uint64 minimumBlockSize)
+            : SubAllocator(capacity), m_MinimumBlockSize(minimumBlockSize) {
+        if (!IsPowerOfTwo(capacity) || !IsPowerOfTwo(minimumBlockSize) || minimumBlockSize > capacity) {
+            throw std::runtime_error("Buddy allocator capacity and minimum block size must be powers of two");
+        }
+        m_FreeBlocks.resize(GetOrder(capacity) + 1);
+        m_FreeBlocks.back().insert(0);
+    }
+
+    uint32 BuddySubAllocator::GetOrder(const uint64 size) const {
+        uint32 order = 0;
+        while (GetOrderSize(order) < size) order++;
+        return order;
+    }
+
+    std::optional<SubAllocation> BuddySubAllocator::Allocate(const uint64 size, const uint64 alignment) {
+        // Blocks are aligned to their own size, so rounding up to the alignment satisfies it as well
+        if (size == 0 || std::max(size, alignment) > m_Capacity) return std::nullopt;
+        const uint32 order = GetOrder(std::max(size, alignment));
+        uint32 freeOrder = order;
+        while (freeOrder < m_FreeBlocks.size() && m_FreeBlocks[freeOrder].empty()) freeOrder++;
+        if (freeOrder == m_FreeBlocks.size()) return std::nullopt;
+        const uint64 offset = *m_FreeBlocks[freeOrder].begin();
+        m_FreeBlocks[freeOrder].erase(m_FreeBlocks[freeOrder].begin());
+        // Split down to the requested order, the upper halves become free buddies
+        while (freeOrder > order) {
+            freeOrder--;
+            m_FreeBlocks[freeOrder].insert(offset + GetOrderSize(freeOrder));
+        }
+        const uint64 blockSize = GetOrderSize(order);
+        m_UsedSize += blockSize;
+        m_AllocationCount++;
+        return SubAllocation{offset, blockSize};
+    }
+
+    void BuddySubAllocator::Free(const SubAllocation& allocation) {
+        uint32 order = GetOrder(allocation.size);
+        uint64 offset = allocation.offset;
+        while (order + 1 < m_FreeBlocks.size()) {
+            const uint64 buddyOffset = offset ^ GetOrderSize(order);
+            auto buddy = m_FreeBlocks[order].find(buddyOffset);
+            if (buddy == m_FreeBlocks[order].end()) break;
+            m_FreeBlocks[order].erase(buddy);
+            offset = std::min(offset, buddyOffset);
+            order++;
+        }
+        m_FreeBlocks[order].insert(offset);
+        m_UsedSize -= allocation.size;
+        m_AllocationCount--;
+    }
+
+    uint64 BuddySubAllocator::GetLargestFreeRange() const {
+        for (size_t order = m_FreeBlocks.size(); order-- > 0;) {
+            if (!m_FreeBlocks[order].empty()) return GetOrderSize(static_cast<uint32>(order));
+        }
+        return 0;
+    }
+}
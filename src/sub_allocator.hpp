@@ -0,0 +1,97 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include <set>
+#include <vector>
+
+#include "type_definitions.hpp"
+
+namespace voxelfield::memory {
+    struct SubAllocation {
+        uint64 offset, size;
+    };
+
+    /// Hands out aligned ranges of a fixed-size block, the block itself is owned by whoever uses the sub-allocator
+    class SubAllocator {
+    public:
+        explicit SubAllocator(uint64 capacity) : m_Capacity(capacity) {}
+
+        virtual ~SubAllocator() = default;
+
+        virtual std::optional<SubAllocation> Allocate(uint64 size, uint64 alignment) = 0;
+
+        virtual void Free(const SubAllocation& allocation) = 0;
+
+        virtual uint64 GetLargestFreeRange() const = 0;
+
+        uint64 GetCapacity() const {
+            return m_Capacity;
+        }
+
+        uint64 GetUsedSize() const {
+            return m_UsedSize;
+        }
+
+        uint64 GetFreeSize() const {
+            return m_Capacity - m_UsedSize;
+        }
+
+        uint32 GetAllocationCount() const {
+            return m_AllocationCount;
+        }
+
+    protected:
+        const uint64 m_Capacity;
+        uint64 m_UsedSize = 0;
+        uint32 m_AllocationCount = 0;
+    };
+
+    /// Best-fit allocator over a sorted list of free ranges, neighbouring ranges are merged when freed
+    class FreeListSubAllocator : public SubAllocator {
+    public:
+        explicit FreeListSubAllocator(uint64 capacity);
+
+        std::optional<SubAllocation> Allocate(uint64 size, uint64 alignment) override;
+
+        void Free(const SubAllocation& allocation) override;
+
+        uint64 GetLargestFreeRange() const override;
+
+    private:
+        // Offset to size
+        std::map<uint64, uint64> m_FreeRanges;
+    };
+
+    /// Power-of-two buddy allocator, capacity has to be a power of two. Fast to free and resistant to fragmentation under churn
+    /// at the cost of rounding every allocation up to the next power of two
+    class BuddySubAllocator : public SubAllocator {
+    public:
+        BuddySubAllocator(uint64 capacity, uint64 minimumBlockSize);
+
+        std::optional<SubAllocation> Allocate(uint64 size, uint64 alignment) override;
+
+        void Free(const SubAllocation& allocation) override;
+
+        uint64 GetLargestFreeRange() const override;
+
+    private:
+        const uint64 m_MinimumBlockSize;
+        // Free block offsets for every order, order zero is the minimum block size
+        std::vector<std::set<uint64>> m_FreeBlocks;
+
+        uint32 GetOrder(uint64 size) const;
+
+        uint64 GetOrderSize(const uint32 order) const {
+            return m_MinimumBlockSize << order;
+        }
+    };
+
+    inline uint64 AlignUp(const uint64 value, const uint64 alignment) {
+        return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+    }
+
+    inline bool IsPowerOfTwo(const uint64 value) {
+        return value && !(value & (value - 1));
+    }
+}
@@ -0,0 +1,690 @@
+#include "terrain_generator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TERRAIN_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TERRAIN_SSE2
+#endif
+
+namespace voxelfield::world {
+    namespace {
+        constexpr uint32 CHUNK_AREA = CHUNK_SIZE * CHUNK_SIZE;
+        // Skew factors of the simplex grids and the corner offsets that follow from them
+        constexpr float F2 = 0.36602540378f, G2 = 0.21132486540f, F3 = 1.0f / 3.0f, G3 = 1.0f / 6.0f;
+        constexpr float G2_TWICE = 2.0f * G2, G3_TWICE = 2.0f * G3, G3_THRICE = 3.0f * G3;
+        // Bring the sums of the corner contributions to roughly minus one to one
+        constexpr float SIMPLEX_2D_SCALE = 70.0f, SIMPLEX_3D_SCALE = 32.0f;
+        constexpr float BIOME_BLEND_SCALE = 1.0f / (TERRAIN_BIOME_BLEND_END - TERRAIN_BIOME_BLEND_START);
+        // Odd constants for hashing lattice points, salts keep the noises of one seed apart
+        constexpr uint32 HASH_X = 0x27D4EB2Du, HASH_Y = 0x165667B1u, HASH_Z = 0x1B873593u, HASH_MIX = 0x2C1B3C6Du;
+        constexpr uint32 BIOME_SALT = 0x9E3779B9u, CAVE_SALT = 0x85EBCA6Bu, ORE_SALT = 0xC2B2AE35u;
+
+        // Scalar reference, every function below has a vectorized twin further down that has to stay in step with it
+
+        uint32 Mix(uint32 hash) {
+            hash ^= hash >> 15;
+            hash *= HASH_MIX;
+            return hash ^ (hash >> 12);
+        }
+
+        uint32 Hash(const int32 i, const int32 j, const uint32 seed) {
+            return Mix(static_cast<uint32>(i) * HASH_X ^ static_cast<uint32>(j) * HASH_Y ^ seed);
+        }
+
+        uint32 Hash(const int32 i, const int32 j, const int32 k, const uint32 seed) {
+            return Mix(static_cast<uint32>(i) * HASH_X ^ static_cast<uint32>(j) * HASH_Y ^ static_cast<uint32>(k) * HASH_Z ^ seed);
+        }
+
+        // Same operand order as the SSE minimum and maximum, which return the second operand unless the first one wins
+        float Maximum(const float first, const float second) {
+            return first > second ? first : second;
+        }
+
+        float Minimum(const float first, const float second) {
+            return first < second ? first : second;
+        }
+
+        int32 Floor(const float value) {
+            return static_cast<int32>(std::floor(value));
+        }
+
+        // Gradients are the diagonals, picked by the low bits of the hash, so a dot product is a sum with flipped signs
+        float GetCorner(const float x, const float y, const uint32 hash) {
+            float falloff = Maximum(0.5f - x * x - y * y, 0.0f);
+            falloff = falloff * falloff;
+            return falloff * falloff * ((hash & 1u ? -x : x) + (hash & 2u ? -y : y));
+        }
+
+        float GetCorner(const float x, const float y, const float z, const uint32 hash) {
+            float falloff = Maximum(0.6f - x * x - y * y - z * z, 0.0f);
+            falloff = falloff * falloff;
+            return falloff * falloff * ((hash & 1u ? -x : x) + (hash & 2u ? -y : y) + (hash & 4u ? -z : z));
+        }
+
+        float Simplex(const float x, const float y, const uint32 seed) {
+            const float skew = (x + y) * F2;
+            const int32 i = Floor(x + skew), j = Floor(y + skew);
+            const float unskew = static_cast<float>(i + j) * G2;
+            const float x0 = x - (static_cast<float>(i) - unskew), y0 = y - (static_cast<float>(j) - unskew);
+            // The middle corner is one step along whichever axis is further into the cell
+            const int32 i1 = x0 > y0 ? 1 : 0, j1 = x0 > y0 ? 0 : 1;
+            const float x1 = x0 - static_cast<float>(i1) + G2, y1 = y0 - static_cast<float>(j1) + G2;
+            const float x2 = x0 - 1.0f + G2_TWICE, y2 = y0 - 1.0f + G2_TWICE;
+            const float sum = GetCorner(x0, y0, Hash(i, j, seed)) + GetCorner(x1, y1, Hash(i + i1, j + j1, seed))
+                              + GetCorner(x2, y2, Hash(i + 1, j + 1, seed));
+            return sum * SIMPLEX_2D_SCALE;
+        }
+
+        float Simplex(const float x, const float y, const float z, const uint32 seed) {
+            const float skew = (x + y + z) * F3;
+            const int32 i = Floor(x + skew), j = Floor(y + skew), k = Floor(z + skew);
+            const float unskew = static_cast<float>(i + j + k) * G3;
+            const float x0 = x - (static_cast<float>(i) - unskew), y0 = y - (static_cast<float>(j) - unskew),
+                    z0 = z - (static_cast<float>(k) - unskew);
+            // The two middle corners step along the axes in order of how far the point is into the cell along them
+            const bool isXy = x0 >= y0, isYz = y0 >= z0, isXz = x0 >= z0;
+            const int32 i1 = isXy && isXz, j1 = !isXy && isYz, k1 = !isXz && !isYz;
+            const int32 i2 = isXy || isXz, j2 = !isXy || isYz, k2 = !isXz || !isYz;
+            const float x1 = x0 - static_cast<float>(i1) + G3, y1 = y0 - static_cast<float>(j1) + G3, z1 = z0 - static_cast<float>(k1) + G3;
+            const float x2 = x0 - static_cast<float>(i2) + G3_TWICE, y2 = y0 - static_cast<float>(j2) + G3_TWICE,
+                    z2 = z0 - static_cast<float>(k2) + G3_TWICE;
+            const float x3 = x0 - 1.0f + G3_THRICE, y3 = y0 - 1.0f + G3_THRICE, z3 = z0 - 1.0f + G3_THRICE;
+            const float sum = GetCorner(x0, y0, z0, Hash(i, j, k, seed)) + GetCorner(x1, y1, z1, Hash(i + i1, j + j1, k + k1, seed))
+                              + GetCorner(x2, y2, z2, Hash(i + i2, j + j2, k + k2, seed))
+                              + GetCorner(x3, y3, z3, Hash(i + 1, j + 1, k + 1, seed));
+            return sum * SIMPLEX_3D_SCALE;
+        }
+
+        float GetFractal(const float x, const float y, const uint32 seed) {
+            // Amplitudes start at a half so the octaves sum to less than one
+            float sum = 0.0f, amplitude = 0.5f, frequency = TERRAIN_FREQUENCY;
+            for (uint32 octave = 0; octave < TERRAIN_OCTAVES; octave++) {
+                sum = sum + Simplex(x * frequency, y * frequency, seed + octave) * amplitude;
+                frequency *= 2.0f;
+                amplitude *= 0.5f;
+            }
+            return sum;
+        }
+
+        int32 GetHeight(const float x, const float z, const uint32 seed) {
+            const float biome = Simplex(x * TERRAIN_BIOME_FREQUENCY, z * TERRAIN_BIOME_FREQUENCY, seed ^ BIOME_SALT);
+            float weight = Minimum(Maximum((biome - TERRAIN_BIOME_BLEND_START) * BIOME_BLEND_SCALE, 0.0f), 1.0f);
+            weight = weight * weight * (3.0f - 2.0f * weight);
+            const float baseHeight = TERRAIN_PLAINS_BASE_HEIGHT + (TERRAIN_MOUNTAINS_BASE_HEIGHT - TERRAIN_PLAINS_BASE_HEIGHT) * weight;
+            const float amplitude = TERRAIN_PLAINS_AMPLITUDE + (TERRAIN_MOUNTAINS_AMPLITUDE - TERRAIN_PLAINS_AMPLITUDE) * weight;
+            return Floor(baseHeight + amplitude * GetFractal(x, z, seed));
+        }
+
+        // Block choice is per voxel and the same for both paths, only the noise feeding it is vectorized
+
+        bool IsStone(const int32 y, const int32 height) {
+            return y <= height - TERRAIN_SOIL_DEPTH;
+        }
+
+        BlockId GetSoilBlock(const int32 y, const int32 height) {
+            if (y > height) return AIR_BLOCK;
+            const bool isBeach = height <= TERRAIN_BEACH_HEIGHT;
+            if (y < height) return isBeach ? SAND_BLOCK : DIRT_BLOCK;
+            return height >= TERRAIN_SNOW_HEIGHT ? SNOW_BLOCK : isBeach ? SAND_BLOCK : GRASS_BLOCK;
+        }
+
+        BlockId GetStoneBlock(const float caveNoise, const uint32 oreHash) {
+            if (caveNoise > TERRAIN_CAVE_THRESHOLD) return AIR_BLOCK;
+            return (oreHash & (TERRAIN_ORE_RARITY - 1)) == 0 ? ORE_BLOCK : STONE_BLOCK;
+        }
+
+        // Lanes of floats and 32-bit integers, comparisons give integer masks with every bit of a lane set where true
+
+#if defined(TERRAIN_AVX2)
+        constexpr uint32 LANE_COUNT = 8;
+
+        struct Floats {
+            __m256 value;
+        };
+
+        struct Ints {
+            __m256i value;
+        };
+
+        Floats Broadcast(const float value) {
+            return {_mm256_set1_ps(value)};
+        }
+
+        Ints BroadcastInts(const uint32 value) {
+            return {_mm256_set1_epi32(static_cast<int>(value))};
+        }
+
+        Ints GetLaneIndices() {
+            return {_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)};
+        }
+
+        void Store(float* destination, const Floats values) {
+            _mm256_storeu_ps(destination, values.value);
+        }
+
+        void Store(uint32* destination, const Ints values) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), values.value);
+        }
+
+        void Store(int32* destination, const Ints values) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), values.value);
+        }
+
+        Floats operator+(const Floats first, const Floats second) {
+            return {_mm256_add_ps(first.value, second.value)};
+        }
+
+        Floats operator-(const Floats first, const Floats second) {
+            return {_mm256_sub_ps(first.value, second.value)};
+        }
+
+        Floats operator*(const Floats first, const Floats second) {
+            return {_mm256_mul_ps(first.value, second.value)};
+        }
+
+        Floats Maximum(const Floats first, const Floats second) {
+            return {_mm256_max_ps(first.value, second.value)};
+        }
+
+        Floats Minimum(const Floats first, const Floats second) {
+            return {_mm256_min_ps(first.value, second.value)};
+        }
+
+        Ints IsGreater(const Floats first, const Floats second) {
+            return {_mm256_castps_si256(_mm256_cmp_ps(first.value, second.value, _CMP_GT_OQ))};
+        }
+
+        Ints IsGreaterOrEqual(const Floats first, const Floats second) {
+            return {_mm256_castps_si256(_mm256_cmp_ps(first.value, second.value, _CMP_GE_OQ))};
+        }
+
+        Floats ToFloats(const Ints values) {
+            return {_mm256_cvtepi32_ps(values.value)};
+        }
+
+        // Truncation rounds up for negative values with a fraction, a true mask is minus one so adding it steps those back down
+        Ints Floor(const Floats values) {
+            const __m256i truncated = _mm256_cvttps_epi32(values.value);
+            const __m256 isRoundedUp = _mm256_cmp_ps(_mm256_cvtepi32_ps(truncated), values.value, _CMP_GT_OQ);
+            return {_mm256_add_epi32(truncated, _mm256_castps_si256(isRoundedUp))};
+        }
+
+        Floats FlipSigns(const Floats values, const Ints signs) {
+            return {_mm256_xor_ps(values.value, _mm256_castsi256_ps(signs.value))};
+        }
+
+        Ints operator+(const Ints first, const Ints second) {
+            return {_mm256_add_epi32(first.value, second.value)};
+        }
+
+        Ints operator*(const Ints first, const Ints second) {
+            return {_mm256_mullo_epi32(first.value, second.value)};
+        }
+
+        Ints operator^(const Ints first, const Ints second) {
+            return {_mm256_xor_si256(first.value, second.value)};
+        }
+
+        Ints operator&(const Ints first, const Ints second) {
+            return {_mm256_and_si256(first.value, second.value)};
+        }
+
+        Ints operator|(const Ints first, const Ints second) {
+            return {_mm256_or_si256(first.value, second.value)};
+        }
+
+        // Clears the bits of the second operand that are set in the first
+        Ints AndNot(const Ints mask, const Ints values) {
+            return {_mm256_andnot_si256(mask.value, values.value)};
+        }
+
+        Ints ShiftLeft(const Ints values, const int count) {
+            return {_mm256_slli_epi32(values.value, count)};
+        }
+
+        Ints ShiftRight(const Ints values, const int count) {
+            return {_mm256_srli_epi32(values.value, count)};
+        }
+
+#elif defined(TERRAIN_SSE2)
+        constexpr uint32 LANE_COUNT = 4;
+
+        struct Floats {
+            __m128 value;
+        };
+
+        struct Ints {
+            __m128i value;
+        };
+
+        Floats Broadcast(const float value) {
+            return {_mm_set1_ps(value)};
+        }
+
+        Ints BroadcastInts(const uint32 value) {
+            return {_mm_set1_epi32(static_cast<int>(value))};
+        }
+
+        Ints GetLaneIndices() {
+            return {_mm_setr_epi32(0, 1, 2, 3)};
+        }
+
+        void Store(float* destination, const Floats values) {
+            _mm_storeu_ps(destination, values.value);
+        }
+
+        void Store(uint32* destination, const Ints values) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination), values.value);
+        }
+
+        void Store(int32* destination, const Ints values) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination), values.value);
+        }
+
+        Floats operator+(const Floats first, const Floats second) {
+            return {_mm_add_ps(first.value, second.value)};
+        }
+
+        Floats operator-(const Floats first, const Floats second) {
+            return {_mm_sub_ps(first.value, second.value)};
+        }
+
+        Floats operator*(const Floats first, const Floats second) {
+            return {_mm_mul_ps(first.value, second.value)};
+        }
+
+        Floats Maximum(const Floats first, const Floats second) {
+            return {_mm_max_ps(first.value, second.value)};
+        }
+
+        Floats Minimum(const Floats first, const Floats second) {
+            return {_mm_min_ps(first.value, second.value)};
+        }
+
+        Ints IsGreater(const Floats first, const Floats second) {
+            return {_mm_castps_si128(_mm_cmpgt_ps(first.value, second.value))};
+        }
+
+        Ints IsGreaterOrEqual(const Floats first, const Floats second) {
+            return {_mm_castps_si128(_mm_cmpge_ps(first.value, second.value))};
+        }
+
+        Floats ToFloats(const Ints values) {
+            return {_mm_cvtepi32_ps(values.value)};
+        }
+
+        // SSE2 has no floor, truncation rounds up for negative values with a fraction and adding the minus one mask steps them back
+        Ints Floor(const Floats values) {
+            const __m128i truncated = _mm_cvttps_epi32(values.value);
+            const __m128 isRoundedUp = _mm_cmpgt_ps(_mm_cvtepi32_ps(truncated), values.value);
+            return {_mm_add_epi32(truncated, _mm_castps_si128(isRoundedUp))};
+        }
+
+        Floats FlipSigns(const Floats values, const Ints signs) {
+            return {_mm_xor_ps(values.value, _mm_castsi128_ps(signs.value))};
+        }
+
+        Ints operator+(const Ints first, const Ints second) {
+            return {_mm_add_epi32(first.value, second.value)};
+        }
+
+        // SSE2 only multiplies the even lanes, the odd ones are shifted down, multiplied and interleaved back
+        Ints operator*(const Ints first, const Ints second) {
+            const __m128i evens = _mm_mul_epu32(first.value, second.value);
+            const __m128i odds = _mm_mul_epu32(_mm_srli_epi64(first.value, 32), _mm_srli_epi64(second.value, 32));
+            return {_mm_unpacklo_epi32(_mm_shuffle_epi32(evens, _MM_SHUFFLE(0, 0, 2, 0)),
+                                       _mm_shuffle_epi32(odds, _MM_SHUFFLE(0, 0, 2, 0)))};
+        }
+
+        Ints operator^(const Ints first, const Ints second) {
+            return {_mm_xor_si128(first.value, second.value)};
+        }
+
+        Ints operator&(const Ints first, const Ints second) {
+            return {_mm_and_si128(first.value, second.value)};
+        }
+
+        Ints operator|(const Ints first, const Ints second) {
+            return {_mm_or_si128(first.value, second.value)};
+        }
+
+        // Clears the bits of the second operand that are set in the first
+        Ints AndNot(const Ints mask, const Ints values) {
+            return {_mm_andnot_si128(mask.value, values.value)};
+        }
+
+        Ints ShiftLeft(const Ints values, const int count) {
+            return {_mm_slli_epi32(values.value, count)};
+        }
+
+        Ints ShiftRight(const Ints values, const int count) {
+            return {_mm_srli_epi32(values.value, count)};
+        }
+
+#else
+        // Without SIMD a lane is a plain value, the vectorized path still runs and checks the lane logic
+        constexpr uint32 LANE_COUNT = 1;
+
+        struct Floats {
+            float value;
+        };
+
+        struct Ints {
+            uint32 value;
+        };
+
+        Floats Broadcast(const float value) {
+            return {value};
+        }
+
+        Ints BroadcastInts(const uint32 value) {
+            return {value};
+        }
+
+        Ints GetLaneIndices() {
+            return {0};
+        }
+
+        void Store(float* destination, const Floats values) {
+            *destination = values.value;
+        }
+
+        void Store(uint32* destination, const Ints values) {
+            *destination = values.value;
+        }
+
+        void Store(int32* destination, const Ints values) {
+            *destination = static_cast<int32>(values.value);
+        }
+
+        Floats operator+(const Floats first, const Floats second) {
+            return {first.value + second.value};
+        }
+
+        Floats operator-(const Floats first, const Floats second) {
+            return {first.value - second.value};
+        }
+
+        Floats operator*(const Floats first, const Floats second) {
+            return {first.value * second.value};
+        }
+
+        Floats Maximum(const Floats first, const Floats second) {
+            return {Maximum(first.value, second.value)};
+        }
+
+        Floats Minimum(const Floats first, const Floats second) {
+            return {Minimum(first.value, second.value)};
+        }
+
+        Ints IsGreater(const Floats first, const Floats second) {
+            return {first.value > second.value ? ~0u : 0u};
+        }
+
+        Ints IsGreaterOrEqual(const Floats first, const Floats second) {
+            return {first.value >= second.value ? ~0u : 0u};
+        }
+
+        Floats ToFloats(const Ints values) {
+            return {static_cast<float>(static_cast<int32>(values.value))};
+        }
+
+        Ints Floor(const Floats values) {
+            return {static_cast<uint32>(Floor(values.value))};
+        }
+
+        Floats FlipSigns(const Floats values, const Ints signs) {
+            return {signs.value ? -values.value : values.value};
+        }
+
+        Ints operator+(const Ints first, const Ints second) {
+            return {first.value + second.value};
+        }
+
+        Ints operator*(const Ints first, const Ints second) {
+            return {first.value * second.value};
+        }
+
+        Ints operator^(const Ints first, const Ints second) {
+            return {first.value ^ second.value};
+        }
+
+        Ints operator&(const Ints first, const Ints second) {
+            return {first.value & second.value};
+        }
+
+        Ints operator|(const Ints first, const Ints second) {
+            return {first.value | second.value};
+        }
+
+        Ints AndNot(const Ints mask, const Ints values) {
+            return {~mask.value & values.value};
+        }
+
+        Ints ShiftLeft(const Ints values, const int count) {
+            return {values.value << count};
+        }
+
+        Ints ShiftRight(const Ints values, const int count) {
+            return {values.value >> count};
+        }
+
+#endif
+
+        // Vectorized twins of the reference functions, operation for operation
+
+        Ints Mix(Ints hash) {
+            hash = hash ^ ShiftRight(hash, 15);
+            hash = hash * BroadcastInts(HASH_MIX);
+            return hash ^ ShiftRight(hash, 12);
+        }
+
+        Ints Hash(const Ints i, const Ints j, const Ints seed) {
+            return Mix(i * BroadcastInts(HASH_X) ^ j * BroadcastInts(HASH_Y) ^ seed);
+        }
+
+        Ints Hash(const Ints i, const Ints j, const Ints k, const Ints seed) {
+            return Mix(i * BroadcastInts(HASH_X) ^ j * BroadcastInts(HASH_Y) ^ k * BroadcastInts(HASH_Z) ^ seed);
+        }
+
+        // Moves a bit of the hash into the sign bit, flipping the sign exactly like the negation in the reference
+        Ints GetSign(const Ints hash, const uint32 bit) {
+            return ShiftLeft(hash & BroadcastInts(1u << bit), static_cast<int>(31 - bit));
+        }
+
+        Floats GetCorner(const Floats x, const Floats y, const Ints hash) {
+            Floats falloff = Maximum(Broadcast(0.5f) - x * x - y * y, Broadcast(0.0f));
+            falloff = falloff * falloff;
+            return falloff * falloff * (FlipSigns(x, GetSign(hash, 0)) + FlipSigns(y, GetSign(hash, 1)));
+        }
+
+        Floats GetCorner(const Floats x, const Floats y, const Floats z, const Ints hash) {
+            Floats falloff = Maximum(Broadcast(0.6f) - x * x - y * y - z * z, Broadcast(0.0f));
+            falloff = falloff * falloff;
+            return falloff * falloff * (FlipSigns(x, GetSign(hash, 0)) + FlipSigns(y, GetSign(hash, 1)) + FlipSigns(z, GetSign(hash, 2)));
+        }
+
+        Floats Simplex(const Floats x, const Floats y, const Ints seed) {
+            const Ints one = BroadcastInts(1);
+            const Floats skew = (x + y) * Broadcast(F2);
+            const Ints i = Floor(x + skew), j = Floor(y + skew);
+            const Floats unskew = ToFloats(i + j) * Broadcast(G2);
+            const Floats x0 = x - (ToFloats(i) - unskew), y0 = y - (ToFloats(j) - unskew);
+            const Ints isXGreater = IsGreater(x0, y0);
+            const Ints i1 = isXGreater & one, j1 = AndNot(isXGreater, one);
+            const Floats x1 = x0 - ToFloats(i1) + Broadcast(G2), y1 = y0 - ToFloats(j1) + Broadcast(G2);
+            const Floats x2 = x0 - Broadcast(1.0f) + Broadcast(G2_TWICE), y2 = y0 - Broadcast(1.0f) + Broadcast(G2_TWICE);
+            const Floats sum = GetCorner(x0, y0, Hash(i, j, seed)) + GetCorner(x1, y1, Hash(i + i1, j + j1, seed))
+                               + GetCorner(x2, y2, Hash(i + one, j + one, seed));
+            return sum * Broadcast(SIMPLEX_2D_SCALE);
+        }
+
+        Floats Simplex(const Floats x, const Floats y, const Floats z, const Ints seed) {
+            const Ints one = BroadcastInts(1);
+            const Floats skew = (x + y + z) * Broadcast(F3);
+            const Ints i = Floor(x + skew), j = Floor(y + skew), k = Floor(z + skew);
+            const Floats unskew = ToFloats(i + j + k) * Broadcast(G3);
+            const Floats x0 = x - (ToFloats(i) - unskew), y0 = y - (ToFloats(j) - unskew), z0 = z - (ToFloats(k) - unskew);
+            const Ints isXy = IsGreaterOrEqual(x0, y0), isYz = IsGreaterOrEqual(y0, z0), isXz = IsGreaterOrEqual(x0, z0);
+            const Ints i1 = isXy & isXz & one, j1 = AndNot(isXy, isYz) & one, k1 = AndNot(isXz | isYz, one);
+            const Ints i2 = (isXy | isXz) & one, j2 = AndNot(isXy, one) | (isYz & one), k2 = AndNot(isXz & isYz, one);
+            const Floats x1 = x0 - ToFloats(i1) + Broadcast(G3), y1 = y0 - ToFloats(j1) + Broadcast(G3),
+                    z1 = z0 - ToFloats(k1) + Broadcast(G3);
+            const Floats x2 = x0 - ToFloats(i2) + Broadcast(G3_TWICE), y2 = y0 - ToFloats(j2) + Broadcast(G3_TWICE),
+                    z2 = z0 - ToFloats(k2) + Broadcast(G3_TWICE);
+            const Floats x3 = x0 - Broadcast(1.0f) + Broadcast(G3_THRICE), y3 = y0 - Broadcast(1.0f) + Broadcast(G3_THRICE),
+                    z3 = z0 - Broadcast(1.0f) + Broadcast(G3_THRICE);
+            const Floats sum = GetCorner(x0, y0, z0, Hash(i, j, k, seed)) + GetCorner(x1, y1, z1, Hash(i + i1, j + j1, k + k1, seed))
+                               + GetCorner(x2, y2, z2, Hash(i + i2, j + j2, k + k2, seed))
+                               + GetCorner(x3, y3, z3, Hash(i + one, j + one, k + one, seed));
+            return sum * Broadcast(SIMPLEX_3D_SCALE);
+        }
+
+        Floats GetFractal(const Floats x, const Floats y, const uint32 seed) {
+            Floats sum = Broadcast(0.0f);
+            float amplitude = 0.5f, frequency = TERRAIN_FREQUENCY;
+            for (uint32 octave = 0; octave < TERRAIN_OCTAVES; octave++) {
+                const Floats noise = Simplex(x * Broadcast(frequency), y * Broadcast(frequency), BroadcastInts(seed + octave));
+                sum = sum + noise * Broadcast(amplitude);
+                frequency *= 2.0f;
+                amplitude *= 0.5f;
+            }
+            return sum;
+        }
+
+        Ints GetHeight(const Floats x, const Floats z, const uint32 seed) {
+            const Floats biome = Simplex(x * Broadcast(TERRAIN_BIOME_FREQUENCY), z * Broadcast(TERRAIN_BIOME_FREQUENCY),
+                                         BroadcastInts(seed ^ BIOME_SALT));
+            Floats weight = Minimum(Maximum((biome - Broadcast(TERRAIN_BIOME_BLEND_START)) * Broadcast(BIOME_BLEND_SCALE), Broadcast(0.0f)),
+                                    Broadcast(1.0f));
+            weight = weight * weight * (Broadcast(3.0f) - Broadcast(2.0f) * weight);
+            const Floats baseHeight = Broadcast(TERRAIN_PLAINS_BASE_HEIGHT)
+                                      + Broadcast(TERRAIN_MOUNTAINS_BASE_HEIGHT - TERRAIN_PLAINS_BASE_HEIGHT) * weight;
+            const Floats amplitude = Broadcast(TERRAIN_PLAINS_AMPLITUDE)
+                                     + Broadcast(TERRAIN_MOUNTAINS_AMPLITUDE - TERRAIN_PLAINS_AMPLITUDE) * weight;
+            return Floor(baseHeight + amplitude * GetFractal(x, z, seed));
+        }
+
+        static_assert(CHUNK_SIZE % LANE_COUNT == 0, "Rows of a chunk are expected to split into whole batches of lanes");
+    }
+
+    TerrainGenerator::TerrainGenerator(const uint32 seed) : m_Seed(seed), m_Blocks(CHUNK_VOLUME), m_Heights(CHUNK_AREA) {}
+
+    void TerrainGenerator::Generate(const ChunkPosition& position, Chunk& chunk) {
+        const int32 originX = position.x * static_cast<int32>(CHUNK_SIZE), originY = position.y * static_cast<int32>(CHUNK_SIZE),
+                originZ = position.z * static_cast<int32>(CHUNK_SIZE);
+        const Ints laneIndices = GetLaneIndices();
+        for (uint32 z = 0; z < CHUNK_SIZE; z++) {
+            const Floats worldZ = Broadcast(static_cast<float>(originZ + static_cast<int32>(z)));
+            for (uint32 x = 0; x < CHUNK_SIZE; x += LANE_COUNT) {
+                const Floats worldX = ToFloats(BroadcastInts(static_cast<uint32>(originX + static_cast<int32>(x))) + laneIndices);
+                Store(&m_Heights[z * CHUNK_SIZE + x], GetHeight(worldX, worldZ, m_Seed));
+            }
+        }
+        // Highest column of each row, rows with no stone need no noise at all
+        int32 rowMaximumHeights[CHUNK_SIZE];
+        for (uint32 z = 0; z < CHUNK_SIZE; z++)
+            rowMaximumHeights[z] = *std::max_element(m_Heights.begin() + z * CHUNK_SIZE, m_Heights.begin() + (z + 1) * CHUNK_SIZE);
+        if (originY > *std::max_element(std::begin(rowMaximumHeights), std::end(rowMaximumHeights))) {
+            chunk.Fill(AIR_BLOCK);
+            return;
+        }
+        const Ints caveSeed = BroadcastInts(m_Seed ^ CAVE_SALT), oreSeed = BroadcastInts(m_Seed ^ ORE_SALT);
+        alignas(32) float caveNoise[LANE_COUNT];
+        alignas(32) uint32 oreHashes[LANE_COUNT];
+        for (uint32 y = 0; y < CHUNK_SIZE; y++) {
+            const int32 worldY = originY + static_cast<int32>(y);
+            const Floats caveY = Broadcast(static_cast<float>(worldY)) * Broadcast(TERRAIN_CAVE_FREQUENCY);
+            for (uint32 z = 0; z < CHUNK_SIZE; z++) {
+                const int32* heights = &m_Heights[z * CHUNK_SIZE];
+                BlockId* blocks = &m_Blocks[Chunk::GetBlockIndex(0, y, z)];
+                if (!IsStone(worldY, rowMaximumHeights[z])) {
+                    for (uint32 x = 0; x < CHUNK_SIZE; x++) blocks[x] = GetSoilBlock(worldY, heights[x]);
+                    continue;
+                }
+                const int32 worldZ = originZ + static_cast<int32>(z);
+                const Floats caveZ = Broadcast(static_cast<float>(worldZ)) * Broadcast(TERRAIN_CAVE_FREQUENCY);
+                for (uint32 x = 0; x < CHUNK_SIZE; x += LANE_COUNT) {
+                    const Ints worldX = BroadcastInts(static_cast<uint32>(originX + static_cast<int32>(x))) + laneIndices;
+                    Store(caveNoise, Simplex(ToFloats(worldX) * Broadcast(TERRAIN_CAVE_FREQUENCY), caveY, caveZ, caveSeed));
+                    Store(oreHashes, Hash(worldX, BroadcastInts(static_cast<uint32>(worldY)), BroadcastInts(static_cast<uint32>(worldZ)),
+                                          oreSeed));
+                    for (uint32 lane = 0; lane < LANE_COUNT; lane++) {
+                        const int32 height = heights[x + lane];
+                        blocks[x + lane] = IsStone(worldY, height) ? GetStoneBlock(caveNoise[lane], oreHashes[lane])
+                                                                   : GetSoilBlock(worldY, height);
+                    }
+                }
+            }
+        }
+        chunk.SetBlocks(m_Blocks.data());
+    }
+
+    void TerrainGenerator::GenerateReference(const ChunkPosition& position, Chunk& chunk) {
+        const int32 originX = position.x * static_cast<int32>(CHUNK_SIZE), originY = position.y * static_cast<int32>(CHUNK_SIZE),
+                originZ = position.z * static_cast<int32>(CHUNK_SIZE);
+        for (uint32 z = 0; z < CHUNK_SIZE; z++)
+            for (uint32 x = 0; x < CHUNK_SIZE; x++)
+                m_Heights[z * CHUNK_SIZE + x] = GetHeight(static_cast<float>(originX + static_cast<int32>(x)),
+                                                          static_cast<float>(originZ + static_cast<int32>(z)), m_Seed);
+        for (uint32 y = 0; y < CHUNK_SIZE; y++) {
+            for (uint32 z = 0; z < CHUNK_SIZE; z++) {
+                for (uint32 x = 0; x < CHUNK_SIZE; x++) {
+                    const int32 worldX = originX + static_cast<int32>(x), worldY = originY + static_cast<int32>(y),
+                            worldZ = originZ + static_cast<int32>(z);
+                    const int32 height = m_Heights[z * CHUNK_SIZE + x];
+                    BlockId block;
+                    if (IsStone(worldY, height)) {
+                        const float caveNoise = Simplex(static_cast<float>(worldX) * TERRAIN_CAVE_FREQUENCY,
+                                                        static_cast<float>(worldY) * TERRAIN_CAVE_FREQUENCY,
+                                                        static_cast<float>(worldZ) * TERRAIN_CAVE_FREQUENCY, m_Seed ^ CAVE_SALT);
+                        block = GetStoneBlock(caveNoise, Hash(worldX, worldY, worldZ, m_Seed ^ ORE_SALT));
+                    } else {
+                        block = GetSoilBlock(worldY, height);
+                    }
+                    m_Blocks[Chunk::GetBlockIndex(x, y, z)] = block;
+                }
+            }
+        }
+        chunk.SetBlocks(m_Blocks.data());
+    }
+
+    const char* TerrainGenerator::GetInstructionSet() {
+#if defined(TERRAIN_AVX2)
+        return "AVX2";
+#elif defined(TERRAIN_SSE2)
+        return "SSE2";
+#else
+        return "scalar";
+#endif
+    }
+
+    void GenerateTerrain(World& world, const int32 widthInChunks, const int32 heightInChunks, const uint32 seed) {
+        TerrainGenerator generator(seed);
+        for (int32 chunkZ = 0; chunkZ < widthInChunks; chunkZ++)
+            for (int32 chunkY = 0; chunkY < heightInChunks; chunkY++)
+                for (int32 chunkX = 0; chunkX < widthInChunks; chunkX++)
+                    generator.Generate({chunkX, chunkY, chunkZ}, world.GetOrCreateChunk({chunkX, chunkY, chunkZ}));
+    }
+
+    void GenerateTerrain(World& world, jobs::JobSystem& jobSystem, const int32 widthInChunks, const int32 heightInChunks,
+                         const uint32 seed) {
+        std::vector<std::pair<ChunkPosition, Chunk*>> chunks;
+        chunks.reserve(static_cast<size_t>(widthInChunks) * widthInChunks * heightInChunks);
+        for (int32 chunkZ = 0; chunkZ < widthInChunks; chunkZ++)
+            for (int32 chunkY = 0; chunkY < heightInChunks; chunkY++)
+                for (int32 chunkX = 0; chunkX < widthInChunks; chunkX++)
+                    chunks.emplace_back(ChunkPosition{chunkX, chunkY, chunkZ}, &world.GetOrCreateChunk({chunkX, chunkY, chunkZ}));
+        std::vector<TerrainGenerator> generators(jobSystem.GetWorkerCount(), TerrainGenerator(seed));
+        jobSystem.ParallelFor(chunks.size(), [&](const size_t first, const size_t last) {
+            TerrainGenerator& generator = generators[jobSystem.GetWorkerIndex()];
+            for (size_t chunkIndex = first; chunkIndex < last; chunkIndex++)
+                generator.Generate(chunks[chunkIndex].first, *chunks[chunkIndex].second);
+        });
+    }
+}
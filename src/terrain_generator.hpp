@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+
+#include "job_system.hpp"
+#include "world.hpp"
+
+// Heights are blended between the two biomes, in blocks
+#define TERRAIN_PLAINS_BASE_HEIGHT 24.0f
+#define TERRAIN_PLAINS_AMPLITUDE 6.0f
+#define TERRAIN_MOUNTAINS_BASE_HEIGHT 34.0f
+#define TERRAIN_MOUNTAINS_AMPLITUDE 26.0f
+// Frequency of the first octave of the height noise, in cycles per block
+#define TERRAIN_FREQUENCY (1.0f / 128.0f)
+#define TERRAIN_OCTAVES 5u
+#define TERRAIN_BIOME_FREQUENCY (1.0f / 512.0f)
+// Biome noise values over which plains turn into mountains
+#define TERRAIN_BIOME_BLEND_START (-0.2f)
+#define TERRAIN_BIOME_BLEND_END 0.4f
+#define TERRAIN_CAVE_FREQUENCY (1.0f / 24.0f)
+// Stone is carved out where the cave noise is above this
+#define TERRAIN_CAVE_THRESHOLD 0.55f
+// Blocks of dirt or sand under the surface, caves and ore stay below them
+#define TERRAIN_SOIL_DEPTH 4
+// Surfaces at or above this height are snow, at or below the beach height sand
+#define TERRAIN_SNOW_HEIGHT 50
+#define TERRAIN_BEACH_HEIGHT 20
+// One stone block in this many is ore, a power of two
+#define TERRAIN_ORE_RARITY 64u
+
+namespace voxelfield::world {
+    /// Block types the generator places, until block types are loaded from data
+    enum TerrainBlock : BlockId {
+        STONE_BLOCK = 1, DIRT_BLOCK, GRASS_BLOCK, ORE_BLOCK, SAND_BLOCK, SNOW_BLOCK
+    };
+
+    /// Generates chunks from simplex noise. Column heights come from fractal noise whose base height and amplitude are blended
+    /// between plains and mountains by a lower frequency biome noise, and stone is carved by three dimensional cave noise. Noise is
+    /// evaluated for as many columns or voxels of a row at once as SSE2 or AVX2 has lanes, and blocks are written into the chunk's
+    /// storage in one pass. Holds scratch buffers, so use one per thread.
+    class TerrainGenerator {
+    public:
+        explicit TerrainGenerator(uint32 seed);
+
+        /// Replaces the blocks of the chunk with the terrain at its position
+        void Generate(const ChunkPosition& position, Chunk& chunk);
+
+        /// Generates the same terrain one column and voxel at a time in plain scalar code. The vectorized path performs the same
+        /// float operations in the same order, so the two have to agree block for block.
+        void GenerateReference(const ChunkPosition& position, Chunk& chunk);
+
+        static const char* GetInstructionSet();
+
+    private:
+        uint32 m_Seed;
+        std::vector<BlockId> m_Blocks;
+        // Surface height of each column, indexed by Z then X
+        std::vector<int32> m_Heights;
+    };
+
+    /// Fills a width by width by height block of chunks from the origin with generated terrain
+    void GenerateTerrain(World& world, int32 widthInChunks, int32 heightInChunks, uint32 seed);
+
+    /// Same as above with the chunks generated in parallel, one generator per worker. Chunks are created up front on the calling
+    /// thread, the world map itself is not safe to change from several threads.
+    void GenerateTerrain(World& world, jobs::JobSystem& jobSystem, int32 widthInChunks, int32 heightInChunks, uint32 seed);
+}
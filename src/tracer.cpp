@@ -0,0 +1,189 @@
+#include "tracer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace voxelfield::profiling {
+    std::atomic<bool> g_IsCapturing{false};
+
+    namespace {
+        typedef std::chrono::steady_clock Clock;
+
+        /// Events of one thread. The owning thread appends and publishes them by moving the count, the exporting thread only reads
+        /// up to the count once the capture has stopped.
+        struct ThreadBuffer {
+            std::unique_ptr<TraceEvent[]> events;
+            std::atomic<uint32> count{0};
+            std::atomic<uint64> droppedCount{0};
+            uint32 threadIndex;
+            char name[MAX_TRACE_THREAD_NAME_LENGTH]{};
+        };
+
+        class Tracer {
+        public:
+            ThreadBuffer* AddBuffer() {
+                auto buffer = std::make_unique<ThreadBuffer>();
+                ThreadBuffer* bufferPointer = buffer.get();
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                // Kept after the thread exits, its events belong in the capture
+                bufferPointer->threadIndex = static_cast<uint32>(m_Buffers.size());
+                m_Buffers.push_back(std::move(buffer));
+                return bufferPointer;
+            }
+
+            void Configure(const TraceOptions& options) {
+                m_Options = options;
+                m_IsCaptured = false;
+                if (!m_Options.fileName.empty() && m_Options.firstFrame == 0) StartCapture();
+            }
+
+            void MarkFrame(const uint64 frameNumber) {
+                if (m_Options.fileName.empty()) return;
+                const uint64 lastFrame = m_Options.firstFrame + std::min(m_Options.frameCount, CAPTURE_UNTIL_EXIT - m_Options.firstFrame);
+                if (IsCapturing() && frameNumber >= lastFrame) StopCapture();
+                else if (!IsCapturing() && !m_IsCaptured && frameNumber >= m_Options.firstFrame && frameNumber < lastFrame) StartCapture();
+                if (IsCapturing()) Record({logging::GetTimestamp(), frameNumber, 0.0, "frame", TraceEventType::FRAME});
+            }
+
+            void Finish() {
+                if (IsCapturing()) StopCapture();
+            }
+
+        private:
+            std::mutex m_Mutex;
+            std::vector<std::unique_ptr<ThreadBuffer>> m_Buffers;
+            TraceOptions m_Options;
+            bool m_IsCaptured = false;
+            int64_t m_StartTimestamp = 0;
+            Clock::time_point m_StartTime;
+
+            void StartCapture() {
+                {
+                    // Nothing writes while no capture runs, so the buffers can be emptied
+                    std::lock_guard<std::mutex> lock(m_Mutex);
+                    for (const auto& buffer : m_Buffers) {
+                        buffer->count.store(0, std::memory_order_relaxed);
+                        buffer->droppedCount.store(0, std::memory_order_relaxed);
+                    }
+                }
+                m_StartTimestamp = logging::GetTimestamp();
+                m_StartTime = Clock::now();
+                g_IsCapturing.store(true, std::memory_order_release);
+            }
+
+            void StopCapture() {
+                g_IsCapturing.store(false, std::memory_order_relaxed);
+                m_IsCaptured = true;
+                // Time stamp counter ticks are measured against the steady clock over the whole capture
+                const int64_t endTimestamp = logging::GetTimestamp();
+                const double elapsedMicroseconds = std::chrono::duration<double, std::micro>(Clock::now() - m_StartTime).count();
+                const double ticksPerMicrosecond =
+                        elapsedMicroseconds > 0.0 ? (endTimestamp - m_StartTimestamp) / elapsedMicroseconds : 1.0;
+                File* file = std::fopen(m_Options.fileName.c_str(), "wb");
+                if (!file) {
+                    logging::Log(logging::LogType::ERROR_LOG, FORMAT("Could not open trace file {} for writing"), m_Options.fileName);
+                    return;
+                }
+                uint64 eventCount = 0, droppedCount = 0;
+                std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+                           "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Voxelfield\"}}", file);
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                for (const auto& buffer : m_Buffers) {
+                    const uint32 count = buffer->count.load(std::memory_order_acquire);
+                    droppedCount += buffer->droppedCount.load(std::memory_order_relaxed);
+                    if (buffer->name[0] != '\0')
+                        std::fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%" PRIu32
+                                           ",\"args\":{\"name\":\"%s\"}}", buffer->threadIndex, buffer->name);
+                    for (uint32 eventIndex = 0; eventIndex < count; eventIndex++) {
+                        const TraceEvent& event = buffer->events[eventIndex];
+                        const double time = (event.timestamp - m_StartTimestamp) / ticksPerMicrosecond;
+                        WriteEvent(file, event, time, event.argument / ticksPerMicrosecond, buffer->threadIndex);
+                    }
+                    eventCount += count;
+                }
+                std::fputs("\n]}\n", file);
+                std::fclose(file);
+                logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Wrote {} trace events to {}, dropped {} that did not fit"),
+                             eventCount, m_Options.fileName, droppedCount);
+            }
+
+            static void WriteEvent(File* file, const TraceEvent& event, const double time, const double duration,
+                                   const uint32 threadIndex) {
+                std::fprintf(file, ",\n{\"name\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%" PRIu32 ",", event.name, time, threadIndex);
+                switch (event.type) {
+                    case TraceEventType::ZONE:
+                        std::fprintf(file, "\"ph\":\"X\",\"dur\":%.3f}", duration);
+                        break;
+                    case TraceEventType::COUNTER:
+                        std::fprintf(file, "\"ph\":\"C\",\"args\":{\"value\":%.6g}}", event.value);
+                        break;
+                    case TraceEventType::FLOW_BEGIN:
+                        std::fprintf(file, "\"ph\":\"s\",\"cat\":\"%s\",\"id\":%" PRIu64 "}", event.name, event.argument);
+                        break;
+                    case TraceEventType::FLOW_END:
+                        // Binds to the zone the end falls in rather than the next one to start
+                        std::fprintf(file, "\"ph\":\"f\",\"bp\":\"e\",\"cat\":\"%s\",\"id\":%" PRIu64 "}", event.name, event.argument);
+                        break;
+                    case TraceEventType::FRAME:
+                        std::fprintf(file, "\"ph\":\"i\",\"s\":\"g\",\"args\":{\"frame\":%" PRIu64 "}}", event.argument);
+                        break;
+                }
+            }
+        };
+
+        Tracer& GetTracer() {
+            static Tracer tracer;
+            return tracer;
+        }
+
+        ThreadBuffer& GetThreadBuffer() {
+            thread_local ThreadBuffer* buffer = GetTracer().AddBuffer();
+            return *buffer;
+        }
+    }
+
+    void ConfigureTracing(const TraceOptions& options) {
+        GetTracer().Configure(options);
+    }
+
+    void MarkFrame(const uint64 frameNumber) {
+        GetTracer().MarkFrame(frameNumber);
+    }
+
+    void FinishTracing() {
+        GetTracer().Finish();
+    }
+
+    void SetThreadName(const std::string_view name) {
+        ThreadBuffer& buffer = GetThreadBuffer();
+        const size_t length = std::min(name.size(), sizeof(buffer.name) - 1);
+        std::copy_n(name.data(), length, buffer.name);
+        buffer.name[length] = '\0';
+    }
+
+    void RecordCounter(const char* name, const double value) {
+        if (IsCapturing()) Record({logging::GetTimestamp(), 0, value, name, TraceEventType::COUNTER});
+    }
+
+    void RecordFlow(const char* name, const uint64 id, const TraceEventType type) {
+        if (IsCapturing()) Record({logging::GetTimestamp(), id, 0.0, name, type});
+    }
+
+    void Record(const TraceEvent& event) {
+        ThreadBuffer& buffer = GetThreadBuffer();
+        // Only threads that record during a capture pay for a buffer
+        if (!buffer.events) buffer.events.reset(new TraceEvent[TRACE_BUFFER_CAPACITY]);
+        const uint32 count = buffer.count.load(std::memory_order_relaxed);
+        if (count == TRACE_BUFFER_CAPACITY) {
+            buffer.droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        buffer.events[count] = event;
+        buffer.count.store(count + 1, std::memory_order_release);
+    }
+}
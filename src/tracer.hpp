@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <string_view>
+
+#include "type_definitions.hpp"
+#include "logger.hpp"
+
+// Events each thread can record during one capture, later ones are dropped and counted
+#define TRACE_BUFFER_CAPACITY (1u << 16)
+// Longer thread names are cut short
+#define MAX_TRACE_THREAD_NAME_LENGTH 32
+#define CAPTURE_UNTIL_EXIT UINT64_MAX
+
+#ifdef TRACING_ENABLED
+#define TRACE_CONCATENATE_INNER(left, right) left##right
+#define TRACE_CONCATENATE(left, right) TRACE_CONCATENATE_INNER(left, right)
+/// Times the rest of the enclosing scope, the name has to be a string literal
+#define TRACE_ZONE(name) const voxelfield::profiling::ScopedZone TRACE_CONCATENATE(traceZone, __LINE__)(name)
+#define TRACE_COUNTER(name, value) voxelfield::profiling::RecordCounter(name, static_cast<double>(value))
+/// Arrow from the zone around the beginning to the zone around the end with the same name and ID, such as from scheduling a job to
+/// running it on a worker
+#define TRACE_FLOW_BEGIN(name, id) voxelfield::profiling::RecordFlow(name, id, voxelfield::profiling::TraceEventType::FLOW_BEGIN)
+#define TRACE_FLOW_END(name, id) voxelfield::profiling::RecordFlow(name, id, voxelfield::profiling::TraceEventType::FLOW_END)
+#define TRACE_FRAME(frameNumber) voxelfield::profiling::MarkFrame(frameNumber)
+#define TRACE_THREAD_NAME(name) voxelfield::profiling::SetThreadName(name)
+#else
+// Arguments are not evaluated either
+#define TRACE_ZONE(name) ((void) 0)
+#define TRACE_COUNTER(name, value) ((void) 0)
+#define TRACE_FLOW_BEGIN(name, id) ((void) 0)
+#define TRACE_FLOW_END(name, id) ((void) 0)
+#define TRACE_FRAME(frameNumber) ((void) 0)
+#define TRACE_THREAD_NAME(name) ((void) 0)
+#endif
+
+namespace voxelfield::profiling {
+    enum class TraceEventType : uint8 {
+        ZONE, COUNTER, FLOW_BEGIN, FLOW_END, FRAME
+    };
+
+    struct TraceEvent {
+        int64_t timestamp;
+        // Ticks the zone took, the ID of a flow or the number of a frame
+        uint64 argument;
+        double value;
+        const char* name;
+        TraceEventType type;
+    };
+
+    struct TraceOptions {
+        // Chrome trace JSON, which the Perfetto UI opens as well
+        std::string fileName;
+        // Frame the capture starts with, capturing from the first frame includes startup
+        uint64 firstFrame = 0;
+        uint64 frameCount = CAPTURE_UNTIL_EXIT;
+    };
+
+    /// Sets up a capture, which starts right away when it begins with the first frame. Called once before the window opens.
+    void ConfigureTracing(const TraceOptions& options);
+
+    /// Starts or ends the capture when its frame range begins or ends and marks the frame in the trace, called from the main thread
+    void MarkFrame(uint64 frameNumber);
+
+    /// Writes the capture if one is still running, for when the program exits inside the frame range
+    void FinishTracing();
+
+    /// Names the calling thread in captures
+    void SetThreadName(std::string_view name);
+
+    void RecordCounter(const char* name, double value);
+
+    void RecordFlow(const char* name, uint64 id, TraceEventType type);
+
+    // Everything below is only used by the functions above and ScopedZone
+
+    extern std::atomic<bool> g_IsCapturing;
+
+    inline bool IsCapturing() {
+        return g_IsCapturing.load(std::memory_order_relaxed);
+    }
+
+    /// Appends to the buffer of the calling thread without locking, only that thread writes to it
+    void Record(const TraceEvent& event);
+
+    /// Records one complete event when it goes out of scope. Costs an atomic load when no capture is running.
+    class ScopedZone {
+    public:
+        explicit ScopedZone(const char* name) : m_Name(name), m_Start(IsCapturing() ? logging::GetTimestamp() : 0) {}
+
+        ~ScopedZone() {
+            // Zones that were open when the capture started are left out
+            if (m_Start == 0 || !IsCapturing()) return;
+            const int64_t end = logging::GetTimestamp();
+            Record({m_Start, static_cast<uint64>(end - m_Start), 0.0, m_Name, TraceEventType::ZONE});
+        }
+
+        ScopedZone(const ScopedZone&) = delete;
+
+        ScopedZone& operator=(const ScopedZone&) = delete;
+
+    private:
+        const char* m_Name;
+        const int64_t m_Start;
+    };
+}
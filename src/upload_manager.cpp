@@ -0,0 +1,199 @@
+#include "upload_manager.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "logger.hpp"
+#include "string_util.hpp"
+#include "tracer.hpp"
+
+namespace voxelfield::memory {
+    void UploadManager::Create(const VkDevice logicalDeviceHandle, DeviceMemoryAllocator& memoryAllocator, const VkQueue queueHandle,
+                               const uint32 queueFamilyIndex, const VkDeviceSize ringSize) {
+        TRACE_ZONE("UploadManager::Create");
+        m_LogicalDeviceHandle = logicalDeviceHandle;
+        m_MemoryAllocator = &memoryAllocator;
+        m_QueueHandle = queueHandle;
+        m_RingSize = ringSize;
+        VkCommandPoolCreateInfo poolCreationInformation{
+                VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                nullptr,
+                VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                queueFamilyIndex
+        };
+        if (const VkResult result = vkCreateCommandPool(m_LogicalDeviceHandle, &poolCreationInformation, nullptr, &m_CommandPoolHandle);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create upload command pool"), result));
+        }
+        VkCommandBufferAllocateInfo commandBufferAllocationInformation{
+                VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                nullptr,
+                m_CommandPoolHandle,
+                VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                MAX_UPLOAD_BATCHES_IN_FLIGHT
+        };
+        if (const VkResult result = vkAllocateCommandBuffers(m_LogicalDeviceHandle, &commandBufferAllocationInformation, m_CommandBufferHandles.data());
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not allocate upload command buffers"), result));
+        }
+        VkSemaphoreTypeCreateInfo semaphoreTypeCreationInformation{
+                VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+                nullptr,
+                VK_SEMAPHORE_TYPE_TIMELINE,
+                0
+        };
+        VkSemaphoreCreateInfo semaphoreCreationInformation{
+                VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+                &semaphoreTypeCreationInformation,
+                0
+        };
+        if (const VkResult result = vkCreateSemaphore(m_LogicalDeviceHandle, &semaphoreCreationInformation, nullptr, &m_TimelineSemaphoreHandle);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create upload timeline semaphore"), result));
+        }
+        VkBufferCreateInfo bufferCreationInformation{
+                VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                nullptr,
+                0,
+                m_RingSize,
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_SHARING_MODE_EXCLUSIVE,
+                0,
+                nullptr
+        };
+        if (const VkResult result = vkCreateBuffer(m_LogicalDeviceHandle, &bufferCreationInformation, nullptr, &m_RingBufferHandle);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create staging ring buffer"), result));
+        }
+        m_RingAllocation = m_MemoryAllocator->AllocateForBuffer(m_RingBufferHandle,
+                                                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                                MemoryPoolType::PERSISTENT);
+        logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Successfully created {} MiB staging ring on queue family {}"),
+                     m_RingSize / (1024 * 1024), queueFamilyIndex);
+    }
+
+    void UploadManager::Release() {
+        if (m_LogicalDeviceHandle == VK_NULL_HANDLE) return;
+        WaitIdle();
+        vkDestroyBuffer(m_LogicalDeviceHandle, m_RingBufferHandle, nullptr);
+        m_MemoryAllocator->Free(m_RingAllocation);
+        vkDestroySemaphore(m_LogicalDeviceHandle, m_TimelineSemaphoreHandle, nullptr);
+        vkDestroyCommandPool(m_LogicalDeviceHandle, m_CommandPoolHandle, nullptr);
+        m_LogicalDeviceHandle = VK_NULL_HANDLE;
+    }
+
+    void UploadManager::Upload(const VkBuffer destinationHandle, const VkDeviceSize destinationOffset, const void* data, const VkDeviceSize size) {
+        if (size == 0) return;
+        if (size > m_RingSize) {
+            throw std::runtime_error(util::Format(FORMAT("Upload of {} bytes does not fit into the staging ring"), size));
+        }
+        uint64 position = AlignUp(m_WritePosition, STAGING_COPY_ALIGNMENT);
+        // Copies have to be contiguous, so skip the tail of the ring if the data would wrap around
+        if (position % m_RingSize + size > m_RingSize)
+            position = AlignUp(position, m_RingSize);
+        RetireCompletedBatches();
+        while (position + size - m_ReleasePosition > m_RingSize) {
+            if (m_BatchCount == 0 && m_PendingCopies.empty()) {
+                // Nothing is in use, only the skipped tail is in the way
+                m_ReleasePosition = position;
+                break;
+            }
+            // The ring is full of data that is still queued, submit it so the space can be waited on
+            if (!m_PendingCopies.empty()) Flush();
+            WaitForOldestBatch();
+        }
+        std::memcpy(static_cast<char*>(m_RingAllocation.mapping) + position % m_RingSize, data, size);
+        m_PendingCopies.push_back({destinationHandle, {position % m_RingSize, destinationOffset, size}});
+        m_WritePosition = position + size;
+        m_QueuedSize += size;
+    }
+
+    uint64 UploadManager::Flush() {
+        if (m_PendingCopies.empty()) return m_LastSubmittedValue;
+        RetireCompletedBatches();
+        if (m_BatchCount == MAX_UPLOAD_BATCHES_IN_FLIGHT) WaitForOldestBatch();
+        const uint64 timelineValue = m_LastSubmittedValue + 1;
+        const VkCommandBuffer commandBufferHandle = m_CommandBufferHandles[timelineValue % MAX_UPLOAD_BATCHES_IN_FLIGHT];
+        vkResetCommandBuffer(commandBufferHandle, 0);
+        VkCommandBufferBeginInfo beginInfo{
+                VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                nullptr,
+                VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+                nullptr
+        };
+        if (const VkResult result = vkBeginCommandBuffer(commandBufferHandle, &beginInfo); result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, failed to begin upload command buffer"), result));
+        }
+        // One copy command per destination buffer
+        std::stable_sort(m_PendingCopies.begin(), m_PendingCopies.end(), [](const PendingCopy& left, const PendingCopy& right) {
+            return left.destinationHandle < right.destinationHandle;
+        });
+        for (size_t copyIndex = 0; copyIndex < m_PendingCopies.size();) {
+            const VkBuffer destinationHandle = m_PendingCopies[copyIndex].destinationHandle;
+            m_Regions.clear();
+            for (; copyIndex < m_PendingCopies.size() && m_PendingCopies[copyIndex].destinationHandle == destinationHandle; copyIndex++)
+                m_Regions.push_back(m_PendingCopies[copyIndex].region);
+            vkCmdCopyBuffer(commandBufferHandle, m_RingBufferHandle, destinationHandle, static_cast<uint32>(m_Regions.size()), m_Regions.data());
+        }
+        if (const VkResult result = vkEndCommandBuffer(commandBufferHandle); result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, failed to end upload command buffer"), result));
+        }
+        VkTimelineSemaphoreSubmitInfo timelineSubmitInformation{
+                VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+                nullptr,
+                0, nullptr,
+                1, &timelineValue
+        };
+        VkSubmitInfo submitInfo{
+                VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                &timelineSubmitInformation,
+                0, nullptr,
+                nullptr,
+                1, &commandBufferHandle,
+                1, &m_TimelineSemaphoreHandle
+        };
+        if (const VkResult result = vkQueueSubmit(m_QueueHandle, 1, &submitInfo, VK_NULL_HANDLE); result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not submit upload batch"), result));
+        }
+        m_Batches[(m_OldestBatchIndex + m_BatchCount) % MAX_UPLOAD_BATCHES_IN_FLIGHT] = {timelineValue, m_WritePosition};
+        m_BatchCount++;
+        m_LastSubmittedValue = timelineValue;
+        m_PendingCopies.clear();
+        m_QueuedSize = 0;
+        return timelineValue;
+    }
+
+    void UploadManager::RetireCompletedBatches() {
+        uint64 completedValue;
+        vkGetSemaphoreCounterValue(m_LogicalDeviceHandle, m_TimelineSemaphoreHandle, &completedValue);
+        while (m_BatchCount > 0 && m_Batches[m_OldestBatchIndex].timelineValue <= completedValue) {
+            m_ReleasePosition = m_Batches[m_OldestBatchIndex].ringEnd;
+            m_OldestBatchIndex = (m_OldestBatchIndex + 1) % MAX_UPLOAD_BATCHES_IN_FLIGHT;
+            m_BatchCount--;
+        }
+    }
+
+    void UploadManager::WaitForOldestBatch() {
+        if (m_BatchCount == 0) return;
+        const uint64 timelineValue = m_Batches[m_OldestBatchIndex].timelineValue;
+        VkSemaphoreWaitInfo waitInformation{
+                VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+                nullptr,
+                0,
+                1, &m_TimelineSemaphoreHandle,
+                &timelineValue
+        };
+        if (const VkResult result = vkWaitSemaphores(m_LogicalDeviceHandle, &waitInformation, std::numeric_limits<uint64>::max());
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, failed waiting for upload batch"), result));
+        }
+        RetireCompletedBatches();
+    }
+
+    void UploadManager::WaitIdle() {
+        Flush();
+        while (m_BatchCount > 0) WaitForOldestBatch();
+    }
+}
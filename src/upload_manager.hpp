@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <vector>
+
+#include "type_definitions.hpp"
+#include "device_memory_allocator.hpp"
+
+#define STAGING_RING_SIZE (32ull * 1024 * 1024)
+#define MAX_UPLOAD_BATCHES_IN_FLIGHT 8
+#define STAGING_COPY_ALIGNMENT 16ull
+
+namespace voxelfield::memory {
+    /// Streams data into device local buffers through a persistently mapped staging ring. Uploads queued during a frame are recorded
+    /// and submitted together on Flush, on the dedicated transfer queue when the device has one. Every batch signals a timeline
+    /// semaphore that graphics submissions wait on, and staging space is reclaimed once the semaphore passes the batch's value,
+    /// so the graphics queue never has to stall for a copy to finish.
+    class UploadManager {
+    public:
+        void Create(VkDevice logicalDeviceHandle, DeviceMemoryAllocator& memoryAllocator, VkQueue queueHandle, uint32 queueFamilyIndex,
+                    VkDeviceSize ringSize = STAGING_RING_SIZE);
+
+        void Release();
+
+        /// Copies the data into the staging ring right away, the copy into the destination happens with the next flush
+        void Upload(VkBuffer destinationHandle, VkDeviceSize destinationOffset, const void* data, VkDeviceSize size);
+
+        /// Submits everything queued since the last flush as a single batch and returns the timeline value that marks its completion
+        uint64 Flush();
+
+        void WaitIdle();
+
+        VkSemaphore GetTimelineSemaphore() const {
+            return m_TimelineSemaphoreHandle;
+        }
+
+        uint64 GetLastSubmittedValue() const {
+            return m_LastSubmittedValue;
+        }
+
+        VkDeviceSize GetQueuedSize() const {
+            return m_QueuedSize;
+        }
+
+    private:
+        struct PendingCopy {
+            VkBuffer destinationHandle;
+            VkBufferCopy region;
+        };
+
+        struct Batch {
+            uint64 timelineValue;
+            // Virtual ring position up to which staging memory is freed once the batch completes
+            uint64 ringEnd;
+        };
+
+        VkDevice m_LogicalDeviceHandle = VK_NULL_HANDLE;
+        DeviceMemoryAllocator* m_MemoryAllocator = nullptr;
+        VkQueue m_QueueHandle = VK_NULL_HANDLE;
+        VkCommandPool m_CommandPoolHandle = VK_NULL_HANDLE;
+        std::array<VkCommandBuffer, MAX_UPLOAD_BATCHES_IN_FLIGHT> m_CommandBufferHandles{};
+        VkSemaphore m_TimelineSemaphoreHandle = VK_NULL_HANDLE;
+        VkBuffer m_RingBufferHandle = VK_NULL_HANDLE;
+        DeviceAllocation m_RingAllocation;
+        VkDeviceSize m_RingSize = 0, m_QueuedSize = 0;
+        // Positions grow forever and are wrapped with the ring size, which keeps full and empty apart
+        uint64 m_WritePosition = 0, m_ReleasePosition = 0;
+        uint64 m_LastSubmittedValue = 0;
+        std::array<Batch, MAX_UPLOAD_BATCHES_IN_FLIGHT> m_Batches{};
+        uint32 m_OldestBatchIndex = 0, m_BatchCount = 0;
+        std::vector<PendingCopy> m_PendingCopies;
+        std::vector<VkBufferCopy> m_Regions;
+
+        void RetireCompletedBatches();
+
+        void WaitForOldestBatch();
+    };
+}
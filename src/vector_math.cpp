@@ -0,0 +1,97 @@
+#include "vector_math.hpp"
+
+#include <cmath>
+
+namespace voxelfield::math {
+    Vector3 operator+(const Vector3& left, const Vector3& right) {
+        return {left.x + right.x, left.y + right.y, left.z + right.z};
+    }
+
+    Vector3 operator-(const Vector3& left, const Vector3& right) {
+        return {left.x - right.x, left.y - right.y, left.z - right.z};
+    }
+
+    Vector3 operator*(const Vector3& vector, const float scalar) {
+        return {vector.x * scalar, vector.y * scalar, vector.z * scalar};
+    }
+
+    float Dot(const Vector3& left, const Vector3& right) {
+        return left.x * right.x + left.y * right.y + left.z * right.z;
+    }
+
+    Vector3 Cross(const Vector3& left, const Vector3& right) {
+        return {left.y * right.z - left.z * right.y, left.z * right.x - left.x * right.z, left.x * right.y - left.y * right.x};
+    }
+
+    Vector3 Normalize(const Vector3& vector) {
+        const float length = std::sqrt(Dot(vector, vector));
+        return length > 0.0f ? vector * (1.0f / length) : vector;
+    }
+
+    Matrix4 Matrix4::Identity() {
+        Matrix4 identity{};
+        for (int diagonal = 0; diagonal < 4; diagonal++) identity(diagonal, diagonal) = 1.0f;
+        return identity;
+    }
+
+    Matrix4 operator*(const Matrix4& left, const Matrix4& right) {
+        Matrix4 product{};
+        for (int column = 0; column < 4; column++) {
+            for (int row = 0; row < 4; row++) {
+                float sum = 0.0f;
+                for (int index = 0; index < 4; index++) sum += left(row, index) * right(index, column);
+                product(row, column) = sum;
+            }
+        }
+        return product;
+    }
+
+    Matrix4 LookAt(const Vector3& eye, const Vector3& target, const Vector3& up) {
+        const Vector3 forward = Normalize(target - eye), side = Normalize(Cross(forward, up)), cameraUp = Cross(side, forward);
+        Matrix4 view = Matrix4::Identity();
+        view(0, 0) = side.x;
+        view(0, 1) = side.y;
+        view(0, 2) = side.z;
+        view(1, 0) = cameraUp.x;
+        view(1, 1) = cameraUp.y;
+        view(1, 2) = cameraUp.z;
+        view(2, 0) = -forward.x;
+        view(2, 1) = -forward.y;
+        view(2, 2) = -forward.z;
+        view(0, 3) = -Dot(side, eye);
+        view(1, 3) = -Dot(cameraUp, eye);
+        view(2, 3) = Dot(forward, eye);
+        return view;
+    }
+
+    Matrix4 Perspective(const float verticalFieldOfViewRadians, const float aspectRatio, const float nearPlane, const float farPlane) {
+        const float focalLength = 1.0f / std::tan(verticalFieldOfViewRadians * 0.5f);
+        Matrix4 projection{};
+        projection(0, 0) = focalLength / aspectRatio;
+        projection(1, 1) = -focalLength;
+        projection(2, 2) = farPlane / (nearPlane - farPlane);
+        projection(2, 3) = nearPlane * farPlane / (nearPlane - farPlane);
+        projection(3, 2) = -1.0f;
+        return projection;
+    }
+
+    std::array<Vector4, 6> ExtractFrustumPlanes(const Matrix4& viewProjection) {
+        const auto row = [&](const int index) {
+            return Vector4{viewProjection(index, 0), viewProjection(index, 1), viewProjection(index, 2), viewProjection(index, 3)};
+        };
+        const auto add = [](const Vector4& left, const Vector4& right, const float sign) {
+            return Vector4{left.x + sign * right.x, left.y + sign * right.y, left.z + sign * right.z, left.w + sign * right.w};
+        };
+        const Vector4 firstRow = row(0), secondRow = row(1), thirdRow = row(2), fourthRow = row(3);
+        std::array<Vector4, 6> planes{
+                add(fourthRow, firstRow, 1.0f), add(fourthRow, firstRow, -1.0f),
+                add(fourthRow, secondRow, 1.0f), add(fourthRow, secondRow, -1.0f),
+                thirdRow, add(fourthRow, thirdRow, -1.0f)
+        };
+        for (Vector4& plane : planes) {
+            const float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+            if (length > 0.0f) plane = {plane.x / length, plane.y / length, plane.z / length, plane.w / length};
+        }
+        return planes;
+    }
+}
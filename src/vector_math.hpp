@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+
+namespace voxelfield::math {
+    struct Vector3 {
+        float x, y, z;
+    };
+
+    Vector3 operator+(const Vector3& left, const Vector3& right);
+
+    Vector3 operator-(const Vector3& left, const Vector3& right);
+
+    Vector3 operator*(const Vector3& vector, float scalar);
+
+    float Dot(const Vector3& left, const Vector3& right);
+
+    Vector3 Cross(const Vector3& left, const Vector3& right);
+
+    Vector3 Normalize(const Vector3& vector);
+
+    struct Vector4 {
+        float x, y, z, w;
+    };
+
+    /// Column-major like GLSL, so it can be pushed to shaders as is
+    struct Matrix4 {
+        std::array<float, 16> elements;
+
+        float& operator()(int row, int column) {
+            return elements[column * 4 + row];
+        }
+
+        float operator()(int row, int column) const {
+            return elements[column * 4 + row];
+        }
+
+        static Matrix4 Identity();
+    };
+
+    Matrix4 operator*(const Matrix4& left, const Matrix4& right);
+
+    /// Right-handed view looking from the eye towards the target
+    Matrix4 LookAt(const Vector3& eye, const Vector3& target, const Vector3& up);
+
+    /// Maps depth to the zero to one range Vulkan uses and flips Y since Vulkan clip space points down
+    Matrix4 Perspective(float verticalFieldOfViewRadians, float aspectRatio, float nearPlane, float farPlane);
+
+    /// Left, right, bottom, top, near and far planes of a view projection with zero to one depth. Normals point inwards and are
+    /// normalized, so a point is inside when the dot product with every plane plus its w is positive.
+    std::array<Vector4, 6> ExtractFrustumPlanes(const Matrix4& viewProjection);
+}
@@ -1 +1,57 @@
 #include "vertex.hpp"
+
+#include <cstddef>
+
+namespace voxelfield::rendering {
+    VkVertexInputBindingDescription ChunkVertex::GetBindingDescription(const uint32 binding) {
+        return {binding, sizeof(ChunkVertex), VK_VERTEX_INPUT_RATE_VERTEX};
+    }
+
+    std::array<VkVertexInputAttributeDescription, 2> ChunkVertex::GetAttributeDescriptions(const uint32 binding) {
+        return {
+                VkVertexInputAttributeDescription{0, binding, VK_FORMAT_R32_UINT, offsetof(ChunkVertex, positionData)},
+                VkVertexInputAttributeDescription{1, binding, VK_FORMAT_R32_UINT, offsetof(ChunkVertex, materialData)}
+        };
+    }
+
+    ChunkVertex PackChunkVertex(const uint32 x, const uint32 y, const uint32 z, const FaceDirection face, const uint16 material,
+                                const uint32 ambientOcclusion) {
+        return {
+                (x & MAX_CHUNK_VERTEX_COORDINATE) |
+                (y & MAX_CHUNK_VERTEX_COORDINATE) << CHUNK_VERTEX_Y_SHIFT |
+                (z & MAX_CHUNK_VERTEX_COORDINATE) << CHUNK_VERTEX_Z_SHIFT |
+                static_cast<uint32>(face) << CHUNK_VERTEX_NORMAL_SHIFT |
+                (ambientOcclusion & MAX_AMBIENT_OCCLUSION_LEVEL) << CHUNK_VERTEX_AMBIENT_OCCLUSION_SHIFT,
+                material
+        };
+    }
+
+    void AppendVoxelFace(std::vector<ChunkVertex>& vertices, std::vector<uint32>& indices, const uint32 x, const uint32 y, const uint32 z,
+                         const FaceDirection face, const uint16 material) {
+        AppendVoxelQuad(vertices, indices, x, y, z, 1, 1, 1, face, material);
+    }
+
+    void AppendVoxelQuad(std::vector<ChunkVertex>& vertices, std::vector<uint32>& indices, const uint32 x, const uint32 y, const uint32 z,
+                         const uint32 sizeX, const uint32 sizeY, const uint32 sizeZ, const FaceDirection face, const uint16 material) {
+        // Corner offsets per face, in counter-clockwise order when looking at the face from outside the voxel
+        static const uint8 faceCorners[6][4][3]{
+                {{1, 0, 0}, {1, 1, 0}, {1, 1, 1}, {1, 0, 1}},
+                {{0, 0, 0}, {0, 0, 1}, {0, 1, 1}, {0, 1, 0}},
+                {{0, 1, 0}, {0, 1, 1}, {1, 1, 1}, {1, 1, 0}},
+                {{0, 0, 0}, {1, 0, 0}, {1, 0, 1}, {0, 0, 1}},
+                {{0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}},
+                {{0, 0, 0}, {0, 1, 0}, {1, 1, 0}, {1, 0, 0}}
+        };
+        static const uint32 quadIndices[6]{0, 1, 2, 2, 3, 0};
+        // Meshers append thousands of quads, growing once and writing in place beats a push per element
+        const size_t firstVertex = vertices.size(), firstIndex = indices.size();
+        vertices.resize(firstVertex + 4);
+        indices.resize(firstIndex + 6);
+        ChunkVertex* quadVertices = &vertices[firstVertex];
+        for (const auto& corner : faceCorners[static_cast<uint8>(face)])
+            *quadVertices++ = PackChunkVertex(x + corner[0] * sizeX, y + corner[1] * sizeY, z + corner[2] * sizeZ, face, material,
+                                              MAX_AMBIENT_OCCLUSION_LEVEL);
+        for (uint32 index = 0; index < 6; index++)
+            indices[firstIndex + index] = static_cast<uint32>(firstVertex) + quadIndices[index];
+    }
+}
@@ -1,5 +1,55 @@
 #pragma once
 
-struct vertex {
-    double x, y, z;
-};
\ No newline at end of file
+#include <vulkan/vulkan.h>
+#include <array>
+#include <vector>
+
+#include "type_definitions.hpp"
+#include "vector_math.hpp"
+
+// Layout of ChunkVertex::positionData, positions are corners relative to the chunk so they run from zero to the chunk size inclusive
+#define CHUNK_VERTEX_POSITION_BITS 6
+#define CHUNK_VERTEX_Y_SHIFT 6
+#define CHUNK_VERTEX_Z_SHIFT 12
+#define CHUNK_VERTEX_NORMAL_SHIFT 18
+#define CHUNK_VERTEX_AMBIENT_OCCLUSION_SHIFT 21
+#define MAX_CHUNK_VERTEX_COORDINATE ((1u << CHUNK_VERTEX_POSITION_BITS) - 1u)
+#define MAX_AMBIENT_OCCLUSION_LEVEL 3u
+
+namespace voxelfield::rendering {
+    // Order matters, shader.vert indexes its normal table with it
+    enum class FaceDirection : uint8 {
+        POSITIVE_X, NEGATIVE_X, POSITIVE_Y, NEGATIVE_Y, POSITIVE_Z, NEGATIVE_Z
+    };
+
+    /// Voxel mesh vertex packed into two words. The first holds the position, face direction and two bits of ambient occlusion,
+    /// the second the material in its low half with the high half left free. Decoded in shader.vert.
+    struct ChunkVertex {
+        uint32 positionData, materialData;
+
+        static VkVertexInputBindingDescription GetBindingDescription(uint32 binding = 0);
+
+        static std::array<VkVertexInputAttributeDescription, 2> GetAttributeDescriptions(uint32 binding = 0);
+    };
+
+    static_assert(sizeof(ChunkVertex) == 8, "Chunk vertices are expected to stay packed");
+
+    struct VertexRange {
+        uint32 first, count;
+    };
+
+    ChunkVertex PackChunkVertex(uint32 x, uint32 y, uint32 z, FaceDirection face, uint16 material, uint32 ambientOcclusion);
+
+    /// Appends the two triangles of a unit face of the voxel at the given position, wound counter-clockwise seen from outside
+    void AppendVoxelFace(std::vector<ChunkVertex>& vertices, std::vector<uint32>& indices, uint32 x, uint32 y, uint32 z, FaceDirection face,
+                         uint16 material);
+
+    /// Appends one face spanning several voxels from the given position, the size along the face normal has to be one
+    void AppendVoxelQuad(std::vector<ChunkVertex>& vertices, std::vector<uint32>& indices, uint32 x, uint32 y, uint32 z, uint32 sizeX,
+                         uint32 sizeY, uint32 sizeZ, FaceDirection face, uint16 material);
+
+    /// Matches the push constant block in shader.vert, chunk origins come from the chunk records instead
+    struct ChunkPushConstants {
+        math::Matrix4 viewProjection;
+    };
+}
@@ -0,0 +1,229 @@
+#include "virtual_file_system.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
+
+#include "compression.hpp"
+#include "logger.hpp"
+#include "string_util.hpp"
+#include "sub_allocator.hpp"
+
+namespace voxelfield::file {
+    namespace {
+        constexpr uint64 FNV_OFFSET_BASIS = 14695981039346656037ull, FNV_PRIME = 1099511628211ull;
+
+        bool IsEntryBefore(const ArchiveEntry& entry, const uint64 pathHash) {
+            return entry.pathHash < pathHash;
+        }
+
+        struct PackedFile {
+            std::string path;
+            std::vector<uint8> data;
+            uint32 size;
+            bool isCompressed;
+        };
+
+        void Write(File* file, const void* data, const size_t size, const std::string& archiveName) {
+            if (size > 0 && std::fwrite(data, size, 1, file) != 1) {
+                std::fclose(file);
+                throw std::runtime_error(util::Format(FORMAT("Could not write archive with name {}"), archiveName));
+            }
+        }
+    }
+
+    uint64 HashPath(const std::string_view path) {
+        uint64 hash = FNV_OFFSET_BASIS;
+        for (const char character : path) {
+            hash ^= static_cast<uint8>(character);
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+
+    FileData FileData::FromView(const uint8* data, const size_t size) {
+        FileData fileData;
+        fileData.m_Data = data;
+        fileData.m_Size = size;
+        return fileData;
+    }
+
+    FileData FileData::FromBuffer(std::vector<uint8> buffer) {
+        FileData fileData;
+        fileData.m_Buffer = std::move(buffer);
+        fileData.m_Data = fileData.m_Buffer.data();
+        fileData.m_Size = fileData.m_Buffer.size();
+        return fileData;
+    }
+
+    FileData FileData::FromMapping(MappedFile mapping) {
+        FileData fileData;
+        fileData.m_Mapping = std::move(mapping);
+        fileData.m_Data = fileData.m_Mapping.GetData();
+        fileData.m_Size = fileData.m_Mapping.GetSize();
+        return fileData;
+    }
+
+    DirectoryMount::DirectoryMount(std::string directory) : m_Directory(std::move(directory)) {
+    }
+
+    std::string DirectoryMount::GetFileName(const std::string_view path) const {
+        return (std::filesystem::path(m_Directory) / std::filesystem::path(path)).string();
+    }
+
+    bool DirectoryMount::Read(const std::string_view path, FileData& data) const {
+        const std::string fileName = GetFileName(path);
+        std::error_code error;
+        if (!std::filesystem::is_regular_file(fileName, error)) return false;
+        // Mapping takes a single open and size query, and the pages are only read when the asset is used
+        data = FileData::FromMapping(MappedFile(fileName));
+        return true;
+    }
+
+    bool DirectoryMount::Contains(const std::string_view path) const {
+        std::error_code error;
+        return std::filesystem::is_regular_file(GetFileName(path), error);
+    }
+
+    ArchiveMount::ArchiveMount(const std::string& fileName) : m_FileName(fileName), m_View(fileName) {
+        const uint64 fileSize = m_View.GetSize();
+        if (fileSize < sizeof(ArchiveHeader))
+            throw std::runtime_error(util::Format(FORMAT("File with name {} is too small to be an archive"), m_FileName));
+        ArchiveHeader header;
+        std::memcpy(&header, m_View.GetData(), sizeof(ArchiveHeader));
+        if (header.magic != ARCHIVE_MAGIC || header.version != ARCHIVE_VERSION)
+            throw std::runtime_error(util::Format(FORMAT("File with name {} is not a version {} archive"), m_FileName, ARCHIVE_VERSION));
+        const uint64 namesOffset = sizeof(ArchiveHeader) + static_cast<uint64>(header.entryCount) * sizeof(ArchiveEntry);
+        if (namesOffset + header.namesSize > fileSize)
+            throw std::runtime_error(util::Format(FORMAT("Archive with name {} has a table outside of the file"), m_FileName));
+        // The mapping starts on a page and the header keeps the table after it aligned
+        m_Entries = reinterpret_cast<const ArchiveEntry*>(m_View.GetData() + sizeof(ArchiveHeader));
+        m_Names = reinterpret_cast<const char*>(m_View.GetData() + namesOffset);
+        m_EntryCount = header.entryCount;
+        for (uint32 entryIndex = 0; entryIndex < m_EntryCount; entryIndex++) {
+            const ArchiveEntry& entry = m_Entries[entryIndex];
+            // Offsets are compared against what is left of the file so a huge offset cannot wrap around the sum. Uncompressed
+            // entries are read as they are stored, so both sizes have to agree.
+            if (entry.offset > fileSize || entry.storedSize > fileSize - entry.offset || (!entry.isCompressed && entry.size != entry.storedSize)
+                || static_cast<uint64>(entry.nameOffset) + entry.nameLength > header.namesSize
+                || (entryIndex > 0 && m_Entries[entryIndex - 1].pathHash > entry.pathHash))
+                throw std::runtime_error(util::Format(FORMAT("Archive with name {} has a corrupt table"), m_FileName));
+        }
+    }
+
+    const ArchiveEntry* ArchiveMount::Find(const std::string_view path) const {
+        const uint64 pathHash = HashPath(path);
+        const ArchiveEntry* end = m_Entries + m_EntryCount;
+        for (const ArchiveEntry* entry = std::lower_bound(m_Entries, end, pathHash, IsEntryBefore);
+             entry != end && entry->pathHash == pathHash; entry++)
+            if (std::string_view(m_Names + entry->nameOffset, entry->nameLength) == path) return entry;
+        return nullptr;
+    }
+
+    bool ArchiveMount::Read(const std::string_view path, FileData& data) const {
+        const ArchiveEntry* entry = Find(path);
+        if (!entry) return false;
+        const uint8* storedData = m_View.GetData() + entry->offset;
+        if (!entry->isCompressed) {
+            data = FileData::FromView(storedData, entry->size);
+            return true;
+        }
+        std::vector<uint8> buffer(entry->size);
+        if (!compression::Decompress(storedData, entry->storedSize, buffer.data(), buffer.size()))
+            throw std::runtime_error(util::Format(FORMAT("Entry {} of archive with name {} is corrupt"), path, m_FileName));
+        data = FileData::FromBuffer(std::move(buffer));
+        return true;
+    }
+
+    bool ArchiveMount::Contains(const std::string_view path) const {
+        return Find(path) != nullptr;
+    }
+
+    void VirtualFileSystem::MountPath(const std::string& path) {
+        if (std::filesystem::is_directory(path)) {
+            AddMount(std::make_unique<DirectoryMount>(path));
+            logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Mounted directory {}"), path);
+        } else {
+            auto archive = std::make_unique<ArchiveMount>(path);
+            logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Mounted archive {} with {} entries"), path, archive->GetEntryCount());
+            AddMount(std::move(archive));
+        }
+    }
+
+    void VirtualFileSystem::AddMount(std::unique_ptr<Mount> mount) {
+        m_Mounts.push_back(std::move(mount));
+    }
+
+    FileData VirtualFileSystem::Read(const std::string_view path) const {
+        FileData data;
+        for (const auto& mount : m_Mounts)
+            if (mount->Read(path, data)) return data;
+        throw std::runtime_error(util::Format(FORMAT("Could not find file {} in any of {} mounts"), path, m_Mounts.size()));
+    }
+
+    bool VirtualFileSystem::Contains(const std::string_view path) const {
+        return std::any_of(m_Mounts.begin(), m_Mounts.end(), [&](const auto& mount) { return mount->Contains(path); });
+    }
+
+    void PackDirectory(const std::string& directory, const std::string& archiveName, const bool isCompressing) {
+        std::vector<PackedFile> files;
+        std::error_code error;
+        for (const auto& directoryEntry : std::filesystem::recursive_directory_iterator(directory)) {
+            // An archive written into the directory it packs is left out of the next one
+            if (!directoryEntry.is_regular_file() || std::filesystem::equivalent(directoryEntry.path(), archiveName, error)) continue;
+            PackedFile& file = files.emplace_back();
+            file.path = directoryEntry.path().lexically_relative(directory).generic_string();
+            const MappedFile mapping(directoryEntry.path().string());
+            if (file.path.size() > UINT16_MAX || mapping.GetSize() > UINT32_MAX)
+                throw std::runtime_error(util::Format(FORMAT("File {} is too large to pack"), file.path));
+            file.size = static_cast<uint32>(mapping.GetSize());
+            file.isCompressed = false;
+            if (isCompressing && file.size > 0) {
+                file.data.resize(compression::GetMaxCompressedSize(file.size));
+                const size_t compressedSize = compression::Compress(mapping.GetData(), file.size, file.data.data());
+                // Entries that do not shrink stay uncompressed, so they can be read in place
+                file.isCompressed = compressedSize < file.size;
+                file.data.resize(compressedSize);
+            }
+            if (!file.isCompressed) file.data.assign(mapping.GetData(), mapping.GetData() + file.size);
+        }
+        std::sort(files.begin(), files.end(), [](const PackedFile& left, const PackedFile& right) {
+            const uint64 leftHash = HashPath(left.path), rightHash = HashPath(right.path);
+            return leftHash != rightHash ? leftHash < rightHash : left.path < right.path;
+        });
+        std::vector<ArchiveEntry> entries(files.size());
+        std::string names;
+        for (size_t fileIndex = 0; fileIndex < files.size(); fileIndex++) {
+            const PackedFile& packedFile = files[fileIndex];
+            entries[fileIndex] = {HashPath(packedFile.path), 0, static_cast<uint32>(packedFile.data.size()), packedFile.size,
+                                  static_cast<uint32>(names.size()), static_cast<uint16>(packedFile.path.size()), packedFile.isCompressed};
+            names += packedFile.path;
+        }
+        // Data follows the table and names, in table order
+        const uint64 dataOffset = sizeof(ArchiveHeader) + entries.size() * sizeof(ArchiveEntry) + names.size();
+        uint64 offset = dataOffset;
+        for (ArchiveEntry& entry : entries) {
+            entry.offset = offset = memory::AlignUp(offset, ARCHIVE_ALIGNMENT);
+            offset += entry.storedSize;
+        }
+        File* file = std::fopen(archiveName.c_str(), "wb");
+        if (!file) throw std::runtime_error(util::Format(FORMAT("Could not create archive with name {}"), archiveName));
+        const ArchiveHeader header{ARCHIVE_MAGIC, ARCHIVE_VERSION, static_cast<uint32>(entries.size()), static_cast<uint32>(names.size())};
+        Write(file, &header, sizeof(ArchiveHeader), archiveName);
+        Write(file, entries.data(), entries.size() * sizeof(ArchiveEntry), archiveName);
+        Write(file, names.data(), names.size(), archiveName);
+        uint64 position = dataOffset;
+        const uint8 padding[ARCHIVE_ALIGNMENT]{};
+        for (size_t fileIndex = 0; fileIndex < files.size(); fileIndex++) {
+            Write(file, padding, entries[fileIndex].offset - position, archiveName);
+            Write(file, files[fileIndex].data.data(), files[fileIndex].data.size(), archiveName);
+            position = entries[fileIndex].offset + entries[fileIndex].storedSize;
+        }
+        if (std::fclose(file) != 0) throw std::runtime_error(util::Format(FORMAT("Could not write archive with name {}"), archiveName));
+        logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Packed {} files into archive {} of {} bytes"), files.size(), archiveName,
+                     position);
+    }
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mapped_file.hpp"
+#include "type_definitions.hpp"
+
+// Spells VFA1 in the first bytes of the file
+#define ARCHIVE_MAGIC 0x31414656u
+#define ARCHIVE_VERSION 1u
+// Entries start on this boundary, so mapped assets can be read as any type up to a cache line
+#define ARCHIVE_ALIGNMENT 64u
+// Archive mounted by default when it is in the working directory
+#define ASSET_ARCHIVE_FILE_NAME "assets.vfa"
+
+namespace voxelfield::file {
+    struct ArchiveHeader {
+        uint32 magic;
+        uint32 version;
+        uint32 entryCount;
+        uint32 namesSize;
+    };
+
+    /// Where an asset lies in its archive. The table follows the header sorted by path hash, then by path for the rare collision,
+    /// and the paths follow the table.
+    struct ArchiveEntry {
+        uint64 pathHash;
+        uint64 offset;
+        // Bytes in the archive, the same as the size unless the entry is compressed
+        uint32 storedSize;
+        uint32 size;
+        uint32 nameOffset;
+        uint16 nameLength;
+        uint16 isCompressed;
+    };
+
+    static_assert(sizeof(ArchiveEntry) == 32, "Archive entries are written as they are laid out in memory");
+
+    /// Contents of a file. Points straight into a mapping for uncompressed archive entries and loose files, and at a buffer it owns
+    /// for compressed entries.
+    class FileData {
+    public:
+        FileData() = default;
+
+        FileData(const FileData&) = delete;
+
+        FileData& operator=(const FileData&) = delete;
+
+        FileData(FileData&& other) noexcept = default;
+
+        FileData& operator=(FileData&& other) noexcept = default;
+
+        static FileData FromView(const uint8* data, size_t size);
+
+        static FileData FromBuffer(std::vector<uint8> buffer);
+
+        static FileData FromMapping(MappedFile mapping);
+
+        const uint8* GetData() const {
+            return m_Data;
+        }
+
+        size_t GetSize() const {
+            return m_Size;
+        }
+
+        /// Whether the data was used where it lies instead of being copied or decompressed
+        bool IsZeroCopy() const {
+            return m_Buffer.empty();
+        }
+
+    private:
+        const uint8* m_Data = nullptr;
+        size_t m_Size = 0;
+        std::vector<uint8> m_Buffer;
+        MappedFile m_Mapping;
+    };
+
+    /// Source of files under virtual paths, which are relative and separated by forward slashes
+    class Mount {
+    public:
+        virtual ~Mount() = default;
+
+        /// Returns false when the mount has no file at the path, throws when it has one that can not be read
+        virtual bool Read(std::string_view path, FileData& data) const = 0;
+
+        virtual bool Contains(std::string_view path) const = 0;
+    };
+
+    /// Loose files of a directory, for development. Every read maps the file, so it is seen as it is on disk now.
+    class DirectoryMount : public Mount {
+    public:
+        explicit DirectoryMount(std::string directory);
+
+        bool Read(std::string_view path, FileData& data) const override;
+
+        bool Contains(std::string_view path) const override;
+
+    private:
+        std::string m_Directory;
+
+        std::string GetFileName(std::string_view path) const;
+    };
+
+    /// Packed archive mapped once when mounted. Finding an asset is a binary search of the table by path hash and reading an
+    /// uncompressed one hands out a view into the mapping.
+    class ArchiveMount : public Mount {
+    public:
+        /// Throws when the file is not an archive or its table points outside of it
+        explicit ArchiveMount(const std::string& fileName);
+
+        bool Read(std::string_view path, FileData& data) const override;
+
+        bool Contains(std::string_view path) const override;
+
+        uint32 GetEntryCount() const {
+            return m_EntryCount;
+        }
+
+    private:
+        std::string m_FileName;
+        MappedFile m_View;
+        const ArchiveEntry* m_Entries = nullptr;
+        const char* m_Names = nullptr;
+        uint32 m_EntryCount = 0;
+
+        const ArchiveEntry* Find(std::string_view path) const;
+    };
+
+    /// Reads assets by virtual path from the first mount that has them, in the order they were mounted
+    class VirtualFileSystem {
+    public:
+        /// Mounts an archive file, or a directory of loose files
+        void MountPath(const std::string& path);
+
+        void AddMount(std::unique_ptr<Mount> mount);
+
+        /// Throws when no mount has the file
+        FileData Read(std::string_view path) const;
+
+        bool Contains(std::string_view path) const;
+
+        size_t GetMountCount() const {
+            return m_Mounts.size();
+        }
+
+    private:
+        std::vector<std::unique_ptr<Mount>> m_Mounts;
+    };
+
+    /// Hash of a virtual path that archives are sorted by
+    uint64 HashPath(std::string_view path);
+
+    /// Packs every file under the directory into an archive, named by their paths relative to it. Entries are compressed when asked
+    /// to and it makes them smaller, compressed entries are decompressed on every read.
+    void PackDirectory(const std::string& directory, const std::string& archiveName, bool isCompressing);
+}
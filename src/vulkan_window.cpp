@@ -2,39 +2,56 @@
 
 #include <limits>
 #include <bitset>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
 
-#include "vertex.hpp"
 
 namespace voxelfield::window {
 #ifdef VALIDATION_LAYERS_ENABLED
 
     VkBool32 VulkanWindow::DebugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType,
                                          const VkDebugUtilsMessengerCallbackDataEXT* callbackData, void* userData) {
-        logging::Log(
-                messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT ? logging::LogType::ERROR_LOG : logging::LogType::INFORMATION_LOG,
-                util::Format("[Vulkan Validation Layer][Severity %d] %s", MAX_MESSAGE_LENGTH, messageSeverity, callbackData->pMessage));
+        logging::Log(messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT ? logging::LogType::ERROR_LOG : logging::LogType::INFORMATION_LOG,
+                     FORMAT("[Vulkan Validation Layer][Severity {}] {}"), messageSeverity, callbackData->pMessage);
         return VK_FALSE;
     }
 
 #endif
 
-    VulkanWindow::VulkanWindow(Application& application, const std::string& title) : Window(application, title),
-                                                                                     m_RequiredDeviceExtensions({
-                                                                                                                        VK_KHR_SWAPCHAIN_EXTENSION_NAME
-                                                                                                                }),
-                                                                                     m_RequiredExtensions({
-                                                                                                                  VK_KHR_SURFACE_EXTENSION_NAME,
-                                                                                                                  VK_KHR_WIN32_SURFACE_EXTENSION_NAME
+    VulkanWindow::VulkanWindow(Application& application, const std::string& title, jobs::JobSystem& jobSystem,
+                               const file::VirtualFileSystem& fileSystem, const rendering::FramePacingOptions& framePacingOptions,
+                               const std::optional<HeadlessOptions>& headlessOptions)
+            : Window(application, title, jobSystem),
 #ifdef VALIDATION_LAYERS_ENABLED
-                                                                                                                  ,
-                                                                                                                  VK_EXT_DEBUG_UTILS_EXTENSION_NAME
+              m_ValidationLayers({"VK_LAYER_LUNARG_standard_validation"}),
+#endif
+              m_FileSystem(fileSystem),
+              m_HeadlessOptions(headlessOptions),
+              m_FramePacingOptions(framePacingOptions),
+              m_RequiredExtensions(GetRequiredExtensions(headlessOptions.has_value())),
+              m_RequiredDeviceExtensions(headlessOptions.has_value()
+                                         ? std::vector<const char*>{}
+                                         : std::vector<const char*>{VK_KHR_SWAPCHAIN_EXTENSION_NAME}),
+              m_ChunkMeshingPipeline(jobSystem) {
+        CreateVulkanInstance();
+    }
+
+    std::vector<const char*> VulkanWindow::GetRequiredExtensions(const bool isHeadless) {
+        std::vector<const char*> requiredExtensions;
+#ifdef VK_USE_PLATFORM_WIN32_KHR
+        if (!isHeadless) {
+            requiredExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+            requiredExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+        }
 #endif
-                                                                                                          })
 #ifdef VALIDATION_LAYERS_ENABLED
-            , m_ValidationLayers({"VK_LAYER_LUNARG_standard_validation"})
+        requiredExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 #endif
-    {
-        CreateVulkanInstance();
+        return requiredExtensions;
     }
 
     VulkanWindow::~VulkanWindow() {
@@ -43,63 +60,128 @@ namespace voxelfield::window {
 
     void VulkanWindow::ReleaseSwapChain() {
         vkDeviceWaitIdle(m_LogicalDeviceHandle);
+        ReleaseRetiredSwapChains(true);
         for (auto framebuffer : m_SwapChainFramebufferHandles)
             vkDestroyFramebuffer(m_LogicalDeviceHandle, framebuffer, nullptr);
-        vkFreeCommandBuffers
-                (m_LogicalDeviceHandle, m_CommandPoolHandle, static_cast<uint32>(m_CommandBufferHandles.size()), m_CommandBufferHandles.data());
-        vkDestroyPipeline(m_LogicalDeviceHandle, m_Pipeline, nullptr);
-        vkDestroyPipelineLayout(m_LogicalDeviceHandle, m_PipelineLayoutHandle, nullptr);
+        vkDestroyFramebuffer(m_LogicalDeviceHandle, m_DepthPrepassFramebufferHandle, nullptr);
+        vkDestroyImageView(m_LogicalDeviceHandle, m_DepthImageViewHandle, nullptr);
+        vkDestroyImage(m_LogicalDeviceHandle, m_DepthImageHandle, nullptr);
+        m_MemoryAllocator.Free(m_DepthImageAllocation);
+        vkDestroyRenderPass(m_LogicalDeviceHandle, m_DepthPrepassRenderPassHandle, nullptr);
         vkDestroyRenderPass(m_LogicalDeviceHandle, m_RenderPassHandle, nullptr);
         for (auto imageViewHandle : m_SwapchainImageViewHandles)
             vkDestroyImageView(m_LogicalDeviceHandle, imageViewHandle, nullptr);
-        vkDestroySwapchainKHR(m_LogicalDeviceHandle, m_SwapchainHandle, nullptr);
+        if (IsHeadless())
+            ReleaseOffscreenTargets();
+        else
+            vkDestroySwapchainKHR(m_LogicalDeviceHandle, m_SwapchainHandle, nullptr);
+    }
+
+    void VulkanWindow::ReleaseRetiredSwapChains(const bool isForced) {
+        TRACE_ZONE("VulkanWindow::ReleaseRetiredSwapChains");
+        // A frame's fence has been waited on by the time its slot comes around again, so after that many frames nothing refers to the old resources
+        auto retiredEnd = std::remove_if(m_RetiredSwapchains.begin(), m_RetiredSwapchains.end(), [&](RetiredSwapchain& retired) {
+            if (!isForced && m_FrameNumber < retired.retiredFrameNumber + m_FramePacingSettings.framesInFlight) return false;
+            for (auto framebufferHandle : retired.framebufferHandles)
+                vkDestroyFramebuffer(m_LogicalDeviceHandle, framebufferHandle, nullptr);
+            for (auto imageViewHandle : retired.imageViewHandles)
+                vkDestroyImageView(m_LogicalDeviceHandle, imageViewHandle, nullptr);
+            vkDestroyFramebuffer(m_LogicalDeviceHandle, retired.depthPrepassFramebufferHandle, nullptr);
+            vkDestroyImageView(m_LogicalDeviceHandle, retired.depthImageViewHandle, nullptr);
+            vkDestroyImage(m_LogicalDeviceHandle, retired.depthImageHandle, nullptr);
+            m_MemoryAllocator.Free(retired.depthImageAllocation);
+            vkDestroySwapchainKHR(m_LogicalDeviceHandle, retired.handle, nullptr);
+            return true;
+        });
+        m_RetiredSwapchains.erase(retiredEnd, m_RetiredSwapchains.end());
+    }
+
+    void VulkanWindow::ReleaseOffscreenTargets() {
+        for (size_t targetIndex = 0; targetIndex < m_SwapchainImageHandles.size(); targetIndex++) {
+            vkDestroyImage(m_LogicalDeviceHandle, m_SwapchainImageHandles[targetIndex], nullptr);
+            m_MemoryAllocator.Free(m_OffscreenImageAllocations[targetIndex]);
+        }
+        for (size_t targetIndex = 0; targetIndex < m_ReadbackBufferHandles.size(); targetIndex++) {
+            vkDestroyBuffer(m_LogicalDeviceHandle, m_ReadbackBufferHandles[targetIndex], nullptr);
+            m_MemoryAllocator.Free(m_ReadbackBufferAllocations[targetIndex]);
+        }
+        m_SwapchainImageHandles.clear();
+        m_OffscreenImageAllocations.clear();
+        m_ReadbackBufferHandles.clear();
+        m_ReadbackBufferAllocations.clear();
     }
 
     void VulkanWindow::Release() {
         ReleaseSwapChain();
-        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        for (size_t i = 0; i < m_InFlightFenceHandles.size(); i++) {
             vkDestroySemaphore(m_LogicalDeviceHandle, m_RenderFinishedSemaphoreHandles[i], nullptr);
             vkDestroySemaphore(m_LogicalDeviceHandle, m_ImageAvailableSemaphoreHandles[i], nullptr);
             vkDestroyFence(m_LogicalDeviceHandle, m_InFlightFenceHandles[i], nullptr);
         }
-        vkDestroyCommandPool(m_LogicalDeviceHandle, m_CommandPoolHandle, nullptr);
+        m_GpuProfiler.Release();
+        m_HiZPyramid.Release();
+        m_ChunkRenderer.Release();
+        m_PipelineRegistry.Release();
+        m_UploadManager.Release();
+        m_MemoryAllocator.LogStatistics();
+        m_MemoryAllocator.Release();
+        m_CommandRecorder.Release();
         vkDestroyDevice(m_LogicalDeviceHandle, nullptr);
 #ifdef VALIDATION_LAYERS_ENABLED
         auto destroyFunction = reinterpret_cast<PFN_vkDestroyDebugUtilsMessengerEXT>(vkGetInstanceProcAddr(m_VulkanInstanceHandle,
                                                                                                            "vkDestroyDebugUtilsMessengerEXT"));
         if (destroyFunction) destroyFunction(m_VulkanInstanceHandle, m_DebugCallback, nullptr);
 #endif
-        vkDestroySurfaceKHR(m_VulkanInstanceHandle, m_SurfaceHandle, nullptr);
+        if (m_SurfaceHandle != VK_NULL_HANDLE)
+            vkDestroySurfaceKHR(m_VulkanInstanceHandle, m_SurfaceHandle, nullptr);
         vkDestroyInstance(m_VulkanInstanceHandle, nullptr);
     }
 
     void VulkanWindow::Open() {
-        Window::Open();
-        CreateSurface();
+        TRACE_ZONE("VulkanWindow::Open");
+        if (!IsHeadless()) {
+            Window::Open();
+            CreateSurface();
+        }
         SelectPhysicalDevice();
         CreateLogicalDevice();
-        CreateSwapChain();
+        ConfigureFramePacing();
+        m_MemoryAllocator.Create(m_PhysicalDevice.handle, m_LogicalDeviceHandle, m_PhysicalDevice.deviceProperties.limits);
+        m_UploadManager.Create(m_LogicalDeviceHandle, m_MemoryAllocator, m_TransferQueueHandle, m_QueueFamilyIndices.transferFamilyIndex);
+        m_PipelineRegistry.Create(m_LogicalDeviceHandle, m_PhysicalDevice.deviceProperties, m_FileSystem);
+        CreateGpuProfiler();
+        m_HiZPyramid.Create(m_LogicalDeviceHandle, m_MemoryAllocator, m_PipelineRegistry, m_FramePacingSettings.framesInFlight);
+        m_ChunkRenderer.Create(m_LogicalDeviceHandle, m_MemoryAllocator, m_UploadManager, m_PipelineRegistry,
+                               {m_QueueFamilyIndices.graphicsFamilyIndex, m_QueueFamilyIndices.transferFamilyIndex},
+                               m_FramePacingSettings.framesInFlight);
+        if (IsHeadless())
+            CreateOffscreenTargets();
+        else
+            CreateSwapChain();
         CreateImageViews();
         CreateRenderPass();
         CreateGraphicsPipeline();
+        CreateDepthResources();
         CreateFramebuffers();
-        CreateCommandPool();
-        CreateCommandBuffers();
+        m_CommandRecorder.Create(m_LogicalDeviceHandle, m_QueueFamilyIndices.graphicsFamilyIndex, m_FramePacingSettings.framesInFlight);
+        CreateTerrainChunks();
         CreateSynchronizationObjects();
     }
 
     void VulkanWindow::CreateVulkanInstance() {
+        TRACE_ZONE("VulkanWindow::CreateVulkanInstance");
 #ifdef VALIDATION_LAYERS_ENABLED
         uint32 layerCount;
         vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
-        std::vector<VkLayerProperties> availableLayerProperties(layerCount);
+        memory::ScratchScope scratch;
+        memory::ArenaVector<VkLayerProperties> availableLayerProperties(layerCount,
+                                                                        memory::ArenaAllocator<VkLayerProperties>(scratch.GetArena()));
         vkEnumerateInstanceLayerProperties(&layerCount, availableLayerProperties.data());
         for (const char* layerName : m_ValidationLayers) {
             bool layerFound = false;
             for (const auto& layerProperties : availableLayerProperties) {
                 if (!strcmp(layerName, layerProperties.layerName)) {
-                    logging::Log(logging::LogType::INFORMATION_LOG,
-                                 util::Format("Vulkan validation layer %s supported", MAX_MESSAGE_LENGTH, layerName));
+                    logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Vulkan validation layer {} supported"), layerName);
                     layerFound = true;
                     break;
                 }
@@ -117,7 +199,7 @@ namespace voxelfield::window {
                 VK_MAKE_VERSION(1, 0, 0),
                 ENGINE_NAME,
                 VK_MAKE_VERSION(1, 0, 0),
-                VK_API_VERSION_1_1
+                VK_API_VERSION_1_2
         };
         VkInstanceCreateInfo instanceCreationInformation{
                 VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
@@ -132,7 +214,7 @@ namespace voxelfield::window {
                 static_cast<uint32>(m_RequiredExtensions.size()), m_RequiredExtensions.data()
         };
         if (const VkResult result = vkCreateInstance(&instanceCreationInformation, nullptr, &m_VulkanInstanceHandle); result != VK_SUCCESS) {
-            throw std::runtime_error(util::Format("Error code %i, cannot create Vulkan instance", MAX_MESSAGE_LENGTH, result));
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, cannot create Vulkan instance"), result));
         }
         logging::Log(logging::LogType::INFORMATION_LOG, "Successfully created Vulkan instance");
 #ifdef VALIDATION_LAYERS_ENABLED
@@ -157,6 +239,8 @@ namespace voxelfield::window {
     }
 
     void VulkanWindow::CreateSurface() {
+        TRACE_ZONE("VulkanWindow::CreateSurface");
+#ifdef VK_USE_PLATFORM_WIN32_KHR
         VkWin32SurfaceCreateInfoKHR surfaceCreationInformation{
                 VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR,
                 nullptr,
@@ -166,21 +250,28 @@ namespace voxelfield::window {
         };
         if (const VkResult result = vkCreateWin32SurfaceKHR(m_VulkanInstanceHandle, &surfaceCreationInformation, nullptr, &m_SurfaceHandle);
                 result != VK_SUCCESS) {
-            throw std::runtime_error(util::Format("Error code %i, could not create windows rendering surface", MAX_MESSAGE_LENGTH, result));
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create windows rendering surface"), result));
         }
         logging::Log(logging::LogType::INFORMATION_LOG, "Successfully created windows rendering surface");
+#else
+        throw std::runtime_error("No rendering surface available on this platform");
+#endif
     }
 
     void VulkanWindow::SelectPhysicalDevice() {
+        TRACE_ZONE("VulkanWindow::SelectPhysicalDevice");
         uint32 physicalDeviceCount;
         vkEnumeratePhysicalDevices(m_VulkanInstanceHandle, &physicalDeviceCount, nullptr);
         if (physicalDeviceCount == 0) {
             throw std::runtime_error("No graphics card detected capable of running Vulkan");
         }
-        std::vector<VkPhysicalDevice> physicalDevicesHandles(physicalDeviceCount);
+        // Only needed while the device is chosen, so taken from the scratch stack
+        memory::ScratchScope scratch;
+        memory::ArenaVector<VkPhysicalDevice> physicalDevicesHandles(physicalDeviceCount,
+                                                                     memory::ArenaAllocator<VkPhysicalDevice>(scratch.GetArena()));
         if (const VkResult result = vkEnumeratePhysicalDevices(m_VulkanInstanceHandle, &physicalDeviceCount, physicalDevicesHandles.data());
                 result != VK_SUCCESS) {
-            throw std::runtime_error(util::Format("Error code %i, could not enumerate physical devices", MAX_MESSAGE_LENGTH, result));
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not enumerate physical devices"), result));
         }
         std::vector<PhysicalDeviceInformation> physicalDevices(physicalDeviceCount);
         unsigned int highestDeviceScore = 0;
@@ -193,61 +284,99 @@ namespace voxelfield::window {
             vkGetPhysicalDeviceFeatures(deviceHandle, &deviceFeatures);
             // Check if required extensions are supported
             bool areRequiredCapabilitiesSupported = true;
+            VkPhysicalDeviceVulkan12Features vulkan12Features{};
+            vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+            if (deviceProperties.apiVersion >= VK_API_VERSION_1_2) {
+                VkPhysicalDeviceFeatures2 deviceFeatures2{
+                        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                        &vulkan12Features,
+                        {}
+                };
+                vkGetPhysicalDeviceFeatures2(deviceHandle, &deviceFeatures2);
+                vulkan12Features.pNext = nullptr;
+            }
+            // Uploads are synchronized with the graphics queue through timeline semaphores
+            if (!vulkan12Features.timelineSemaphore) {
+                logging::Log(logging::LogType::WARNING_LOG, FORMAT("Timeline semaphores not supported for device {}"),
+                             deviceProperties.deviceName);
+                areRequiredCapabilitiesSupported = false;
+            }
+            // Chunks are culled on the GPU and drawn with one indirect draw whose count comes from a buffer
+            if (!vulkan12Features.drawIndirectCount || !deviceFeatures.multiDrawIndirect || !deviceFeatures.drawIndirectFirstInstance) {
+                logging::Log(logging::LogType::WARNING_LOG, FORMAT("Indirect count drawing not supported for device {}"),
+                             deviceProperties.deviceName);
+                areRequiredCapabilitiesSupported = false;
+            }
+            // Occlusion culling reduces the depth buffer into the Hi-Z pyramid with a max sampler
+            VkFormatProperties depthFormatProperties;
+            vkGetPhysicalDeviceFormatProperties(deviceHandle, DEPTH_FORMAT, &depthFormatProperties);
+            const VkFormatFeatureFlags requiredDepthFeatures = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+                                                               VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_MINMAX_BIT;
+            if (!vulkan12Features.samplerFilterMinmax || (depthFormatProperties.optimalTilingFeatures & requiredDepthFeatures) != requiredDepthFeatures) {
+                logging::Log(logging::LogType::WARNING_LOG, FORMAT("Min-max depth sampling not supported for device {}"),
+                             deviceProperties.deviceName);
+                areRequiredCapabilitiesSupported = false;
+            }
             uint32 extensionCount;
             vkEnumerateDeviceExtensionProperties(deviceHandle, nullptr, &extensionCount, nullptr);
-            std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+            memory::ArenaVector<VkExtensionProperties> availableExtensions(extensionCount,
+                                                                           memory::ArenaAllocator<VkExtensionProperties>(scratch.GetArena()));
             vkEnumerateDeviceExtensionProperties(deviceHandle, nullptr, &extensionCount, availableExtensions.data());
             for (const char* requiredExtensionName : m_RequiredDeviceExtensions) {
                 bool extensionFound = false;
                 for (const VkExtensionProperties& availableExtensionProperties : availableExtensions) {
                     if (!strcmp(requiredExtensionName, availableExtensionProperties.extensionName)) {
-                        logging::Log(logging::LogType::INFORMATION_LOG,
-                                     util::Format("Vulkan extension %s supported for device %s", MAX_MESSAGE_LENGTH, requiredExtensionName,
-                                                  deviceProperties.deviceName));
+                        logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Vulkan extension {} supported for device {}"),
+                                     requiredExtensionName, deviceProperties.deviceName);
                         extensionFound = true;
                         break;
                     }
                 }
                 if (!extensionFound) {
-                    logging::Log(logging::LogType::WARNING_LOG,
-                                 util::Format("Not all Vulkan device extensions supported for device %s",
-                                              MAX_MESSAGE_LENGTH, deviceProperties.deviceName));
+                    logging::Log(logging::LogType::WARNING_LOG, FORMAT("Not all Vulkan device extensions supported for device {}"),
+                                 deviceProperties.deviceName);
                     areRequiredCapabilitiesSupported = false;
                     break;
                 }
             }
-            uint32 formatCount;
-            vkGetPhysicalDeviceSurfaceFormatsKHR(deviceHandle, m_SurfaceHandle, &formatCount, nullptr);
-            if (formatCount == 0) {
-                areRequiredCapabilitiesSupported = false;
-                logging::Log(logging::LogType::WARNING_LOG,
-                             util::Format("No image formats supported for device %s", MAX_MESSAGE_LENGTH, deviceProperties.deviceName));
-            }
-            std::vector<VkSurfaceFormatKHR> supportedSurfaceFormats(formatCount);
-            vkGetPhysicalDeviceSurfaceFormatsKHR(deviceHandle, m_SurfaceHandle, &formatCount, supportedSurfaceFormats.data());
-            uint32 presentationModeCount;
-            vkGetPhysicalDeviceSurfacePresentModesKHR(deviceHandle, m_SurfaceHandle, &presentationModeCount, nullptr);
-            if (presentationModeCount == 0) {
-                areRequiredCapabilitiesSupported = false;
-                logging::Log(logging::LogType::WARNING_LOG,
-                             util::Format("No presentation modes supported for device %s", MAX_MESSAGE_LENGTH, deviceProperties.deviceName));
+            std::vector<VkSurfaceFormatKHR> supportedSurfaceFormats;
+            std::vector<VkPresentModeKHR> supportedPresentationModes;
+            if (!IsHeadless()) {
+                uint32 formatCount;
+                vkGetPhysicalDeviceSurfaceFormatsKHR(deviceHandle, m_SurfaceHandle, &formatCount, nullptr);
+                if (formatCount == 0) {
+                    areRequiredCapabilitiesSupported = false;
+                    logging::Log(logging::LogType::WARNING_LOG, FORMAT("No image formats supported for device {}"),
+                                 deviceProperties.deviceName);
+                }
+                supportedSurfaceFormats.resize(formatCount);
+                vkGetPhysicalDeviceSurfaceFormatsKHR(deviceHandle, m_SurfaceHandle, &formatCount, supportedSurfaceFormats.data());
+                uint32 presentationModeCount;
+                vkGetPhysicalDeviceSurfacePresentModesKHR(deviceHandle, m_SurfaceHandle, &presentationModeCount, nullptr);
+                if (presentationModeCount == 0) {
+                    areRequiredCapabilitiesSupported = false;
+                    logging::Log(logging::LogType::WARNING_LOG, FORMAT("No presentation modes supported for device {}"),
+                                 deviceProperties.deviceName);
+                }
+                supportedPresentationModes.resize(presentationModeCount);
+                vkGetPhysicalDeviceSurfacePresentModesKHR(deviceHandle, m_SurfaceHandle, &presentationModeCount, supportedPresentationModes.data());
             }
-            std::vector<VkPresentModeKHR> supportedPresentationModes(presentationModeCount);
-            vkGetPhysicalDeviceSurfacePresentModesKHR(deviceHandle, m_SurfaceHandle, &presentationModeCount, supportedPresentationModes.data());
-            const bool isIntegratedDevice = deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU;
-            logging::Log(logging::LogType::INFORMATION_LOG,
-                         util::Format("Detected %s rendering device: %s", MAX_MESSAGE_LENGTH, isIntegratedDevice ? "integrated" : "discrete",
-                                      deviceProperties.deviceName));
-            const unsigned int deviceScore = isIntegratedDevice ? 0 : 1;
+            const bool isIntegratedDevice = deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU,
+                    isSoftwareDevice = deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU;
+            logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Detected {} rendering device: {}"),
+                         isSoftwareDevice ? "software" : isIntegratedDevice ? "integrated" : "discrete", deviceProperties.deviceName);
+            // Software implementations such as lavapipe are only picked when nothing else is available
+            const unsigned int deviceScore = isSoftwareDevice ? 0 : isIntegratedDevice ? 1 : 2;
             physicalDevices[deviceIndex] = {
                     deviceHandle,
                     deviceProperties,
                     deviceFeatures,
+                    vulkan12Features,
                     supportedSurfaceFormats,
                     supportedPresentationModes,
                     deviceScore
             };
-            if (areRequiredCapabilitiesSupported && deviceScore > highestDeviceScore) {
+            if (areRequiredCapabilitiesSupported && (!highestDeviceScoreIndex.has_value() || deviceScore > highestDeviceScore)) {
                 highestDeviceScore = deviceScore;
                 highestDeviceScoreIndex = deviceIndex;
             }
@@ -256,14 +385,16 @@ namespace voxelfield::window {
             throw std::runtime_error("No graphics card detected with suitable Vulkan function requirements");
         }
         m_PhysicalDevice = physicalDevices[highestDeviceScoreIndex.value()];
-        logging::Log(logging::LogType::INFORMATION_LOG,
-                     util::Format("Using rendering device: %s", MAX_MESSAGE_LENGTH, m_PhysicalDevice.deviceProperties.deviceName));
+        logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Using rendering device: {}"), m_PhysicalDevice.deviceProperties.deviceName);
     }
 
     void VulkanWindow::CreateLogicalDevice() {
+        TRACE_ZONE("VulkanWindow::CreateLogicalDevice");
         uint32 queueFamilyCount;
         vkGetPhysicalDeviceQueueFamilyProperties(m_PhysicalDevice.handle, &queueFamilyCount, nullptr);
-        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        memory::ScratchScope scratch;
+        memory::ArenaVector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount,
+                                                                   memory::ArenaAllocator<VkQueueFamilyProperties>(scratch.GetArena()));
         vkGetPhysicalDeviceQueueFamilyProperties(m_PhysicalDevice.handle, &queueFamilyCount, queueFamilies.data());
         bool hasRequiredQueueFamilies = false;
         std::optional<uint32> graphicsFamilyIndex, presentationFamilyIndex;
@@ -273,10 +404,15 @@ namespace voxelfield::window {
             if (queueFamily.queueCount > 0) {
                 if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
                     graphicsFamilyIndex = queueFamilyIndex;
-                VkBool32 supportsSurfacePresentation;
-                vkGetPhysicalDeviceSurfaceSupportKHR(m_PhysicalDevice.handle, queueFamilyIndex, m_SurfaceHandle, &supportsSurfacePresentation);
-                if (supportsSurfacePresentation)
-                    presentationFamilyIndex = queueFamilyIndex;
+                if (IsHeadless()) {
+                    // Nothing is presented, so the graphics queue stands in for the presentation queue
+                    presentationFamilyIndex = graphicsFamilyIndex;
+                } else {
+                    VkBool32 supportsSurfacePresentation;
+                    vkGetPhysicalDeviceSurfaceSupportKHR(m_PhysicalDevice.handle, queueFamilyIndex, m_SurfaceHandle, &supportsSurfacePresentation);
+                    if (supportsSurfacePresentation)
+                        presentationFamilyIndex = queueFamilyIndex;
+                }
             }
             if (graphicsFamilyIndex.has_value() && presentationFamilyIndex.has_value()) {
                 hasRequiredQueueFamilies = true;
@@ -286,8 +422,24 @@ namespace voxelfield::window {
         if (!hasRequiredQueueFamilies) {
             throw std::runtime_error("No collection of queue families found where all requirements are met");
         }
-        m_QueueFamilyIndices = {graphicsFamilyIndex.value(), presentationFamilyIndex.value()};
-        const std::set<uint32> uniqueQueueFamilyIndices{m_QueueFamilyIndices.graphicsFamilyIndex, m_QueueFamilyIndices.presentationFamilyIndex};
+        // Prefer a transfer only family, those map to the copy engines and run alongside graphics work
+        std::optional<uint32> transferFamilyIndex;
+        for (uint32 queueFamilyIndex = 0; queueFamilyIndex < queueFamilyCount; queueFamilyIndex++) {
+            const VkQueueFamilyProperties& queueFamily = queueFamilies[queueFamilyIndex];
+            if (queueFamily.queueCount == 0 || !(queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) || (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT))
+                continue;
+            if (!transferFamilyIndex.has_value() || !(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT))
+                transferFamilyIndex = queueFamilyIndex;
+        }
+        m_QueueFamilyIndices = {graphicsFamilyIndex.value(), presentationFamilyIndex.value(), transferFamilyIndex.value_or(graphicsFamilyIndex.value())};
+        if (transferFamilyIndex.has_value())
+            logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Using dedicated transfer queue family {}"),
+                         m_QueueFamilyIndices.transferFamilyIndex);
+        else
+            logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Using graphics queue family {} for transfers"),
+                         m_QueueFamilyIndices.transferFamilyIndex);
+        const std::set<uint32> uniqueQueueFamilyIndices{m_QueueFamilyIndices.graphicsFamilyIndex, m_QueueFamilyIndices.presentationFamilyIndex,
+                                                        m_QueueFamilyIndices.transferFamilyIndex};
         std::vector<VkDeviceQueueCreateInfo> deviceQueueCreateInformation;
         {
             const float priority = 1.0f;
@@ -303,9 +455,16 @@ namespace voxelfield::window {
             }
         }
         VkPhysicalDeviceFeatures physicalDeviceFeatures{};
+        physicalDeviceFeatures.multiDrawIndirect = VK_TRUE;
+        physicalDeviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+        VkPhysicalDeviceVulkan12Features enabledVulkan12Features{};
+        enabledVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        enabledVulkan12Features.timelineSemaphore = VK_TRUE;
+        enabledVulkan12Features.drawIndirectCount = VK_TRUE;
+        enabledVulkan12Features.samplerFilterMinmax = VK_TRUE;
         VkDeviceCreateInfo deviceCreateInformation{
                 VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-                nullptr,
+                &enabledVulkan12Features,
                 0,
                 static_cast<uint32>(deviceQueueCreateInformation.size()),
                 deviceQueueCreateInformation.data(),
@@ -319,25 +478,127 @@ namespace voxelfield::window {
         };
         if (VkResult result = vkCreateDevice(m_PhysicalDevice.handle, &deviceCreateInformation, nullptr, &m_LogicalDeviceHandle); result !=
                                                                                                                                   VK_SUCCESS) {
-            throw std::runtime_error(util::Format("Error code %i, could not create logical Vulkan device", MAX_MESSAGE_LENGTH, result));
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create logical Vulkan device"), result));
         }
         logging::Log(logging::LogType::INFORMATION_LOG, "Successfully created logical Vulkan device");
         vkGetDeviceQueue(m_LogicalDeviceHandle, m_QueueFamilyIndices.graphicsFamilyIndex, 0, &m_GraphicsQueueHandle);
         vkGetDeviceQueue(m_LogicalDeviceHandle, m_QueueFamilyIndices.presentationFamilyIndex, 0, &m_PresentationQueueHandle);
+        vkGetDeviceQueue(m_LogicalDeviceHandle, m_QueueFamilyIndices.transferFamilyIndex, 0, &m_TransferQueueHandle);
+    }
+
+    void VulkanWindow::ConfigureFramePacing() {
+        TRACE_ZONE("VulkanWindow::ConfigureFramePacing");
+        std::optional<VkSurfaceCapabilitiesKHR> surfaceCapabilities;
+        if (!IsHeadless()) {
+            surfaceCapabilities.emplace();
+            if (const VkResult result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_PhysicalDevice.handle, m_SurfaceHandle, &surfaceCapabilities.value());
+                    result != VK_SUCCESS) {
+                throw std::runtime_error(util::Format(FORMAT("Error code {}, could not retrieve device surface capabilities"), result));
+            }
+            for (const auto& availablePresentationMode : m_PhysicalDevice.supportedPresentationModes) {
+                logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Found available presentation mode: {}"), availablePresentationMode);
+            }
+        }
+        m_FramePacingSettings = rendering::SelectFramePacingSettings(m_FramePacingOptions.profile, m_PhysicalDevice.supportedPresentationModes,
+                                                                     surfaceCapabilities ? &surfaceCapabilities.value() : nullptr);
+        m_FrameLimiter.SetFrameRate(m_FramePacingOptions.frameRateLimit);
+        m_LatencyTracker.Create(m_FramePacingSettings.framesInFlight, m_FrameStatistics);
+        m_LimiterWaitMetric = m_FrameStatistics.AddMetric("limiter_wait");
+        logging::Log(logging::LogType::INFORMATION_LOG,
+                     FORMAT("Frame pacing profile {}: presentation mode {}, {} swapchain images, {} frames in flight, frame rate limit "
+                            "{:.1f}"), rendering::GetFramePacingProfileName(m_FramePacingOptions.profile),
+                     m_FramePacingSettings.presentMode, m_FramePacingSettings.imageCount, m_FramePacingSettings.framesInFlight,
+                     m_FramePacingOptions.frameRateLimit);
+    }
+
+    void VulkanWindow::BeginFramePacing() {
+        TRACE_ZONE("VulkanWindow::BeginFramePacing");
+        // Called right after the frame's fence wait, so a fence that signalled during it is timestamped as it finished
+        m_LatencyTracker.Poll(m_LogicalDeviceHandle, m_InFlightFenceHandles);
+        if (m_FrameLimiter.IsEnabled()) {
+            // The limiter sleeps in the remaining fences, otherwise frames finishing meanwhile would be charged the whole sleep
+            m_FrameStatistics.Record(m_LimiterWaitMetric, m_FrameLimiter.Wait([&](const rendering::LatencyTracker::Clock::time_point sleepDeadline) {
+                m_LatencyTracker.WaitUntil(m_LogicalDeviceHandle, m_InFlightFenceHandles, sleepDeadline);
+            }));
+        }
+    }
+
+    void VulkanWindow::RecordFrameMemory() {
+        const memory::ArenaStatistics& arenaStatistics = m_FrameArenas.GetCurrent().GetStatistics();
+        m_FrameStatistics.Record(m_FrameArenaSizeMetric, arenaStatistics.allocatedSize / 1024.0);
+        m_FrameStatistics.Record(m_FrameArenaAllocationMetric, static_cast<double>(arenaStatistics.allocationCount));
+        TRACE_COUNTER("Frame arena KB", arenaStatistics.allocatedSize / 1024.0);
+        TRACE_COUNTER("Meshing jobs in flight", m_ChunkMeshingPipeline.GetInFlightCount());
+        TRACE_COUNTER("Dirty chunks", m_ChunkMeshingPipeline.GetDirtyCount());
+#ifdef HEAP_COUNTING_ENABLED
+        const uint64 heapAllocationCount = memory::GetHeapAllocationCount();
+        m_FrameStatistics.Record(m_HeapAllocationMetric, static_cast<double>(heapAllocationCount - m_LastHeapAllocationCount));
+        m_LastHeapAllocationCount = heapAllocationCount;
+#endif
     }
 
     void VulkanWindow::RecreateSwapChain() {
-        vkDeviceWaitIdle(m_LogicalDeviceHandle);
-        ReleaseSwapChain();
+        TRACE_ZONE("VulkanWindow::RecreateSwapChain");
+        VkSurfaceCapabilitiesKHR surfaceCapabilities;
+        if (const VkResult result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_PhysicalDevice.handle, m_SurfaceHandle, &surfaceCapabilities);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not retrieve device surface capabilities"), result));
+        }
+        // Minimized windows have no area to render into, try again next frame
+        if (const VkExtent2D extent = GetDrawableExtent(surfaceCapabilities); extent.width == 0 || extent.height == 0) {
+            m_IsSwapchainOutOfDate = true;
+            return;
+        }
+        m_IsSwapchainOutOfDate = false;
+        // Only resources that depend on the image size are rebuilt, frames still in flight keep using the old ones until they finish
+        m_RetiredSwapchains.push_back({
+                                              m_SwapchainHandle,
+                                              std::move(m_SwapchainImageViewHandles),
+                                              std::move(m_SwapChainFramebufferHandles),
+                                              m_DepthImageHandle,
+                                              m_DepthImageViewHandle,
+                                              m_DepthImageAllocation,
+                                              m_DepthPrepassFramebufferHandle,
+                                              m_FrameNumber
+                                      });
+        m_SwapchainImageViewHandles.clear();
+        m_SwapChainFramebufferHandles.clear();
+        const VkFormat previousImageFormat = m_SwapchainImageFormat;
         CreateSwapChain();
+        if (m_SwapchainImageFormat != previousImageFormat) {
+            // Rare enough that waiting is fine, the render pass may be referenced by frames in flight
+            vkDeviceWaitIdle(m_LogicalDeviceHandle);
+            vkDestroyRenderPass(m_LogicalDeviceHandle, m_DepthPrepassRenderPassHandle, nullptr);
+            vkDestroyRenderPass(m_LogicalDeviceHandle, m_RenderPassHandle, nullptr);
+            CreateRenderPass();
+            CreateGraphicsPipeline();
+        }
         CreateImageViews();
-        CreateRenderPass();
-        CreateGraphicsPipeline();
+        CreateDepthResources();
         CreateFramebuffers();
-        CreateCommandBuffers();
+        logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Resized swapchain to {}x{}"), m_SwapchainExtent.width,
+                     m_SwapchainExtent.height);
+    }
+
+    VkExtent2D VulkanWindow::GetDrawableExtent(const VkSurfaceCapabilitiesKHR& surfaceCapabilities) const {
+        // A current extent of all ones means the surface size is determined by the swapchain
+        if (surfaceCapabilities.currentExtent.width != std::numeric_limits<uint32>::max())
+            return surfaceCapabilities.currentExtent;
+#ifdef _WIN32
+        Rectangle area;
+        GetClientRect(m_Handle, &area);
+        const VkExtent2D& minExtent = surfaceCapabilities.minImageExtent, maxExtent = surfaceCapabilities.maxImageExtent;
+        return {
+                std::clamp(static_cast<uint32>(area.right), minExtent.width, maxExtent.width),
+                std::clamp(static_cast<uint32>(area.bottom), minExtent.height, maxExtent.height),
+        };
+#else
+        return surfaceCapabilities.minImageExtent;
+#endif
     }
 
     void VulkanWindow::CreateSwapChain() {
+        TRACE_ZONE("VulkanWindow::CreateSwapChain");
         VkSurfaceFormatKHR surfaceFormat;
         if (m_PhysicalDevice.supportedSurfaceFormats.size() > 1) {
             for (const auto& availableFormat : m_PhysicalDevice.supportedSurfaceFormats) {
@@ -347,38 +608,20 @@ namespace voxelfield::window {
         } else {
             surfaceFormat = m_PhysicalDevice.supportedSurfaceFormats.front();
         }
-        VkPresentModeKHR presentationMode;
-        bool foundImmediate = false;
-        for (const auto& availablePresentationMode : m_PhysicalDevice.supportedPresentationModes) {
-            logging::Log(logging::LogType::INFORMATION_LOG,
-                         util::Format("Found available presentation mode: %d", MAX_MESSAGE_LENGTH, availablePresentationMode));
-            if (availablePresentationMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-                presentationMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
-                foundImmediate = true;
-                break;
-            }
-        }
-        if (!foundImmediate) presentationMode = VK_PRESENT_MODE_MAILBOX_KHR;
+        const VkPresentModeKHR presentationMode = m_FramePacingSettings.presentMode;
         VkSurfaceCapabilitiesKHR surfaceCapabilities;
         if (const VkResult result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_PhysicalDevice.handle, m_SurfaceHandle, &surfaceCapabilities);
                 result != VK_SUCCESS) {
-            throw std::runtime_error(util::Format("Error code %i, could not retrieve device surface capabilities", MAX_MESSAGE_LENGTH, result));
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not retrieve device surface capabilities"), result));
         }
-        uint32 imageCount = surfaceCapabilities.minImageCount + 1;
-        if (surfaceCapabilities.maxImageCount > 0 && imageCount > surfaceCapabilities.maxImageCount)
-            imageCount = surfaceCapabilities.maxImageCount;
+        uint32 imageCount = rendering::ClampSwapchainImageCount(m_FramePacingSettings.imageCount, surfaceCapabilities);
         const bool sameQueueFamilyIndices = m_QueueFamilyIndices.graphicsFamilyIndex == m_QueueFamilyIndices.presentationFamilyIndex;
         const VkSharingMode sharingMode = sameQueueFamilyIndices
                                           ? VK_SHARING_MODE_EXCLUSIVE
                                           : VK_SHARING_MODE_CONCURRENT;
-        Rectangle area;
-        GetClientRect(m_Handle, &area);
-        const VkExtent2D& minExtent = surfaceCapabilities.minImageExtent, maxExtent = surfaceCapabilities.maxImageExtent;
-        VkExtent2D extent = {
-                std::clamp(static_cast<uint32>(area.right), minExtent.width, maxExtent.width),
-                std::clamp(static_cast<uint32>(area.bottom), minExtent.height, maxExtent.height),
-        };
-//        logging::Log(logging::LogType::INFORMATION_LOG, util::Format("%d, %d", MAX_MESSAGE_LENGTH, extent.width, extent.height));
+        const VkExtent2D extent = GetDrawableExtent(surfaceCapabilities);
+        const std::array<uint32, NUMBER_OF_QUEUE_INDICES> queueFamilyIndices{m_QueueFamilyIndices.graphicsFamilyIndex,
+                                                                             m_QueueFamilyIndices.presentationFamilyIndex};
         VkSwapchainCreateInfoKHR swapchainCreationInformation{
                 VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
                 nullptr,
@@ -395,27 +638,114 @@ namespace voxelfield::window {
                 VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
                 presentationMode,
                 VK_TRUE,
-                VK_NULL_HANDLE
+                // Lets the driver reuse the previous swapchain's resources and keep presenting it during the switch
+                m_SwapchainHandle
         };
         if (!sameQueueFamilyIndices) {
             swapchainCreationInformation.queueFamilyIndexCount = NUMBER_OF_QUEUE_INDICES;
-            const std::array<uint32, NUMBER_OF_QUEUE_INDICES> queueFamilyIndices{m_QueueFamilyIndices.graphicsFamilyIndex,
-                                                                                 m_QueueFamilyIndices.presentationFamilyIndex};
             swapchainCreationInformation.pQueueFamilyIndices = queueFamilyIndices.data();
         }
         if (const VkResult result = vkCreateSwapchainKHR(m_LogicalDeviceHandle, &swapchainCreationInformation, nullptr, &m_SwapchainHandle);
                 result != VK_SUCCESS) {
-            throw std::runtime_error(util::Format("Error code %i, could not create Vulkan swapchain", MAX_MESSAGE_LENGTH, result));
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create Vulkan swapchain"), result));
         }
         logging::Log(logging::LogType::INFORMATION_LOG, "Successfully created Vulkan swapchain");
         vkGetSwapchainImagesKHR(m_LogicalDeviceHandle, m_SwapchainHandle, &imageCount, nullptr);
         m_SwapchainImageHandles.resize(imageCount);
         vkGetSwapchainImagesKHR(m_LogicalDeviceHandle, m_SwapchainHandle, &imageCount, m_SwapchainImageHandles.data());
+        m_ImageInFlightFenceHandles.assign(imageCount, VK_NULL_HANDLE);
         m_SwapchainImageFormat = surfaceFormat.format;
         m_SwapchainExtent = extent;
     }
 
+    void VulkanWindow::CreateOffscreenTargets() {
+        TRACE_ZONE("VulkanWindow::CreateOffscreenTargets");
+        const HeadlessOptions& options = m_HeadlessOptions.value();
+        m_SwapchainImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+        m_SwapchainExtent = {options.width, options.height};
+        // One target per frame in flight, so a frame's fence also guards the image it renders into
+        const uint32 targetCount = m_FramePacingSettings.framesInFlight;
+        m_SwapchainImageHandles.resize(targetCount);
+        m_OffscreenImageAllocations.resize(targetCount);
+        for (size_t targetIndex = 0; targetIndex < targetCount; targetIndex++) {
+            VkImageCreateInfo imageCreationInformation{
+                    VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+                    nullptr,
+                    0,
+                    VK_IMAGE_TYPE_2D,
+                    m_SwapchainImageFormat,
+                    {m_SwapchainExtent.width, m_SwapchainExtent.height, 1},
+                    1, 1,
+                    VK_SAMPLE_COUNT_1_BIT,
+                    VK_IMAGE_TILING_OPTIMAL,
+                    VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                    VK_SHARING_MODE_EXCLUSIVE,
+                    0, nullptr,
+                    VK_IMAGE_LAYOUT_UNDEFINED
+            };
+            if (const VkResult result = vkCreateImage(m_LogicalDeviceHandle, &imageCreationInformation, nullptr, &m_SwapchainImageHandles[targetIndex]);
+                    result != VK_SUCCESS) {
+                throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create offscreen render target"), result));
+            }
+            m_OffscreenImageAllocations[targetIndex] = m_MemoryAllocator.AllocateForImage(m_SwapchainImageHandles[targetIndex],
+                                                                                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                                                          memory::MemoryPoolType::PERSISTENT);
+        }
+        logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Successfully created {} offscreen render targets of {}x{}"), targetCount,
+                     m_SwapchainExtent.width, m_SwapchainExtent.height);
+        if (!options.isReadbackEnabled) return;
+        m_ReadbackBufferHandles.resize(targetCount);
+        m_ReadbackBufferAllocations.resize(targetCount);
+        const VkDeviceSize readbackSize = static_cast<VkDeviceSize>(m_SwapchainExtent.width) * m_SwapchainExtent.height * 4;
+        for (size_t targetIndex = 0; targetIndex < targetCount; targetIndex++) {
+            VkBufferCreateInfo bufferCreationInformation{
+                    VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                    nullptr,
+                    0,
+                    readbackSize,
+                    VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_SHARING_MODE_EXCLUSIVE,
+                    0,
+                    nullptr
+            };
+            if (const VkResult result = vkCreateBuffer(m_LogicalDeviceHandle, &bufferCreationInformation, nullptr, &m_ReadbackBufferHandles[targetIndex]);
+                    result != VK_SUCCESS) {
+                throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create readback buffer"), result));
+            }
+            // Cached memory makes the CPU reads of the copied frame much faster where it is available
+            m_ReadbackBufferAllocations[targetIndex] = m_MemoryAllocator.AllocateForBuffer(
+                    m_ReadbackBufferHandles[targetIndex], VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                    memory::MemoryPoolType::PERSISTENT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+        }
+    }
+
+    void VulkanWindow::CreateGpuProfiler() {
+        TRACE_ZONE("VulkanWindow::CreateGpuProfiler");
+        m_ProfiledSlotsInFlight.assign(m_FramePacingSettings.framesInFlight, std::nullopt);
+        uint32 queueFamilyCount;
+        vkGetPhysicalDeviceQueueFamilyProperties(m_PhysicalDevice.handle, &queueFamilyCount, nullptr);
+        memory::ScratchScope scratch;
+        memory::ArenaVector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount,
+                                                                   memory::ArenaAllocator<VkQueueFamilyProperties>(scratch.GetArena()));
+        vkGetPhysicalDeviceQueueFamilyProperties(m_PhysicalDevice.handle, &queueFamilyCount, queueFamilies.data());
+        m_GpuProfiler.Create(m_LogicalDeviceHandle, m_PhysicalDevice.deviceProperties.limits,
+                             queueFamilies[m_QueueFamilyIndices.graphicsFamilyIndex].timestampValidBits, m_FrameStatistics);
+        m_CullGpuZone = m_GpuProfiler.AddZone("gpu_cull");
+        m_DepthPrepassGpuZone = m_GpuProfiler.AddZone("gpu_depth_prepass");
+        m_HiZBuildGpuZone = m_GpuProfiler.AddZone("gpu_hiz_build");
+        m_OcclusionCullGpuZone = m_GpuProfiler.AddZone("gpu_occlusion_cull");
+        m_RenderPassGpuZone = m_GpuProfiler.AddZone("gpu_render_pass");
+        m_DrawGpuZone = m_GpuProfiler.AddZone("gpu_draw");
+    }
+
+    void VulkanWindow::ResolveGpuProfilerSlot() {
+        // Called after the fence of the current frame has signalled, so the slot it last used has finished executing
+        if (std::optional<uint32>& slot = m_ProfiledSlotsInFlight[m_CurrentFrame]; slot.has_value() && m_GpuProfiler.Resolve(slot.value()))
+            slot.reset();
+    }
+
     void VulkanWindow::CreateImageViews() {
+        TRACE_ZONE("VulkanWindow::CreateImageViews");
         m_SwapchainImageViewHandles.resize(m_SwapchainImageHandles.size());
         for (size_t imageIndex = 0; imageIndex < m_SwapchainImageHandles.size(); imageIndex++) {
             VkImageViewCreateInfo imageViewCreateInformation{
@@ -430,195 +760,220 @@ namespace voxelfield::window {
             };
             if (const VkResult result = vkCreateImageView(m_LogicalDeviceHandle, &imageViewCreateInformation, nullptr,
                                                           &m_SwapchainImageViewHandles[imageIndex]); result != VK_SUCCESS) {
-                throw std::runtime_error(util::Format("Error code %i, could not create image view", MAX_MESSAGE_LENGTH, result));
+                throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create image view"), result));
             }
         }
         logging::Log(logging::LogType::INFORMATION_LOG, "Successfully created Vulkan swapchain image views");
     }
 
     void VulkanWindow::CreateGraphicsPipeline() {
-        const auto
-                vertexShaderSource = file::ReadFile("shaders/vert.spv"),
-                fragmentShaderSource = file::ReadFile("shaders/frag.spv");
-        m_VertexShaderModuleHandle = CreateShaderModule(vertexShaderSource);
-        m_FragmentShaderModuleHandle = CreateShaderModule(fragmentShaderSource);
-        VkPipelineShaderStageCreateInfo
-                vertexShaderStateCreationInformation{
-                VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-                nullptr,
-                0,
-                VK_SHADER_STAGE_VERTEX_BIT,
-                m_VertexShaderModuleHandle,
-                "main",
-                nullptr
-        },
-                fragmentShaderStateCreationInformation{
-                VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-                nullptr,
-                0,
-                VK_SHADER_STAGE_FRAGMENT_BIT,
-                m_FragmentShaderModuleHandle,
-                "main",
-                nullptr
-        };
-        std::array<VkPipelineShaderStageCreateInfo, 2> shaderStates{vertexShaderStateCreationInformation, fragmentShaderStateCreationInformation};
-        VkPipelineVertexInputStateCreateInfo vertexInputStateCreationInformation{
-                VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-                nullptr,
-                0,
-                0, nullptr,
-                0, nullptr
+        TRACE_ZONE("VulkanWindow::CreateGraphicsPipeline");
+        rendering::GraphicsPipelineDescription pipelineDescription;
+        pipelineDescription.vertexShader = m_PipelineRegistry.GetShaderModule("shaders/vert.spv");
+        const std::array<VkVertexInputAttributeDescription, 2> vertexAttributes = rendering::ChunkVertex::GetAttributeDescriptions();
+        pipelineDescription.vertexBindings = {rendering::ChunkVertex::GetBindingDescription()};
+        pipelineDescription.vertexAttributes.assign(vertexAttributes.begin(), vertexAttributes.end());
+        // Faces are wound counter-clockwise in world space, the projection flips Y which keeps them counter-clockwise on screen
+        pipelineDescription.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+        pipelineDescription.layoutHandle = m_ChunkRenderer.GetDrawPipelineLayout();
+        pipelineDescription.isDepthTestEnabled = true;
+        pipelineDescription.isDepthWriteEnabled = true;
+        pipelineDescription.depthAttachmentFormat = DEPTH_FORMAT;
+        // Depth only, the main pass shares the vertex shader so chunks already in the prepass pass its less or equal test
+        pipelineDescription.depthCompareOperation = VK_COMPARE_OP_LESS;
+        pipelineDescription.renderPassHandle = m_DepthPrepassRenderPassHandle;
+        m_DepthPrepassPipeline = m_PipelineRegistry.GetGraphicsPipeline(pipelineDescription);
+        pipelineDescription.fragmentShader = m_PipelineRegistry.GetShaderModule("shaders/frag.spv");
+        pipelineDescription.depthCompareOperation = VK_COMPARE_OP_LESS_OR_EQUAL;
+        pipelineDescription.renderPassHandle = m_RenderPassHandle;
+        pipelineDescription.colorAttachmentFormats = {m_SwapchainImageFormat};
+        m_Pipeline = m_PipelineRegistry.GetGraphicsPipeline(pipelineDescription);
+    }
+
+    void VulkanWindow::CreateRenderPass() {
+        TRACE_ZONE("VulkanWindow::CreateRenderPass");
+        const std::array<VkAttachmentDescription, 2> attachments{
+                VkAttachmentDescription{
+                        0,
+                        m_SwapchainImageFormat,
+                        VK_SAMPLE_COUNT_1_BIT,
+                        VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE,
+                        VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                        VK_IMAGE_LAYOUT_UNDEFINED, IsHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+                },
+                // Continues from the depth prepass, nothing reads the depth afterwards
+                VkAttachmentDescription{
+                        0,
+                        DEPTH_FORMAT,
+                        VK_SAMPLE_COUNT_1_BIT,
+                        VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                        VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                        VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+                }
         };
-        VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreationInformation{
-                VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
-                nullptr,
+        VkAttachmentReference colorAttachmentReference{
                 0,
-                VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-                VK_FALSE
-        };
-        VkViewport viewport{
-                0.0f, 0.0f, static_cast<float>(m_SwapchainExtent.width), static_cast<float>(m_SwapchainExtent.height),
-                0.0f, 1.0f
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
         };
-        VkRect2D scissor{{0, 0}, m_SwapchainExtent};
-        VkPipelineViewportStateCreateInfo viewportStateCreationInformation{
-                VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-                nullptr,
-                0,
-                1, &viewport,
-                1, &scissor
+        VkAttachmentReference depthAttachmentReference{
+                1,
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
         };
-        VkPipelineRasterizationStateCreateInfo rasterizationStateCreationInformation{
-                VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-                nullptr,
+        VkSubpassDescription subpassDescription{
                 0,
-                VK_FALSE,
-                VK_FALSE,
-                VK_POLYGON_MODE_FILL,
-                VK_CULL_MODE_BACK_BIT,
-                VK_FRONT_FACE_CLOCKWISE,
-                VK_FALSE,
-                0.0f, 0.0f, 0.0f,
-                1.0f
-        };
-        VkPipelineMultisampleStateCreateInfo multisampleStateCreationInformation{
-                VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-                nullptr,
+                VK_PIPELINE_BIND_POINT_GRAPHICS,
                 0,
-                VK_SAMPLE_COUNT_1_BIT,
-                VK_FALSE,
-                1.0f,
                 nullptr,
-                VK_FALSE,
-                VK_FALSE
-        };
-        VkPipelineColorBlendAttachmentState colorBlendAttachmentState{
-                VK_FALSE,
-                VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO,
-                VK_BLEND_OP_ADD,
-                VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO,
-                VK_BLEND_OP_ADD,
-                VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
-        };
-        VkPipelineColorBlendStateCreateInfo colorBlendStateCreationInformation{
-                VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-                nullptr,
-                0,
-                VK_FALSE,
-                VK_LOGIC_OP_COPY,
                 1,
-                &colorBlendAttachmentState,
-                {0.0f, 0.0f, 0.0f, 0.0f}
-        };
-        VkPipelineLayoutCreateInfo pipelineLayoutCreationInformation{
-                VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+                &colorAttachmentReference,
                 nullptr,
+                &depthAttachmentReference,
                 0,
-                0, nullptr,
-                0, nullptr
+                nullptr
         };
-        if (const VkResult result = vkCreatePipelineLayout(m_LogicalDeviceHandle, &pipelineLayoutCreationInformation, nullptr,
-                                                           &m_PipelineLayoutHandle); result != VK_SUCCESS) {
-            throw std::runtime_error(util::Format("Error code %i, could not create Vulkan pipeline layout", MAX_MESSAGE_LENGTH, result));
-        }
-        VkGraphicsPipelineCreateInfo pipelineCreationInformation{
-                VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-                nullptr,
-                0,
-                2,
-                shaderStates.data(),
-                &vertexInputStateCreationInformation,
-                &inputAssemblyCreationInformation,
-                nullptr,
-                &viewportStateCreationInformation,
-                &rasterizationStateCreationInformation,
-                &multisampleStateCreationInformation,
-                nullptr,
-                &colorBlendStateCreationInformation,
+        std::array<VkSubpassDependency, 2> subpassDependencies{
+                // The depth layout transition also has to wait for the Hi-Z build to finish reading the prepass depth
+                VkSubpassDependency{
+                        VK_SUBPASS_EXTERNAL, 0,
+                        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                        0
+                },
+                // Only used headless, makes the color writes visible to the readback copy
+                VkSubpassDependency{
+                        0, VK_SUBPASS_EXTERNAL,
+                        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                        0
+                }
+        };
+        VkRenderPassCreateInfo renderPassCreateInfo{
+                VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
                 nullptr,
-                m_PipelineLayoutHandle,
-                m_RenderPassHandle,
                 0,
-                VK_NULL_HANDLE,
-                -1
+                static_cast<uint32>(attachments.size()), attachments.data(),
+                1, &subpassDescription,
+                IsHeadless() ? 2u : 1u, subpassDependencies.data()
         };
-        if (const VkResult result = vkCreateGraphicsPipelines(m_LogicalDeviceHandle, VK_NULL_HANDLE, 1, &pipelineCreationInformation, nullptr,
-                                                              &m_Pipeline); result != VK_SUCCESS) {
-            throw std::runtime_error(util::Format("Error code %i, could not create Vulkan pipeline", MAX_MESSAGE_LENGTH, result));
+        if (const VkResult result = vkCreateRenderPass(m_LogicalDeviceHandle, &renderPassCreateInfo, nullptr, &m_RenderPassHandle);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create Vulkan render pass"), result));
         }
-        vkDestroyShaderModule(m_LogicalDeviceHandle, m_VertexShaderModuleHandle, nullptr);
-        vkDestroyShaderModule(m_LogicalDeviceHandle, m_FragmentShaderModuleHandle, nullptr);
-    }
-
-    void VulkanWindow::CreateRenderPass() {
-        VkAttachmentDescription colorAttachment{
+        // Depth only pass of the chunks visible last frame, its result is what the Hi-Z pyramid is built from
+        VkAttachmentDescription prepassDepthAttachment{
                 0,
-                m_SwapchainImageFormat,
+                DEPTH_FORMAT,
                 VK_SAMPLE_COUNT_1_BIT,
                 VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE,
                 VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_STORE_OP_DONT_CARE,
-                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
         };
-        VkAttachmentReference colorAttachmentReference{
-                0,
-                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
-        };
-        VkSubpassDescription subpassDescription{
+        VkSubpassDescription prepassSubpassDescription{
                 0,
                 VK_PIPELINE_BIND_POINT_GRAPHICS,
                 0,
                 nullptr,
-                1,
-                &colorAttachmentReference,
+                0,
                 nullptr,
                 nullptr,
+                &depthAttachmentReference,
                 0,
                 nullptr
         };
-        VkSubpassDependency subpassDependency{
-                VK_SUBPASS_EXTERNAL, 0,
-                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                0, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-                0
+        std::array<VkSubpassDependency, 2> prepassSubpassDependencies{
+                // Last frame's main pass and Hi-Z build are still using the depth buffer
+                VkSubpassDependency{
+                        VK_SUBPASS_EXTERNAL, 0,
+                        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                        0
+                },
+                VkSubpassDependency{
+                        0, VK_SUBPASS_EXTERNAL,
+                        VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                        0
+                }
         };
-        VkRenderPassCreateInfo renderPassCreateInfo{
+        VkRenderPassCreateInfo prepassRenderPassCreateInfo{
                 VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
                 nullptr,
                 0,
-                1, &colorAttachment,
-                1, &subpassDescription,
-                1, &subpassDependency
+                1, &prepassDepthAttachment,
+                1, &prepassSubpassDescription,
+                static_cast<uint32>(prepassSubpassDependencies.size()), prepassSubpassDependencies.data()
         };
-        if (const VkResult result = vkCreateRenderPass(m_LogicalDeviceHandle, &renderPassCreateInfo, nullptr, &m_RenderPassHandle);
+        if (const VkResult result = vkCreateRenderPass(m_LogicalDeviceHandle, &prepassRenderPassCreateInfo, nullptr, &m_DepthPrepassRenderPassHandle);
                 result != VK_SUCCESS) {
-            throw std::runtime_error(util::Format("Error code %i, could not create Vulkan render pass", MAX_MESSAGE_LENGTH, result));
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create depth prepass render pass"), result));
         }
     }
 
+    void VulkanWindow::CreateDepthResources() {
+        TRACE_ZONE("VulkanWindow::CreateDepthResources");
+        VkImageCreateInfo imageCreationInformation{
+                VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+                nullptr,
+                0,
+                VK_IMAGE_TYPE_2D,
+                DEPTH_FORMAT,
+                {m_SwapchainExtent.width, m_SwapchainExtent.height, 1},
+                1, 1,
+                VK_SAMPLE_COUNT_1_BIT,
+                VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                VK_SHARING_MODE_EXCLUSIVE,
+                0, nullptr,
+                VK_IMAGE_LAYOUT_UNDEFINED
+        };
+        if (const VkResult result = vkCreateImage(m_LogicalDeviceHandle, &imageCreationInformation, nullptr, &m_DepthImageHandle);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create depth image"), result));
+        }
+        // Recreated with the swapchain while the retired one is still in flight, which the buddy pool keeps from fragmenting
+        m_DepthImageAllocation = m_MemoryAllocator.AllocateForImage(m_DepthImageHandle, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                                    memory::MemoryPoolType::STREAMING);
+        VkImageViewCreateInfo imageViewCreateInformation{
+                VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+                nullptr,
+                0,
+                m_DepthImageHandle,
+                VK_IMAGE_VIEW_TYPE_2D,
+                DEPTH_FORMAT,
+                {VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY},
+                {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1}
+        };
+        if (const VkResult result = vkCreateImageView(m_LogicalDeviceHandle, &imageViewCreateInformation, nullptr, &m_DepthImageViewHandle);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create depth image view"), result));
+        }
+        VkFramebufferCreateInfo framebufferCreationInformation{
+                VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+                nullptr,
+                0,
+                m_DepthPrepassRenderPassHandle,
+                1, &m_DepthImageViewHandle,
+                m_SwapchainExtent.width,
+                m_SwapchainExtent.height,
+                1
+        };
+        if (const VkResult result = vkCreateFramebuffer(m_LogicalDeviceHandle, &framebufferCreationInformation, nullptr, &m_DepthPrepassFramebufferHandle);
+                result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create depth prepass framebuffer"), result));
+        }
+        m_HiZPyramid.SetDepthTarget(m_DepthImageViewHandle, m_SwapchainExtent, m_FrameNumber);
+    }
+
     void VulkanWindow::CreateFramebuffers() {
+        TRACE_ZONE("VulkanWindow::CreateFramebuffers");
         m_SwapChainFramebufferHandles.resize(m_SwapchainImageViewHandles.size());
         for (int i = 0; i < m_SwapchainImageViewHandles.size(); i++) {
-            std::array<VkImageView, 1> attachment{m_SwapchainImageViewHandles[i]};
+            std::array<VkImageView, 2> attachment{m_SwapchainImageViewHandles[i], m_DepthImageViewHandle};
             VkFramebufferCreateInfo framebufferCreationInformation{
                     VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
                     nullptr,
@@ -631,116 +986,167 @@ namespace voxelfield::window {
             };
             if (const VkResult result = vkCreateFramebuffer(m_LogicalDeviceHandle, &framebufferCreationInformation, nullptr,
                                                             &m_SwapChainFramebufferHandles[i]); result != VK_SUCCESS) {
-                throw std::runtime_error(util::Format("Error code %i, could not create Vulkan framebuffer", MAX_MESSAGE_LENGTH, result));
+                throw std::runtime_error(util::Format(FORMAT("Error code {}, could not create Vulkan framebuffer"), result));
             }
         }
     }
 
-    void VulkanWindow::CreateCommandPool() {
-        VkCommandPoolCreateInfo poolCreationInformation{
-                VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-                nullptr,
-                0,
-                m_QueueFamilyIndices.graphicsFamilyIndex
-        };
-        if (const VkResult result = vkCreateCommandPool(m_LogicalDeviceHandle, &poolCreationInformation, nullptr, &m_CommandPoolHandle);
-                result != VK_SUCCESS) {
-            throw std::runtime_error(util::Format("Error code %i, could not create Vulkan command pool", MAX_MESSAGE_LENGTH, result));
+    void VulkanWindow::CreateTerrainChunks() {
+        TRACE_ZONE("VulkanWindow::CreateTerrainChunks");
+        world::GenerateTerrain(m_World, m_JobSystem, TERRAIN_WIDTH_IN_CHUNKS, TERRAIN_HEIGHT_IN_CHUNKS, 0);
+        // Meshed in the background and streamed in over the first frames
+        for (int32 chunkZ = 0; chunkZ < TERRAIN_WIDTH_IN_CHUNKS; chunkZ++)
+            for (int32 chunkY = 0; chunkY < TERRAIN_HEIGHT_IN_CHUNKS; chunkY++)
+                for (int32 chunkX = 0; chunkX < TERRAIN_WIDTH_IN_CHUNKS; chunkX++)
+                    m_ChunkMeshingPipeline.MarkDirty({chunkX, chunkY, chunkZ});
+    }
+
+    void VulkanWindow::StreamChunks(const math::Vector3& cameraPosition) {
+        TRACE_ZONE("VulkanWindow::StreamChunks");
+        // Evicted first, so the neighbours it dirties are remeshed along with this frame's edits
+        m_EvictedChunkPositions.clear();
+        const world::ChunkPosition cameraChunk = world::World::GetChunkPosition(static_cast<int32>(std::floor(cameraPosition.x)),
+                                                                                static_cast<int32>(std::floor(cameraPosition.y)),
+                                                                                static_cast<int32>(std::floor(cameraPosition.z)));
+        m_World.EvictFurthestChunks(cameraChunk, m_EvictedChunkPositions);
+        for (const world::ChunkPosition& position : m_EvictedChunkPositions) {
+            m_ChunkMeshingPipeline.Cancel(position);
+            if (const auto it = m_ChunkIds.find(position); it != m_ChunkIds.end()) {
+                m_ChunkRenderer.RemoveChunk(it->second);
+                m_ChunkIds.erase(it);
+            }
         }
+        m_World.TakeDirtySlices(m_DirtySlices);
+        m_ChunkMeshingPipeline.MarkDirtySlices(m_DirtySlices);
+        m_ChunkMeshingPipeline.Update(m_World, cameraPosition, math::ExtractFrustumPlanes(m_ViewProjection), m_FrameArenas.GetCurrent());
+        m_ChunkMeshingPipeline.Upload([&](const world::ChunkPosition& position, const rendering::ChunkMesh& mesh) {
+            const math::Vector3 origin{static_cast<float>(position.x * CHUNK_SIZE), static_cast<float>(position.y * CHUNK_SIZE),
+                                       static_cast<float>(position.z * CHUNK_SIZE)};
+            // Edits mostly fit the ranges of the old mesh and are patched in place, otherwise the chunk moves to new ranges
+            if (const auto it = m_ChunkIds.find(position); it != m_ChunkIds.end()) {
+                if (m_ChunkRenderer.UpdateChunk(it->second, origin, mesh.vertices, mesh.indices, mesh.changedVertexRanges)) return;
+                m_ChunkRenderer.RemoveChunk(it->second);
+                m_ChunkIds.erase(it);
+            }
+            // Copied with this frame's upload batch, which its submission waits on. Empty meshes are skipped.
+            if (const std::optional<uint32> chunkId = m_ChunkRenderer.AddChunk(origin, mesh.vertices, mesh.indices))
+                m_ChunkIds[position] = *chunkId;
+        });
     }
 
-    void VulkanWindow::CreateVertexBuffer() {
-        std::vector<vertex> vertices{
-                {0.0,  -0.5, 0.0},
-                {0.5,  0.5,  0.0},
-                {-0.5, 0.5,  0.0}
-        };
-        VkBufferCreateInfo bufferCreationInformation{
-                VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+    VkCommandBuffer VulkanWindow::RecordFrameCommands(const uint32 imageIndex) {
+        TRACE_ZONE("VulkanWindow::RecordFrameCommands");
+        // The frame's fence has signalled, so its pools can be reset and recorded again
+        const VkCommandBuffer commandBuffer = m_CommandRecorder.BeginFrame(static_cast<uint32>(m_CurrentFrame));
+        const auto profilerSlot = static_cast<uint32>(m_CurrentFrame);
+        m_GpuProfiler.BeginFrame(commandBuffer, profilerSlot);
+        const float aspectRatio = static_cast<float>(m_SwapchainExtent.width) / static_cast<float>(std::max(m_SwapchainExtent.height, 1u));
+        const math::Vector3 cameraPosition{-24.0f, 72.0f, -24.0f};
+        m_ViewProjection = math::Perspective(1.0f, aspectRatio, 0.1f, 1000.0f) *
+                           math::LookAt(cameraPosition, {64.0f, 24.0f, 64.0f}, {0.0f, 1.0f, 0.0f});
+        StreamChunks(cameraPosition);
+        // Two phase occlusion culling, whatever was visible last frame is drawn into the depth prepass and every chunk is then tested
+        // against the pyramid built from it. Chunks that become visible are caught by the second test, so nothing pops in late.
+        m_HiZPyramid.RecordDiscard(commandBuffer);
+        m_GpuProfiler.BeginZone(commandBuffer, profilerSlot, m_CullGpuZone);
+        m_ChunkRenderer.RecordCulling(commandBuffer, static_cast<uint32>(m_CurrentFrame), m_ViewProjection, rendering::CullPhase::EARLY, m_HiZPyramid);
+        m_GpuProfiler.EndZone(commandBuffer, profilerSlot, m_CullGpuZone);
+        m_GpuProfiler.BeginZone(commandBuffer, profilerSlot, m_DepthPrepassGpuZone);
+        RecordDepthPrepass(commandBuffer);
+        m_GpuProfiler.EndZone(commandBuffer, profilerSlot, m_DepthPrepassGpuZone);
+        m_GpuProfiler.BeginZone(commandBuffer, profilerSlot, m_HiZBuildGpuZone);
+        m_HiZPyramid.RecordBuild(commandBuffer);
+        m_GpuProfiler.EndZone(commandBuffer, profilerSlot, m_HiZBuildGpuZone);
+        m_GpuProfiler.BeginZone(commandBuffer, profilerSlot, m_OcclusionCullGpuZone);
+        m_ChunkRenderer.RecordCulling(commandBuffer, static_cast<uint32>(m_CurrentFrame), m_ViewProjection, rendering::CullPhase::LATE, m_HiZPyramid);
+        m_GpuProfiler.EndZone(commandBuffer, profilerSlot, m_OcclusionCullGpuZone);
+        VkClearValue clearColor{0.0f, 0.0f, 0.0f, 1.0f};
+        VkRenderPassBeginInfo renderPassInfo{
+                VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
                 nullptr,
-                0,
-                sizeof(vertex) * vertices.size(),
-                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                VK_SHARING_MODE_EXCLUSIVE,
-                0,
-                nullptr
+                m_RenderPassHandle,
+                m_SwapChainFramebufferHandles[imageIndex],
+                {{0, 0}, m_SwapchainExtent},
+                1,
+                &clearColor
         };
-        if (const VkResult result = vkCreateBuffer(m_LogicalDeviceHandle, &bufferCreationInformation, nullptr, &m_VertexBufferHandle);
-                result != VK_SUCCESS) {
-            throw std::runtime_error(util::Format("Error code %i, could not create Vulkan vertex buffer", MAX_MESSAGE_LENGTH, result));
-        }
-        VkMemoryRequirements memoryRequirements;
-        vkGetBufferMemoryRequirements(m_LogicalDeviceHandle, m_VertexBufferHandle, &memoryRequirements);
-        VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties;
-        vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice.handle, &physicalDeviceMemoryProperties);
-        std::optional<uint32> memoryTypeIndex;
-        VkMemoryPropertyFlags memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-        for (int i = 0; i < physicalDeviceMemoryProperties.memoryTypeCount; i++) {
-            if ((memoryRequirements.memoryTypeBits * (1 << i)) &&
-                (physicalDeviceMemoryProperties.memoryTypes[i].propertyFlags & memoryProperties) != 0) {
-                memoryTypeIndex = i;
-                break;
-            }
+        m_GpuProfiler.BeginZone(commandBuffer, profilerSlot, m_RenderPassGpuZone);
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        RecordDraw(commandBuffer);
+        vkCmdEndRenderPass(commandBuffer);
+        m_GpuProfiler.EndZone(commandBuffer, profilerSlot, m_RenderPassGpuZone);
+        if (!m_ReadbackBufferHandles.empty()) {
+            VkBufferImageCopy copyRegion{
+                    0, 0, 0,
+                    {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+                    {0, 0, 0},
+                    {m_SwapchainExtent.width, m_SwapchainExtent.height, 1}
+            };
+            vkCmdCopyImageToBuffer(commandBuffer, m_SwapchainImageHandles[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                   m_ReadbackBufferHandles[imageIndex], 1, &copyRegion);
         }
-        if (!memoryTypeIndex.has_value())
-            throw std::runtime_error("Failed to find suitable memory type");
-        VkMemoryAllocateInfo memoryAllocationInformation{
-                VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-                nullptr,
-                memoryRequirements.size,
-                memoryTypeIndex.value()
+        m_GpuProfiler.EndFrame(commandBuffer, profilerSlot);
+        if (const VkResult result = vkEndCommandBuffer(commandBuffer); result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, failed to end command buffer"), result));
+        }
+        return commandBuffer;
+    }
+
+    void VulkanWindow::RecordViewportAndScissor(const VkCommandBuffer commandBufferHandle) const {
+        VkViewport viewport{
+                0.0f, 0.0f, static_cast<float>(m_SwapchainExtent.width), static_cast<float>(m_SwapchainExtent.height),
+                0.0f, 1.0f
         };
-        if (const VkResult result = vkAllocateMemory(m_LogicalDeviceHandle, &memoryAllocationInformation, nullptr, &m_VertexBufferMemoryHandle))
+        VkRect2D scissor{{0, 0}, m_SwapchainExtent};
+        vkCmdSetViewport(commandBufferHandle, 0, 1, &viewport);
+        vkCmdSetScissor(commandBufferHandle, 0, 1, &scissor);
     }
 
-    void VulkanWindow::CreateCommandBuffers() {
-        m_CommandBufferHandles.resize(m_SwapChainFramebufferHandles.size());
-        VkCommandBufferAllocateInfo commandBufferAllocationInformation{
-                VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+    void VulkanWindow::RecordDepthPrepass(const VkCommandBuffer commandBufferHandle) {
+        VkClearValue clearDepth;
+        clearDepth.depthStencil = {1.0f, 0};
+        VkRenderPassBeginInfo renderPassInfo{
+                VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
                 nullptr,
-                m_CommandPoolHandle,
-                VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-                static_cast<uint32>(m_CommandBufferHandles.size())
+                m_DepthPrepassRenderPassHandle,
+                m_DepthPrepassFramebufferHandle,
+                {{0, 0}, m_SwapchainExtent},
+                1,
+                &clearDepth
         };
-        if (const VkResult result = vkAllocateCommandBuffers(m_LogicalDeviceHandle, &commandBufferAllocationInformation,
-                                                             m_CommandBufferHandles.data()); result != VK_SUCCESS) {
-            throw std::runtime_error(util::Format("Error code %i, could not allocate Vulkan command buffers", MAX_MESSAGE_LENGTH, result));
-        }
-        for (size_t commandIndex = 0; commandIndex < m_CommandBufferHandles.size(); commandIndex++) {
-            VkCommandBufferBeginInfo beginInfo{
-                    VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-                    nullptr,
-                    VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT,
-                    nullptr
-            };
-            const VkCommandBuffer& commandBuffer = m_CommandBufferHandles[commandIndex];
-            if (const VkResult result = vkBeginCommandBuffer(commandBuffer, &beginInfo); result != VK_SUCCESS) {
-                throw std::runtime_error(util::Format("Error code %i, failed to begin command buffer", MAX_MESSAGE_LENGTH, result));
-            }
-            VkClearValue clearColor{0.0f, 0.0f, 0.0f, 1.0f};
-            VkRenderPassBeginInfo renderPassInfo{
-                    VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-                    nullptr,
-                    m_RenderPassHandle,
-                    m_SwapChainFramebufferHandles[commandIndex],
-                    {{0, 0}, m_SwapchainExtent},
-                    1,
-                    &clearColor
-            };
-            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline);
-            vkCmdDraw(commandBuffer, 3, 1, 0, 0);
-            vkCmdEndRenderPass(commandBuffer);
-            if (const VkResult result = vkEndCommandBuffer(commandBuffer); result != VK_SUCCESS) {
-                throw std::runtime_error(util::Format("Error code %i, failed to end command buffer", MAX_MESSAGE_LENGTH, result));
-            }
-        }
+        vkCmdBeginRenderPass(commandBufferHandle, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBindPipeline(commandBufferHandle, VK_PIPELINE_BIND_POINT_GRAPHICS, m_DepthPrepassPipeline);
+        RecordViewportAndScissor(commandBufferHandle);
+        vkCmdPushConstants(commandBufferHandle, m_ChunkRenderer.GetDrawPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT,
+                           offsetof(rendering::ChunkPushConstants, viewProjection), sizeof(math::Matrix4), &m_ViewProjection);
+        m_ChunkRenderer.RecordDraw(commandBufferHandle, static_cast<uint32>(m_CurrentFrame), rendering::CullPhase::EARLY);
+        vkCmdEndRenderPass(commandBufferHandle);
+    }
+
+    void VulkanWindow::RecordDraw(const VkCommandBuffer commandBufferHandle) {
+        const auto profilerSlot = static_cast<uint32>(m_CurrentFrame);
+        m_GpuProfiler.BeginZone(commandBufferHandle, profilerSlot, m_DrawGpuZone);
+        vkCmdBindPipeline(commandBufferHandle, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline);
+        RecordViewportAndScissor(commandBufferHandle);
+        vkCmdPushConstants(commandBufferHandle, m_ChunkRenderer.GetDrawPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT,
+                           offsetof(rendering::ChunkPushConstants, viewProjection), sizeof(math::Matrix4), &m_ViewProjection);
+        // Every chunk the late phase kept goes out in this one indirect count draw
+        m_ChunkRenderer.RecordDraw(commandBufferHandle, static_cast<uint32>(m_CurrentFrame), rendering::CullPhase::LATE);
+        m_GpuProfiler.EndZone(commandBufferHandle, profilerSlot, m_DrawGpuZone);
     }
 
     void VulkanWindow::CreateSynchronizationObjects() {
-        m_ImageAvailableSemaphoreHandles.resize(MAX_FRAMES_IN_FLIGHT);
-        m_RenderFinishedSemaphoreHandles.resize(MAX_FRAMES_IN_FLIGHT);
-        m_InFlightFenceHandles.resize(MAX_FRAMES_IN_FLIGHT);
+        TRACE_ZONE("VulkanWindow::CreateSynchronizationObjects");
+        const uint32 framesInFlight = m_FramePacingSettings.framesInFlight;
+        m_ImageAvailableSemaphoreHandles.resize(framesInFlight);
+        m_RenderFinishedSemaphoreHandles.resize(framesInFlight);
+        m_InFlightFenceHandles.resize(framesInFlight);
+        m_FrameArenas.Create(framesInFlight);
+        m_FrameArenaSizeMetric = m_FrameStatistics.AddMetric("arena", "kb");
+        m_FrameArenaAllocationMetric = m_FrameStatistics.AddMetric("arena_n", "allocations");
+#ifdef HEAP_COUNTING_ENABLED
+        m_HeapAllocationMetric = m_FrameStatistics.AddMetric("heap_n", "allocations");
+#endif
         VkSemaphoreCreateInfo semaphoreCreationInformation{
                 VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
                 nullptr,
@@ -751,7 +1157,7 @@ namespace voxelfield::window {
                 nullptr,
                 VK_FENCE_CREATE_SIGNALED_BIT
         };
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        for (size_t i = 0; i < framesInFlight; i++) {
             if (vkCreateSemaphore(m_LogicalDeviceHandle, &semaphoreCreationInformation, nullptr, &m_ImageAvailableSemaphoreHandles[i])
                 != VK_SUCCESS ||
                 vkCreateSemaphore(m_LogicalDeviceHandle, &semaphoreCreationInformation, nullptr, &m_RenderFinishedSemaphoreHandles[i])
@@ -763,46 +1169,55 @@ namespace voxelfield::window {
         }
     }
 
-    VkShaderModule VulkanWindow::CreateShaderModule(const std::vector<char>& shaderSource) {
-        VkShaderModuleCreateInfo creationInformation{
-                VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-                nullptr,
-                0,
-                shaderSource.size(),
-                reinterpret_cast<const uint32*>(shaderSource.data())
-        };
-        VkShaderModule shaderModule;
-        if (const VkResult result = vkCreateShaderModule(m_LogicalDeviceHandle, &creationInformation, nullptr, &shaderModule);
-                result != VK_SUCCESS) {
-            throw std::runtime_error(util::Format("Error code %i, could not create Vulkan shader module", MAX_MESSAGE_LENGTH, result));
-        }
-        return shaderModule;
-    }
-
     void VulkanWindow::DrawFrame() {
-        vkWaitForFences(m_LogicalDeviceHandle, 1, &m_InFlightFenceHandles[m_CurrentFrame], VK_TRUE, ULONG_MAX);
-        vkResetFences(m_LogicalDeviceHandle, 1, &m_InFlightFenceHandles[m_CurrentFrame]);
+        TRACE_FRAME(m_FrameNumber);
+        if (IsHeadless()) {
+            DrawOffscreenFrame();
+            return;
+        }
+        TRACE_ZONE("VulkanWindow::DrawFrame");
+        {
+            TRACE_ZONE("Wait for frame fence");
+            vkWaitForFences(m_LogicalDeviceHandle, 1, &m_InFlightFenceHandles[m_CurrentFrame], VK_TRUE, ULONG_MAX);
+        }
+        BeginFramePacing();
+        m_FrameArenas.BeginFrame(static_cast<uint32>(m_CurrentFrame));
+        ResolveGpuProfilerSlot();
+        ReleaseRetiredSwapChains(false);
+        m_ChunkRenderer.BeginFrame(m_FrameNumber);
+        m_HiZPyramid.BeginFrame(m_FrameNumber);
+        if (m_IsSwapchainOutOfDate) {
+            RecreateSwapChain();
+            if (m_IsSwapchainOutOfDate) return;
+        }
         uint32 imageIndex;
-        if (const VkResult result = vkAcquireNextImageKHR(m_LogicalDeviceHandle, m_SwapchainHandle, ULONG_MAX,
-                                                          m_ImageAvailableSemaphoreHandles[m_CurrentFrame], VK_NULL_HANDLE, &imageIndex);
-                result != VK_SUCCESS) {
-            throw std::runtime_error(util::Format("Error code %i, could not acquire next Vulkan image", MAX_MESSAGE_LENGTH, result));
+        VkResult acquireResult;
+        {
+            TRACE_ZONE("Acquire swapchain image");
+            acquireResult = vkAcquireNextImageKHR(m_LogicalDeviceHandle, m_SwapchainHandle, ULONG_MAX,
+                                                  m_ImageAvailableSemaphoreHandles[m_CurrentFrame], VK_NULL_HANDLE, &imageIndex);
         }
-        std::array<VkSemaphore, 1> waitSemaphores{m_ImageAvailableSemaphoreHandles[m_CurrentFrame]};
-        std::array<VkSemaphore, 1> signalSemaphores{m_RenderFinishedSemaphoreHandles[m_CurrentFrame]};
-        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        VkSubmitInfo submitInfo{
-                VK_STRUCTURE_TYPE_SUBMIT_INFO,
-                nullptr,
-                static_cast<uint32>(waitSemaphores.size()), waitSemaphores.data(),
-                &waitStage,
-                1, &m_CommandBufferHandles[imageIndex],
-                static_cast<uint32>(signalSemaphores.size()), signalSemaphores.data()
-        };
-        if (const VkResult result = vkQueueSubmit(m_GraphicsQueueHandle, 1, &submitInfo, m_InFlightFenceHandles[m_CurrentFrame]); result !=
-                                                                                                                                  VK_SUCCESS) {
-            throw std::runtime_error(util::Format("Error code %i, could not submit Vulkan graphics queue", MAX_MESSAGE_LENGTH, result));
+        if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR) {
+            // The fence has not been reset yet, so returning here leaves the frame slot untouched
+            RecreateSwapChain();
+            return;
+        } else if (acquireResult != VK_SUCCESS && acquireResult != VK_SUBOPTIMAL_KHR) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not acquire next Vulkan image"), acquireResult));
         }
+        // With more images than frames in flight an image can come back while an older frame still renders into it
+        if (VkFence imageFenceHandle = m_ImageInFlightFenceHandles[imageIndex];
+                imageFenceHandle != VK_NULL_HANDLE && imageFenceHandle != m_InFlightFenceHandles[m_CurrentFrame]) {
+            TRACE_ZONE("Wait for image fence");
+            vkWaitForFences(m_LogicalDeviceHandle, 1, &imageFenceHandle, VK_TRUE, ULONG_MAX);
+        }
+        m_ImageInFlightFenceHandles[imageIndex] = m_InFlightFenceHandles[m_CurrentFrame];
+        m_LatencyTracker.MarkInputSampled(static_cast<uint32>(m_CurrentFrame));
+        vkResetFences(m_LogicalDeviceHandle, 1, &m_InFlightFenceHandles[m_CurrentFrame]);
+        std::array<VkSemaphore, 1> signalSemaphores{m_RenderFinishedSemaphoreHandles[m_CurrentFrame]};
+        SubmitGraphicsCommandBuffer(RecordFrameCommands(imageIndex), m_ImageAvailableSemaphoreHandles[m_CurrentFrame], signalSemaphores[0],
+                                    m_InFlightFenceHandles[m_CurrentFrame]);
+        m_ProfiledSlotsInFlight[m_CurrentFrame] = static_cast<uint32>(m_CurrentFrame);
+        m_LatencyTracker.Poll(m_LogicalDeviceHandle, m_InFlightFenceHandles);
         std::array<VkSwapchainKHR, 1> swapChains{m_SwapchainHandle};
         VkPresentInfoKHR presentInfo{
                 VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
@@ -813,15 +1228,145 @@ namespace voxelfield::window {
                 nullptr
         };
         {
+            TRACE_ZONE("Present");
+            const auto presentStart = std::chrono::high_resolution_clock::now();
             const VkResult result = vkQueuePresentKHR(m_PresentationQueueHandle, &presentInfo);
-            if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-                RecreateSwapChain();
-                return;
-            } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-                throw std::runtime_error(util::Format("Error code %i, could not present Vulkan queue", MAX_MESSAGE_LENGTH, result));
+            m_FrameStatistics.Record(profiling::PRESENT_TIME_METRIC,
+                                     std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - presentStart).count());
+            // The frame was submitted either way, recreate once its slot comes around again
+            if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+                m_IsSwapchainOutOfDate = true;
+            } else if (result != VK_SUCCESS) {
+                throw std::runtime_error(util::Format(FORMAT("Error code {}, could not present Vulkan queue"), result));
             }
         }
-        m_CurrentFrame = (m_CurrentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        // Presenting can block on the display, frames finishing during it are timestamped here rather than after the next fence wait
+        m_LatencyTracker.Poll(m_LogicalDeviceHandle, m_InFlightFenceHandles);
+        RecordFrameMemory();
+        m_FrameNumber++;
+        m_CurrentFrame = (m_CurrentFrame + 1) % m_FramePacingSettings.framesInFlight;
+    }
+
+    void VulkanWindow::DrawOffscreenFrame() {
+        TRACE_ZONE("VulkanWindow::DrawOffscreenFrame");
+        using Clock = std::chrono::high_resolution_clock;
+        {
+            TRACE_ZONE("Wait for frame fence");
+            vkWaitForFences(m_LogicalDeviceHandle, 1, &m_InFlightFenceHandles[m_CurrentFrame], VK_TRUE, std::numeric_limits<uint64>::max());
+        }
+        BeginFramePacing();
+        m_FrameArenas.BeginFrame(static_cast<uint32>(m_CurrentFrame));
+        const Clock::time_point waitEnd = Clock::now();
+        m_LatencyTracker.MarkInputSampled(static_cast<uint32>(m_CurrentFrame));
+        // The fence covers the previous frame rendered into this target, so its timestamps are ready without stalling
+        ResolveGpuProfilerSlot();
+        m_ChunkRenderer.BeginFrame(m_FrameNumber);
+        m_HiZPyramid.BeginFrame(m_FrameNumber);
+        vkResetFences(m_LogicalDeviceHandle, 1, &m_InFlightFenceHandles[m_CurrentFrame]);
+        // Offscreen targets are owned per frame in flight, so the frame index doubles as the image index
+        SubmitGraphicsCommandBuffer(RecordFrameCommands(static_cast<uint32>(m_CurrentFrame)), VK_NULL_HANDLE, VK_NULL_HANDLE, m_InFlightFenceHandles[m_CurrentFrame]);
+        m_ProfiledSlotsInFlight[m_CurrentFrame] = static_cast<uint32>(m_CurrentFrame);
+        m_LatencyTracker.Poll(m_LogicalDeviceHandle, m_InFlightFenceHandles);
+        const Clock::time_point frameEnd = Clock::now();
+        m_FrameStatistics.Record(profiling::CPU_TIME_METRIC, std::chrono::duration<double, std::milli>(frameEnd - waitEnd).count());
+        RecordFrameMemory();
+        m_FrameNumber++;
+        m_CurrentFrame = (m_CurrentFrame + 1) % m_FramePacingSettings.framesInFlight;
+    }
+
+    void VulkanWindow::SubmitGraphicsCommandBuffer(const VkCommandBuffer commandBufferHandle, const VkSemaphore imageAvailableSemaphoreHandle,
+                                                   const VkSemaphore renderFinishedSemaphoreHandle, const VkFence fenceHandle) {
+        TRACE_ZONE("VulkanWindow::SubmitGraphicsCommandBuffer");
+        // Everything uploaded this frame goes out as one batch, the graphics queue only waits for it right before culling
+        const uint64 uploadTimelineValue = m_UploadManager.Flush();
+        std::array<VkSemaphore, 2> waitSemaphores{};
+        std::array<VkPipelineStageFlags, 2> waitStages{};
+        std::array<uint64, 2> waitValues{};
+        uint32 waitCount = 0;
+        if (imageAvailableSemaphoreHandle != VK_NULL_HANDLE) {
+            waitSemaphores[waitCount] = imageAvailableSemaphoreHandle;
+            waitStages[waitCount++] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        }
+        if (uploadTimelineValue > 0) {
+            waitSemaphores[waitCount] = m_UploadManager.GetTimelineSemaphore();
+            waitValues[waitCount] = uploadTimelineValue;
+            // Culling reads the chunk records before any vertex is fetched, and mesh patches overwrite what was uploaded before them
+            waitStages[waitCount++] = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+                                      VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+        }
+        // Values for binary semaphores are ignored but the arrays have to line up
+        VkTimelineSemaphoreSubmitInfo timelineSubmitInformation{
+                VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+                nullptr,
+                waitCount, waitValues.data(),
+                0, nullptr
+        };
+        const bool hasRenderFinishedSemaphore = renderFinishedSemaphoreHandle != VK_NULL_HANDLE;
+        VkSubmitInfo submitInfo{
+                VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                &timelineSubmitInformation,
+                waitCount, waitSemaphores.data(),
+                waitStages.data(),
+                1, &commandBufferHandle,
+                hasRenderFinishedSemaphore ? 1u : 0u, hasRenderFinishedSemaphore ? &renderFinishedSemaphoreHandle : nullptr
+        };
+        if (const VkResult result = vkQueueSubmit(m_GraphicsQueueHandle, 1, &submitInfo, fenceHandle); result != VK_SUCCESS) {
+            throw std::runtime_error(util::Format(FORMAT("Error code {}, could not submit Vulkan graphics queue"), result));
+        }
+    }
+
+    void VulkanWindow::WriteReadbackImage(const size_t frameIndex) {
+        TRACE_ZONE("VulkanWindow::WriteReadbackImage");
+        const std::string& fileName = m_HeadlessOptions->readbackFileName;
+        std::ofstream file(fileName, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error(util::Format(FORMAT("Could not open readback image {} for writing"), fileName));
+        }
+        file << "P6\n" << m_SwapchainExtent.width << ' ' << m_SwapchainExtent.height << "\n255\n";
+        const auto* pixels = static_cast<const uint8*>(m_ReadbackBufferAllocations[frameIndex].mapping);
+        const size_t pixelCount = static_cast<size_t>(m_SwapchainExtent.width) * m_SwapchainExtent.height;
+        std::vector<char> row(pixelCount * 3);
+        for (size_t pixelIndex = 0; pixelIndex < pixelCount; pixelIndex++) {
+            // Targets are BGRA, PPM wants RGB
+            row[pixelIndex * 3 + 0] = static_cast<char>(pixels[pixelIndex * 4 + 2]);
+            row[pixelIndex * 3 + 1] = static_cast<char>(pixels[pixelIndex * 4 + 1]);
+            row[pixelIndex * 3 + 2] = static_cast<char>(pixels[pixelIndex * 4 + 0]);
+        }
+        file.write(row.data(), row.size());
+        logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Wrote last headless frame to {}"), fileName);
+    }
+
+    void VulkanWindow::RunHeadless() {
+        using Clock = std::chrono::high_resolution_clock;
+        const HeadlessOptions& options = m_HeadlessOptions.value();
+        const Clock::time_point benchmarkStart = Clock::now();
+        Clock::time_point frameStart = benchmarkStart;
+        for (uint32 frame = 0; frame < options.frameCount; frame++) {
+            DrawFrame();
+            const Clock::time_point frameEnd = Clock::now();
+            m_FrameStatistics.Record(profiling::FRAME_TIME_METRIC, std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+            m_FrameStatistics.EndFrame();
+            m_JobSystem.EndFrame();
+            frameStart = frameEnd;
+        }
+        // Waiting on the frames still in flight one by one timestamps each as it finishes instead of all at once after idling
+        m_LatencyTracker.WaitUntil(m_LogicalDeviceHandle, m_InFlightFenceHandles, rendering::LatencyTracker::Clock::time_point::max());
+        vkDeviceWaitIdle(m_LogicalDeviceHandle);
+        const double totalSeconds = std::chrono::duration<double>(Clock::now() - benchmarkStart).count();
+        // Frames still in flight when the loop ended have not had their timestamps collected yet, they go into the rows those frames already committed
+        const uint32 framesInFlight = m_FramePacingSettings.framesInFlight;
+        for (size_t frameOffset = 0; frameOffset < framesInFlight; frameOffset++) {
+            ResolveGpuProfilerSlot();
+            m_CurrentFrame = (m_CurrentFrame + 1) % framesInFlight;
+        }
+        logging::Log(logging::LogType::INFORMATION_LOG, FORMAT("Headless benchmark: {} frames at {}x{} in {:.3f} s, {:.1f} FPS on {}"),
+                     options.frameCount, m_SwapchainExtent.width, m_SwapchainExtent.height, totalSeconds,
+                     options.frameCount / totalSeconds, m_PhysicalDevice.deviceProperties.deviceName);
+        m_FrameStatistics.LogSummary();
+        m_FrameStatistics.WriteCsv(FRAME_STATISTICS_FILE_NAME);
+        m_JobSystem.LogUtilization();
+        if (options.isReadbackEnabled && options.frameCount > 0)
+            WriteReadbackImage((m_CurrentFrame + framesInFlight - 1) % framesInFlight);
     }
 
     void VulkanWindow::Draw() {
@@ -1,7 +1,11 @@
 #pragma once
 
 #define NUMBER_OF_QUEUE_INDICES 2
-#define MAX_FRAMES_IN_FLIGHT 2
+// Sampled by the Hi-Z build, which needs min-max filtering on it
+#define DEPTH_FORMAT VK_FORMAT_D32_SFLOAT
+// Generated world meshed at startup, in chunks
+#define TERRAIN_WIDTH_IN_CHUNKS 4
+#define TERRAIN_HEIGHT_IN_CHUNKS 2
 
 #include <vulkan/vulkan.h>
 #include <algorithm>
@@ -9,10 +13,25 @@
 #include <vector>
 #include <array>
 #include <set>
+#include <unordered_map>
 
 #include "game.hpp"
 #include "window.hpp"
-#include "file_reader.hpp"
+#include "virtual_file_system.hpp"
+#include "gpu_profiler.hpp"
+#include "device_memory_allocator.hpp"
+#include "upload_manager.hpp"
+#include "pipeline_registry.hpp"
+#include "command_recorder.hpp"
+#include "frame_pacing.hpp"
+#include "memory_arena.hpp"
+#include "tracer.hpp"
+#include "vertex.hpp"
+#include "chunk_renderer.hpp"
+#include "hiz_pyramid.hpp"
+#include "chunk_meshing_pipeline.hpp"
+#include "world.hpp"
+#include "terrain_generator.hpp"
 
 namespace voxelfield::window {
     struct PhysicalDeviceInformation {
@@ -20,23 +39,52 @@ namespace voxelfield::window {
         VkPhysicalDevice handle;
         VkPhysicalDeviceProperties deviceProperties;
         VkPhysicalDeviceFeatures deviceFeatures;
+        VkPhysicalDeviceVulkan12Features vulkan12Features;
         std::vector<VkSurfaceFormatKHR> supportedSurfaceFormats;
         std::vector<VkPresentModeKHR> supportedPresentationModes;
         unsigned int score;
     };
 
     struct QueueFamilyIndices {
-        uint32 graphicsFamilyIndex, presentationFamilyIndex;
+        // The transfer family is the graphics family when the device has no dedicated transfer queue
+        uint32 graphicsFamilyIndex, presentationFamilyIndex, transferFamilyIndex;
+    };
+
+    // Renders into device-local images instead of a surface, used for benchmarking without a display
+    struct HeadlessOptions {
+        uint32 width = 640, height = 480;
+        uint32 frameCount = 1000;
+        bool isReadbackEnabled = false;
+        std::string readbackFileName = "headless_frame.ppm";
+    };
+
+    // Resources of a swapchain replaced on resize, destroyed once no frame in flight can still be using them
+    struct RetiredSwapchain {
+        VkSwapchainKHR handle;
+        std::vector<VkImageView> imageViewHandles;
+        std::vector<VkFramebuffer> framebufferHandles;
+        VkImage depthImageHandle;
+        VkImageView depthImageViewHandle;
+        memory::DeviceAllocation depthImageAllocation;
+        VkFramebuffer depthPrepassFramebufferHandle;
+        uint64 retiredFrameNumber;
     };
 
     class VulkanWindow : public Window {
     public:
-        VulkanWindow(Application& application, const std::string& title);
+        VulkanWindow(Application& application, const std::string& title, jobs::JobSystem& jobSystem, const file::VirtualFileSystem& fileSystem,
+                     const rendering::FramePacingOptions& framePacingOptions = {}, const std::optional<HeadlessOptions>& headlessOptions = std::nullopt);
 
         ~VulkanWindow() override;
 
         void Open() override;
 
+        void RunHeadless();
+
+        bool IsHeadless() const {
+            return m_HeadlessOptions.has_value();
+        }
+
     protected:
 #ifdef VALIDATION_LAYERS_ENABLED
         VkDebugUtilsMessengerEXT m_DebugCallback;
@@ -46,31 +94,72 @@ namespace voxelfield::window {
         DebugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType,
                       const VkDebugUtilsMessengerCallbackDataEXT* callbackData, void* userData);
 
+#endif
+        const file::VirtualFileSystem& m_FileSystem;
+        const std::optional<HeadlessOptions> m_HeadlessOptions;
+        const rendering::FramePacingOptions m_FramePacingOptions;
+        rendering::FramePacingSettings m_FramePacingSettings;
+        rendering::FrameLimiter m_FrameLimiter;
+        rendering::LatencyTracker m_LatencyTracker;
+        uint32 m_LimiterWaitMetric, m_FrameArenaSizeMetric, m_FrameArenaAllocationMetric;
+#ifdef HEAP_COUNTING_ENABLED
+        uint32 m_HeapAllocationMetric;
+        uint64 m_LastHeapAllocationCount = 0;
 #endif
         const std::vector<const char*> m_RequiredExtensions, m_RequiredDeviceExtensions;
         VkInstance m_VulkanInstanceHandle;
         PhysicalDeviceInformation m_PhysicalDevice;
         QueueFamilyIndices m_QueueFamilyIndices;
         VkDevice m_LogicalDeviceHandle;
-        VkQueue m_GraphicsQueueHandle, m_PresentationQueueHandle;
-        VkSurfaceKHR m_SurfaceHandle;
-        VkSwapchainKHR m_SwapchainHandle;
-        VkRenderPass m_RenderPassHandle;
+        VkQueue m_GraphicsQueueHandle, m_PresentationQueueHandle, m_TransferQueueHandle;
+        VkSurfaceKHR m_SurfaceHandle = VK_NULL_HANDLE;
+        VkSwapchainKHR m_SwapchainHandle = VK_NULL_HANDLE;
+        VkRenderPass m_RenderPassHandle, m_DepthPrepassRenderPassHandle;
         std::vector<VkImage> m_SwapchainImageHandles;
         VkFormat m_SwapchainImageFormat;
         VkExtent2D m_SwapchainExtent;
         std::vector<VkImageView> m_SwapchainImageViewHandles;
-        VkShaderModule m_VertexShaderModuleHandle, m_FragmentShaderModuleHandle;
-        VkPipeline m_Pipeline;
-        VkPipelineLayout m_PipelineLayoutHandle;
+        rendering::PipelineRegistry m_PipelineRegistry;
+        VkPipeline m_Pipeline, m_DepthPrepassPipeline;
         std::vector<VkFramebuffer> m_SwapChainFramebufferHandles;
-        VkCommandPool m_CommandPoolHandle;
-        std::vector<VkCommandBuffer> m_CommandBufferHandles;
+        // A single depth buffer is enough, frames on the same queue are ordered by the render pass dependencies
+        VkImage m_DepthImageHandle = VK_NULL_HANDLE;
+        VkImageView m_DepthImageViewHandle = VK_NULL_HANDLE;
+        memory::DeviceAllocation m_DepthImageAllocation;
+        VkFramebuffer m_DepthPrepassFramebufferHandle = VK_NULL_HANDLE;
+        rendering::HiZPyramid m_HiZPyramid;
+        rendering::CommandRecorder m_CommandRecorder;
+        rendering::ChunkRenderer m_ChunkRenderer;
+        world::World m_World;
+        rendering::ChunkMeshingPipeline m_ChunkMeshingPipeline;
+        // Renderer chunk IDs of the meshes currently drawn
+        std::unordered_map<world::ChunkPosition, uint32, world::ChunkPositionHash> m_ChunkIds;
+        // Taken from the world every frame, kept to reuse its buckets
+        world::DirtySliceMap m_DirtySlices;
+        // Chunks dropped from the world this frame to stay within its memory budget
+        std::vector<world::ChunkPosition> m_EvictedChunkPositions;
+        // Written before recording starts each frame, recording threads only read it
+        math::Matrix4 m_ViewProjection;
         std::vector<VkSemaphore> m_ImageAvailableSemaphoreHandles, m_RenderFinishedSemaphoreHandles;
         std::vector<VkFence> m_InFlightFenceHandles;
+        // Temporaries of each frame in flight, reset once the frame's fence has signalled
+        memory::FrameArenas m_FrameArenas;
+        // Fence of the frame that last rendered into each swapchain image
+        std::vector<VkFence> m_ImageInFlightFenceHandles;
         size_t m_CurrentFrame = 0;
-        VkBuffer m_VertexBufferHandle;
-        VkDeviceMemory m_VertexBufferMemoryHandle;
+        uint64 m_FrameNumber = 0;
+        bool m_IsSwapchainOutOfDate = false;
+        std::vector<RetiredSwapchain> m_RetiredSwapchains;
+        memory::DeviceMemoryAllocator m_MemoryAllocator;
+        memory::UploadManager m_UploadManager;
+        std::vector<memory::DeviceAllocation> m_OffscreenImageAllocations;
+        std::vector<VkBuffer> m_ReadbackBufferHandles;
+        std::vector<memory::DeviceAllocation> m_ReadbackBufferAllocations;
+        profiling::GpuProfiler m_GpuProfiler;
+        uint32 m_CullGpuZone, m_DepthPrepassGpuZone, m_HiZBuildGpuZone, m_OcclusionCullGpuZone, m_RenderPassGpuZone, m_DrawGpuZone;
+        std::vector<std::optional<uint32>> m_ProfiledSlotsInFlight;
+
+        static std::vector<const char*> GetRequiredExtensions(bool isHeadless);
 
         void Draw() override;
 
@@ -86,28 +175,62 @@ namespace voxelfield::window {
 
         void CreateLogicalDevice();
 
+        void ConfigureFramePacing();
+
+        void BeginFramePacing();
+
+        /// Records the frame arena's usage, and the heap allocations since the last frame when they are counted, along with the trace
+        /// counters of the frame
+        void RecordFrameMemory();
+
         void RecreateSwapChain();
 
         void CreateSwapChain();
 
+        void ReleaseRetiredSwapChains(bool isForced);
+
+        VkExtent2D GetDrawableExtent(const VkSurfaceCapabilitiesKHR& surfaceCapabilities) const;
+
+        void CreateOffscreenTargets();
+
+        void ReleaseOffscreenTargets();
+
+        void CreateGpuProfiler();
+
+        void ResolveGpuProfilerSlot();
+
+        void WriteReadbackImage(size_t frameIndex);
+
         void CreateImageViews();
 
         void CreateGraphicsPipeline();
 
         void CreateRenderPass();
 
+        void CreateDepthResources();
+
         void CreateFramebuffers();
 
-        void CreateCommandPool();
+        void CreateTerrainChunks();
+
+        /// Schedules meshing of dirty chunks and uploads finished meshes within the frame's budget
+        void StreamChunks(const math::Vector3& cameraPosition);
+
+        VkCommandBuffer RecordFrameCommands(uint32 imageIndex);
 
-        void CreateVertexBuffer();
+        void RecordViewportAndScissor(VkCommandBuffer commandBufferHandle) const;
 
-        void CreateCommandBuffers();
+        void RecordDepthPrepass(VkCommandBuffer commandBufferHandle);
+
+        void RecordDraw(VkCommandBuffer commandBufferHandle);
 
         void CreateSynchronizationObjects();
 
         void DrawFrame();
 
-        VkShaderModule CreateShaderModule(const std::vector<char>& shaderSource);
+        void DrawOffscreenFrame();
+
+        void SubmitGraphicsCommandBuffer(VkCommandBuffer commandBufferHandle, VkSemaphore imageAvailableSemaphoreHandle,
+                                         VkSemaphore renderFinishedSemaphoreHandle, VkFence fenceHandle);
     };
 }
\ No newline at end of file
@@ -3,8 +3,10 @@
 #include <chrono>
 
 namespace voxelfield::window {
-    Window::Window(Application& application, const std::string& title) : m_Application(application) {
+    Window::Window(Application& application, const std::string& title, jobs::JobSystem& jobSystem)
+            : m_Application(application), m_JobSystem(jobSystem) {
         m_Title = title;
+#ifdef _WIN32
         m_WindowClass = {
                 sizeof(WindowClass),
                 CS_OWNDC,
@@ -18,12 +20,17 @@ namespace voxelfield::window {
                 application.GetName().c_str(),
                 nullptr
         };
+#endif
     }
 
     Window::~Window() {
-        DestroyWindow(m_Handle);
+#ifdef _WIN32
+        if (m_Handle) DestroyWindow(m_Handle);
+#endif
     }
 
+#ifdef _WIN32
+
     long long
     Window::WindowProcess(WindowHandle windowHandle, unsigned int message, unsigned long long messageParameter, long long longMessageParameter) {
 //        auto* meme = reinterpret_cast<Window*>(GetWindowLongPtr(windowHandle, GWLP_USERDATA));
@@ -82,13 +89,18 @@ namespace voxelfield::window {
     }
 
     void Window::Loop() {
+        using Clock = std::chrono::high_resolution_clock;
         WindowMessage message;
+        Clock::time_point frameStart = Clock::now();
         while (GetMessage(&message, m_Handle, 0, 0)) {
-            auto start = std::chrono::high_resolution_clock::now();
+            const Clock::time_point drawStart = Clock::now();
             Draw();
-            auto end = std::chrono::high_resolution_clock::now();
-            auto duration = std::chrono::duration<double, std::ratio<1, 1>>(end - start);
-            logging::Log(logging::LogType::INFORMATION_LOG, util::Format("Time: %f", MAX_MESSAGE_LENGTH, 1.0 / duration.count()));
+            const Clock::time_point drawEnd = Clock::now();
+            m_FrameStatistics.Record(profiling::CPU_TIME_METRIC, std::chrono::duration<double, std::milli>(drawEnd - drawStart).count());
+            m_FrameStatistics.Record(profiling::FRAME_TIME_METRIC, std::chrono::duration<double, std::milli>(drawEnd - frameStart).count());
+            m_FrameStatistics.EndFrame();
+            m_JobSystem.EndFrame();
+            frameStart = drawEnd;
             TranslateMessage(&message);
             DispatchMessage(&message);
             if (GetAsyncKeyState(VK_ESCAPE) & 0x8000) {
@@ -105,8 +117,21 @@ namespace voxelfield::window {
 //                s_FKeyStatus = 0;
 //            }
         }
+        m_FrameStatistics.LogSummary();
+        m_FrameStatistics.WriteCsv(FRAME_STATISTICS_FILE_NAME);
+        m_JobSystem.LogUtilization();
     }
 
+#else
+
+    void Window::Open() {
+        throw std::runtime_error("Windowed mode is only supported on Windows, run with --headless instead");
+    }
+
+    void Window::Loop() {}
+
+#endif
+
     void Window::SetFullscreen(bool isFullScreen) {
 
     }
@@ -1,17 +1,18 @@
 #pragma once
 
-#include <windows.h>
 #include <iostream>
 
 #include "windows_definitions.hpp"
 #include "type_definitions.hpp"
 #include "logger.hpp"
 #include "application.hpp"
+#include "frame_statistics.hpp"
+#include "job_system.hpp"
 
 namespace voxelfield::window {
     class Window {
     public:
-        Window(Application& application, const std::string& title);
+        Window(Application& application, const std::string& title, jobs::JobSystem& jobSystem);
 
         Window() = delete;
 
@@ -26,8 +27,10 @@ namespace voxelfield::window {
     protected:
         std::string m_Title;
         WindowClass m_WindowClass;
-        WindowHandle m_Handle;
+        WindowHandle m_Handle = nullptr;
         Application& m_Application;
+        jobs::JobSystem& m_JobSystem;
+        profiling::FrameStatistics m_FrameStatistics;
 
         static long long WindowProcess
                 (WindowHandle windowHandle, unsigned int message, unsigned long long messageParameter, long long longMessageParameter);
@@ -1,5 +1,7 @@
 #pragma once
 
+#ifdef _WIN32
+
 #include <windows.h>
 
 namespace voxelfield {
@@ -12,3 +14,14 @@ namespace voxelfield {
     typedef HINSTANCE ApplicationHandle;
     typedef PIXELFORMATDESCRIPTOR PixelFormatDescriptor;
 }
+
+#else
+
+// Stand-ins so headless builds compile on platforms without a windowing backend
+namespace voxelfield {
+    struct WindowClass {};
+    typedef void* WindowHandle;
+    typedef void* ApplicationHandle;
+}
+
+#endif
@@ -0,0 +1,120 @@
+#include "world.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace voxelfield::world {
+    namespace {
+        // Approximate cost of a map node beyond the chunk itself, the next pointer and the cached hash
+        constexpr size_t NODE_OVERHEAD = sizeof(void*) + sizeof(size_t);
+
+        size_t GetChunkFootprint(const Chunk& chunk) {
+            return sizeof(ChunkPosition) + sizeof(Chunk) + NODE_OVERHEAD + chunk.GetMemoryUsage();
+        }
+
+        int64_t GetDistanceSquared(const ChunkPosition& position, const ChunkPosition& center) {
+            const int64_t x = position.x - center.x, y = position.y - center.y, z = position.z - center.z;
+            return x * x + y * y + z * z;
+        }
+    }
+
+    World::World(const size_t memoryBudget) : m_MemoryBudget(memoryBudget) {}
+
+    Chunk& World::GetOrCreateChunk(const ChunkPosition& position, const BlockId fillBlock) {
+        return m_Chunks.try_emplace(position, fillBlock).first->second;
+    }
+
+    Chunk* World::GetChunk(const ChunkPosition& position) {
+        auto it = m_Chunks.find(position);
+        return it == m_Chunks.end() ? nullptr : &it->second;
+    }
+
+    const Chunk* World::GetChunk(const ChunkPosition& position) const {
+        auto it = m_Chunks.find(position);
+        return it == m_Chunks.end() ? nullptr : &it->second;
+    }
+
+    bool World::RemoveChunk(const ChunkPosition& position) {
+        m_DirtySlices.erase(position);
+        return m_Chunks.erase(position) > 0;
+    }
+
+    BlockId World::GetBlock(const int32 x, const int32 y, const int32 z) const {
+        const Chunk* chunk = GetChunk(GetChunkPosition(x, y, z));
+        if (!chunk) return AIR_BLOCK;
+        constexpr int32 localMask = CHUNK_SIZE - 1;
+        return chunk->GetBlock(x & localMask, y & localMask, z & localMask);
+    }
+
+    void World::SetBlock(const int32 x, const int32 y, const int32 z, const BlockId block) {
+        constexpr int32 localMask = CHUNK_SIZE - 1;
+        GetOrCreateChunk(GetChunkPosition(x, y, z)).SetBlock(x & localMask, y & localMask, z & localMask, block);
+    }
+
+    bool World::EditBlock(const int32 x, const int32 y, const int32 z, const BlockId block) {
+        constexpr int32 localMask = CHUNK_SIZE - 1;
+        const ChunkPosition position = GetChunkPosition(x, y, z);
+        const uint32 local[3] = {static_cast<uint32>(x & localMask), static_cast<uint32>(y & localMask), static_cast<uint32>(z & localMask)};
+        Chunk& chunk = GetOrCreateChunk(position);
+        if (chunk.GetBlock(local[0], local[1], local[2]) == block) return false;
+        chunk.SetBlock(local[0], local[1], local[2], block);
+        DirtySlices& slices = m_DirtySlices[position];
+        for (uint32 axis = 0; axis < 3; axis++) {
+            // Faces of the edited layer and of the layers on either side of it depend on the block
+            slices.layers[axis] |= static_cast<uint32>(7ull << local[axis] >> 1);
+            // Neighbours only see the block through their layer that touches it
+            if (local[axis] == 0 || local[axis] == CHUNK_SIZE - 1) {
+                ChunkPosition neighbour = position;
+                int32* coordinate = axis == 0 ? &neighbour.x : axis == 1 ? &neighbour.y : &neighbour.z;
+                *coordinate += local[axis] == 0 ? -1 : 1;
+                if (GetChunk(neighbour))
+                    m_DirtySlices[neighbour].layers[axis] |= local[axis] == 0 ? 1u << (CHUNK_SIZE - 1) : 1u;
+            }
+        }
+        return true;
+    }
+
+    void World::TakeDirtySlices(DirtySliceMap& dirtySlices) {
+        dirtySlices.clear();
+        dirtySlices.swap(m_DirtySlices);
+    }
+
+    size_t World::EvictFurthestChunks(const ChunkPosition& center, std::vector<ChunkPosition>& evictedPositions) {
+        size_t memoryUsage = GetMemoryUsage();
+        if (memoryUsage <= m_MemoryBudget) return 0;
+        std::vector<std::pair<int64_t, ChunkPosition>> chunksByDistance;
+        chunksByDistance.reserve(m_Chunks.size());
+        for (const auto& [position, chunk] : m_Chunks)
+            chunksByDistance.emplace_back(GetDistanceSquared(position, center), position);
+        std::sort(chunksByDistance.begin(), chunksByDistance.end(),
+                  [](const auto& first, const auto& second) { return first.first > second.first; });
+        size_t evictedCount = 0;
+        for (const auto& [distanceSquared, position] : chunksByDistance) {
+            if (memoryUsage <= m_MemoryBudget) break;
+            auto it = m_Chunks.find(position);
+            memoryUsage -= GetChunkFootprint(it->second);
+            m_Chunks.erase(it);
+            m_DirtySlices.erase(position);
+            for (uint32 axis = 0; axis < 3; axis++) {
+                for (const int32 direction : {-1, 1}) {
+                    ChunkPosition neighbour = position;
+                    int32* coordinate = axis == 0 ? &neighbour.x : axis == 1 ? &neighbour.y : &neighbour.z;
+                    *coordinate += direction;
+                    // The neighbour's layer that touched the evicted chunk now borders air
+                    if (GetChunk(neighbour))
+                        m_DirtySlices[neighbour].layers[axis] |= direction < 0 ? 1u << (CHUNK_SIZE - 1) : 1u;
+                }
+            }
+            evictedPositions.push_back(position);
+            evictedCount++;
+        }
+        return evictedCount;
+    }
+
+    size_t World::GetMemoryUsage() const {
+        size_t memoryUsage = m_Chunks.bucket_count() * sizeof(void*);
+        for (const auto& [position, chunk] : m_Chunks)
+            memoryUsage += GetChunkFootprint(chunk);
+        return memoryUsage;
+    }
+}
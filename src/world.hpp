@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+#include "chunk.hpp"
+
+// Heap memory the resident chunks may hold before the furthest ones are evicted
+#define WORLD_MEMORY_BUDGET (512ull * 1024 * 1024)
+
+namespace voxelfield::world {
+    struct ChunkPosition {
+        int32 x, y, z;
+
+        bool operator==(const ChunkPosition& other) const {
+            return x == other.x && y == other.y && z == other.z;
+        }
+    };
+
+    struct ChunkPositionHash {
+        size_t operator()(const ChunkPosition& position) const {
+            // Large primes spread neighbouring positions over the buckets
+            return static_cast<size_t>(position.x) * 73856093u ^ static_cast<size_t>(position.y) * 19349663u
+                   ^ static_cast<size_t>(position.z) * 83492791u;
+        }
+    };
+
+    /// Layers along each axis whose faces have to be rebuilt after edits, bit n standing for layer n. Faces are meshed per layer,
+    /// so this is all a remesh needs to know.
+    struct DirtySlices {
+        std::array<uint32, 3> layers{};
+
+        void Merge(const DirtySlices& other) {
+            for (uint32 axis = 0; axis < 3; axis++) layers[axis] |= other.layers[axis];
+        }
+
+        bool IsFull() const {
+            return layers[0] == UINT32_MAX && layers[1] == UINT32_MAX && layers[2] == UINT32_MAX;
+        }
+
+        static DirtySlices Full() {
+            return {{UINT32_MAX, UINT32_MAX, UINT32_MAX}};
+        }
+    };
+
+    typedef std::unordered_map<ChunkPosition, DirtySlices, ChunkPositionHash> DirtySliceMap;
+
+    /// Resident chunks of the world keyed by chunk position. Chunks are stored in the map nodes themselves, so references to them
+    /// stay valid until that chunk is removed.
+    class World {
+    public:
+        explicit World(size_t memoryBudget = WORLD_MEMORY_BUDGET);
+
+        Chunk& GetOrCreateChunk(const ChunkPosition& position, BlockId fillBlock = AIR_BLOCK);
+
+        /// Returns null when the chunk is not resident
+        Chunk* GetChunk(const ChunkPosition& position);
+
+        const Chunk* GetChunk(const ChunkPosition& position) const;
+
+        bool RemoveChunk(const ChunkPosition& position);
+
+        /// Blocks of chunks that are not resident read as air
+        BlockId GetBlock(int32 x, int32 y, int32 z) const;
+
+        void SetBlock(int32 x, int32 y, int32 z, BlockId block);
+
+        /// Sets a block like SetBlock and records the slices it dirties, in neighbouring chunks too when it lies on their border.
+        /// For changes to chunks that are already meshed. Returns false when the block was already there.
+        bool EditBlock(int32 x, int32 y, int32 z, BlockId block);
+
+        /// Moves the slices dirtied since the last call into the map, replacing its contents
+        void TakeDirtySlices(DirtySliceMap& dirtySlices);
+
+        /// Removes the chunks furthest from the center until the world fits its memory budget and appends their positions, returns how
+        /// many were removed. Resident neighbours of removed chunks get their bordering slices dirtied, as those faces are now exposed.
+        size_t EvictFurthestChunks(const ChunkPosition& center, std::vector<ChunkPosition>& evictedPositions);
+
+        size_t GetChunkCount() const {
+            return m_Chunks.size();
+        }
+
+        size_t GetMemoryBudget() const {
+            return m_MemoryBudget;
+        }
+
+        /// Sum of the chunk storage and the map that indexes it
+        size_t GetMemoryUsage() const;
+
+        static ChunkPosition GetChunkPosition(const int32 x, const int32 y, const int32 z) {
+            // Arithmetic shift rounds towards negative infinity, which keeps negative coordinates in the right chunk
+            return {x >> CHUNK_SIZE_BITS, y >> CHUNK_SIZE_BITS, z >> CHUNK_SIZE_BITS};
+        }
+
+    private:
+        std::unordered_map<ChunkPosition, Chunk, ChunkPositionHash> m_Chunks;
+        DirtySliceMap m_DirtySlices;
+        size_t m_MemoryBudget;
+    };
+}